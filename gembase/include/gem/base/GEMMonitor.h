@@ -88,12 +88,12 @@ namespace gem {
         /**
          * Pause the monitoring
          */
-        void pauseMonitoring();
+        virtual void pauseMonitoring();
 
         /**
-         * Pause the monitoring
+         * Resume the monitoring
          */
-        void resumeMonitoring();
+        virtual void resumeMonitoring();
 
         /**
          * Stop the monitoring
@@ -160,7 +160,8 @@ namespace gem {
         /**
          * A way to get the formatted information from the items in the set
          * @param setname the name of the set for which to print the information
-         * @returns a list of name, value, regname, docstring values for each item in the set
+         * @returns a list of name, value, regname, docstring values for each item in the set,
+         *          "raw/rate" counters give their count and add one entry per rate item
          */
         std::list<std::vector<std::string> > getFormattedItemSet(std::string const& setname);
 
@@ -195,6 +195,15 @@ namespace gem {
          */
         std::string getFormattedItem(std::string const& itemName, std::string const& format);
 
+        /**
+         * Name of the item holding the rate of a counter item, for the "raw/rate" format
+         * @param itemName is the name of the counter item in the info space
+         * @param average selects the moving average rather than the rate over the last interval
+         * @returns the name of the DOUBLE item with the rate in Hz, filled by the hardware monitoring
+         */
+        static std::string getRateItemName(std::string const& itemName, bool const average=false)
+        { return itemName + (average ? "_RATE_AVG" : "_RATE"); };
+
         /**
          * Print the docstring associated with the infospace item
          * @param itemName is the name of the item in the info space
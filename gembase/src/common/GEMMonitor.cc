@@ -265,7 +265,8 @@ std::list<std::vector<std::string> > gem::base::GEMMonitor::getFormattedItemSet(
     auto gemItem = item->second;
     std::vector<std::string> itl;
     auto gemIS = gemItem.infoSpace;
-    std::string val = gemIS->getFormattedItem(gemItem.name, gemItem.format);
+    // the rates of a counter follow as their own items, the count is sent alone
+    std::string val = gemIS->getFormattedItem(gemItem.name, gemItem.format == "raw/rate" ? "dec" : gemItem.format);
     std::string doc = gemIS->getItemDocstring(gemItem.name);
     itl.push_back(gemItem.name);
     itl.push_back(val);
@@ -277,6 +278,21 @@ std::list<std::vector<std::string> > gem::base::GEMMonitor::getFormattedItemSet(
           << " val: "     << itl.at(1)
           << " doc: "     << itl.at(2)
           << " regname: " << itl.at(3));
+
+    // counters publish their rates in companion items, filled by the hardware monitoring
+    if (gemItem.format == "raw/rate") {
+      for (int average = 0; average < 2; ++average) {
+        std::string const rateName = utils::GEMInfoSpaceToolBox::getRateItemName(gemItem.name, average);
+        if (!gemIS->find(rateName))
+          continue;
+        std::vector<std::string> rtl;
+        rtl.push_back(rateName);
+        rtl.push_back(gemIS->getFormattedItem(rateName, "rate"));
+        rtl.push_back(gemIS->getItemDocstring(rateName));
+        rtl.push_back(gemItem.regname);
+        result.push_back(rtl);
+      }
+    }
   }
   return result;
 }
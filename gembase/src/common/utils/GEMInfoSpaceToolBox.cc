@@ -1,5 +1,8 @@
 #include "gem/base/utils/GEMInfoSpaceToolBox.h"
 
+#include <iomanip>
+#include <sstream>
+
 #include "toolbox/string.h"
 
 #include "xdaq/ApplicationStub.h"
@@ -7,6 +10,22 @@
 #include "gem/base/GEMApplication.h"
 #include "gem/utils/GEMRegisterUtils.h"
 
+namespace {
+  // rate in Hz with a unit prefix, e.g., "100.0 kHz"
+  std::string formatRate(double const rate)
+  {
+    std::stringstream os;
+    os << std::fixed << std::setprecision(1);
+    if (rate >= 1e6)
+      os << rate/1e6 << " MHz";
+    else if (rate >= 1e3)
+      os << rate/1e3 << " kHz";
+    else
+      os << rate << " Hz";
+    return os.str();
+  }
+}
+
 gem::base::utils::GEMInfoSpaceToolBox::GEMInfoSpaceToolBox(gem::base::GEMApplication* gemApp,
                                                            xdata::InfoSpace* infoSpace,
                                                            // gem::base::GEMMonitor* gemMonitor,
@@ -939,7 +958,9 @@ std::string gem::base::utils::GEMInfoSpaceToolBox::getFormattedItem(std::string
       result << "0x" << std::setw(8) << std::setfill('0') << std::hex
              << val << " / " << std::dec << val;
     } else if ( format == "raw/rate" ) {  // for a counter, get the raw count, plus the rate
-      result << "0x" << std::setw(8) << std::setfill('0') << std::hex << val;
+      result << std::dec << val;
+      if (this->find(getRateItemName(itemName, true)))
+        result << " / " << formatRate(this->getDouble(getRateItemName(itemName, true)));
     } else if ( format == "ip" ) {
       result << std::dec << gem::utils::uint32ToDottedQuad(val);
     } else if ( format == "id" ) {
@@ -1001,9 +1022,22 @@ std::string gem::base::utils::GEMInfoSpaceToolBox::getFormattedItem(std::string
              << val << " / " << std::dec << val;
     } else if ( format == "mac" ) {
       result << gem::utils::uint32ToGroupedHex((val>>32), val&(uint32_t)0xffffffff);
+    } else if ( format == "raw/rate" ) {
+      result << std::dec << val;
+      if (this->find(getRateItemName(itemName, true)))
+        result << " / " << formatRate(this->getDouble(getRateItemName(itemName, true)));
+    }
+
+  } else if (type == DOUBLE) {  // end of type == UINT64
+    double val = this->getDouble(itemName);
+    CMSGEMOS_DEBUG(itemName << " has value " << val);
+    if ( format == "rate" ) {
+      result << formatRate(val);
+    } else {
+      result << val;
     }
 
-  } else if (type == STRING) {  // end of type == UINT64
+  } else if (type == STRING) {  // end of type == DOUBLE
     std::string val = this->getString(itemName);
     CMSGEMOS_DEBUG(itemName << " has value " << val);
     if ( format == "" ) {
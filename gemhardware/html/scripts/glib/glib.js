@@ -37,7 +37,10 @@ function updateGLIBMonitorables( glibjson )
         for ( var monitem in monitorset ) {
             var arr = monitorset[monitem];
             for( var i = 0; i < arr.length; ++i ) {
-                document.getElementById( arr[i].name ).innerHTML = arr[i].value;
+                // not every item has a cell, e.g., the instantaneous rates of the counters
+                var cell = document.getElementById( arr[i].name );
+                if ( cell )
+                    cell.innerHTML = arr[i].value;
             }
         }
     }
@@ -0,0 +1,73 @@
+/** @file GEMHwAddressTable.h */
+
+#ifndef GEM_HW_GEMHWADDRESSTABLE_H
+#define GEM_HW_GEMHWADDRESSTABLE_H
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "uhal/uhal.hpp"
+
+namespace gem {
+  namespace hw {
+
+    /**
+     * @brief Flat view of a uhal address table, every node by its full name
+     * @details Built once from the node tree of a uhal device, for the users that only need names
+     *          and addresses, e.g., the emulated boards
+     */
+    class GEMHwAddressTable
+      {
+      public:
+        /**
+         * @struct Register
+         * @brief Properties of one node of the address table
+         * @var Register::Address
+         * Address is the full address of the node
+         * @var Register::Mask
+         * Mask is the bit mask of the node in its 32-bit word
+         * @var Register::Size
+         * Size is the number of 32-bit words of the node, 1 for single registers
+         * @var Register::Permission
+         * Permission is the uhal::defs::NodePermission of the node
+         * @var Register::Mode
+         * Mode is the uhal::defs::BlockReadWriteMode of the node
+         */
+        typedef struct Register {
+          uint32_t Address;
+          uint32_t Mask;
+          uint32_t Size;
+          uint8_t  Permission;
+          uint8_t  Mode;
+
+        Register() : Address(0), Mask(0), Size(0), Permission(0), Mode(0) {};
+        } Register;
+
+        typedef std::unordered_map<std::string, Register> register_map;
+
+        GEMHwAddressTable();
+
+        /**
+         * @brief flatten the node tree of a uhal device
+         */
+        explicit GEMHwAddressTable(uhal::HwInterface const& device);
+
+        /**
+         * @retval the register, or nullptr if there is no node with this name
+         */
+        Register const* find(std::string const& regName) const;
+
+        size_t size() const { return m_registers.size(); };
+
+        register_map const& getRegisters() const { return m_registers; };
+
+      private:
+        register_map m_registers;
+      };
+
+  }  // namespace gem::hw
+}  // namespace gem
+
+#endif  // GEM_HW_GEMHWADDRESSTABLE_H
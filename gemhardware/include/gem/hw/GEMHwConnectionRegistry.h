@@ -0,0 +1,68 @@
+/** @file GEMHwConnectionRegistry.h */
+
+#ifndef GEM_HW_GEMHWCONNECTIONREGISTRY_H
+#define GEM_HW_GEMHWCONNECTIONREGISTRY_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "uhal/uhal.hpp"
+
+#include "gem/utils/GEMLogging.h"
+
+namespace gem {
+  namespace hw {
+
+    /**
+     * @brief Process-wide registry of the uhal connection files
+     * @details Every GEMHwDevice created from a connection file used to build its own
+     *          uhal::ConnectionManager, parsing the connection file again for each of the devices of
+     *          the crate. The registry keeps one manager per connection file and serializes the
+     *          creation of devices, which uhal does not protect.
+     *          The managers are kept until clear() is called, the applications do so in their
+     *          resetAction so that the next Initialize reads the connection files again.
+     */
+    class GEMHwConnectionRegistry
+      {
+      public:
+        static GEMHwConnectionRegistry& getInstance();
+
+        /**
+         * @brief a device from a connection file, the file is parsed on first use only
+         *
+         * @param deviceName id of the device in the connection file
+         * @param connectionFile uhal file expression of the connection file
+         */
+        uhal::HwInterface getDevice(std::string const& deviceName, std::string const& connectionFile);
+
+        /**
+         * @brief a device from a URI and an address table, see uhal::ConnectionManager::getDevice
+         */
+        uhal::HwInterface getDevice(std::string const& deviceName,
+                                    std::string const& connectionURI,
+                                    std::string const& addressTable);
+
+        /**
+         * @brief drop all connection managers, devices already created are unaffected
+         */
+        void clear();
+
+      private:
+        GEMHwConnectionRegistry();
+
+        log4cplus::Logger m_gemLogger;
+
+        mutable std::mutex m_mutex;  ///< guards the map, and all uhal device creation
+        std::map<std::string, std::shared_ptr<uhal::ConnectionManager> > m_managers;
+
+        // Prevent copying
+        GEMHwConnectionRegistry(GEMHwConnectionRegistry const&);
+        GEMHwConnectionRegistry& operator=(GEMHwConnectionRegistry const&);
+      };
+
+  }  // namespace gem::hw
+}  // namespace gem
+
+#endif  // GEM_HW_GEMHWCONNECTIONREGISTRY_H
@@ -0,0 +1,147 @@
+/** @file GEMHwCounterSnapshot.h */
+
+#ifndef GEM_HW_GEMHWCOUNTERSNAPSHOT_H
+#define GEM_HW_GEMHWCOUNTERSNAPSHOT_H
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "gem/hw/GEMHwDevice.h"
+#include "gem/hw/utils/GEMCounterRate.h"
+
+namespace gem {
+  namespace hw {
+
+    class GEMHwTransaction;
+
+    /**
+     * @brief Counters of one board latched together, with their rates
+     * @details All counters are read in the same transaction, and the whole set gets one timestamp,
+     *          the middle of the dispatch, so that the rates of different counters of a board are
+     *          computed over the same interval. The rates are kept per counter by GEMCounterRate,
+     *          which handles the wrap around of the 32-bit counters.
+     *          The reads can be queued into a transaction that also reads other registers, with read()
+     *          and then update() once it is committed, or done on their own with latch(). Values read
+     *          by someone else are passed with set() before update().
+     *
+     * @usage
+     *   gem::hw::GEMHwCounterSnapshot counters;
+     *   counters.addCounter("L1A", amc->resolve("GEM_AMC.TTC.CMD_COUNTERS.L1A"));
+     *   counters.latch(*amc);  // every monitoring cycle
+     *   double l1aRate = counters.getCounter("L1A").Rate.getAverageRate();
+     */
+    class GEMHwCounterSnapshot
+      {
+      public:
+        /**
+         * @struct Counter
+         * @brief One latched counter
+         * @var Counter::Name
+         * Name is the name the counter was added with
+         * @var Counter::Lower
+         * Lower is the register of the counter, of its lower 32 bits for a 64-bit counter
+         * @var Counter::Upper
+         * Upper is the register of the upper 32 bits of a 64-bit counter, unresolved otherwise
+         * @var Counter::LowerVal
+         * LowerVal is the value of Lower in the last snapshot
+         * @var Counter::UpperVal
+         * UpperVal is the value of Upper in the last snapshot
+         * @var Counter::Rate
+         * Rate holds the instantaneous and averaged rates
+         */
+        typedef struct Counter {
+          std::string                    Name;
+          GEMHwDevice::RegHandle         Lower;
+          GEMHwDevice::RegHandle         Upper;
+          uint32_t                       LowerVal;
+          uint32_t                       UpperVal;
+          gem::hw::utils::GEMCounterRate Rate;
+
+          bool is64() const { return Upper.node != NULL; };
+
+          uint64_t value() const { return is64() ? ((((uint64_t)UpperVal) << 32) + LowerVal) : LowerVal; };
+
+        Counter() : LowerVal(0), UpperVal(0) {};
+        } Counter;
+
+        /**
+         * @param timeConstant of the moving average of the rates, in seconds
+         */
+        explicit GEMHwCounterSnapshot(double const timeConstant=10.);
+
+        /**
+         * @brief add a 32-bit counter
+         * @retval the index of the counter
+         */
+        size_t addCounter(std::string const& name, GEMHwDevice::RegHandle const& reg);
+
+        /**
+         * @brief add a 64-bit counter made of two registers
+         * @retval the index of the counter
+         */
+        size_t addCounter(std::string const& name, GEMHwDevice::RegHandle const& lower,
+                          GEMHwDevice::RegHandle const& upper);
+
+        /**
+         * @brief queue the reads of all counters in a transaction, call update() after it is committed
+         */
+        void read(GEMHwTransaction& trans);
+
+        /**
+         * @brief set the values of a counter read elsewhere, e.g., from a GEMHwMonitorCache,
+         *        call update() once all counters are set
+         */
+        void set(size_t const index, uint32_t const lowerVal, uint32_t const upperVal=0);
+
+        /**
+         * @brief update the rates from the values read by the last committed transaction
+         * @param timestamp the time of the reading
+         */
+        void update(gem::hw::utils::GEMCounterRate::clock::time_point const& timestamp);
+
+        /**
+         * @brief read all counters in one transaction and update the rates
+         * @details uses the I/O thread of the device if it has one, at monitoring priority
+         * @throws gem::hw::exception::HardwareProblem if the read fails, the previous snapshot is kept
+         */
+        void latch(GEMHwDevice& device);
+
+        std::vector<Counter> const& getCounters() const { return m_counters; };
+
+        Counter const& getCounter(size_t const index) const { return m_counters.at(index); };
+
+        /**
+         * @throws gem::hw::exception::HardwareProblem if there is no counter with that name
+         */
+        Counter const& getCounter(std::string const& name) const;
+
+        bool hasCounter(std::string const& name) const { return m_index.find(name) != m_index.end(); };
+
+        /**
+         * @retval the time of the last snapshot
+         */
+        gem::hw::utils::GEMCounterRate::clock::time_point getTimestamp() const { return m_timestamp; };
+
+        size_t size() const { return m_counters.size(); };
+
+        /**
+         * @brief forget the readings of all counters, e.g., after the counters were reset
+         */
+        void resetRates();
+
+        void clear();
+
+      private:
+        double m_timeConstant;
+
+        std::vector<Counter> m_counters;
+        std::unordered_map<std::string, size_t> m_index;
+        gem::hw::utils::GEMCounterRate::clock::time_point m_timestamp;
+      };
+
+  }  // namespace gem::hw
+}  // namespace gem
+
+#endif  // GEM_HW_GEMHWCOUNTERSNAPSHOT_H
@@ -0,0 +1,155 @@
+/** @file GEMHwCrateLinkHealth.h */
+
+#ifndef GEM_HW_GEMHWCRATELINKHEALTH_H
+#define GEM_HW_GEMHWCRATELINKHEALTH_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gem/hw/GEMHwTaskGroup.h"
+#include "gem/hw/HwGenericAMC.h"
+
+namespace gem {
+  namespace hw {
+
+    /**
+     * @brief Checks the OptoHybrid links and the PLL lock of all AMCs of a crate concurrently
+     * @details check() runs one task per AMC on a GEMHwTaskGroup. Each task optionally resets the
+     *          link counters, reads the counters of the requested links, samples the PLL lock status
+     *          at regular intervals while the links run for the settle time, and reads the counters
+     *          again. The errors of
+     *          a link are the increments over that interval, so the result does not depend on what
+     *          accumulated before, and the wrap around of the counters is handled. All AMCs wait the
+     *          settle time at the same time, so checking a crate takes about as long as one AMC.
+     *
+     * @usage
+     *   gem::hw::GEMHwCrateLinkHealth linkHealth;
+     *   linkHealth.addAMC(2, amc02, 0xfff);
+     *   auto results = linkHealth.check(true);
+     *   CMSGEMOS_INFO(gem::hw::GEMHwCrateLinkHealth::summary(results));
+     */
+    class GEMHwCrateLinkHealth
+      {
+      public:
+        typedef std::shared_ptr<HwGenericAMC> amc_shared_ptr;
+
+        static const uint32_t DEFAULT_PLL_SAMPLES = 100;
+        static const uint32_t DEFAULT_SETTLE_MSEC = 100;
+
+        /**
+         * @struct LinkResult
+         * @brief Health of one OptoHybrid link over the settle time
+         * @var LinkResult::Link
+         * Link is the number of the OptoHybrid link
+         * @var LinkResult::Healthy
+         * Healthy is true if the link had no tracking or trigger errors
+         * @var LinkResult::TrackingErrors
+         * TrackingErrors is the number of tracking link errors over the settle time
+         * @var LinkResult::TriggerErrors
+         * TriggerErrors is the number of trigger link errors over the settle time
+         * @var LinkResult::DataPackets
+         * DataPackets is the number of VFAT blocks received over the settle time
+         */
+        typedef struct LinkResult {
+          uint8_t  Link;
+          bool     Healthy;
+          uint32_t TrackingErrors;
+          uint32_t TriggerErrors;
+          uint32_t DataPackets;
+
+        LinkResult() : Link(0), Healthy(false), TrackingErrors(0), TriggerErrors(0), DataPackets(0) {};
+        } LinkResult;
+
+        /**
+         * @struct AMCResult
+         * @brief Outcome of the check of one AMC
+         * @var AMCResult::Slot
+         * Slot is the slot of the AMC
+         * @var AMCResult::Succeeded
+         * Succeeded is false if the AMC could not be checked, see Error
+         * @var AMCResult::Error
+         * Error is the reason the check failed
+         * @var AMCResult::PLLSamples
+         * PLLSamples is the number of samples of the PLL lock status
+         * @var AMCResult::PLLLocked
+         * PLLLocked is the number of samples that found the PLL locked
+         * @var AMCResult::DurationUsec
+         * DurationUsec is the time the check of the AMC took
+         * @var AMCResult::Links
+         * Links are the results of the requested links that are active
+         */
+        typedef struct AMCResult {
+          int                     Slot;
+          bool                    Succeeded;
+          std::string             Error;
+          uint32_t                PLLSamples;
+          uint32_t                PLLLocked;
+          uint64_t                DurationUsec;
+          std::vector<LinkResult> Links;
+
+          /**
+           * @retval whether the AMC was checked, its PLL stayed locked and all its links are healthy
+           */
+          bool healthy() const;
+
+        AMCResult() : Slot(0), Succeeded(false), PLLSamples(0), PLLLocked(0), DurationUsec(0) {};
+        } AMCResult;
+
+        /**
+         * @param maxWorkers maximum number of AMCs checked at the same time
+         */
+        explicit GEMHwCrateLinkHealth(size_t const maxWorkers=GEMHwTaskGroup::DEFAULT_MAX_WORKERS);
+
+        /**
+         * @brief check the links in the mask of the AMC in a slot, replacing the AMC already there
+         */
+        void addAMC(int const slot, amc_shared_ptr amc, uint32_t const linkMask);
+
+        void clear();
+
+        bool empty() const;
+
+        /**
+         * @brief check all AMCs
+         * @param resetCounters reset the link counters of every AMC first
+         * @param pllSamples number of samples of the PLL lock status per AMC, spread over settleMsec
+         * @param settleMsec time over which the link errors are counted
+         * @retval one result per AMC, by increasing slot
+         */
+        std::vector<AMCResult> check(bool const resetCounters,
+                                     uint32_t const pllSamples=DEFAULT_PLL_SAMPLES,
+                                     uint32_t const settleMsec=DEFAULT_SETTLE_MSEC);
+
+        /**
+         * @retval one line per AMC and one per unhealthy link, for the logs
+         */
+        static std::string summary(std::vector<AMCResult> const& results);
+
+        /**
+         * @brief the results as a JSON array
+         */
+        static void printJSON(std::ostream& out, std::vector<AMCResult> const& results);
+
+      private:
+        static void checkAMC(amc_shared_ptr amc, uint32_t const linkMask, bool const resetCounters,
+                             uint32_t const pllSamples, uint32_t const settleMsec, AMCResult& result);
+
+        size_t m_maxWorkers;
+
+        mutable std::mutex m_mutex;  ///< guards m_amcs
+        std::map<int, std::pair<amc_shared_ptr, uint32_t> > m_amcs;  ///< AMC and link mask, by slot
+
+        // Prevent copying
+        GEMHwCrateLinkHealth(GEMHwCrateLinkHealth const&);
+        GEMHwCrateLinkHealth& operator=(GEMHwCrateLinkHealth const&);
+      };
+
+  }  // namespace gem::hw
+}  // namespace gem
+
+#endif  // GEM_HW_GEMHWCRATELINKHEALTH_H
@@ -0,0 +1,96 @@
+/** @file GEMHwCrateTriggerRates.h */
+
+#ifndef GEM_HW_GEMHWCRATETRIGGERRATES_H
+#define GEM_HW_GEMHWCRATETRIGGERRATES_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+#include "gem/hw/GEMHwTaskGroup.h"
+#include "gem/hw/HwGenericAMC.h"
+
+namespace gem {
+  namespace hw {
+
+    /**
+     * @brief Trigger and cluster rates of all AMCs of a crate
+     * @details poll() reads HwGenericAMC::getTriggerRates of every AMC concurrently with a
+     *          GEMHwTaskGroup, so that refreshing the whole crate costs about one IPbus round trip.
+     *          An AMC that cannot be read keeps its previous rates, and the error is reported until
+     *          the next successful poll. Concurrent polls are serialized, the results can be read
+     *          from any thread.
+     *
+     * @usage
+     *   gem::hw::GEMHwCrateTriggerRates crateRates;
+     *   crateRates.addAMC(2, amc02);
+     *   crateRates.poll();
+     *   crateRates.printJSON(*out);
+     */
+    class GEMHwCrateTriggerRates
+      {
+      public:
+        typedef std::shared_ptr<HwGenericAMC> amc_shared_ptr;
+
+        /**
+         * @param maxWorkers maximum number of AMCs read at the same time
+         */
+        explicit GEMHwCrateTriggerRates(size_t const maxWorkers=GEMHwTaskGroup::DEFAULT_MAX_WORKERS);
+
+        /**
+         * @brief poll the AMC in a slot, replacing the AMC already there
+         */
+        void addAMC(int const slot, amc_shared_ptr amc);
+
+        void clear();
+
+        bool empty() const;
+
+        /**
+         * @brief read the rates of all AMCs
+         * @param withCounts also read the trigger and cluster counts
+         * @retval false if any AMC could not be read
+         */
+        bool poll(bool const withCounts=false);
+
+        /**
+         * @retval the rates of every AMC that was read at least once, by slot
+         */
+        std::map<int, HwGenericAMC::AMCTriggerRates> getRates() const;
+
+        /**
+         * @retval the error of every AMC that failed in the last poll, by slot
+         */
+        std::map<int, std::string> getErrors() const;
+
+        /**
+         * @retval the sum of the OR trigger rates of the AMCs
+         */
+        uint64_t getCrateTriggerRate() const;
+
+        /**
+         * @brief the rates of all AMCs, as a JSON object
+         */
+        void printJSON(std::ostream& out) const;
+
+      private:
+        size_t m_maxWorkers;
+
+        std::mutex m_pollMutex;     ///< serializes the polls
+        mutable std::mutex m_mutex;  ///< guards the members below
+        std::map<int, amc_shared_ptr>                m_amcs;
+        std::map<int, HwGenericAMC::AMCTriggerRates> m_rates;
+        std::map<int, std::string>                   m_errors;
+        uint64_t                                     m_pollUsec;  ///< duration of the last poll
+
+        // Prevent copying
+        GEMHwCrateTriggerRates(GEMHwCrateTriggerRates const&);
+        GEMHwCrateTriggerRates& operator=(GEMHwCrateTriggerRates const&);
+      };
+
+  }  // namespace gem::hw
+}  // namespace gem
+
+#endif  // GEM_HW_GEMHWCRATETRIGGERRATES_H
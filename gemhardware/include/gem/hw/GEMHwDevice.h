@@ -5,6 +5,8 @@
 
 #include <iomanip>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 /* #include "xdata/String.h" */
 /* #include "xdata/UnsignedLong.h" */
@@ -24,6 +26,10 @@
 
 #include "gem/hw/utils/GEMCrateUtils.h"
 #include "gem/hw/exception/Exception.h"
+#include "gem/hw/GEMHwExecutor.h"
+#include "gem/hw/GEMHwProfiler.h"
+#include "gem/hw/GEMHwRetryPolicy.h"
+#include "gem/hw/GEMHwShadow.h"
 
 /// TODO: would be good to decouple from utils, maybe migrate RegisterUtils to gem::hw::utils
 #include "gem/utils/GEMLogging.h"
@@ -61,15 +67,18 @@ typedef std::vector<register_value>                      register_val_list;
 namespace gem {
   namespace hw {
 
+    class GEMHwTransaction;
+
     class GEMHwDevice : public xhal::XHALInterface, public uhal::HwInterface
     {
+      friend class GEMHwTransaction;
 
     public:
       /* IPBus transactions still have some problems in the firmware
          so it helps to retry a few times in the case of a failure
-         that is recognized
+         that is recognized, see GEMHwRetryPolicy
       */
-      static const unsigned MAX_IPBUS_RETRIES = 5;
+      static const unsigned MAX_IPBUS_RETRIES = GEMHwRetryPolicy::DEFAULT_MAX_ATTEMPTS;
 
       /** TODO: REMOVE
        * @struct OpticalLinkStatus
@@ -130,6 +139,33 @@ namespace gem {
         void reset() { BadHeader=0; ReadError=0; Timeout=0; ControlHubErr=0; return; };
       } DeviceErrors;
 
+      /**
+       * @struct RegHandle
+       * @brief A register resolved once in the address table, see resolve()
+       * @var RegHandle::name
+       * name is the full path of the register in the address table
+       * @var RegHandle::node
+       * node is the resolved uhal::Node, owned by the uhal::HwInterface
+       * @var RegHandle::address
+       * address is the address of the register
+       * @var RegHandle::mask
+       * mask is the mask of the register
+       * @var RegHandle::generation
+       * generation is the address table generation the handle was resolved in, a handle from an
+       * older generation is resolved again by name on its next use
+       */
+      typedef struct RegHandle {
+        std::string       name;
+        uhal::Node const* node;
+        uint32_t          address;
+        uint32_t          mask;
+        uint32_t          generation;
+
+      RegHandle() : name(""), node(NULL), address(0), mask(0), generation(0) {};
+
+        bool isValid() const { return node != NULL; };
+      } RegHandle;
+
       // TODO: REDESIGN
       typedef std::pair<uint8_t, OpticalLinkStatus>  linkStatus;
       //typedef std::vector<linkStatus>                linkStatus;
@@ -213,6 +249,26 @@ namespace gem {
        */
       uint32_t readReg(std::string const& regName);
 
+      /**
+       * @ingroup uhalwrappers
+       * @brief resolve a register in the address table once, for repeated access with readReg/writeReg
+       *
+       * @usage Resolved handles are cached by name, resolving the same register again is a single
+       *        hash lookup. The cache is invalidated when the address table or the base node changes.
+       *
+       * @param regName name of the register in the address table
+       *
+       * @retval the resolved handle
+       * @throws gem::hw::exception::HardwareProblem if the register is not in the address table
+       */
+      RegHandle resolve(std::string const& regName);
+
+      /**
+       * @ingroup uhalwrappers
+       * @brief drop all resolved handles, outstanding handles are resolved again on their next use
+       */
+      void invalidateHandles();
+
       /**
        * @ingroup uhalwrappers
        * @brief read from a register identified by a raw address
@@ -225,6 +281,19 @@ namespace gem {
        */
       uint32_t readReg(uint32_t const& regAddr);
 
+      /**
+       * @ingroup uhalwrappers
+       * @brief read from a register through a resolved handle, without any address table lookup
+       *
+       * @usage RegHandle h = resolve("GEM_AMC.TTC.STATUS.BC0.LOCKED"); ... readReg(h);
+       *
+       * @param handle resolved register, re-resolved in place if the address table changed
+       *
+       * @retval returns the 32 bit unsigned value in the register
+       * @throws gem::hw::exception::HardwareProblem if the handle was never resolved
+       */
+      uint32_t readReg(RegHandle& handle);
+
       /**
        * @ingroup uhalwrappers
        * @brief read from a register identified by an address, with the supplied mask
@@ -312,6 +381,18 @@ namespace gem {
        */
       void     writeReg(std::string const& regName, uint32_t const val);
 
+      /**
+       * @ingroup uhalwrappers
+       * @brief write to a register through a resolved handle, without any address table lookup
+       *
+       * @usage
+       *
+       * @param handle resolved register, re-resolved in place if the address table changed
+       * @param val value to write to the register
+       * @throws gem::hw::exception::HardwareProblem if the handle was never resolved
+       */
+      void     writeReg(RegHandle& handle, uint32_t const val);
+
       /**
        * @ingroup uhalwrappers
        * @brief write to a register identified by a raw address
@@ -347,6 +428,42 @@ namespace gem {
        */
       void     writeRegs(register_pair_list const& regList, int const& freq=8);
 
+      /**
+       * @ingroup uhalwrappers
+       * @brief write only the registers whose value differs from the shadow image, in one transaction
+       * @details registers written through this call are tracked in the shadow image of the device,
+       *          registers not yet in the image are always written. Intended for configuration
+       *          registers, the image is checked against the hardware by verifyShadow().
+       *          writeReg and writeRegs by name keep tracked registers up to date, and drop them
+       *          from the image when the write fails or does not read back the value written
+       *
+       * @param regList std::vector of a pairs of register names and values to write
+       * @throws gem::hw::exception::HardwareProblem if the transaction fails, the failed registers
+       *         are then dropped from the image so that they are written again next time
+       * @retval number of registers actually written
+       */
+      size_t   writeChangedRegs(register_pair_list const& regList);
+
+      /**
+       * @brief compare the shadow image with the hardware
+       * @details reads back the next maxRegs registers of the image in one transaction, successive
+       *          calls walk through the whole image. A register found different is logged and its
+       *          hardware value is stored in the image, so that the next writeChangedRegs() call
+       *          restores it
+       *
+       * @param maxRegs number of registers to check, 0 for the whole image
+       * @throws gem::hw::exception::HardwareProblem if the readback fails
+       * @retval number of registers that did not match the image
+       */
+      size_t   verifyShadow(size_t const maxRegs=0);
+
+      /**
+       * @brief forget the shadow image, the next writeChangedRegs() call writes every register
+       */
+      void     invalidateShadow() { m_shadow.clear(); };
+
+      size_t   shadowSize() const { return m_shadow.size(); };
+
       /**
        * @ingroup uhalwrappers
        * @brief write single value to a list of registers in a single transaction
@@ -499,6 +616,56 @@ namespace gem {
        */
       void zeroFIFO(std::string const& regName);
 
+      /**
+       * @defgroup asyncaccess Asynchronous register access
+       * @brief Requests handed to the I/O thread of the device, started on first use if
+       *        startExecutor() was not called
+       * @details The calls return immediately, the result is obtained from the future or passed to
+       *          the callback, which runs on the I/O thread of the device. A callback must therefore
+       *          never wait for another asynchronous request to the same device, it would deadlock,
+       *          and issuing a request without a callback from it raises SoftwareProblem.
+       *          Requests issued to many devices are executed concurrently, one thread per device,
+       *          so supervisory code can fan out across a crate and wait once:
+       *
+       * @usage
+       *   std::vector<std::shared_future<uint32_t> > fws;
+       *   for (auto amc = amcs.begin(); amc != amcs.end(); ++amc)
+       *     fws.push_back((*amc)->readRegAsync("GEM_AMC.GEM_SYSTEM.RELEASE"));
+       *   for (auto fw = fws.begin(); fw != fws.end(); ++fw)
+       *     fw->get();  // rethrows the error of a failed read
+       */
+
+      /**
+       * @ingroup asyncaccess
+       * @brief read a register through the I/O thread
+       *
+       * @param regName name of the register to read
+       * @param priority one of GEMHwExecutor::Priority
+       * @retval future holding the value of the register
+       */
+      std::shared_future<uint32_t> readRegAsync(std::string const& regName,
+                                                int const priority=GEMHwExecutor::Priority::MONITOR);
+      void readRegAsync(std::string const& regName, GEMHwExecutor::word_callback callback,
+                        int const priority=GEMHwExecutor::Priority::MONITOR);
+
+      /**
+       * @ingroup asyncaccess
+       * @brief read a block of nWords words through the I/O thread, the size of the node if nWords is 0
+       */
+      std::shared_future<std::vector<uint32_t> > readBlockAsync(std::string const& regName, size_t const nWords=0,
+                                                                int const priority=GEMHwExecutor::Priority::MONITOR);
+      void readBlockAsync(std::string const& regName, size_t const nWords, GEMHwExecutor::block_callback callback,
+                          int const priority=GEMHwExecutor::Priority::MONITOR);
+
+      /**
+       * @ingroup asyncaccess
+       * @brief write a register through the I/O thread, the value is not read back
+       */
+      std::shared_future<void> writeRegAsync(std::string const& regName, uint32_t const val,
+                                             int const priority=GEMHwExecutor::Priority::CONFIGURE);
+      void writeRegAsync(std::string const& regName, uint32_t const val, GEMHwExecutor::done_callback callback,
+                         int const priority=GEMHwExecutor::Priority::CONFIGURE);
+
 
       // These methods provide access to the member variables
       // specifying the `uhal` address table name and the IPbus protocol
@@ -519,9 +686,15 @@ namespace gem {
       void setControlHubIPAddress( std::string const& ipAddress) { m_controlHubIPAddress = ipAddress; };
       void setIPBusProtocolVersion(std::string const& version) { m_ipBusProtocol = version; };
       void setDeviceIPAddress(     std::string const& deviceIPAddr) { m_deviceIPAddress = deviceIPAddr; };
-      void setAddressTableFileName(std::string const& name) { m_addressTable = "file://${GEM_ADDRESS_TABLE_PATH}/"+name; };
-
-      void setDeviceBaseNode(std::string const& deviceBase) { m_deviceBaseNode = deviceBase; };
+      void setAddressTableFileName(std::string const& name) {
+        m_addressTable = "file://${GEM_ADDRESS_TABLE_PATH}/"+name;
+        invalidateHandles();
+      };
+
+      void setDeviceBaseNode(std::string const& deviceBase) {
+        m_deviceBaseNode = deviceBase;
+        invalidateHandles();
+      };
       void setDeviceID(      std::string const& deviceID) { m_deviceID = deviceID; };
 
       void setControlHubPort(uint32_t const& port) { m_controlHubPort = port; };
@@ -536,8 +709,53 @@ namespace gem {
 
       std::string getLoggerName() const { return m_gemLogger.getName(); };
 
+      /**
+       * @brief start a dedicated I/O thread for this device, see GEMHwExecutor
+       * @details Requests submitted through the executor are coalesced and prioritized, direct calls
+       *          to the accessors keep working and are serialized with the I/O thread by m_hwLock
+       *
+       * @param maxBatch maximum number of requests combined into one dispatch
+       * @param windowUsec time the I/O thread waits for further requests to fill a batch
+       */
+      void startExecutor(size_t const maxBatch=64, unsigned const windowUsec=0);
+
+      /**
+       * @brief execute the requests still queued and stop the I/O thread
+       */
+      void stopExecutor();
+
+      /**
+       * @retval the I/O executor of the device, empty if none was started
+       */
+      std::shared_ptr<GEMHwExecutor> getExecutor() const;
+
       void updateErrorCounters(std::string const& errCode);
 
+      /**
+       * @brief replace the policy deciding which failed accesses are retried, see GEMHwRetryPolicy
+       *
+       * @param policy the new policy, the default policy if empty
+       */
+      void setRetryPolicy(std::shared_ptr<GEMHwRetryPolicy> policy);
+
+      std::shared_ptr<GEMHwRetryPolicy> getRetryPolicy() const;
+
+      /**
+       * @brief send the queued IPbus requests, hides uhal::HwInterface::dispatch to profile it
+       */
+      void dispatch();
+
+      /**
+       * @brief start or stop recording the IPbus accesses of the device, see GEMHwProfiler
+       * @details stopping drops the statistics collected so far
+       */
+      void enableProfiler(bool const enable=true);
+
+      /**
+       * @retval the profiler of the device, empty unless enableProfiler() was called
+       */
+      std::shared_ptr<GEMHwProfiler> getProfiler() const;
+
       virtual std::string printErrorCounts() const;
 
       /**
@@ -566,6 +784,7 @@ namespace gem {
       virtual void linkReset(uint8_t const& link);
 
       DeviceErrors m_ipBusErrs;
+      GEMHwRetryPolicy::ErrorCounts m_ipBusErrClasses;  ///< errors per GEMHwRetryPolicy::ErrorClass and retries
 
       bool b_is_connected;
 
@@ -577,6 +796,15 @@ namespace gem {
 
       mutable gem::utils::Lock m_hwLock;
 
+      std::shared_ptr<GEMHwExecutor> p_executor;  ///< optional I/O thread, see startExecutor()
+      mutable std::mutex             m_executorMutex;  ///< guards p_executor, not held during I/O
+
+      std::shared_ptr<GEMHwRetryPolicy> p_retryPolicy;  ///< guarded by m_hwLock
+
+      GEMHwShadow m_shadow;  ///< last values written with writeChangedRegs(), see verifyShadow()
+
+      std::shared_ptr<GEMHwProfiler> p_profiler;  ///< guarded by m_hwLock, empty unless profiling
+
       /**
        * @brief Performs basic setup for the device
        * sets connection details (OBSOLETE)
@@ -615,6 +843,9 @@ namespace gem {
       uint32_t m_controlHubPort;          //!<
       uint32_t m_ipBusPort;               //!<
 
+      std::unordered_map<std::string, RegHandle> m_regHandles;  //!< resolved registers, by name
+      uint32_t m_handleGeneration;                              //!< bumped when m_regHandles is invalidated
+
       /** FIXME removed when infospace was dropped
       //infospace im(ex)portables
       xdata::String xs_controlHubIPAddress;  //!<
@@ -627,6 +858,57 @@ namespace gem {
       **/
 
       bool knownErrorCode(std::string const& errCode) const;
+
+      /**
+       * @brief make a handle usable, re-resolving it if the address table changed since it was resolved
+       * @throws gem::hw::exception::HardwareProblem if the handle was never resolved
+       */
+      void checkHandle(RegHandle& handle);
+
+      /**
+       * @brief read a register, retrying as the retry policy allows
+       * @details shared by the readReg overloads taking a name or a handle, m_hwLock must be held
+       *
+       * @param name of the register, looked up in the address table if node is NULL
+       * @param node resolved node of the register, or NULL
+       */
+      uint32_t readNode(std::string const& name, uhal::Node const* node);
+
+      /**
+       * @brief write a register and check the readback, retrying as the retry policy allows
+       * @details shared by the writeReg overloads taking a name or a handle, m_hwLock must be held
+       *
+       * @param name of the register, looked up in the address table if node is NULL
+       * @param node resolved node of the register, or NULL
+       * @param val value to write to the register
+       */
+      void writeNode(std::string const& name, uhal::Node const* node, uint32_t const val);
+
+      /**
+       * @brief account for a failed access and wait before retrying it, if the retry policy allows
+       * @details must be called with m_hwLock held once, it is released during the backoff and taken
+       *          again before returning. A caller holding m_hwLock more than once (e.g. a broadcast
+       *          of HwOptoHybrid) keeps the device for itself during the backoff
+       *
+       * @param errCode message of the uhal exception
+       * @param attempt number of attempts made so far, starting from 1
+       * @retval true if the access should be attempted again
+       */
+      bool retryAfterError(std::string const& errCode, unsigned const attempt);
+
+      /**
+       * @brief account for a failed access in the error counters and the error classes
+       * @details called by retryAfterError, and directly for accesses that are never retried
+       *
+       * @param errCode message of the uhal exception
+       * @retval the GEMHwRetryPolicy::ErrorClass of the error
+       */
+      int countError(std::string const& errCode);
+
+      /**
+       * @brief the I/O executor of the device, started with the default settings if not running
+       */
+      std::shared_ptr<GEMHwExecutor> asyncExecutor();
       //std::string registerToChar(uint32_t value) const;
     };  // class GEMHwDevice
   }  // namespace gem::hw
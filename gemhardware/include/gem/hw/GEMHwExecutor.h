@@ -0,0 +1,165 @@
+/** @file GEMHwExecutor.h */
+
+#ifndef GEM_HW_GEMHWEXECUTOR_H
+#define GEM_HW_GEMHWEXECUTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gem/utils/GEMLogging.h"
+
+namespace gem {
+  namespace hw {
+
+    class GEMHwDevice;
+
+    /**
+     * @brief I/O thread owning all register access to one GEMHwDevice
+     * @details Other threads submit requests and get a future back immediately, they never wait for
+     *          the device lock. The I/O thread takes all requests queued since its last dispatch, up to
+     *          maxBatch of them, and executes them as one GEMHwTransaction, so requests from several
+     *          threads that arrive close together share a dispatch. Requests are taken in order of
+     *          priority, configuration before monitoring.
+     *          If a coalesced batch fails, its reads are retried one by one so that only the faulty
+     *          read reports the error. Its writes and FIFO block reads are not sent again, as they
+     *          may have been applied before the failure, and report the error of the batch.
+     */
+    class GEMHwExecutor
+      {
+      public:
+        struct Priority {
+          enum EPriority {
+            READOUT   = 0x0,  ///< served first, reserved for data taking, no readout submits through the executor yet
+            CONFIGURE = 0x1,
+            MONITOR   = 0x2,
+            N_PRIORITIES
+          } Priority;
+        };
+
+        /**
+         * @param device the device to operate on, must outlive the executor
+         * @param maxBatch maximum number of requests combined into one transaction
+         * @param windowUsec time the I/O thread waits for further requests before dispatching a batch
+         *        that is not full, 0 to dispatch whatever is queued immediately
+         */
+        GEMHwExecutor(GEMHwDevice& device, size_t const maxBatch=64, unsigned const windowUsec=0);
+
+        /**
+         * @brief executes the requests still queued and stops the I/O thread
+         */
+        ~GEMHwExecutor();
+
+        typedef std::function<void(std::shared_future<uint32_t>)>                word_callback;
+        typedef std::function<void(std::shared_future<std::vector<uint32_t> >)> block_callback;
+        typedef std::function<void(std::shared_future<void>)>                    done_callback;
+
+        /**
+         * The optional callbacks are invoked on the I/O thread with the ready future, as soon as the
+         * request has completed or failed. They should return quickly, and get() on the future
+         * rethrows the error of a failed request.
+         * A callback must not wait for another request to the same device: that request is only
+         * executed by the I/O thread once the callback has returned. It may issue further requests
+         * with callbacks, requests without a callback issued from the I/O thread, including
+         * submit(), raise gem::hw::exception::SoftwareProblem instead of deadlocking.
+         */
+        std::shared_future<uint32_t> readReg(std::string const& regName, int const priority=Priority::MONITOR,
+                                             word_callback callback=word_callback());
+
+        std::shared_future<std::vector<uint32_t> > readBlock(std::string const& regName, size_t const nWords=0,
+                                                             int const priority=Priority::MONITOR,
+                                                             block_callback callback=block_callback());
+
+        /**
+         * @brief the future becomes ready once the write has been dispatched, writes are not read back
+         */
+        std::shared_future<void> writeReg(std::string const& regName, uint32_t const val,
+                                          int const priority=Priority::CONFIGURE,
+                                          done_callback callback=done_callback());
+
+        /**
+         * @brief run an arbitrary operation on the device from the I/O thread, never combined with other requests
+         */
+        std::shared_future<void> submit(std::function<void(GEMHwDevice&)> task, int const priority=Priority::CONFIGURE);
+
+        size_t   queued()       const;
+        uint64_t requestCount() const { return m_requestCount.load(std::memory_order_relaxed); };
+        uint64_t batchCount()   const { return m_batchCount.load(std::memory_order_relaxed); };
+
+      private:
+        struct RequestType {
+          enum ERequestType {
+            READ       = 0x0,
+            WRITE      = 0x1,
+            READ_BLOCK = 0x2,
+            TASK       = 0x3
+          } RequestType;
+        };
+
+        struct Request {
+          int                                type;
+          std::string                        regName;
+          uint32_t                           value;
+          size_t                             nWords;
+          std::function<void(GEMHwDevice&)> task;
+          std::function<void()>              onComplete;  ///< invoked once the result is set
+
+          uint32_t              wordVal;
+          std::vector<uint32_t> blockVal;
+
+          std::promise<uint32_t>                wordResult;
+          std::promise<std::vector<uint32_t> > blockResult;
+          std::promise<void>                    doneResult;
+
+          Request() : type(RequestType::READ), value(0), nWords(0), wordVal(0) {};
+
+          void complete();
+          void fail(std::exception_ptr err);
+          void notify(log4cplus::Logger& logger);
+        };
+
+        typedef std::shared_ptr<Request> request_ptr;
+
+        void enqueue(request_ptr request, int const priority);
+        void run();
+        void execute(std::vector<request_ptr>& batch);
+
+        /**
+         * @retval true if the request can be sent again after its batch failed
+         */
+        bool repeatable(Request const& request);
+        void executeTask(request_ptr request);
+
+        GEMHwDevice& m_device;
+        size_t       m_maxBatch;
+        unsigned     m_windowUsec;
+
+        log4cplus::Logger m_gemLogger;
+
+        mutable std::mutex      m_queueMutex;
+        std::condition_variable m_queueCondition;
+        std::deque<request_ptr> m_queues[Priority::N_PRIORITIES];
+        size_t                  m_nQueued;
+        bool                    m_stopping;
+
+        std::atomic<uint64_t> m_requestCount;
+        std::atomic<uint64_t> m_batchCount;
+
+        std::thread m_thread;
+
+        // Prevent copying
+        GEMHwExecutor(GEMHwExecutor const&);
+        GEMHwExecutor& operator=(GEMHwExecutor const&);
+      };
+
+  }  // namespace gem::hw
+}  // namespace gem
+
+#endif  // GEM_HW_GEMHWEXECUTOR_H
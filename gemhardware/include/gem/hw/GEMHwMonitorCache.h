@@ -0,0 +1,232 @@
+/** @file GEMHwMonitorCache.h */
+
+#ifndef GEM_HW_GEMHWMONITORCACHE_H
+#define GEM_HW_GEMHWMONITORCACHE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gem/hw/GEMHwDevice.h"
+
+#include "gem/utils/GEMLogging.h"
+
+namespace gem {
+  namespace hw {
+
+    /**
+     * @brief Monitoring values of one board, shared by all the monitors of the board in the process
+     * @details Monitors subscribe the registers they display, and the cache reads the union of the
+     *          registers of all subscribers, each register once however many subscribers want it,
+     *          with one transaction per device and a common timestamp. A thread of the cache polls
+     *          the board with the shortest period requested by the subscribers, so the monitoring
+     *          traffic of a board does not grow with the number of monitors attached to it.
+     *          fetch() serves the cached values with the time they were read, and reads the board
+     *          itself if they are older than the staleness bound of the caller.
+     *          Registers are identified by address and mask, so the same register subscribed
+     *          through different devices of the board, e.g., an AMC and one of its OptoHybrids, is
+     *          read once, through the device of the first subscriber that still wants it.
+     *          Caches are shared by the board endpoint, see getCache().
+     *          When the transaction of a device fails, its registers are read one by one until one
+     *          fails. If others were read before it, that register is dropped: it is left out of the
+     *          reads, so it cannot fail the transaction of the others, and fetch() reports it. It is
+     *          tried again after DROPPED_RETRY_MSEC, doubled on every failure up to
+     *          DROPPED_RETRY_MAX_MSEC, and read as usual again once a read succeeds. If the first
+     *          single read fails, the device is taken as unreachable and the refresh gives up on it.
+     *          A paused subscription, e.g., of a monitor paused during a transition, does not make
+     *          the thread poll, and its registers are only read for the subscriptions still running,
+     *          through their devices, or when it fetches stale values itself.
+     *          The board is read without the lock of the cache, from a copy of the registers to read,
+     *          so a slow or unreachable board does not block subscribe(), setPaused() or the fetch()
+     *          of fresh values. Refreshes do not overlap: fetch() of stale values waits for the one in
+     *          flight, and unsubscribe() waits for it to end, as it may be reading through the device
+     *          of the subscription.
+     *
+     * @usage
+     *   std::shared_ptr<gem::hw::GEMHwMonitorCache> cache = gem::hw::GEMHwMonitorCache::getCache(*amc);
+     *   auto id = cache->subscribe(*amc, handles, 5000);
+     *   std::vector<uint32_t> values;
+     *   auto timestamp = cache->fetch(id, values, std::chrono::milliseconds(5000));
+     *   cache->unsubscribe(id);
+     */
+    class GEMHwMonitorCache
+      {
+      public:
+        typedef std::chrono::steady_clock clock;
+        typedef uint32_t                  subscription_id;
+
+        /**
+         * the default update interval of the monitorables of a GEMMonitor
+         */
+        static const uint32_t DEFAULT_POLL_MSEC = 5000;
+
+        /**
+         * time before a dropped register is tried again, doubled on every failure
+         */
+        static const uint32_t DROPPED_RETRY_MSEC     = 10000;
+        static const uint32_t DROPPED_RETRY_MAX_MSEC = 600000;
+
+        /**
+         * @brief the cache of the board of a device, created on first use
+         * @details the board is the IPbus endpoint of the device, the cache lives as long as
+         *          someone holds it
+         */
+        static std::shared_ptr<GEMHwMonitorCache> getCache(GEMHwDevice& device);
+
+        /**
+         * @param board name of the board, used in the logs
+         */
+        explicit GEMHwMonitorCache(std::string const& board);
+
+        ~GEMHwMonitorCache();
+
+        /**
+         * @brief add registers to be read for a subscriber
+         * @details the device must outlive the subscription
+         *
+         * @param device the device the registers were resolved in, and which reads them
+         * @param regs the registers, fetch() returns their values in this order
+         * @param pollMsec how often the subscriber wants the values refreshed
+         * @retval the id of the subscription
+         */
+        subscription_id subscribe(GEMHwDevice& device, std::vector<GEMHwDevice::RegHandle> const& regs,
+                                  uint32_t const pollMsec=DEFAULT_POLL_MSEC);
+
+        /**
+         * @brief drop a subscription, registers nobody else wants are no longer read
+         * @details waits for the refresh in flight, after it the device of the subscription is no
+         *          longer used
+         */
+        void unsubscribe(subscription_id const id);
+
+        /**
+         * @brief stop or restart the polling for a subscription
+         * @details the registers of a paused subscription are read by the poll thread only if a
+         *          running subscription wants them too, fetch() still reads them when they are stale
+         */
+        void setPaused(subscription_id const id, bool const paused);
+
+        /**
+         * @brief the values of the registers of a subscription
+         *
+         * @param id the subscription
+         * @param values filled with the values of the registers, in the order they were subscribed
+         * @param maxAge the board is read first if any value is older than this
+         * @param dropped if not NULL, filled with true for the registers that are dropped until
+         *        their next retry, their values are the ones of their last successful read
+         * @retval the time the oldest of the values of the registers still read was read
+         * @throws gem::hw::exception::HardwareProblem if the board had to be read and could not be,
+         *         or if the subscription does not exist
+         */
+        clock::time_point fetch(subscription_id const id, std::vector<uint32_t>& values,
+                                clock::duration const& maxAge, std::vector<bool>* dropped=NULL);
+
+        /**
+         * @brief read the registers of all running subscriptions now
+         * @throws gem::hw::exception::HardwareProblem if a device is unreachable, its registers
+         *         keep their previous values
+         */
+        void refresh();
+
+        std::string getBoard() const { return m_board; };
+
+        /**
+         * @retval the number of distinct registers read on every refresh
+         */
+        size_t size() const;
+
+        size_t subscribers() const;
+
+        /**
+         * @retval the number of refreshes of the board since the cache was created
+         */
+        uint64_t getRefreshCount() const;
+
+      private:
+        typedef std::pair<uint32_t, uint32_t> reg_key;  ///< address and mask of a register
+
+        /**
+         * A subscribed register, read through the device of its first reader
+         */
+        struct Entry {
+          uint32_t          value;
+          clock::time_point timestamp;  ///< of the last successful read, the epoch if never read
+          bool              dropped;    ///< failed alone, not read until retryAt
+          uint32_t          failures;   ///< failed reads in a row, sets the retry back-off
+          clock::time_point retryAt;
+          std::vector<std::pair<subscription_id, GEMHwDevice::RegHandle> > readers;
+
+          Entry() : value(0), dropped(false), failures(0) {};
+        };
+
+        /**
+         * A register to read in a refresh, copied from its entry as the board is read without m_mutex
+         */
+        struct Read {
+          reg_key                key;
+          GEMHwDevice::RegHandle handle;
+          uint32_t               value;
+          bool                   ok;
+          bool                   failed;  ///< failed alone while the device answered
+
+          Read() : value(0), ok(false), failed(false) {};
+        };
+
+        struct Subscriber {
+          GEMHwDevice*         device;
+          std::vector<reg_key> keys;
+          uint32_t             pollMsec;
+          bool                 paused;
+
+          Subscriber() : device(NULL), pollMsec(DEFAULT_POLL_MSEC), paused(false) {};
+        };
+
+        /**
+         * @brief read the entries of the running subscriptions and of the requester, m_mutex is
+         *        released while the board is read
+         * @param lock holds m_mutex, it is held again on return, also when an exception is thrown
+         * @param requester the subscription that asks for the refresh, read even if it is paused,
+         *        m_nextId for none
+         */
+        void readBoard(std::unique_lock<std::mutex>& lock, subscription_id const requester);
+
+        /**
+         * @brief read the registers of one device, without m_mutex
+         * @param offset the register the single reads start from, after the transaction failed
+         * @retval false if the device is unreachable, the first single read failed
+         */
+        static bool readDevice(GEMHwDevice& device, std::vector<Read>& reads, size_t const offset);
+
+        void poll();
+
+        std::string       m_board;
+        log4cplus::Logger m_gemLogger;
+
+        mutable std::mutex      m_mutex;  ///< guards the members below, not held while the board is read
+        std::condition_variable m_pollCondition;
+        std::condition_variable m_refreshCondition;  ///< notified when a refresh ends
+        std::map<reg_key, Entry>              m_entries;
+        std::map<subscription_id, Subscriber> m_subscribers;
+        subscription_id                       m_nextId;
+        clock::time_point                     m_lastRefresh;  ///< of the last attempt, successful or not
+        uint64_t                              m_nRefreshes;
+        bool                                  m_refreshing;  ///< a refresh is reading the board
+        bool                                  m_stop;
+
+        std::thread m_poller;
+
+        // Prevent copying
+        GEMHwMonitorCache(GEMHwMonitorCache const&);
+        GEMHwMonitorCache& operator=(GEMHwMonitorCache const&);
+      };
+
+  }  // namespace gem::hw
+}  // namespace gem
+
+#endif  // GEM_HW_GEMHWMONITORCACHE_H
@@ -0,0 +1,127 @@
+/** @file GEMHwMonitorReadList.h */
+
+#ifndef GEM_HW_GEMHWMONITORREADLIST_H
+#define GEM_HW_GEMHWMONITORREADLIST_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "gem/base/GEMMonitor.h"
+#include "gem/hw/GEMHwCounterSnapshot.h"
+#include "gem/hw/GEMHwDevice.h"
+#include "gem/hw/GEMHwMonitorCache.h"
+
+namespace gem {
+  namespace hw {
+
+    /**
+     * @brief Register list of the hardware monitorables of a GEMMonitor, read through the monitoring cache of the board
+     * @details The registers of all monitorable sets are resolved once and subscribed to the
+     *          GEMHwMonitorCache of the board, which reads them together with the registers of the
+     *          other monitors of the board. Every update() fills the info spaces from the cache, which
+     *          reads the board first if the values are older than the poll period. The list is rebuilt
+     *          when the number of monitorables changes, e.g., after a reset of the monitor.
+     *          Monitorables with the "raw/rate" format are counters: they are latched together in a
+     *          GEMHwCounterSnapshot with the time the cache read them, and their instantaneous and averaged
+     *          rates are published in the info space next to the count, under the names given by
+     *          GEMInfoSpaceToolBox::getRateItemName.
+     */
+    class GEMHwMonitorReadList
+      {
+      public:
+        typedef std::unordered_map<std::string,
+          std::unordered_map<std::string, gem::base::GEMMonitor::GEMMonitorable> > monitorable_sets;
+
+        /**
+         * @param pollMsec how often the monitorables are read, also the maximum age of the values
+         *        filled in the info spaces
+         */
+        GEMHwMonitorReadList(log4cplus::Logger& logger,
+                             uint32_t const pollMsec=GEMHwMonitorCache::DEFAULT_POLL_MSEC);
+
+        ~GEMHwMonitorReadList();
+
+        /**
+         * @brief read all hardware monitorables of the sets and fill the info spaces
+         * @details on a failed read the info space values are left unchanged, as are the values of
+         *          the registers the cache dropped because they failed on their own
+         *
+         * @param device the device to read from
+         * @param sets the monitorable sets of the monitor
+         * @param prefix prepended to the register names, e.g., the device base node, may be empty
+         */
+        void update(GEMHwDevice& device, monitorable_sets const& sets, std::string const& prefix);
+
+        /**
+         * @brief drop the list and its subscription to the monitoring cache
+         */
+        void clear();
+
+        size_t size() const { return m_items.size(); };
+
+        /**
+         * @retval the counters of the "raw/rate" monitorables, as of the last update
+         */
+        GEMHwCounterSnapshot const& getCounters() const { return m_counters; };
+
+        /**
+         * @brief forget the previous readings of the counters, e.g., after a counter reset
+         */
+        void resetRates() { m_counters.resetRates(); };
+
+        /**
+         * @brief stop the polling of the registers of the list, e.g., while the monitor is paused,
+         *        update() still reads them when they are stale
+         */
+        void pause() { setPaused(true); };
+
+        void resume() { setPaused(false); };
+
+      private:
+        /**
+         * 64-bit items combine two registers, the value is (upper << 32) + lower,
+         * counter items also update m_counters
+         */
+        struct Item {
+          std::shared_ptr<gem::base::utils::GEMInfoSpaceToolBox> infoSpace;
+          std::string            name;
+          bool                   is64;
+          GEMHwDevice::RegHandle lower;
+          GEMHwDevice::RegHandle upper;
+          size_t                 lowerIdx;  ///< index of lower in the subscription
+          size_t                 upperIdx;  ///< index of upper in the subscription
+          int                    counter;   ///< index in m_counters, -1 if not a counter
+
+          Item() : is64(false), lowerIdx(0), upperIdx(0), counter(-1) {};
+        };
+
+        void build(GEMHwDevice& device, monitorable_sets const& sets, std::string const& prefix);
+
+        bool isDropped(Item const& item) const;
+
+        void setPaused(bool const paused);
+
+        log4cplus::Logger m_gemLogger;
+
+        std::vector<Item>    m_items;
+        GEMHwCounterSnapshot m_counters;
+        size_t            m_nMonitorables;  ///< number of monitorables the list was built from
+        uint32_t          m_pollMsec;
+
+        std::shared_ptr<GEMHwMonitorCache> p_cache;  ///< empty until the list is built
+        GEMHwMonitorCache::subscription_id m_subscription;
+        std::vector<uint32_t>              m_values;   ///< values of the subscribed registers
+        std::vector<bool>                  m_dropped;  ///< subscribed registers the cache no longer reads
+        bool                               m_paused;   ///< kept over a rebuild of the list
+
+        // Prevent copying
+        GEMHwMonitorReadList(GEMHwMonitorReadList const&);
+        GEMHwMonitorReadList& operator=(GEMHwMonitorReadList const&);
+      };
+
+  }  // namespace gem::hw
+}  // namespace gem
+
+#endif  // GEM_HW_GEMHWMONITORREADLIST_H
@@ -0,0 +1,203 @@
+/** @file GEMHwProfiler.h */
+
+#ifndef GEM_HW_GEMHWPROFILER_H
+#define GEM_HW_GEMHWPROFILER_H
+
+#include <stdint.h>
+#include <array>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace gem {
+  namespace hw {
+
+    /**
+     * @brief Statistics of the IPbus accesses of one device, per register, calling subsystem and
+     *        type of access
+     * @details The accessors of GEMHwDevice report every access to the profiler of the device, if
+     *          one is enabled (GEMHwDevice::enableProfiler). The calling subsystem is the name set by
+     *          the innermost CallerScope of the calling thread, so that monitoring, configuration and
+     *          the I/O thread of the device can be told apart.
+     *          Registers accessed in a list (readRegs, writeRegs) are accounted individually, each
+     *          with its share of the latency of the list, in proportion to its payload, so that the
+     *          times of the registers of a list add up to the time of the list.
+     *
+     * @usage
+     *   {
+     *     gem::hw::GEMHwProfiler::CallerScope scope("GLIBMonitor");
+     *     amc->readReg("GEM_AMC.TTC.STATUS.BC0.LOCKED");  // accounted to GLIBMonitor
+     *   }
+     *   amc->getProfiler()->dumpToFile("/tmp/amc-02.profile");
+     */
+    class GEMHwProfiler
+      {
+      public:
+        struct AccessTypeT {
+          enum EAccessType {
+            READ        = 0x0,
+            WRITE       = 0x1,
+            READ_LIST   = 0x2,
+            WRITE_LIST  = 0x3,
+            READ_BLOCK  = 0x4,
+            WRITE_BLOCK = 0x5,
+            DISPATCH    = 0x6
+          };  // end enum EAccessType
+        };  // end struct AccessTypeT
+        typedef AccessTypeT::EAccessType AccessType;
+
+        /// latency bin i counts the accesses that took less than 2^(i+1) microseconds, the last bin all others
+        static const size_t N_LATENCY_BINS = 20;
+
+        typedef std::array<uint64_t, N_LATENCY_BINS> latency_histogram;
+
+        /**
+         * @struct Entry
+         * @brief Statistics of the accesses of one type to one register, from one calling subsystem
+         * @var Entry::Register
+         * Register is the name of the register, or its address in hexadecimal, empty for dispatches
+         * @var Entry::Caller
+         * Caller is the calling subsystem, see CallerScope
+         * @var Entry::Type
+         * Type is the type of access
+         * @var Entry::Count
+         * Count is the number of accesses
+         * @var Entry::Bytes
+         * Bytes is the payload read or written, 4 bytes per word
+         * @var Entry::TotalUsec
+         * TotalUsec is the time spent in the accesses, including retries
+         * @var Entry::MaxUsec
+         * MaxUsec is the longest access
+         * @var Entry::Latency
+         * Latency is the histogram of the access times, see N_LATENCY_BINS
+         */
+        typedef struct Entry {
+          std::string       Register;
+          std::string       Caller;
+          AccessType        Type;
+          uint64_t          Count;
+          uint64_t          Bytes;
+          uint64_t          TotalUsec;
+          uint64_t          MaxUsec;
+          latency_histogram Latency;
+
+        Entry() : Type(AccessTypeT::READ), Count(0), Bytes(0), TotalUsec(0), MaxUsec(0) { Latency.fill(0); };
+        } Entry;
+
+        /**
+         * @brief names the calling subsystem of the accesses made by the current thread, until the
+         *        scope ends
+         */
+        class CallerScope
+          {
+          public:
+            explicit CallerScope(std::string const& caller);
+            ~CallerScope();
+
+          private:
+            std::string m_previous;
+
+            // Prevent copying
+            CallerScope(CallerScope const&);
+            CallerScope& operator=(CallerScope const&);
+          };
+
+        /**
+         * @brief times one access and reports it to the profiler when it goes out of scope
+         * @details does nothing, not even reading the clock, if the profiler is null. Only the
+         *          registers given to the constructor or to add() are accounted, dispatches use an
+         *          empty register name. The time of the access is shared among its registers
+         */
+        class Probe
+          {
+          public:
+            Probe(GEMHwProfiler* profiler, AccessType const type);
+            Probe(GEMHwProfiler* profiler, AccessType const type, std::string const& regName, size_t const nWords=1);
+            ~Probe();
+
+            /**
+             * @brief account one more register to the access, for the list accesses
+             */
+            void add(std::string const& regName, size_t const nWords=1);
+
+            bool enabled() const { return p_profiler != nullptr; };
+
+          private:
+            GEMHwProfiler* p_profiler;
+            AccessType     m_type;
+            std::vector<std::pair<std::string, size_t> > m_registers;
+            std::chrono::steady_clock::time_point m_start;
+
+            // Prevent copying
+            Probe(Probe const&);
+            Probe& operator=(Probe const&);
+          };
+
+        explicit GEMHwProfiler(std::string const& deviceID);
+
+        /**
+         * @brief account one access of the calling thread
+         */
+        void record(AccessType const type, std::string const& regName, size_t const nWords, uint64_t const usec);
+
+        /**
+         * @retval all entries, the most time consuming first
+         */
+        std::vector<Entry> getEntries() const;
+
+        /**
+         * @retval register accesses and time per calling subsystem, over all registers
+         */
+        std::map<std::string, std::pair<uint64_t, uint64_t> > getCallerTotals() const;
+
+        void reset();
+
+        std::string getDeviceID() const { return m_deviceID; };
+
+        /**
+         * @brief HTML tables of the per caller totals and of the most time consuming entries
+         *
+         * @param maxEntries number of entries shown, 0 for all
+         */
+        void printHTML(std::ostream& out, size_t const maxEntries=50) const;
+
+        /**
+         * @brief all entries as tab separated text, one per line, with the latency histogram
+         */
+        void dump(std::ostream& out) const;
+
+        /**
+         * @retval false if the file could not be written
+         */
+        bool dumpToFile(std::string const& fileName) const;
+
+        static std::string getAccessTypeName(AccessType const type);
+
+        /**
+         * @retval the calling subsystem of the current thread, see CallerScope
+         */
+        static std::string const& currentCaller();
+
+      private:
+        typedef std::tuple<std::string, std::string, int> entry_key;  ///< register, caller, type
+
+        std::string m_deviceID;
+
+        mutable std::mutex m_mutex;  ///< guards m_entries and m_start
+        std::map<entry_key, Entry> m_entries;
+        std::chrono::system_clock::time_point m_start;
+
+        // Prevent copying
+        GEMHwProfiler(GEMHwProfiler const&);
+        GEMHwProfiler& operator=(GEMHwProfiler const&);
+      };
+
+  }  // namespace gem::hw
+}  // namespace gem
+
+#endif  // GEM_HW_GEMHWPROFILER_H
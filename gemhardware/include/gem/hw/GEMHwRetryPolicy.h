@@ -0,0 +1,117 @@
+/** @file GEMHwRetryPolicy.h */
+
+#ifndef GEM_HW_GEMHWRETRYPOLICY_H
+#define GEM_HW_GEMHWRETRYPOLICY_H
+
+#include <stdint.h>
+#include <string>
+
+namespace gem {
+  namespace hw {
+
+    /**
+     * @brief Decides whether a failed IPbus access of a GEMHwDevice is retried, and after how long
+     * @details Errors are classified from the uhal exception message. Transient errors (timeouts,
+     *          a busy ControlHub, corrupted replies) are retried with an exponential backoff with
+     *          random jitter, so that several devices behind the same ControlHub do not retry in
+     *          lock-step. Permanent errors (unknown registers, access violations, unknown failures)
+     *          are not retried at all. Bus errors are retried once, as a repeated bus error usually
+     *          means the address is not implemented in the firmware.
+     *          Derive from this class and install it with GEMHwDevice::setRetryPolicy to change the
+     *          behaviour.
+     */
+    class GEMHwRetryPolicy
+      {
+      public:
+        struct ErrorClass {
+          enum EErrorClass {
+            TIMEOUT     = 0x0,  ///< no reply from the device or from the ControlHub
+            HUB_BUSY    = 0x1,  ///< the ControlHub reported error code 3 or 4, usually overload
+            BAD_HEADER  = 0x2,  ///< reply with an unexpected size or header
+            BUS_ERROR   = 0x3,  ///< the firmware answered with a bus error
+            BAD_ADDRESS = 0x4,  ///< register unknown or access not permitted, never retried
+            UNKNOWN     = 0x5,  ///< anything else, never retried
+            N_CLASSES
+          } ErrorClass;
+        };
+
+        /**
+         * @struct ErrorCounts
+         * @brief Counters of the errors seen by a device, per class, and of the retries they caused
+         * @var ErrorCounts::Errors
+         * Errors is the number of errors of each ErrorClass
+         * @var ErrorCounts::Retries
+         * Retries is the number of accesses repeated after an error
+         * @var ErrorCounts::GaveUp
+         * GaveUp is the number of accesses abandoned, after a permanent error or the last attempt
+         * @var ErrorCounts::BackoffUsec
+         * BackoffUsec is the total time spent waiting before retries
+         */
+        typedef struct ErrorCounts {
+          uint64_t Errors[ErrorClass::N_CLASSES];
+          uint64_t Retries;
+          uint64_t GaveUp;
+          uint64_t BackoffUsec;
+
+        ErrorCounts() { reset(); };
+          void reset() {
+            for (int i = 0; i < ErrorClass::N_CLASSES; ++i)
+              Errors[i] = 0;
+            Retries = 0; GaveUp = 0; BackoffUsec = 0;
+            return; };
+        } ErrorCounts;
+
+        static const unsigned DEFAULT_MAX_ATTEMPTS  = 5;
+        static const unsigned DEFAULT_BASE_DELAY_US = 100;
+        static const unsigned DEFAULT_MAX_DELAY_US  = 100000;
+
+        /**
+         * @param maxAttempts total number of attempts of one access, including the first one
+         * @param baseDelayUsec backoff before the first retry, doubled for every further retry
+         * @param maxDelayUsec upper bound of the backoff
+         */
+        GEMHwRetryPolicy(unsigned const maxAttempts=DEFAULT_MAX_ATTEMPTS,
+                         unsigned const baseDelayUsec=DEFAULT_BASE_DELAY_US,
+                         unsigned const maxDelayUsec=DEFAULT_MAX_DELAY_US);
+
+        virtual ~GEMHwRetryPolicy();
+
+        /**
+         * @brief classify an error from the message of the uhal exception
+         * @retval one of ErrorClass
+         */
+        virtual int classify(std::string const& errCode) const;
+
+        /**
+         * @retval true if an error of this class may go away by itself
+         */
+        virtual bool isTransient(int const errClass) const;
+
+        /**
+         * @param errClass class of the error of the last attempt
+         * @param attempt number of attempts made so far, starting from 1
+         * @retval true if the access should be attempted again
+         */
+        virtual bool shouldRetry(int const errClass, unsigned const attempt) const;
+
+        /**
+         * @brief time to wait before the next attempt, with jitter
+         * @details half of the exponential delay is fixed, the other half is random. Retries after a
+         *          ControlHub error start from a four times larger delay to let the hub drain
+         */
+        virtual unsigned backoffUsec(int const errClass, unsigned const attempt) const;
+
+        unsigned maxAttempts() const { return m_maxAttempts; };
+
+        static std::string errorClassName(int const errClass);
+
+      private:
+        unsigned m_maxAttempts;
+        unsigned m_baseDelayUsec;
+        unsigned m_maxDelayUsec;
+      };
+
+  }  // namespace gem::hw
+}  // namespace gem
+
+#endif  // GEM_HW_GEMHWRETRYPOLICY_H
@@ -0,0 +1,66 @@
+/** @file GEMHwShadow.h */
+
+#ifndef GEM_HW_GEMHWSHADOW_H
+#define GEM_HW_GEMHWSHADOW_H
+
+#include <stdint.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace gem {
+  namespace hw {
+
+    /**
+     * @brief Last known values of the configuration registers of one device
+     * @details Only registers written with GEMHwDevice::writeChangedRegs are tracked, so that
+     *          trigger-like registers (resets, broadcast requests) never end up in the shadow
+     *          and are never read back by the verification. The entries are kept ordered by
+     *          register name so that verification can walk through them in slices.
+     */
+    class GEMHwShadow
+      {
+      public:
+        typedef std::vector<std::pair<std::string, uint32_t> > entry_list;
+
+        GEMHwShadow();
+
+        /**
+         * @retval true if the register is tracked, with its value in val
+         */
+        bool lookup(std::string const& regName, uint32_t& val) const;
+
+        /**
+         * @brief track the register with the given value
+         */
+        void update(std::string const& regName, uint32_t const val);
+
+        /**
+         * @brief update the value of the register only if it is already tracked
+         */
+        void refresh(std::string const& regName, uint32_t const val);
+
+        void erase(std::string const& regName);
+
+        void clear();
+
+        size_t size() const;
+
+        /**
+         * @brief the next maxEntries entries after the previous call, wrapping around
+         * @param maxEntries number of entries to return, all entries if 0
+         */
+        entry_list nextSlice(size_t const maxEntries);
+
+      private:
+        mutable std::mutex              m_mutex;
+        std::map<std::string, uint32_t> m_values;
+        std::string                     m_cursor;  ///< last register returned by nextSlice
+      };
+
+  }  // namespace gem::hw
+}  // namespace gem
+
+#endif  // GEM_HW_GEMHWSHADOW_H
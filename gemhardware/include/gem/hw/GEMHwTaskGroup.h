@@ -0,0 +1,127 @@
+/** @file GEMHwTaskGroup.h */
+
+#ifndef GEM_HW_GEMHWTASKGROUP_H
+#define GEM_HW_GEMHWTASKGROUP_H
+
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "xcept/Exception.h"
+
+#include "gem/utils/GEMLogging.h"
+
+namespace gem {
+  namespace hw {
+
+    /**
+     * @brief Runs a set of hardware tasks, e.g., the configuration of every link of a crate, on a
+     *        bounded number of threads
+     * @details Each task has a target, used in the results, and a serial key. Tasks with the same
+     *          serial key (e.g., all tasks touching one board) run one after the other in the order
+     *          they were added, and a failed task cancels the following ones of its key. Tasks with
+     *          different keys run concurrently, on at most maxWorkers threads.
+     *          Errors never escape run(): every task gets a Result, returned in the order the tasks
+     *          were added, so that failures are reported in the same order whatever the timing.
+     *
+     * @usage
+     *   gem::hw::GEMHwTaskGroup group(8);
+     *   for (auto const& link : links)
+     *     group.add(link.name, link.name, [&link]() { configure(link); });
+     *   std::vector<gem::hw::GEMHwTaskGroup::Result> results = group.run();
+     *   gem::hw::GEMHwTaskGroup::checkResults<gem::hw::exception::Exception>(m_gemLogger, "configure", results);
+     */
+    class GEMHwTaskGroup
+      {
+      public:
+        /**
+         * @struct Result
+         * @brief Outcome of one task
+         * @var Result::Target
+         * Target is the name given to the task
+         * @var Result::Succeeded
+         * Succeeded is false if the task threw, or was cancelled after a failure with the same serial key
+         * @var Result::Error
+         * Error is the message of the exception thrown by the task
+         * @var Result::DurationUsec
+         * DurationUsec is the time the task took to run
+         */
+        typedef struct Result {
+          std::string Target;
+          bool        Succeeded;
+          std::string Error;
+          uint64_t    DurationUsec;
+
+        Result() : Succeeded(false), DurationUsec(0) {};
+        } Result;
+
+        static const size_t DEFAULT_MAX_WORKERS = 8;
+
+        /**
+         * @param maxWorkers maximum number of threads, 1 runs all tasks in the calling thread
+         */
+        explicit GEMHwTaskGroup(size_t const maxWorkers=DEFAULT_MAX_WORKERS);
+
+        /**
+         * @param target name of the task in the results, e.g., the link it configures
+         * @param serialKey tasks with the same key are never run concurrently
+         * @param task the work, reports errors by throwing
+         */
+        void add(std::string const& target, std::string const& serialKey, std::function<void()> task);
+
+        /**
+         * @brief run all the tasks added so far and wait for them, the group is empty afterwards
+         * @retval one result per task, in the order the tasks were added
+         * @throws std::system_error if a thread cannot be started, once the threads already
+         *         started have finished the chains they had taken
+         */
+        std::vector<Result> run();
+
+        size_t size() const { return m_tasks.size(); };
+
+        /**
+         * @retval "target: error" for every failed task, one per line, empty if all tasks succeeded
+         */
+        static std::string failureSummary(std::vector<Result> const& results);
+
+        /**
+         * @brief log the duration and the errors of the tasks of a transition
+         * @retval the failureSummary of the results
+         */
+        static std::string logResults(log4cplus::Logger& logger, std::string const& action,
+                                      std::vector<Result> const& results);
+
+        /**
+         * @brief log the results of the tasks of a transition, raise if any of them failed
+         * @tparam E the exception raised, e.g., the exception of the calling manager
+         */
+        template<typename E>
+          static void checkResults(log4cplus::Logger& logger, std::string const& action,
+                                   std::vector<Result> const& results)
+          {
+            std::string const failures = logResults(logger, action, results);
+            if (!failures.empty())
+              XCEPT_RAISE(E, action + " failed for:\n" + failures);
+          };
+
+      private:
+        struct Task {
+          std::string           target;
+          std::function<void()> work;
+        };
+
+        void runChain(std::vector<size_t> const& chain, std::vector<Result>& results) const;
+
+        size_t m_maxWorkers;
+
+        std::vector<Task>                m_tasks;
+        std::vector<std::vector<size_t> > m_chains;      ///< indices of the tasks of each serial key
+        std::map<std::string, size_t>     m_chainIndex;  ///< serial key to entry in m_chains
+      };
+
+  }  // namespace gem::hw
+}  // namespace gem
+
+#endif  // GEM_HW_GEMHWTASKGROUP_H
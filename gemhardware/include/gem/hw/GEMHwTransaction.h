@@ -0,0 +1,169 @@
+/** @file GEMHwTransaction.h */
+
+#ifndef GEM_HW_GEMHWTRANSACTION_H
+#define GEM_HW_GEMHWTRANSACTION_H
+
+#include <future>
+#include <string>
+#include <vector>
+
+#include "gem/hw/GEMHwDevice.h"
+
+namespace gem {
+  namespace hw {
+
+    /**
+     * @brief Collects register operations on a GEMHwDevice and executes them with as few dispatches as possible
+     * @details Reads, writes, block reads and read-modify-writes are queued in any order and only
+     *          sent to the hardware on commit(). The queued operations are packed into chunks that
+     *          fit in one IPbus packet each (maxPacketWords, in 32-bit words, for both the request
+     *          and the reply), and each chunk is sent with a single dispatch. Operations are
+     *          executed in the order they were queued.
+     *          Results are delivered through futures, or through references supplied when the
+     *          operation is queued, and are available once commit() returns. Writes are not read
+     *          back, as in GEMHwDevice::writeRegs.
+     *
+     * @usage
+     *   gem::hw::GEMHwTransaction trans(*amc);
+     *   auto fw = trans.read("GEM_AMC.GEM_SYSTEM.RELEASE");
+     *   trans.write("GEM_AMC.TTC.CTRL.L1A_ENABLE", 0x0);
+     *   trans.commit();
+     *   uint32_t release = fw.get();
+     */
+    class GEMHwTransaction
+      {
+      public:
+        /**
+         * A 1500 byte MTU leaves 368 words of UDP payload, keep some margin for the transport
+         */
+        static const size_t DEFAULT_MAX_PACKET_WORDS = 350;
+
+        /**
+         * @param device the device to operate on, must outlive the transaction
+         * @param maxPacketWords maximum size in 32-bit words of the request or the reply of one dispatch
+         */
+        explicit GEMHwTransaction(GEMHwDevice& device, size_t const maxPacketWords=DEFAULT_MAX_PACKET_WORDS);
+
+        ~GEMHwTransaction();
+
+        /**
+         * @brief queue a register read
+         * @throws gem::hw::exception::HardwareProblem if the register is not in the address table
+         */
+        std::shared_future<uint32_t> read(std::string const& regName);
+        std::shared_future<uint32_t> read(GEMHwDevice::RegHandle const& handle);
+
+        /**
+         * @brief queue a register read, value is filled on commit() and must outlive the transaction
+         */
+        void read(std::string const& regName, uint32_t& value);
+        void read(GEMHwDevice::RegHandle const& handle, uint32_t& value);
+
+        /**
+         * @brief queue a block read of nWords words, the size of the node if nWords is 0
+         */
+        std::shared_future<std::vector<uint32_t> > readBlock(std::string const& regName, size_t const nWords=0);
+
+        /**
+         * @brief queue a block read, values is filled on commit() and must outlive the transaction
+         */
+        void readBlock(std::string const& regName, std::vector<uint32_t>& values, size_t const nWords=0);
+
+        /**
+         * @brief queue a register write, masked registers only modify their own bits
+         */
+        void write(std::string const& regName, uint32_t const val);
+        void write(GEMHwDevice::RegHandle const& handle, uint32_t const val);
+
+        /**
+         * @brief queue an IPbus read-modify-write on the full 32-bit word of a register
+         *        new value = (old value & andTerm) | orTerm
+         *
+         * @retval the value returned by the IPbus RMW transaction
+         */
+        std::shared_future<uint32_t> rmwBits(std::string const& regName, uint32_t const andTerm, uint32_t const orTerm);
+
+        /**
+         * @brief execute all queued operations and empty the transaction
+         * @details When a chunk of reads fails with a transient IPbus error it is retried as
+         *          allowed by the GEMHwRetryPolicy of the device. A chunk with writes, RMWs or
+         *          FIFO block reads is never retried, part of it may have been applied before the
+         *          error, and it fails on the first error. After a failure the futures of the
+         *          failed chunk and of all following operations hold the exception, the chunks
+         *          before it have been applied
+         *
+         * @throws gem::hw::exception::HardwareProblem if an operation could not be executed
+         */
+        void commit();
+
+        /**
+         * @brief drop all queued operations without executing them
+         */
+        void clear() { m_operations.clear(); };
+
+        size_t size()  const { return m_operations.size(); };
+        bool   empty() const { return m_operations.empty(); };
+
+        /**
+         * @brief number of dispatch calls of the last commit()
+         */
+        size_t dispatchCount() const { return m_dispatchCount; };
+
+      private:
+        struct OperationType {
+          enum EOperationType {
+            READ       = 0x0,
+            WRITE      = 0x1,
+            READ_BLOCK = 0x2,
+            RMW_BITS   = 0x3
+          } OperationType;
+        };
+
+        struct Operation {
+          int                    type;
+          GEMHwDevice::RegHandle handle;
+          uint32_t               value;    ///< value to write, or andTerm for RMW_BITS
+          uint32_t               orTerm;
+          size_t                 nWords;
+          uint32_t*              wordRef;
+          std::vector<uint32_t>* blockRef;
+
+          std::promise<uint32_t>                wordResult;
+          std::promise<std::vector<uint32_t> > blockResult;
+
+          Operation() : type(OperationType::READ), value(0), orTerm(0), nWords(0), wordRef(NULL), blockRef(NULL) {};
+
+          size_t requestWords() const;
+          size_t replyWords()   const;
+          bool   repeatable()   const;  ///< true if executing the operation twice is harmless
+        };
+
+        typedef std::vector<Operation>::iterator op_iterator;
+
+        Operation& queue(int const type, GEMHwDevice::RegHandle const& handle);
+
+        /**
+         * @brief send the operations in [first,last) with one dispatch, retried if all are repeatable
+         * @returns an empty string on success, the error otherwise
+         */
+        std::string execute(op_iterator first, op_iterator last);
+
+        void fail(op_iterator first, op_iterator last, std::string const& msg);
+
+        GEMHwDevice& m_device;
+        size_t       m_maxPacketWords;
+        size_t       m_dispatchCount;
+
+        std::vector<Operation> m_operations;
+
+        log4cplus::Logger m_gemLogger;
+
+        // Prevent copying
+        GEMHwTransaction(GEMHwTransaction const&);
+        GEMHwTransaction& operator=(GEMHwTransaction const&);
+      };
+
+  }  // namespace gem::hw
+}  // namespace gem
+
+#endif  // GEM_HW_GEMHWTRANSACTION_H
@@ -3,10 +3,15 @@
 #ifndef GEM_HW_HWGENERICAMC_H
 #define GEM_HW_HWGENERICAMC_H
 
+#include <array>
+#include <chrono>
+#include <vector>
+
 #include "gem/hw/GEMHwDevice.h"
 
 #include "gem/hw/exception/Exception.h"
 #include "gem/hw/GenericAMCSettingsEnums.h"
+#include "gem/hw/utils/GEMPhaseStatistics.h"
 
 namespace gem {
   namespace hw {
@@ -53,6 +58,57 @@ namespace gem {
             return; }
         } AMCIPBusCounters;
 
+        /**
+         * @struct AMCLinkHealth
+         * @brief This structure stores the error and data counters of one OptoHybrid link, read by getLinkHealth
+         * @var AMCLinkHealth::Link
+         * Link is the number of the OptoHybrid link
+         * @var AMCLinkHealth::TrackingErrors
+         * TrackingErrors is the error count of the tracking data link
+         * @var AMCLinkHealth::TriggerErrors
+         * TriggerErrors is the sum of the missed comma and not valid counts of the two trigger links
+         * @var AMCLinkHealth::DataPackets
+         * DataPackets is the count of VFAT blocks received on the tracking data link
+         */
+        typedef struct AMCLinkHealth {
+          uint8_t  Link;
+          uint32_t TrackingErrors;
+          uint32_t TriggerErrors;
+          uint32_t DataPackets;
+
+        AMCLinkHealth() : Link(0), TrackingErrors(0), TriggerErrors(0), DataPackets(0) {}
+        } AMCLinkHealth;
+
+        typedef std::array<uint32_t, gem::hw::utils::N_CLUSTER_SIZES> cluster_counters;
+
+        /**
+         * @struct AMCTriggerRates
+         * @brief This structure stores the trigger and cluster rates of all OptoHybrids of an AMC,
+         *        read together by getTriggerRates
+         * @var AMCTriggerRates::ORTriggerRate
+         * ORTriggerRate is the rate of the OR of the triggers of all OptoHybrids
+         * @var AMCTriggerRates::TriggerRate
+         * TriggerRate is the trigger rate of each OptoHybrid
+         * @var AMCTriggerRates::ClusterRate
+         * ClusterRate is the rate of the sbit clusters of each size, for each OptoHybrid
+         * @var AMCTriggerRates::TriggerCount
+         * TriggerCount is the trigger count of each OptoHybrid, empty unless the counts were requested
+         * @var AMCTriggerRates::ClusterCount
+         * ClusterCount is the count of the sbit clusters of each size, empty unless the counts were requested
+         * @var AMCTriggerRates::Timestamp
+         * Timestamp is the time of the reading, the middle of the dispatch
+         */
+        typedef struct AMCTriggerRates {
+          uint32_t                              ORTriggerRate;
+          std::vector<uint32_t>                 TriggerRate;
+          std::vector<cluster_counters>         ClusterRate;
+          std::vector<uint32_t>                 TriggerCount;
+          std::vector<cluster_counters>         ClusterCount;
+          std::chrono::steady_clock::time_point Timestamp;
+
+        AMCTriggerRates() : ORTriggerRate(0) {}
+        } AMCTriggerRates;
+
 
         /**
          * Constructors, the preferred constructor is with a connection file and device name
@@ -198,6 +254,20 @@ namespace gem {
          */
         virtual void LinkReset(uint8_t const& gtx, uint8_t const& resets);
 
+        /**
+         * @brief Reset the error and data counters of the OptoHybrid links, in one transaction
+         * @details the firmware resets the counters of all links together, of both the OH_LINKS
+         *          and the TRIGGER modules
+         */
+        virtual void resetLinkCounters();
+
+        /**
+         * @brief Read the error and data counters of the active links in the mask, in one transaction
+         * @param linkMask links to read, links that are not active are skipped
+         * @throws gem::hw::exception::HardwareProblem if the read fails
+         */
+        virtual std::vector<AMCLinkHealth> getLinkHealth(uint32_t const& linkMask);
+
         /**
          * Reset the all gtx status registers
          * @param uint8_t resets control which bits to reset
@@ -574,38 +644,87 @@ namespace gem {
          */
         int checkPLLLock(uint32_t readAttempts);
 
+        /**
+         * @brief Sample the lock status of the MMCM PLL, without resetting it
+         * @details One sample is read every intervalUsec, each in its own transaction, as in samplePhase
+         * @param nSamples number of reads of the lock status
+         * @param intervalUsec time between the starts of two reads
+         * @returns number of samples that found the PLL locked
+         * @throws gem::hw::exception::HardwareProblem if the reads fail
+         */
+        uint32_t samplePLLLock(uint32_t const nSamples, uint32_t const intervalUsec=PHASE_SAMPLE_INTERVAL_USEC);
+
         /**
          * @brief Check the phase mean of the MMCM PLL
          * @param Number of times to read the phase mean
-         *        * 0 reads means take the mean calculated in FW
-         *        * 1+ reads means take the mean of the specified reads of the phase directly
+         *        * 0 or 1 reads means take the mean calculated in FW
+         *        * 2+ reads means take the mean of the specified reads of the phase, computed on the card
          * @returns Mean value of the MMCH phase
          */
         double getMMCMPhaseMean(uint32_t readAttempts);
 
         /**
          * @brief Check the phase median of the MMCM PLL
+         * @details Samples the phase from the host with getMMCMPhaseStatistics, which takes
+         *          readAttempts*PHASE_SAMPLE_INTERVAL_USEC and one IPbus transaction per read
          * @param Number of times to read the phase and compute the median
          * @returns Median value of the MMCH phase
          */
         double getMMCMPhaseMedian(uint32_t readAttempts);
 
+        /**
+         * @brief Sample the phase of the MMCM PLL
+         * @details Blocks for readAttempts*PHASE_SAMPLE_INTERVAL_USEC, use getMMCMPhaseMean for the mean alone
+         * @param Number of times to read the phase, see samplePhase
+         * @throws gem::hw::exception::ValueError if readAttempts is 0
+         * @returns Statistics of the MMCM phase samples
+         */
+        gem::hw::utils::GEMPhaseStatistics getMMCMPhaseStatistics(uint32_t readAttempts);
+
         /**
          * @brief Check the phase mean of the GTH PLL
          * @param Number of times to read the phase mean
-         *        * 0 reads means take the mean calculated in FW
-         *        * 1+ reads means take the mean of the specified reads of the phase directly
+         *        * 0 or 1 reads means take the mean calculated in FW
+         *        * 2+ reads means take the mean of the specified reads of the phase, computed on the card
          * @returns Mean value of the GTH phase
          */
         double getGTHPhaseMean(uint32_t readAttempts);
 
         /**
          * @brief Check the phase median of the GTH PLL
+         * @details Samples the phase from the host with getGTHPhaseStatistics, which takes
+         *          readAttempts*PHASE_SAMPLE_INTERVAL_USEC and one IPbus transaction per read
          * @param Number of times to read the phase and compute the median
          * @returns Median value of the MMCH phase
          */
         double getGTHPhaseMedian(uint32_t readAttempts);
 
+        /**
+         * @brief Sample the phase of the GTH PLL
+         * @details Blocks for readAttempts*PHASE_SAMPLE_INTERVAL_USEC, use getGTHPhaseMean for the mean alone
+         * @param Number of times to read the phase, see samplePhase
+         * @throws gem::hw::exception::ValueError if readAttempts is 0
+         * @returns Statistics of the GTH phase samples
+         */
+        gem::hw::utils::GEMPhaseStatistics getGTHPhaseStatistics(uint32_t readAttempts);
+
+        /**
+         * @brief Read a phase monitor register repeatedly and accumulate the statistics
+         * @details One sample is read every intervalUsec, each in its own transaction, so that the
+         *          samples follow the phase over nSamples*intervalUsec rather than catching the same
+         *          value many times within one packet. The device is not locked between the samples.
+         *          The memory used does not depend on the number of samples.
+         * @param regName register relative to the device base node, e.g., TTC.STATUS.CLK.TTC_PM_PHASE
+         * @param nSamples number of reads
+         * @param intervalUsec time between the starts of two reads
+         * @throws gem::hw::exception::ValueError if nSamples is 0
+         * @throws gem::hw::exception::HardwareProblem if the reads fail
+         */
+        gem::hw::utils::GEMPhaseStatistics samplePhase(std::string const& regName, uint32_t const nSamples,
+                                                       uint32_t const intervalUsec=PHASE_SAMPLE_INTERVAL_USEC);
+
+        static const uint32_t PHASE_SAMPLE_INTERVAL_USEC = 1000;  ///< default time between two phase samples
+
         /**
          * @brief Reset the counters of the TTC module
          */
@@ -748,6 +867,17 @@ namespace gem {
          */
         virtual uint32_t getOptoHybridClusterCount(uint8_t const& oh, uint8_t const& cs);
 
+        /**
+         * @brief Returns the trigger and cluster rates of all OptoHybrids, read in one transaction
+         * @details The registers are resolved once and kept, so that the rates can be polled at a
+         *          high cadence: the OR rate plus 9 registers per OptoHybrid travel in one IPbus
+         *          packet, instead of one round trip per getOptoHybridTriggerRate or
+         *          getOptoHybridClusterRate call.
+         * @param withCounts also read the trigger and cluster counts
+         * @throws gem::hw::exception::HardwareProblem if the read fails
+         */
+        virtual AMCTriggerRates getTriggerRates(bool const& withCounts=false);
+
         /**
          * @brief Returns the last cluster of seen sbit clusters of a given size from a specific OptoHybrid
          * @param OptoHybrid to obtain the last cluster for
@@ -816,6 +946,15 @@ namespace gem {
         int m_crate;  ///< Crate number the AMC is housed in
         int m_slot;   ///< Slot number in the uTCA shelf the AMC is sitting in
 
+        /**
+         * @brief resolve the registers read by getTriggerRates, for the supported OptoHybrids
+         * @details must be called with m_hwLock held
+         */
+        void resolveTriggerRateRegisters();
+
+        std::vector<RegHandle> m_triggerRateRegs;   ///< OR rate, then per OptoHybrid the trigger and cluster rates, guarded by m_hwLock
+        std::vector<RegHandle> m_triggerCountRegs;  ///< per OptoHybrid the trigger and cluster counts, guarded by m_hwLock
+
       private:
         // Do not use default constructor. HwGenericAMC object should only be made using
         // either connection file method or with a list of URIs and address tables
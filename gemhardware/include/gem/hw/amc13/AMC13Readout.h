@@ -44,9 +44,26 @@ namespace gem {
 
           virtual int readout(unsigned int expected, unsigned int* eventNumbers, std::vector< ::toolbox::mem::Reference* >& data);
 
-          int dumpData();
+          /**
+           * @brief Write the events in the AMC13 monitor buffer to the current chunk file
+           * @details the drain controller decides how many events each pass reads, and defers the
+           *          read while the buffer holds fewer events than arrive during one
+           * @param data filled with the pool frames holding the events, when compression is enabled
+           * @returns the number of events written
+           */
+          int dumpData(std::vector< ::toolbox::mem::Reference* >& data);
 
         private:
+          /**
+           * capacity of the AMC13 monitor buffer in events, unless the fifoDepth setting says otherwise
+           */
+          static const uint32_t MONITOR_BUFFER_EVENTS = 512;
+
+          /**
+           * @brief free the event kept by dumpData, e.g., from a previous run
+           */
+          void dropPendingEvent();
+
           amc13_shared_ptr p_amc13;
           xdata::String  m_cardName;
           xdata::Integer m_crateID, m_slot;
@@ -54,6 +71,13 @@ namespace gem {
           int nwrote_global;
           std::clock_t m_start;
           double m_duration;
+
+          // output stream buffer, allocated by the readout task on its NUMA node
+          std::shared_ptr<gem::readout::GEMReadoutBuffer> p_outBuffer;
+
+          // event already read from the AMC13 when no pool frame was free, written first by the next drain
+          uint64_t* p_pendingEvent;
+          size_t    m_pendingSize;
       };
     }  // namespace gem::hw::amc13
   }  // namespace gem::hw
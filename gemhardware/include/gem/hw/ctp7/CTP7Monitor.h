@@ -4,6 +4,7 @@
 #define GEM_HW_CTP7_CTP7MONITOR_H
 
 #include "gem/base/GEMMonitor.h"
+#include "gem/hw/GEMHwMonitorReadList.h"
 #include "gem/hw/ctp7/exception/Exception.h"
 #include "gem/hw/ctp7/HwCTP7.h"
 
@@ -35,6 +36,7 @@ namespace gem {
 
       private:
         std::shared_ptr<HwCTP7> p_ctp7;
+        GEMHwMonitorReadList m_readList;
 
         // system_monitorables
         //  "BOARD_ID"
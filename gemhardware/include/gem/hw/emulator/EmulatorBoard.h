@@ -0,0 +1,256 @@
+/** @file EmulatorBoard.h */
+
+#ifndef GEM_HW_EMULATOR_EMULATORBOARD_H
+#define GEM_HW_EMULATOR_EMULATORBOARD_H
+
+#include <stdint.h>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "gem/hw/GEMHwAddressTable.h"
+
+#include "gem/utils/GEMLogging.h"
+
+namespace gem {
+  namespace hw {
+    namespace emulator {
+
+      /**
+       * @brief Register content of one emulated board, built from its uhal address tables
+       * @details Every node of the address tables is a word in memory, with the permissions of the
+       *          table: reading a write-only word, writing a read-only word or accessing an address
+       *          that is not in the tables is a bus error. Several tables can be added, e.g., the AMC
+       *          table and the tables of its OptoHybrid links, nodes at the same address share the word.
+       *          On top of the plain memory the board models, by node name:
+       *          - counters, read-only nodes ending in CNT or COUNT or under a COUNTERS node, that count
+       *            at CounterRate, or at ErrorCounterRate for error counters (ERR, MISSED, NOT_VALID,
+       *            TIMEOUT, CRC, OVF, UNF), and are cleared by writing a RESET node of the same block
+       *            whose name contains CNT or COUNT
+       *          - read-only RATE nodes, which read CounterRate, and LOCK/READY status bits, which read 1
+       *          - FIFOs, readable non-incremental nodes, fed by the synthetic DataSource at FIFORate up to
+       *            FIFODepth words, with DEPTH/OCCUPANCY/EMPTY/FULL/VALID status nodes next to them and
+       *            cleared by writing a RESET or FLUSH node next to them, an empty FIFO reads 0
+       *          - the OptoHybrid VFAT broadcast, X.Broadcast.Request.<reg> reads or writes <reg> of every
+       *            VFAT X.VFATS.VFAT<n> not in X.Broadcast.Mask, X.Broadcast.Running is set for
+       *            BroadcastUsec and the read values are queued in X.Broadcast.Results as (n << 8) | value
+       *          - the OptoHybrid scan module X.ScanController.<TYPE>, START runs a scan from CONF.MIN to
+       *            CONF.MAX by CONF.STEP, MONITOR.STATUS is set for ScanMsec and an S-curve of CONF.NTRIGS
+       *            triggers is queued in RESULTS, or RESULTS.VFAT<n>, as (point << 24) | hits
+       *
+       * @usage
+       *   gem::hw::emulator::EmulatorBoard board("amc01");
+       *   board.addAddressTable(*registry.getAddressTable("file://uhal_gem_amc_glib.xml"));
+       *   uint32_t value;
+       *   board.read(board.getAddress("GEM_AMC.GEM_SYSTEM.RELEASE"), value);
+       */
+      class EmulatorBoard
+        {
+        public:
+          typedef std::chrono::steady_clock clock;
+
+          /**
+           * @brief the word a FIFO returns, from its address and the number of words it produced before
+           */
+          typedef std::function<uint32_t(uint32_t const address, uint64_t const index)> data_source;
+
+          /**
+           * @struct Settings
+           * @brief Behaviour of the emulated registers
+           * @var Settings::CounterRate
+           * CounterRate is the rate of the counters and the value of the rate registers, in Hz
+           * @var Settings::ErrorCounterRate
+           * ErrorCounterRate is the rate of the error counters, in Hz
+           * @var Settings::FIFORate
+           * FIFORate is the rate at which the FIFOs are filled, in words per second
+           * @var Settings::FIFODepth
+           * FIFODepth is the maximum number of words in a FIFO
+           * @var Settings::BroadcastUsec
+           * BroadcastUsec is the time a VFAT broadcast runs
+           * @var Settings::ScanMsec
+           * ScanMsec is the time a scan of the scan module runs
+           * @var Settings::DataSource
+           * DataSource produces the words of the FIFOs, pseudo-random words by default
+           */
+          typedef struct Settings {
+            double      CounterRate;
+            double      ErrorCounterRate;
+            double      FIFORate;
+            uint32_t    FIFODepth;
+            uint32_t    BroadcastUsec;
+            uint32_t    ScanMsec;
+            data_source DataSource;
+
+            Settings();
+          } Settings;
+
+          explicit EmulatorBoard(std::string const& name, Settings const& settings=Settings());
+
+          /**
+           * @brief add the nodes of an address table, nodes already known by name are kept
+           */
+          void addAddressTable(GEMHwAddressTable const& table);
+
+          std::string getName() const { return m_name; };
+
+          /**
+           * @retval the number of emulated words
+           */
+          size_t size() const;
+
+          /**
+           * @brief read a word, a FIFO word pops one word of the FIFO
+           * @retval false on a bus error
+           */
+          bool read(uint32_t const address, uint32_t& value);
+
+          /**
+           * @brief write a word, only the writable bits of the word change
+           * @retval false on a bus error
+           */
+          bool write(uint32_t const address, uint32_t const value);
+
+          /**
+           * @brief IPbus read-modify-write bits, new value = (old value & andTerm) | orTerm
+           * @retval false on a bus error
+           */
+          bool rmwBits(uint32_t const address, uint32_t const andTerm, uint32_t const orTerm, uint32_t& previous);
+
+          /**
+           * @brief IPbus read-modify-write sum, new value = old value + addend
+           * @retval false on a bus error
+           */
+          bool rmwSum(uint32_t const address, uint32_t const addend, uint32_t& previous);
+
+          /**
+           * @retval the address of a node
+           * @throws gem::hw::exception::ConfigurationProblem if the node is not in the tables
+           */
+          uint32_t getAddress(std::string const& regName) const;
+
+          /**
+           * @brief the value of a node, without side effects and regardless of its permission
+           * @throws gem::hw::exception::ConfigurationProblem if the node is not in the tables
+           */
+          uint32_t peek(std::string const& regName);
+
+          /**
+           * @brief set the value of a node regardless of its permission, e.g., to inject an error,
+           *        a counter counts on from the new value
+           * @throws gem::hw::exception::ConfigurationProblem if the node is not in the tables
+           */
+          void poke(std::string const& regName, uint32_t const value);
+
+        private:
+          /**
+           * A 32-bit word of the address space, the union of the nodes at its address
+           */
+          struct Word {
+            uint32_t value;
+            uint32_t readMask;   ///< bits of the readable nodes
+            uint32_t writeMask;  ///< bits of the writable nodes
+            bool     port;       ///< a non-incremental node, a FIFO if readable
+
+            Word() : value(0), readMask(0), writeMask(0), port(false) {};
+          };
+
+          /**
+           * A counter node, the upper word of a 64-bit counter reads the count shifted by 32 bits
+           */
+          struct Counter {
+            std::string       name;
+            uint32_t          address;
+            uint32_t          mask;
+            unsigned          shift;
+            double            rate;
+            uint64_t          base;   ///< count at start
+            clock::time_point start;
+
+            uint64_t count(clock::time_point const& now) const;
+          };
+
+          struct Queue {
+            std::deque<uint32_t> words;
+            bool                 synthetic;  ///< fed by the data source, otherwise by a broadcast or a scan
+            uint64_t             produced;
+            clock::time_point    lastFill;
+
+            Queue() : synthetic(false), produced(0) {};
+          };
+
+          /**
+           * read hooks compute the value of a word without side effects, read actions are the side
+           * effects of reading a word, write hooks the side effects of writing it
+           */
+          typedef std::function<uint32_t(uint32_t const word)> read_hook;
+          typedef std::function<void(uint32_t const word)>     write_hook;
+
+          /**
+           * @brief rebuild the behaviours of the nodes, after a table was added
+           */
+          void build();
+
+          void addCounters();
+          void addStatus();
+          void addFIFOs();
+          void addBroadcasts();
+          void addScans();
+
+          GEMHwAddressTable::Register const* findRegister(std::string const& regName) const;
+
+          /**
+           * @brief the register names under a node, without the node name and its dot
+           */
+          std::vector<std::string> getChildren(std::string const& parent) const;
+
+          void addReadHook(uint32_t const address, read_hook hook) { m_readHooks[address].push_back(hook); };
+          void addReadAction(uint32_t const address, write_hook action) { m_readActions[address].push_back(action); };
+          void addWriteHook(uint32_t const address, write_hook hook) { m_writeHooks[address].push_back(hook); };
+
+          /**
+           * @brief a FIFO or result queue, created empty
+           */
+          Queue& getQueue(uint32_t const address, bool const synthetic);
+
+          void fill(uint32_t const address, Queue& queue);
+
+          /**
+           * @brief read and write without locking m_mutex
+           */
+          bool readLocked(uint32_t const address, uint32_t& value);
+          bool writeLocked(uint32_t const address, uint32_t const value);
+
+          uint32_t readWord(uint32_t const address);
+          void     writeWord(uint32_t const address, uint32_t const value);
+
+          uint32_t readField(std::string const& regName);
+          void     writeField(std::string const& regName, uint32_t const value);
+
+          std::string       m_name;
+          Settings          m_settings;
+          log4cplus::Logger m_gemLogger;
+
+          mutable std::mutex m_mutex;  ///< guards the members below
+          std::unordered_map<std::string, GEMHwAddressTable::Register> m_registers;
+          std::unordered_map<uint32_t, Word>                           m_words;
+          std::vector<Counter>                                         m_counters;
+          std::unordered_map<uint32_t, std::vector<size_t> >           m_counterIndex;  ///< counters by address
+          std::unordered_map<uint32_t, Queue>                          m_queues;
+          std::unordered_map<uint32_t, std::vector<read_hook> >        m_readHooks;
+          std::unordered_map<uint32_t, std::vector<write_hook> >       m_readActions;
+          std::unordered_map<uint32_t, std::vector<write_hook> >       m_writeHooks;
+
+          // Prevent copying
+          EmulatorBoard(EmulatorBoard const&);
+          EmulatorBoard& operator=(EmulatorBoard const&);
+        };
+
+    }  // namespace gem::hw::emulator
+  }  // namespace gem::hw
+}  // namespace gem
+
+#endif  // GEM_HW_EMULATOR_EMULATORBOARD_H
@@ -0,0 +1,216 @@
+/** @file EmulatorServer.h */
+
+#ifndef GEM_HW_EMULATOR_EMULATORSERVER_H
+#define GEM_HW_EMULATOR_EMULATORSERVER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gem/hw/emulator/EmulatorBoard.h"
+
+#include "gem/utils/GEMLogging.h"
+
+namespace gem {
+  namespace hw {
+    namespace emulator {
+
+      /**
+       * @brief IPbus 2.0 UDP target serving emulated boards, one per local port
+       * @details Speaks the protocol uhal speaks to a board or a ControlHub, so the unchanged
+       *          managers, tools and uhal itself run against it when the connection file points
+       *          them to it, e.g., uri="ipbusudp-2.0://localhost:50001". The status and resend
+       *          packets are answered as by the firmware, and control packets out of sequence are
+       *          ignored, so the packet loss recovery of uhal is exercised too.
+       *          The link can be degraded on purpose: every reply waits LatencyUsec plus up to
+       *          JitterUsec, requests and replies are dropped at the given rates, and a transaction
+       *          fails with a bus error at BusErrorRate. Every board is served by its own thread,
+       *          so the latency of a packet delays the packets behind it to the same board, as on a
+       *          real link, but not the packets to the other boards.
+       *          The server needs the uhal, xcept, toolbox and log4cplus libraries of an XDAQ
+       *          installation, but no XDAQ executive nor hardware.
+       *
+       * @usage
+       *   gem::hw::emulator::EmulatorServer server;
+       *   server.addBoards("connections_emulator.xml");
+       *   server.start();
+       */
+      class EmulatorServer
+        {
+        public:
+          /**
+           * @struct Settings
+           * @brief Behaviour of the emulated link
+           * @var Settings::LatencyUsec
+           * LatencyUsec is the time added before every reply
+           * @var Settings::JitterUsec
+           * JitterUsec is the maximum of the random time added on top of LatencyUsec
+           * @var Settings::RequestLossRate
+           * RequestLossRate is the fraction of the request packets dropped
+           * @var Settings::ReplyLossRate
+           * ReplyLossRate is the fraction of the reply packets dropped, they can still be resent
+           * @var Settings::BusErrorRate
+           * BusErrorRate is the fraction of the transactions that fail with a bus error
+           * @var Settings::Seed
+           * Seed of the random numbers, the same seed gives the same losses and errors
+           */
+          typedef struct Settings {
+            uint32_t LatencyUsec;
+            uint32_t JitterUsec;
+            double   RequestLossRate;
+            double   ReplyLossRate;
+            double   BusErrorRate;
+            uint32_t Seed;
+
+            Settings();
+          } Settings;
+
+          /**
+           * @struct Statistics
+           * @brief Packets handled since the server was created
+           * @var Statistics::Requests
+           * Requests is the number of packets received, including the dropped ones
+           * @var Statistics::Replies
+           * Replies is the number of packets sent
+           * @var Statistics::Dropped
+           * Dropped is the number of requests and replies dropped on purpose
+           * @var Statistics::OutOfSequence
+           * OutOfSequence is the number of control packets ignored because of their packet ID
+           * @var Statistics::Resent
+           * Resent is the number of replies sent again on a resend request
+           * @var Statistics::BusErrors
+           * BusErrors is the number of transactions that failed, on purpose or not
+           */
+          typedef struct Statistics {
+            uint64_t Requests;
+            uint64_t Replies;
+            uint64_t Dropped;
+            uint64_t OutOfSequence;
+            uint64_t Resent;
+            uint64_t BusErrors;
+
+          Statistics() : Requests(0), Replies(0), Dropped(0), OutOfSequence(0), Resent(0), BusErrors(0) {};
+          } Statistics;
+
+          explicit EmulatorServer(Settings const& settings=Settings());
+
+          ~EmulatorServer();
+
+          /**
+           * @brief serve a board on a local UDP port, right away if the server is running
+           * @throws gem::hw::exception::ConfigurationProblem if the port is taken or cannot be bound
+           */
+          void addBoard(uint16_t const port, std::shared_ptr<EmulatorBoard> board);
+
+          /**
+           * @brief serve all the devices of a uhal connection file, on the ports of their URIs
+           * @details the devices are grouped by local port, each port serves one board made of the
+           *          address tables of all its devices, e.g., an AMC and its OptoHybrids behind it
+           *
+           * @param connectionFile the uhal connection file, file:// is added if it has no protocol
+           * @param settings the behaviour of the boards
+           * @retval the ports of the boards added
+           * @throws gem::hw::exception::ConfigurationProblem if a device has no usable port
+           */
+          std::vector<uint16_t> addBoards(std::string const& connectionFile,
+                                          EmulatorBoard::Settings const& settings=EmulatorBoard::Settings());
+
+          /**
+           * @retval the board on a port, or nullptr
+           */
+          std::shared_ptr<EmulatorBoard> getBoard(uint16_t const port) const;
+
+          /**
+           * @brief serve every board from a thread of its own
+           * @throws std::system_error if a thread cannot be started, the server is then stopped
+           */
+          void start();
+
+          /**
+           * @brief stop serving, the boards keep their content
+           */
+          void stop();
+
+          bool isRunning() const { return m_running; };
+
+          Statistics getStatistics() const;
+
+          /**
+           * @retval the local port of an IPbus URI, 0 if it has none,
+           *         the target port for a ControlHub URI
+           */
+          static uint16_t getPort(std::string const& uri);
+
+        private:
+          static const size_t   MAX_PACKET_BYTES = 1500;  ///< the MTU the server announces
+          static const uint32_t N_REPLY_BUFFERS  = 16;    ///< replies kept for resend requests
+
+          /**
+           * One emulated board and the IPbus state of its port
+           */
+          struct Endpoint {
+            uint16_t                       port;
+            int                            socket;
+            std::shared_ptr<EmulatorBoard> board;
+            uint16_t                       nextId;    ///< the packet ID of the next control packet expected
+            std::map<uint16_t, std::vector<uint32_t> > replies;  ///< the last replies by packet ID
+            std::deque<uint16_t>           replyOrder;
+            std::deque<uint32_t>           received;  ///< headers of the last control requests
+            std::deque<uint32_t>           sent;      ///< headers of the last control replies
+            std::thread                    server;    ///< the thread serving the port
+
+            Endpoint() : port(0), socket(-1), nextId(1) {};
+          };
+
+          /**
+           * @brief serve one board until the server is stopped, the endpoint state is only touched
+           *        by this thread, with m_mutex held
+           */
+          void serve(Endpoint& endpoint);
+
+          /**
+           * @brief answer one packet, a packet that gets no answer leaves reply empty
+           */
+          void handle(Endpoint& endpoint, std::vector<uint32_t> const& request, std::vector<uint32_t>& reply);
+
+          void handleControl(Endpoint& endpoint, std::vector<uint32_t> const& request, std::vector<uint32_t>& reply);
+
+          void handleStatus(Endpoint& endpoint, std::vector<uint32_t>& reply) const;
+
+          /**
+           * @brief run one transaction
+           * @param pos the position of the transaction header in the request, moved past the transaction
+           * @retval false if the processing of the packet stops here
+           */
+          bool transaction(EmulatorBoard& board, std::vector<uint32_t> const& request, size_t& pos,
+                           std::vector<uint32_t>& reply);
+
+          bool chance(double const rate);
+
+          Settings          m_settings;
+          log4cplus::Logger m_gemLogger;
+
+          mutable std::mutex             m_mutex;  ///< guards the members below, not held during the latency
+          std::map<uint16_t, Endpoint>   m_endpoints;
+          Statistics                     m_statistics;
+          std::mt19937                   m_random;
+
+          std::atomic<bool> m_running;
+
+          // Prevent copying
+          EmulatorServer(EmulatorServer const&);
+          EmulatorServer& operator=(EmulatorServer const&);
+        };
+
+    }  // namespace gem::hw::emulator
+  }  // namespace gem::hw
+}  // namespace gem
+
+#endif  // GEM_HW_EMULATOR_EMULATORSERVER_H
@@ -8,6 +8,9 @@
 #include "gem/base/GEMFSMApplication.h"
 //#include "gem/hw/glib/GLIBSettings.h"
 
+#include "gem/hw/GEMHwCrateLinkHealth.h"
+#include "gem/hw/GEMHwCrateTriggerRates.h"
+#include "gem/hw/GEMHwTaskGroup.h"
 #include "gem/hw/glib/exception/Exception.h"
 
 #include "gem/utils/soap/GEMSOAPToolBox.h"
@@ -73,8 +76,36 @@ namespace gem {
            */
           void dumpGLIBFIFO(xgi::Input* in, xgi::Output* out);
 
+          /**
+           * @brief write the IPbus profile of every GLIB to IPbusProfileDir, if set
+           */
+          void dumpIPbusProfiles();
+
+          /**
+           * @brief the IPbus profile of every GLIB as text, see GEMHwProfiler::dump
+           */
+          void dumpIPbusProfiles(xgi::Input* in, xgi::Output* out);
+
+          /**
+           * @brief the trigger and cluster rates of all GLIBs as JSON, read when requested,
+           *        see GEMHwCrateTriggerRates
+           */
+          void triggerRates(xgi::Input* in, xgi::Output* out);
+
+          /**
+           * @brief check the OptoHybrid links and PLL lock of all GLIBs and report them as JSON,
+           *        see GEMHwCrateLinkHealth
+           */
+          void linkHealth(xgi::Input* in, xgi::Output* out);
+
         private:
           void     createGLIBInfoSpaceItems(is_toolbox_ptr is_glib, glib_shared_ptr glib);
+
+          /**
+           * @brief configure the GLIB in a slot, run from a GEMHwTaskGroup
+           */
+          void     configureSlot(unsigned const slot);
+
           uint16_t m_amcEnableMask;
 
           toolbox::task::WorkLoop *p_amc_wl; ///< paralelize the calls to different AMCs
@@ -140,6 +171,8 @@ namespace gem {
           std::array<glib_shared_ptr, MAX_AMCS_PER_CRATE>              m_glibs;
           std::array<std::shared_ptr<GLIBMonitor>, MAX_AMCS_PER_CRATE> m_glibMonitors;
           std::array<is_toolbox_ptr, MAX_AMCS_PER_CRATE>               is_glibs;
+          gem::hw::GEMHwCrateTriggerRates                              m_triggerRates;  ///< rates of all connected GLIBs
+          gem::hw::GEMHwCrateLinkHealth                                m_linkHealth;    ///< link checks of all connected GLIBs
 
           xdata::Vector<xdata::Bag<GLIBInfo> > m_glibInfo;  // [MAX_AMCS_PER_CRATE];
           xdata::String                        m_amcSlots;
@@ -147,6 +180,10 @@ namespace gem {
           xdata::Boolean                       m_uhalPhaseShift; // FIXME OBSOLETE
           xdata::Boolean                       m_bc0LockPhaseShift;
           xdata::Boolean                       m_relockPhase;
+          xdata::Boolean                       m_useIOThread;  ///< give every GLIB its own I/O thread, see GEMHwExecutor
+          xdata::UnsignedInteger32             m_maxConfigureThreads;  ///< GLIBs configured concurrently, see GEMHwTaskGroup
+          xdata::Boolean                       m_profileIPbus;     ///< record the IPbus accesses of every GLIB, see GEMHwProfiler
+          xdata::String                        m_ipbusProfileDir;  ///< where the profiles are written at stop, nothing is written if empty
 
 	  uint32_t m_lastLatency, m_lastVT1, m_lastVT2;
         };  // class GLIBManager
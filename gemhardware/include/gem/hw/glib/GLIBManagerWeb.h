@@ -53,6 +53,18 @@ namespace gem {
           void dumpGLIBFIFO(xgi::Input *in, xgi::Output *out)
             throw (xgi::exception::Exception);
 
+          void ipbusProfilePage(xgi::Input *in, xgi::Output *out)
+            throw (xgi::exception::Exception);
+
+          void dumpIPbusProfiles(xgi::Input *in, xgi::Output *out)
+            throw (xgi::exception::Exception);
+
+          void triggerRates(xgi::Input *in, xgi::Output *out)
+            throw (xgi::exception::Exception);
+
+          void linkHealth(xgi::Input *in, xgi::Output *out)
+            throw (xgi::exception::Exception);
+
         private:
           size_t activeCard;
 
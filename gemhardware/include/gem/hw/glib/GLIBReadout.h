@@ -133,8 +133,6 @@ namespace gem {
           mutable gem::utils::Lock m_queueLock;
           // The main data flow
           std::queue<uint32_t> m_dataque;
-
-          xdata::UnsignedInteger64 m_queueDepth;
           /*
            * Counter all in one
            *   [0] VFAT's Blocks counter
@@ -420,28 +420,24 @@ namespace gem {
            * 5 from AMC TTC decoder over GBT
            */
           void setTrigSource(uint8_t const& mode) {
+            register_pair const setting = trigSourceSetting(mode);
+            writeReg(setting.first, setting.second); };
+
+          /**
+           * Register and value setTrigSource would write, e.g., for writeChangedRegs
+           * @param uint8_t mode, an unknown mode selects the AMC TTC decoder over GBT
+           */
+          register_pair trigSourceSetting(uint8_t const& mode) {
             switch (mode) {
             case(OptoHybridTrigSrc::GTX_TTC):
-              writeReg(getDeviceBaseNode(),"CONTROL.TRIGGER.SOURCE",mode);
-              return;
             case(OptoHybridTrigSrc::INTERNAL):
-              writeReg(getDeviceBaseNode(),"CONTROL.TRIGGER.SOURCE",mode);
-              return;
             case(OptoHybridTrigSrc::EXTERNAL):
-              writeReg(getDeviceBaseNode(),"CONTROL.TRIGGER.SOURCE",mode);
-              return;
             case(OptoHybridTrigSrc::LOOPBACK):
-              writeReg(getDeviceBaseNode(),"CONTROL.TRIGGER.SOURCE",mode);
-              return;
             case(OptoHybridTrigSrc::GBT_TTC):
-              writeReg(getDeviceBaseNode(),"CONTROL.TRIGGER.SOURCE",mode);
-              return;
             case(OptoHybridTrigSrc::ALL):
-              writeReg(getDeviceBaseNode(),"CONTROL.TRIGGER.SOURCE",mode);
-              return;
+              return register_pair(getDeviceBaseNode()+".CONTROL.TRIGGER.SOURCE", mode);
             default:
-              writeReg(getDeviceBaseNode(),"CONTROL.TRIGGER.SOURCE", OptoHybridTrigSrc::GBT_TTC);
-              return;
+              return register_pair(getDeviceBaseNode()+".CONTROL.TRIGGER.SOURCE", OptoHybridTrigSrc::GBT_TTC);
             }
           };
 
@@ -499,10 +495,18 @@ namespace gem {
            * @param std::array<uint8_t, 6> which s-bits to forward (maximum 6)
            */
           void setHDMISBitSource(std::array<uint8_t, 6> const sources) {
+            register_pair const setting = hdmiSBitSourceSetting(sources);
+            writeReg(setting.first, setting.second); };
+
+          /**
+           * Register and value setHDMISBitSource would write, e.g., for writeChangedRegs
+           * @param std::array<uint8_t, 6> which s-bits to forward (maximum 6)
+           */
+          register_pair hdmiSBitSourceSetting(std::array<uint8_t, 6> const sources) {
             uint32_t mask = 0x0;
             for (int i = 0; i < 6; ++i)
               mask |= (sources[i] << (5*i));
-            setHDMISBitSource(mask);
+            return register_pair(getDeviceBaseNode()+".CONTROL.HDMI_OUTPUT.SBITS", mask);
           };
 
           /**
@@ -549,7 +553,14 @@ namespace gem {
            *        if mode is 3 - the output sbits will be constant 0's
            */
           void setHDMISBitMode(uint8_t const mode) {
-            writeReg(getDeviceBaseNode(),"CONTROL.HDMI_OUTPUT.SBIT_MODE", mode); };
+            register_pair const setting = hdmiSBitModeSetting(mode);
+            writeReg(setting.first, setting.second); };
+
+          /**
+           * Register and value setHDMISBitMode would write, e.g., for writeChangedRegs
+           */
+          register_pair hdmiSBitModeSetting(uint8_t const mode) {
+            return register_pair(getDeviceBaseNode()+".CONTROL.HDMI_OUTPUT.SBIT_MODE", mode); };
 
           /**
            * Read the S-bit mode
@@ -586,9 +597,16 @@ namespace gem {
            * 0x2 external clock from LEMO expansion module
            */
           void setReferenceClock(uint8_t const& source) {
-            writeReg(getDeviceBaseNode(),"CONTROL.CLOCK.REF_CLK", (uint32_t)source);
+            register_pair const setting = referenceClockSetting(source);
+            writeReg(setting.first, setting.second);
           };
 
+          /**
+           * Register and value setReferenceClock would write, e.g., for writeChangedRegs
+           */
+          register_pair referenceClockSetting(uint8_t const& source) {
+            return register_pair(getDeviceBaseNode()+".CONTROL.CLOCK.REF_CLK", (uint32_t)source); };
+
           /**
            * Get is the current clock source
            * @returns uint32_t clock source
@@ -1191,6 +1209,22 @@ namespace gem {
                                               uint32_t    const& mask=gem::hw::utils::ALL_VFATS_BCAST_MASK,
                                               bool               reset=false);
 
+          /**
+           * Reads several registers from all (un-masked) VFATs with pipelined broadcast requests
+           * The mask is written once, and the results of each request are read in the same
+           * dispatch that issues the next request and samples GEB.Broadcast.Running, so the
+           * status is only polled again while a request is still running
+           * @param std::vector<std::string> names names of the registers to broadcast the requests to
+           * @param uint32_t mask specifying which VFATs will receive the broadcast commands
+           * @param bool reset specifying whether to reset the firmware module first
+           * @returns a std::map of register name to the responses, one for each VFAT
+           * @throws gem::hw::exception::HardwareProblem if a dispatch fails
+           * @throws gem::hw::optohybrid::exception::HardwareProblem if a request does not finish
+           */
+          std::map<std::string, std::vector<uint32_t> > broadcastRead(std::vector<std::string> const& names,
+                                                                      uint32_t const& mask=gem::hw::utils::ALL_VFATS_BCAST_MASK,
+                                                                      bool            reset=false);
+
           /**
            * Sends a write request to all (un-masked) VFATs on the same register
            * @param std::string name name of the register to broadcast the request to
@@ -1255,6 +1289,8 @@ namespace gem {
         protected:
           //OptoHybridMonitor *monOptoHybrid_;
 
+          static const unsigned BCAST_MAX_POLLS = 10000;  ///< polls of GEB.Broadcast.Running before giving up
+
           bool b_links[3];
 
           std::vector<linkStatus> v_activeLinks;
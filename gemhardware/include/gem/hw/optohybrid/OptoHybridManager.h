@@ -9,6 +9,7 @@
 #include "gem/base/GEMFSMApplication.h"
 // #include "gem/hw/optohybrid/OptoHybridSettings.h"
 
+#include "gem/hw/GEMHwTaskGroup.h"
 #include "gem/hw/optohybrid/exception/Exception.h"
 
 #include "gem/utils/soap/GEMSOAPToolBox.h"
@@ -212,6 +213,22 @@ namespace gem {
 
           void     createOptoHybridInfoSpaceItems(is_toolbox_ptr is_optohybrid, optohybrid_shared_ptr optohybrid);
 
+          /**
+           * @brief connect to the OptoHybrid on a link and find its VFATs, run from a GEMHwTaskGroup
+           */
+          void     initializeLink(unsigned const slot, unsigned const link, std::string const& deviceName);
+
+          /**
+           * @brief configure the OptoHybrid on a link, run from a GEMHwTaskGroup
+           */
+          void     configureLink(unsigned const slot, unsigned const link);
+
+
+          /**
+           * @brief write the IPbus profile of every OptoHybrid to IPbusProfileDir, if set
+           */
+          void     dumpIPbusProfiles();
+
           mutable gem::utils::Lock m_deviceLock;  // [MAX_OPTOHYBRIDS_PER_AMC*MAX_AMCS_PER_CRATE];
 
           // Matrix<optohybrid_shared_ptr, MAX_OPTOHYBRIDS_PER_AMC, MAX_AMCS_PER_CRATE>
@@ -226,6 +243,10 @@ namespace gem {
 
           xdata::Vector<xdata::Bag<OptoHybridInfo> > m_optohybridInfo;
           xdata::String        m_connectionFile;
+          xdata::UnsignedInteger32 m_maxConfigureThreads;  ///< links initialized/configured concurrently, see GEMHwTaskGroup
+          xdata::Boolean       m_diffConfigure;  ///< write only the OptoHybrid settings that changed since the last configure, see GEMHwDevice::writeChangedRegs, the VFATs have HwVFAT2::writeImage
+          xdata::Boolean       m_profileIPbus;     ///< record the IPbus accesses of every OptoHybrid, see GEMHwProfiler
+          xdata::String        m_ipbusProfileDir;  ///< where the profiles are written at stop, nothing is written if empty
 
           std::array<std::array<uint32_t, MAX_OPTOHYBRIDS_PER_AMC>, MAX_AMCS_PER_CRATE>
             m_trackingMask;   ///< VFAT slots to ignore tracking data
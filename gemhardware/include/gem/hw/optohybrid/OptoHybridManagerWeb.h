@@ -41,6 +41,9 @@ namespace gem {
           void boardPage(xgi::Input *in, xgi::Output *out)
             throw (xgi::exception::Exception);
 
+          void ipbusProfilePage(xgi::Input *in, xgi::Output *out)
+            throw (xgi::exception::Exception);
+
         private:
           size_t activeBoard;
 
@@ -4,6 +4,7 @@
 #define GEM_HW_OPTOHYBRID_OPTOHYBRIDMONITOR_H
 
 #include "gem/base/GEMMonitor.h"
+#include "gem/hw/GEMHwMonitorReadList.h"
 #include "gem/hw/optohybrid/exception/Exception.h"
 #include "gem/hw/optohybrid/HwOptoHybrid.h"
 
@@ -29,6 +30,25 @@ namespace gem {
 
         virtual void updateMonitorables();
         virtual void reset();
+
+        /**
+         * @brief forget the previous counter readings, after the counters were reset in hardware
+         */
+        void resetRates() { m_readList.resetRates(); };
+
+        /**
+         * @brief pause the updates and the polling of the registers in the monitoring cache
+         */
+        virtual void pauseMonitoring() {
+          gem::base::GEMMonitor::pauseMonitoring();
+          m_readList.pause();
+        };
+
+        virtual void resumeMonitoring() {
+          m_readList.resume();
+          gem::base::GEMMonitor::resumeMonitoring();
+        };
+
         void setupHwMonitoring();
 
         /**
@@ -65,6 +85,7 @@ namespace gem {
 
       private:
         std::shared_ptr<HwOptoHybrid> p_optohybrid;
+        GEMHwMonitorReadList m_readList;
 
       };  // class OptoHybridMonitor
 
@@ -0,0 +1,112 @@
+/** @file GEMCounterRate.h */
+
+#ifndef GEM_HW_UTILS_GEMCOUNTERRATE_H
+#define GEM_HW_UTILS_GEMCOUNTERRATE_H
+
+#include <stdint.h>
+#include <chrono>
+
+namespace gem {
+  namespace hw {
+    namespace utils {
+
+      /**
+       * @brief Rate of a hardware counter of limited width, from successive timestamped readings
+       * @details Every update() takes the difference to the previous reading modulo the width of the
+       *          counter, so that a counter wrapping around between two readings still gives the right
+       *          increment. A difference of more than half the range is taken as a reset of the counter
+       *          (e.g., a TTC resync or a counter reset by software) rather than as a wrap: no rate is
+       *          derived from that interval and the counter restarts from the new reading.
+       *          A 32-bit counter incremented every bunch crossing wraps after 107 s, so the readings
+       *          must be closer than half of that for the wraps to be told from resets.
+       *          Two rates are kept: the instantaneous rate over the last interval, and an exponentially
+       *          weighted moving average with the given time constant, which accounts for irregular
+       *          intervals between the readings.
+       *          Nothing depends on the hardware, so the readings can come from any source.
+       *
+       * @usage
+       *   gem::hw::utils::GEMCounterRate l1a(32, 10.);
+       *   l1a.update(count, std::chrono::steady_clock::now());
+       *   double hz = l1a.getAverageRate();
+       */
+      class GEMCounterRate
+        {
+        public:
+          typedef std::chrono::steady_clock clock;
+
+          /**
+           * @param width number of bits of the counter, between 1 and 64
+           * @param timeConstant of the moving average, in seconds
+           */
+          explicit GEMCounterRate(unsigned const width=32, double const timeConstant=10.);
+
+          /**
+           * @brief add one reading of the counter
+           * @param count the value read, bits above the width are ignored
+           * @param timestamp the time of the reading
+           * @retval true if the rates were updated, false for the first reading, for a reading that is
+           *         not later than the previous one, and for a reset of the counter
+           */
+          bool update(uint64_t const count, clock::time_point const& timestamp);
+
+          /**
+           * @retval the last value read
+           */
+          uint64_t getCount() const { return m_count; };
+
+          /**
+           * @retval the increments summed since the first reading, without the wrap arounds
+           */
+          uint64_t getTotal() const { return m_total; };
+
+          /**
+           * @retval the rate over the last interval, in Hz
+           */
+          double getRate() const { return m_rate; };
+
+          /**
+           * @retval the moving average of the rate, in Hz
+           */
+          double getAverageRate() const { return m_averageRate; };
+
+          uint64_t getWraps()  const { return m_nWraps;  };
+          uint64_t getResets() const { return m_nResets; };
+
+          /**
+           * @retval whether at least one rate has been computed
+           */
+          bool valid() const { return m_hasRate; };
+
+          clock::time_point getTimestamp() const { return m_timestamp; };
+
+          /**
+           * @brief forget the readings, e.g., after the counter was reset on purpose
+           */
+          void reset();
+
+          /**
+           * @retval the increment from previous to current of a counter of the given width
+           */
+          static uint64_t increment(uint64_t const previous, uint64_t const current, unsigned const width);
+
+        private:
+          unsigned m_width;
+          uint64_t m_mask;
+          double   m_timeConstant;
+
+          bool     m_hasReading;
+          bool     m_hasRate;
+          uint64_t m_count;
+          uint64_t m_total;
+          uint64_t m_nWraps;
+          uint64_t m_nResets;
+          double   m_rate;
+          double   m_averageRate;
+          clock::time_point m_timestamp;
+        };
+
+    }  // namespace gem::hw::utils
+  }  // namespace gem::hw
+}  // namespace gem
+
+#endif  // GEM_HW_UTILS_GEMCOUNTERRATE_H
@@ -23,6 +23,7 @@ namespace gem {
       // FIXME, THIS SHOULD NOT BE HARDCODED, move out of class?
       static constexpr uint8_t  N_GTX                = 12;          ///< maximum number of GTX links on the GenericAMC
       static constexpr uint8_t  MAX_VFATS            = 24;          ///< maximum number of VFATs that can be connected
+      static constexpr uint8_t  N_CLUSTER_SIZES      = 8;           ///< cluster sizes with a rate counter in the AMC TRIGGER module
       static constexpr uint32_t ALL_VFATS_BCAST_MASK = 0xff000000;  ///< send broadcast I2C requests to all chips
       static constexpr uint32_t ALL_VFATS_DATA_MASK  = 0xffffffff;  ///< mask tracking data packets from all VFATs
 
@@ -0,0 +1,148 @@
+/** @file GEMPhaseStatistics.h */
+
+#ifndef GEM_HW_UTILS_GEMPHASESTATISTICS_H
+#define GEM_HW_UTILS_GEMPHASESTATISTICS_H
+
+#include <stdint.h>
+#include <array>
+#include <string>
+#include <vector>
+
+namespace gem {
+  namespace hw {
+    namespace utils {
+
+      /**
+       * @brief Streaming estimate of one quantile, with the P-square algorithm
+       * @details Five markers are moved towards the desired positions as samples arrive, with a
+       *          piecewise parabolic interpolation (R. Jain and I. Chlamtac, Commun. ACM 28, 1985).
+       *          The memory does not depend on the number of samples, the estimate is exact up to
+       *          five samples.
+       */
+      class GEMStreamingQuantile
+        {
+        public:
+          /**
+           * @param quantile the quantile to estimate, between 0 and 1, e.g., 0.5 for the median
+           */
+          explicit GEMStreamingQuantile(double const quantile=0.5);
+
+          void add(double const sample);
+
+          /**
+           * @retval the current estimate, 0 if there were no samples
+           */
+          double get() const;
+
+          double   getQuantile() const { return m_quantile; };
+          uint64_t getCount()    const { return m_count;    };
+
+          void reset();
+
+        private:
+          double   m_quantile;
+          uint64_t m_count;
+
+          std::array<double, 5> m_heights;    ///< marker heights, the first samples until there are five
+          std::array<double, 5> m_positions;  ///< actual marker positions
+          std::array<double, 5> m_desired;    ///< desired marker positions
+          std::array<double, 5> m_increments; ///< increments of the desired positions per sample
+        };
+
+      /**
+       * @brief Statistics of phase samples, e.g., of the MMCM or GTH phase monitors of an AMC
+       * @details Everything is updated sample by sample with a fixed amount of memory: count, mean
+       *          and RMS (Welford), minimum and maximum, streaming estimates of the quartiles and of
+       *          the 5% and 95% percentiles (GEMStreamingQuantile), and a fixed binning histogram.
+       *          Other percentiles are interpolated from the histogram.
+       *          Nothing depends on the hardware, so the samples can come from any source.
+       *
+       * @usage
+       *   gem::hw::utils::GEMPhaseStatistics stats;
+       *   for (auto const& phase : phases)
+       *     stats.add(phase);
+       *   double median = stats.getMedian();
+       */
+      class GEMPhaseStatistics
+        {
+        public:
+          static const size_t N_TRACKED_QUANTILES = 5;
+
+          /// quantiles estimated with GEMStreamingQuantile, see getPercentile
+          static const std::array<double, N_TRACKED_QUANTILES> TRACKED_QUANTILES;
+
+          /**
+           * @param histLow low edge of the histogram
+           * @param histHigh high edge of the histogram, the default covers the 12 bits of the phase monitors
+           * @param nBins number of bins of the histogram
+           */
+          GEMPhaseStatistics(double const histLow=0., double const histHigh=4096., size_t const nBins=64);
+
+          void add(double const sample);
+
+          void add(std::vector<uint32_t> const& samples);
+
+          uint64_t getCount() const { return m_count; };
+
+          double getMean() const { return m_mean; };
+
+          double getRMS() const;
+
+          double getMin() const { return m_min; };
+
+          double getMax() const { return m_max; };
+
+          double getMedian() const;
+
+          /**
+           * @param percentile between 0 and 100
+           * @retval the streaming estimate for the tracked quantiles, otherwise interpolated in the histogram
+           */
+          double getPercentile(double const percentile) const;
+
+          std::vector<uint64_t> const& getHistogram() const { return m_histogram; };
+
+          double getBinLowEdge(size_t const bin) const { return m_histLow + bin*m_binWidth; };
+
+          uint64_t getUnderflow() const { return m_underflow; };
+
+          uint64_t getOverflow() const { return m_overflow; };
+
+          /**
+           * @brief add the samples of another set, the streaming quantiles are not merged
+           * @details use it to combine histograms, e.g., of several links of a crate, the quantile
+           *          estimates of the result are those of the histogram
+           */
+          void merge(GEMPhaseStatistics const& other);
+
+          void reset();
+
+          /**
+           * @retval one line summary, for the logs
+           */
+          std::string toString() const;
+
+        private:
+          double histogramPercentile(double const fraction) const;
+
+          uint64_t m_count;
+          double   m_mean;
+          double   m_sumSquares;  ///< sum of the squared differences from the mean
+          double   m_min;
+          double   m_max;
+
+          std::array<GEMStreamingQuantile, N_TRACKED_QUANTILES> m_quantiles;
+          bool m_merged;  ///< the streaming quantiles do not describe all samples
+
+          double   m_histLow;
+          double   m_binWidth;
+          std::vector<uint64_t> m_histogram;
+          uint64_t m_underflow;
+          uint64_t m_overflow;
+        };
+
+    }  // namespace gem::hw::utils
+  }  // namespace gem::hw
+}  // namespace gem
+
+#endif  // GEM_HW_UTILS_GEMPHASESTATISTICS_H
@@ -3,6 +3,8 @@
 #ifndef GEM_HW_VFAT_HWVFAT2_H
 #define GEM_HW_VFAT_HWVFAT2_H
 
+#include <cstring>
+
 #include "gem/hw/GEMHwDevice.h"
 
 #include "gem/hw/vfat/VFAT2Settings.h"
@@ -48,6 +50,44 @@ namespace gem {
             void reset()       {Error=0; Invalid=0; RWMismatch=0;return; }
           } TransactionErrors;
 
+          /**
+           * @struct VFAT2Image
+           * @brief Raw 8-bit image of the registers of a VFAT2 chip
+           * @details The settings are written by writeImage, the read-only identification
+           *          and counter registers are only filled by readImage
+           * @var VFAT2Image::channels
+           * channels holds ChanReg1 to ChanReg128, channels[0] is ChanReg1
+           */
+          typedef struct VFAT2Image {
+            uint8_t control0;
+            uint8_t control1;
+            uint8_t control2;
+            uint8_t control3;
+            uint8_t latency;
+            uint8_t iPreampIn;
+            uint8_t iPreampFeed;
+            uint8_t iPreampOut;
+            uint8_t iShaper;
+            uint8_t iShaperFeed;
+            uint8_t iComp;
+            uint8_t vCal;
+            uint8_t vThresh1;
+            uint8_t vThresh2;
+            uint8_t calPhase;
+            uint8_t channels[N_VFAT2_CHANNELS];
+
+            // read-only
+            uint8_t chipID0;
+            uint8_t chipID1;
+            uint8_t upsetReg;
+            uint8_t hitCount0;
+            uint8_t hitCount1;
+            uint8_t hitCount2;
+
+          VFAT2Image() { reset(); }
+            void reset() { std::memset(this, 0x0, sizeof(VFAT2Image)); return; }
+          } VFAT2Image;
+
           HwVFAT2(std::string const& vfatDevice, std::string const& connectionFile);
           HwVFAT2(std::string const& vfatDevice, std::string const& connectionURI,
                   std::string const& addressTable);
@@ -198,8 +238,48 @@ namespace gem {
            */
           uint8_t  getUpsetCount() { return readVFATReg("UpsetReg");    }
 
-          //Set control register settings
-          void setAllSettings(const gem::hw::vfat::VFAT2ControlParams &params);
+          /**
+           * @brief  Write the settings registers of the chip from params, see writeImage
+           * @param changedOnly write only the registers that differ from the shadow image
+           * @retval the number of registers written
+           */
+          size_t setAllSettings(const gem::hw::vfat::VFAT2ControlParams &params, bool changedOnly=false);
+
+          /**
+           * @brief  Read all registers of the chip with a single GEMHwTransaction
+           * @param image is filled with the register values, registers with the transaction
+           *        error bit set are left unchanged
+           * @throws gem::hw::vfat::exception::TransactionError if any register had the error bit set
+           * @throws gem::hw::exception::HardwareProblem if the transaction failed
+           */
+          void readImage(VFAT2Image& image);
+
+          /**
+           * @brief  Write all settings registers of the chip with a single GEMHwTransaction
+           * @details the values are not read back, use readImage to verify. The written values are
+           *          kept in the shadow image of the device, see GEMHwDevice::writeChangedRegs, and
+           *          checked against the chip by GEMHwDevice::verifyShadow
+           * @param withLatency whether the Latency register is written too
+           * @param changedOnly write only the registers that differ from the shadow image, otherwise
+           *        the shadow image is dropped and every register is written
+           * @retval the number of registers written
+           * @throws gem::hw::exception::HardwareProblem if the transaction failed
+           */
+          size_t writeImage(VFAT2Image const& image, bool withLatency=true, bool changedOnly=false);
+
+          /**
+           * @brief  Read ChanReg1 to ChanReg128 with a single GEMHwTransaction
+           * @param chanRegs is resized to N_VFAT2_CHANNELS, chanRegs[0] is ChanReg1
+           */
+          void readChannelRegs(std::vector<uint8_t>& chanRegs);
+
+          /**
+           * @brief  Write ChanReg1 to ChanReg128 with a single GEMHwTransaction, see writeImage
+           * @param chanRegs holds N_VFAT2_CHANNELS values, chanRegs[0] is ChanReg1
+           * @param changedOnly write only the channels that differ from the shadow image
+           * @retval the number of registers written
+           */
+          size_t writeChannelRegs(std::vector<uint8_t> const& chanRegs, bool changedOnly=false);
 
           //Control register settings
           /// might be good to overload them to act on local variables
@@ -587,6 +667,7 @@ namespace gem {
            * @param uint8_t which channel to read
            */
           void    readVFAT2Channel(uint8_t channel);
+          void    readVFAT2Channel(uint8_t channel, uint8_t chanSettings);
           //void    readVFAT2Channel(gem::hw::vfat::VFAT2ControlParams &params, uint8_t channel);
 
           /**
@@ -632,6 +713,14 @@ namespace gem {
           //VFATMonitor *monVFAT_;
 
         private:
+          typedef std::vector<std::pair<std::string, uint8_t*> > image_register_list;
+
+          /**
+           * @brief  Names of the registers of a VFAT2Image, with the location of their value
+           * @param withReadOnly whether to include the identification and counter registers
+           */
+          static image_register_list imageRegisters(VFAT2Image& image, bool withReadOnly);
+
           uint8_t m_slot;
 
         };  // class HwVFAT2
@@ -0,0 +1,32 @@
+/**
+ * class: GEMHwAddressTable
+ * description: Flat view of a uhal address table
+ */
+
+#include "gem/hw/GEMHwAddressTable.h"
+
+gem::hw::GEMHwAddressTable::GEMHwAddressTable()
+{
+}
+
+gem::hw::GEMHwAddressTable::GEMHwAddressTable(uhal::HwInterface const& device)
+{
+  std::vector<std::string> const names = device.getNodes();
+  m_registers.reserve(names.size());
+  for (auto name = names.begin(); name != names.end(); ++name) {
+    uhal::Node const& node = device.getNode(*name);
+    Register reg;
+    reg.Address    = node.getAddress();
+    reg.Mask       = node.getMask();
+    reg.Size       = node.getSize();
+    reg.Permission = static_cast<uint8_t>(node.getPermission());
+    reg.Mode       = static_cast<uint8_t>(node.getMode());
+    m_registers.insert(std::make_pair(*name, reg));
+  }
+}
+
+gem::hw::GEMHwAddressTable::Register const* gem::hw::GEMHwAddressTable::find(std::string const& regName) const
+{
+  auto reg = m_registers.find(regName);
+  return (reg == m_registers.end()) ? nullptr : &(reg->second);
+}
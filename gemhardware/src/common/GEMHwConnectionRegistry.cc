@@ -0,0 +1,50 @@
+/**
+ * class: GEMHwConnectionRegistry
+ * description: Process-wide registry of the uhal connection files
+ */
+
+#include "gem/hw/GEMHwConnectionRegistry.h"
+
+#include <chrono>
+
+gem::hw::GEMHwConnectionRegistry& gem::hw::GEMHwConnectionRegistry::getInstance()
+{
+  static GEMHwConnectionRegistry registry;
+  return registry;
+}
+
+gem::hw::GEMHwConnectionRegistry::GEMHwConnectionRegistry() :
+  m_gemLogger(log4cplus::Logger::getInstance("GEMHwConnectionRegistry"))
+{
+}
+
+uhal::HwInterface gem::hw::GEMHwConnectionRegistry::getDevice(std::string const& deviceName,
+                                                              std::string const& connectionFile)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  auto manager = m_managers.find(connectionFile);
+  if (manager == m_managers.end()) {
+    auto t1 = std::chrono::steady_clock::now();
+    std::shared_ptr<uhal::ConnectionManager> newManager = std::make_shared<uhal::ConnectionManager>(connectionFile);
+    auto t2 = std::chrono::steady_clock::now();
+    CMSGEMOS_INFO("GEMHwConnectionRegistry::getDevice parsed " << connectionFile << " in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count() << "ms");
+    manager = m_managers.insert(std::make_pair(connectionFile, newManager)).first;
+  }
+  return manager->second->getDevice(deviceName);
+}
+
+uhal::HwInterface gem::hw::GEMHwConnectionRegistry::getDevice(std::string const& deviceName,
+                                                              std::string const& connectionURI,
+                                                              std::string const& addressTable)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return uhal::ConnectionManager::getDevice(deviceName, connectionURI, addressTable);
+}
+
+void gem::hw::GEMHwConnectionRegistry::clear()
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  CMSGEMOS_DEBUG("GEMHwConnectionRegistry::clear dropping " << m_managers.size() << " connection managers");
+  m_managers.clear();
+}
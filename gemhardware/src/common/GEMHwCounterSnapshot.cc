@@ -0,0 +1,98 @@
+/**
+ * class: GEMHwCounterSnapshot
+ * description: Counters of a board read in one transaction, with a common timestamp and their rates
+ */
+
+#include "gem/hw/GEMHwCounterSnapshot.h"
+
+#include "gem/hw/GEMHwExecutor.h"
+#include "gem/hw/GEMHwTransaction.h"
+
+gem::hw::GEMHwCounterSnapshot::GEMHwCounterSnapshot(double const timeConstant) :
+  m_timeConstant(timeConstant)
+{
+}
+
+size_t gem::hw::GEMHwCounterSnapshot::addCounter(std::string const& name, GEMHwDevice::RegHandle const& reg)
+{
+  return addCounter(name, reg, GEMHwDevice::RegHandle());
+}
+
+size_t gem::hw::GEMHwCounterSnapshot::addCounter(std::string const& name, GEMHwDevice::RegHandle const& lower,
+                                                 GEMHwDevice::RegHandle const& upper)
+{
+  Counter counter;
+  counter.Name  = name;
+  counter.Lower = lower;
+  counter.Upper = upper;
+  counter.Rate  = gem::hw::utils::GEMCounterRate(counter.is64() ? 64 : 32, m_timeConstant);
+  m_index[name] = m_counters.size();
+  m_counters.push_back(counter);
+  return m_counters.size()-1;
+}
+
+void gem::hw::GEMHwCounterSnapshot::read(GEMHwTransaction& trans)
+{
+  for (auto counter = m_counters.begin(); counter != m_counters.end(); ++counter) {
+    trans.read(counter->Lower, counter->LowerVal);
+    if (counter->is64())
+      trans.read(counter->Upper, counter->UpperVal);
+  }
+}
+
+void gem::hw::GEMHwCounterSnapshot::set(size_t const index, uint32_t const lowerVal, uint32_t const upperVal)
+{
+  Counter& counter = m_counters.at(index);
+  counter.LowerVal = lowerVal;
+  counter.UpperVal = counter.is64() ? upperVal : 0;
+}
+
+void gem::hw::GEMHwCounterSnapshot::update(gem::hw::utils::GEMCounterRate::clock::time_point const& timestamp)
+{
+  m_timestamp = timestamp;
+  for (auto counter = m_counters.begin(); counter != m_counters.end(); ++counter)
+    counter->Rate.update(counter->value(), timestamp);
+}
+
+void gem::hw::GEMHwCounterSnapshot::latch(GEMHwDevice& device)
+{
+  if (m_counters.empty())
+    return;
+
+  typedef gem::hw::utils::GEMCounterRate::clock clock;
+  auto readAll = [this](GEMHwDevice& dev) {
+    GEMHwTransaction trans(dev);
+    read(trans);
+    clock::time_point const start = clock::now();
+    trans.commit();
+    update(start + (clock::now() - start)/2);
+  };
+
+  std::shared_ptr<GEMHwExecutor> executor = device.getExecutor();
+  if (executor)
+    executor->submit(readAll, GEMHwExecutor::Priority::MONITOR).get();
+  else
+    readAll(device);
+}
+
+gem::hw::GEMHwCounterSnapshot::Counter const& gem::hw::GEMHwCounterSnapshot::getCounter(std::string const& name) const
+{
+  auto index = m_index.find(name);
+  if (index == m_index.end()) {
+    std::string msg = "GEMHwCounterSnapshot: no counter named " + name;
+    XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+  }
+  return m_counters.at(index->second);
+}
+
+void gem::hw::GEMHwCounterSnapshot::resetRates()
+{
+  for (auto counter = m_counters.begin(); counter != m_counters.end(); ++counter)
+    counter->Rate.reset();
+}
+
+void gem::hw::GEMHwCounterSnapshot::clear()
+{
+  m_counters.clear();
+  m_index.clear();
+}
@@ -0,0 +1,178 @@
+/**
+ * class: GEMHwCrateLinkHealth
+ * description: Concurrent check of the OptoHybrid links and PLL lock of all AMCs of a crate
+ */
+
+#include "gem/hw/GEMHwCrateLinkHealth.h"
+
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+#include "gem/hw/utils/GEMCounterRate.h"
+
+namespace {
+  uint32_t increment(uint32_t const before, uint32_t const after)
+  {
+    return static_cast<uint32_t>(gem::hw::utils::GEMCounterRate::increment(before, after, 32));
+  }
+}
+
+const uint32_t gem::hw::GEMHwCrateLinkHealth::DEFAULT_PLL_SAMPLES;
+const uint32_t gem::hw::GEMHwCrateLinkHealth::DEFAULT_SETTLE_MSEC;
+
+bool gem::hw::GEMHwCrateLinkHealth::AMCResult::healthy() const
+{
+  if (!Succeeded || PLLLocked != PLLSamples)
+    return false;
+  for (auto link = Links.begin(); link != Links.end(); ++link)
+    if (!link->Healthy)
+      return false;
+  return true;
+}
+
+gem::hw::GEMHwCrateLinkHealth::GEMHwCrateLinkHealth(size_t const maxWorkers) :
+  m_maxWorkers(maxWorkers)
+{
+}
+
+void gem::hw::GEMHwCrateLinkHealth::addAMC(int const slot, amc_shared_ptr amc, uint32_t const linkMask)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  m_amcs[slot] = std::make_pair(amc, linkMask);
+}
+
+void gem::hw::GEMHwCrateLinkHealth::clear()
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  m_amcs.clear();
+}
+
+bool gem::hw::GEMHwCrateLinkHealth::empty() const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_amcs.empty();
+}
+
+std::vector<gem::hw::GEMHwCrateLinkHealth::AMCResult> gem::hw::GEMHwCrateLinkHealth::check(bool const resetCounters,
+                                                                                          uint32_t const pllSamples,
+                                                                                          uint32_t const settleMsec)
+{
+  std::map<int, std::pair<amc_shared_ptr, uint32_t> > amcs;
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    amcs = m_amcs;
+  }
+
+  std::vector<AMCResult> results(amcs.size());
+  GEMHwTaskGroup tasks(m_maxWorkers);
+  size_t index = 0;
+  for (auto amc = amcs.begin(); amc != amcs.end(); ++amc, ++index) {
+    AMCResult& result = results.at(index);
+    result.Slot       = amc->first;
+    result.PLLSamples = pllSamples;
+    std::stringstream target;
+    target << "AMC" << amc->first;
+    amc_shared_ptr device   = amc->second.first;
+    uint32_t const linkMask = amc->second.second;
+    tasks.add(target.str(), target.str(), [device, linkMask, resetCounters, pllSamples, settleMsec, &result]() {
+        checkAMC(device, linkMask, resetCounters, pllSamples, settleMsec, result);
+      });
+  }
+
+  std::vector<GEMHwTaskGroup::Result> const taskResults = tasks.run();
+  for (size_t i = 0; i < taskResults.size(); ++i) {
+    results.at(i).Succeeded    = taskResults.at(i).Succeeded;
+    results.at(i).Error        = taskResults.at(i).Error;
+    results.at(i).DurationUsec = taskResults.at(i).DurationUsec;
+  }
+  return results;
+}
+
+void gem::hw::GEMHwCrateLinkHealth::checkAMC(amc_shared_ptr amc, uint32_t const linkMask, bool const resetCounters,
+                                             uint32_t const pllSamples, uint32_t const settleMsec, AMCResult& result)
+{
+  gem::hw::GEMHwProfiler::CallerScope profilerScope("GEMHwCrateLinkHealth");
+  if (resetCounters)
+    amc->resetLinkCounters();
+
+  std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+  std::vector<HwGenericAMC::AMCLinkHealth> const before = amc->getLinkHealth(linkMask);
+
+  // the PLL samples are spread over the settle time, while the links run
+  uint32_t const intervalUsec = pllSamples > 1 ? static_cast<uint32_t>(1000ULL*settleMsec/pllSamples) : 0;
+  result.PLLLocked = amc->samplePLLLock(pllSamples, intervalUsec);
+  std::this_thread::sleep_until(start + std::chrono::milliseconds(settleMsec));
+
+  std::vector<HwGenericAMC::AMCLinkHealth> const after = amc->getLinkHealth(linkMask);
+  for (auto link = after.begin(); link != after.end(); ++link) {
+    LinkResult linkResult;
+    linkResult.Link = link->Link;
+    for (auto previous = before.begin(); previous != before.end(); ++previous) {
+      if (previous->Link != link->Link)
+        continue;
+      linkResult.TrackingErrors = increment(previous->TrackingErrors, link->TrackingErrors);
+      linkResult.TriggerErrors  = increment(previous->TriggerErrors,  link->TriggerErrors);
+      linkResult.DataPackets    = increment(previous->DataPackets,    link->DataPackets);
+      linkResult.Healthy        = linkResult.TrackingErrors == 0 && linkResult.TriggerErrors == 0;
+    }
+    result.Links.push_back(linkResult);
+  }
+}
+
+std::string gem::hw::GEMHwCrateLinkHealth::summary(std::vector<AMCResult> const& results)
+{
+  std::stringstream os;
+  for (auto amc = results.begin(); amc != results.end(); ++amc) {
+    os << "AMC" << amc->Slot << ": ";
+    if (!amc->Succeeded) {
+      os << "check failed: " << amc->Error << std::endl;
+      continue;
+    }
+    size_t nHealthy = 0;
+    for (auto link = amc->Links.begin(); link != amc->Links.end(); ++link)
+      if (link->Healthy)
+        ++nHealthy;
+    os << nHealthy << "/" << amc->Links.size() << " links healthy, PLL locked in "
+       << amc->PLLLocked << "/" << amc->PLLSamples << " samples, "
+       << amc->DurationUsec/1000 << " ms" << std::endl;
+    for (auto link = amc->Links.begin(); link != amc->Links.end(); ++link)
+      if (!link->Healthy)
+        os << "  link " << static_cast<int>(link->Link)
+           << ": tracking errors " << link->TrackingErrors
+           << ", trigger errors "  << link->TriggerErrors
+           << ", data packets "    << link->DataPackets << std::endl;
+  }
+  return os.str();
+}
+
+void gem::hw::GEMHwCrateLinkHealth::printJSON(std::ostream& out, std::vector<AMCResult> const& results)
+{
+  out << "[" << std::endl;
+  for (auto amc = results.begin(); amc != results.end(); ++amc) {
+    std::string error;
+    for (auto c = amc->Error.begin(); c != amc->Error.end(); ++c) {
+      if (*c == '"' || *c == '\\')
+        error += '\\';
+      error += (*c == '\n') ? ' ' : *c;
+    }
+    out << (amc == results.begin() ? "  " : " ,")
+        << "{ \"slot\":" << amc->Slot
+        << ", \"healthy\":" << (amc->healthy() ? "true" : "false")
+        << ", \"succeeded\":" << (amc->Succeeded ? "true" : "false")
+        << ", \"error\":\"" << error << "\""
+        << ", \"pllSamples\":" << amc->PLLSamples
+        << ", \"pllLocked\":" << amc->PLLLocked
+        << ", \"durationUsec\":" << amc->DurationUsec
+        << ", \"links\":[";
+    for (auto link = amc->Links.begin(); link != amc->Links.end(); ++link)
+      out << (link == amc->Links.begin() ? "" : ",")
+          << "{\"link\":" << static_cast<int>(link->Link)
+          << ",\"healthy\":" << (link->Healthy ? "true" : "false")
+          << ",\"trackingErrors\":" << link->TrackingErrors
+          << ",\"triggerErrors\":" << link->TriggerErrors
+          << ",\"dataPackets\":" << link->DataPackets << "}";
+    out << "] }" << std::endl;
+  }
+  out << "]" << std::endl;
+}
@@ -0,0 +1,166 @@
+/**
+ * class: GEMHwCrateTriggerRates
+ * description: Trigger and cluster rates of all AMCs of a crate, polled concurrently
+ */
+
+#include "gem/hw/GEMHwCrateTriggerRates.h"
+
+#include <chrono>
+#include <sstream>
+#include <vector>
+
+namespace {
+  void printCounters(std::ostream& out, gem::hw::HwGenericAMC::cluster_counters const& counters)
+  {
+    out << "[";
+    for (size_t cs = 0; cs < counters.size(); ++cs)
+      out << (cs ? "," : "") << counters.at(cs);
+    out << "]";
+  }
+
+  std::string jsonEscape(std::string const& in)
+  {
+    std::stringstream out;
+    for (auto c = in.begin(); c != in.end(); ++c) {
+      if (*c == '"' || *c == '\\')
+        out << '\\' << *c;
+      else if (*c == '\n')
+        out << "\\n";
+      else
+        out << *c;
+    }
+    return out.str();
+  }
+}
+
+gem::hw::GEMHwCrateTriggerRates::GEMHwCrateTriggerRates(size_t const maxWorkers) :
+  m_maxWorkers(maxWorkers),
+  m_pollUsec(0)
+{
+}
+
+void gem::hw::GEMHwCrateTriggerRates::addAMC(int const slot, amc_shared_ptr amc)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  m_amcs[slot] = amc;
+  m_rates.erase(slot);
+  m_errors.erase(slot);
+}
+
+void gem::hw::GEMHwCrateTriggerRates::clear()
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  m_amcs.clear();
+  m_rates.clear();
+  m_errors.clear();
+}
+
+bool gem::hw::GEMHwCrateTriggerRates::empty() const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_amcs.empty();
+}
+
+bool gem::hw::GEMHwCrateTriggerRates::poll(bool const withCounts)
+{
+  std::lock_guard<std::mutex> pollGuard(m_pollMutex);
+
+  std::map<int, amc_shared_ptr> amcs;
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    amcs = m_amcs;
+  }
+
+  // every task fills its own entry, the AMCs are independent so each is its own serial key
+  std::vector<int> slots;
+  std::vector<HwGenericAMC::AMCTriggerRates> rates(amcs.size());
+  GEMHwTaskGroup tasks(m_maxWorkers);
+  for (auto amc = amcs.begin(); amc != amcs.end(); ++amc) {
+    std::stringstream slot;
+    slot << "AMC" << amc->first;
+    HwGenericAMC::AMCTriggerRates& result = rates.at(slots.size());
+    amc_shared_ptr device = amc->second;
+    tasks.add(slot.str(), slot.str(), [device, &result, withCounts]() {
+        result = device->getTriggerRates(withCounts);
+      });
+    slots.push_back(amc->first);
+  }
+
+  auto t1 = std::chrono::steady_clock::now();
+  std::vector<GEMHwTaskGroup::Result> const results = tasks.run();
+  auto t2 = std::chrono::steady_clock::now();
+
+  bool allRead = true;
+  std::lock_guard<std::mutex> guard(m_mutex);
+  m_pollUsec = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+  for (size_t i = 0; i < results.size(); ++i) {
+    // the AMC may have been replaced or removed while it was read
+    if (m_amcs.find(slots.at(i)) == m_amcs.end() || m_amcs.at(slots.at(i)) != amcs.at(slots.at(i)))
+      continue;
+    if (results.at(i).Succeeded) {
+      m_rates[slots.at(i)] = rates.at(i);
+      m_errors.erase(slots.at(i));
+    } else {
+      m_errors[slots.at(i)] = results.at(i).Error;
+      allRead = false;
+    }
+  }
+  return allRead;
+}
+
+std::map<int, gem::hw::HwGenericAMC::AMCTriggerRates> gem::hw::GEMHwCrateTriggerRates::getRates() const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_rates;
+}
+
+std::map<int, std::string> gem::hw::GEMHwCrateTriggerRates::getErrors() const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_errors;
+}
+
+uint64_t gem::hw::GEMHwCrateTriggerRates::getCrateTriggerRate() const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  uint64_t total = 0;
+  for (auto rates = m_rates.begin(); rates != m_rates.end(); ++rates)
+    total += rates->second.ORTriggerRate;
+  return total;
+}
+
+void gem::hw::GEMHwCrateTriggerRates::printJSON(std::ostream& out) const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  uint64_t total = 0;
+  for (auto rates = m_rates.begin(); rates != m_rates.end(); ++rates)
+    total += rates->second.ORTriggerRate;
+
+  std::chrono::steady_clock::time_point const now = std::chrono::steady_clock::now();
+  out << "{ \"crateTriggerRate\":" << total << ", \"pollUsec\":" << m_pollUsec << "," << std::endl
+      << "  \"amcs\":[" << std::endl;
+  for (auto rates = m_rates.begin(); rates != m_rates.end(); ++rates) {
+    HwGenericAMC::AMCTriggerRates const& amc = rates->second;
+    uint64_t const ageMsec = std::chrono::duration_cast<std::chrono::milliseconds>(now - amc.Timestamp).count();
+    out << (rates == m_rates.begin() ? "    " : "   ,")
+        << "{ \"slot\":" << rates->first
+        << ", \"ageMsec\":" << ageMsec
+        << ", \"orTriggerRate\":" << amc.ORTriggerRate
+        << ", \"optohybrids\":[";
+    for (size_t oh = 0; oh < amc.TriggerRate.size(); ++oh) {
+      out << (oh ? "," : "") << "{\"triggerRate\":" << amc.TriggerRate.at(oh) << ",\"clusterRate\":";
+      printCounters(out, amc.ClusterRate.at(oh));
+      if (oh < amc.TriggerCount.size()) {
+        out << ",\"triggerCount\":" << amc.TriggerCount.at(oh) << ",\"clusterCount\":";
+        printCounters(out, amc.ClusterCount.at(oh));
+      }
+      out << "}";
+    }
+    out << "] }" << std::endl;
+  }
+  out << "  ]," << std::endl
+      << "  \"errors\":{";
+  for (auto error = m_errors.begin(); error != m_errors.end(); ++error)
+    out << (error == m_errors.begin() ? "" : ",") << "\"" << error->first << "\":\"" << jsonEscape(error->second) << "\"";
+  out << "} }" << std::endl;
+}
@@ -5,13 +5,22 @@
 
 #include "gem/hw/GEMHwDevice.h"
 
+#include <chrono>
+#include <thread>
+
+#include "gem/hw/GEMHwConnectionRegistry.h"
+#include "gem/hw/GEMHwExecutor.h"
+#include "gem/hw/GEMHwTransaction.h"
+
 gem::hw::GEMHwDevice::GEMHwDevice(std::string const& deviceName,
                                   std::string const& connectionFile) :
   xhal::XHALInterface(deviceName),
-  uhal::HwInterface(std::shared_ptr<uhal::ConnectionManager>(new uhal::ConnectionManager("file://${GEM_ADDRESS_TABLE_PATH}/"+connectionFile))->getDevice(deviceName)),
+  uhal::HwInterface(GEMHwConnectionRegistry::getInstance().getDevice(deviceName, "file://${GEM_ADDRESS_TABLE_PATH}/"+connectionFile)),
   // b_is_connected(false),
   m_gemLogger(log4cplus::Logger::getInstance(deviceName)),
-  m_hwLock(toolbox::BSem::FULL, true)
+  m_hwLock(toolbox::BSem::FULL, true),
+  p_retryPolicy(std::make_shared<GEMHwRetryPolicy>()),
+  m_handleGeneration(1)
 {
   // CMSGEMOS_DEBUG("GEMHwDevice(std::string, std::string) ctor");
 
@@ -24,10 +33,13 @@ gem::hw::GEMHwDevice::GEMHwDevice(std::string const& deviceName,
                                   std::string const& connectionURI,
                                   std::string const& addressTable) :
   xhal::XHALInterface(deviceName),
-  uhal::HwInterface(uhal::ConnectionManager::getDevice(deviceName, connectionURI, addressTable)),
+  uhal::HwInterface(GEMHwConnectionRegistry::getInstance().getDevice(deviceName, connectionURI, addressTable)),
   // b_is_connected(false),
   m_gemLogger(log4cplus::Logger::getInstance(deviceName)),
-  m_hwLock(toolbox::BSem::FULL, true)
+  m_hwLock(toolbox::BSem::FULL, true),
+  p_retryPolicy(std::make_shared<GEMHwRetryPolicy>()),
+  m_addressTable(addressTable),
+  m_handleGeneration(1)
 {
   // CMSGEMOS_DEBUG("GEMHwDevice(std::string, std::string, std::string) ctor");
   // FIXME: REMOVE or REDESIGN, virtual function in constructor
@@ -41,7 +53,9 @@ gem::hw::GEMHwDevice::GEMHwDevice(std::string const& deviceName,
   uhal::HwInterface(uhalDevice),
   // b_is_connected(false),
   m_gemLogger(log4cplus::Logger::getInstance(deviceName)),
-  m_hwLock(toolbox::BSem::FULL, true)
+  m_hwLock(toolbox::BSem::FULL, true),
+  p_retryPolicy(std::make_shared<GEMHwRetryPolicy>()),
+  m_handleGeneration(1)
 {
   CMSGEMOS_DEBUG("GEMHwDevice(std::string, uhal::HwInterface) ctor");
   // FIXME: REMOVE or REDESIGN, virtual function in constructor
@@ -51,6 +65,8 @@ gem::hw::GEMHwDevice::GEMHwDevice(std::string const& deviceName,
 
 gem::hw::GEMHwDevice::~GEMHwDevice()
 {
+  // the I/O thread must be gone before the uhal interface
+  stopExecutor();
   // if (p_gemHW)
   //   releaseDevice();
   // if (p_gemConnectionManager)
@@ -58,6 +74,84 @@ gem::hw::GEMHwDevice::~GEMHwDevice()
   // p_gemConnectionManager = 0;
 }
 
+void gem::hw::GEMHwDevice::startExecutor(size_t const maxBatch, unsigned const windowUsec)
+{
+  std::lock_guard<std::mutex> guard(m_executorMutex);
+  if (p_executor) {
+    CMSGEMOS_DEBUG("GEMHwDevice::startExecutor I/O thread already running for " << getDeviceID());
+    return;
+  }
+  p_executor = std::make_shared<GEMHwExecutor>(*this, maxBatch, windowUsec);
+}
+
+void gem::hw::GEMHwDevice::stopExecutor()
+{
+  std::shared_ptr<GEMHwExecutor> executor;
+  {
+    std::lock_guard<std::mutex> guard(m_executorMutex);
+    executor.swap(p_executor);
+  }
+  // drained and joined outside of the guard, queued callbacks may still look up the executor
+  executor.reset();
+}
+
+std::shared_ptr<gem::hw::GEMHwExecutor> gem::hw::GEMHwDevice::getExecutor() const
+{
+  std::lock_guard<std::mutex> guard(m_executorMutex);
+  return p_executor;
+}
+
+std::shared_ptr<gem::hw::GEMHwExecutor> gem::hw::GEMHwDevice::asyncExecutor()
+{
+  std::shared_ptr<GEMHwExecutor> executor = getExecutor();
+  if (!executor) {
+    startExecutor();
+    executor = getExecutor();
+  }
+  if (!executor) {
+    std::string msg = "GEMHwDevice::asyncExecutor unable to start the I/O thread for " + getDeviceID();
+    CMSGEMOS_ERROR(msg);
+    XCEPT_RAISE(gem::hw::exception::SoftwareProblem, msg);
+  }
+  return executor;
+}
+
+std::shared_future<uint32_t> gem::hw::GEMHwDevice::readRegAsync(std::string const& regName, int const priority)
+{
+  return asyncExecutor()->readReg(regName, priority);
+}
+
+void gem::hw::GEMHwDevice::readRegAsync(std::string const& regName, GEMHwExecutor::word_callback callback,
+                                        int const priority)
+{
+  asyncExecutor()->readReg(regName, priority, callback);
+}
+
+std::shared_future<std::vector<uint32_t> > gem::hw::GEMHwDevice::readBlockAsync(std::string const& regName,
+                                                                                 size_t const nWords,
+                                                                                 int const priority)
+{
+  return asyncExecutor()->readBlock(regName, nWords, priority);
+}
+
+void gem::hw::GEMHwDevice::readBlockAsync(std::string const& regName, size_t const nWords,
+                                          GEMHwExecutor::block_callback callback, int const priority)
+{
+  asyncExecutor()->readBlock(regName, nWords, priority, callback);
+}
+
+std::shared_future<void> gem::hw::GEMHwDevice::writeRegAsync(std::string const& regName, uint32_t const val,
+                                                             int const priority)
+{
+  return asyncExecutor()->writeReg(regName, val, priority);
+}
+
+void gem::hw::GEMHwDevice::writeRegAsync(std::string const& regName, uint32_t const val,
+                                         GEMHwExecutor::done_callback callback, int const priority)
+{
+  asyncExecutor()->writeReg(regName, val, priority, callback);
+}
+
 std::string gem::hw::GEMHwDevice::printErrorCounts() const {
   std::stringstream errstream;
   errstream << "errors while accessing registers:"                << std::endl
@@ -65,6 +159,13 @@ std::string gem::hw::GEMHwDevice::printErrorCounts() const {
             << "Read errors: "       << m_ipBusErrs.ReadError     << std::endl
             << "Timeouts:    "       << m_ipBusErrs.Timeout       << std::endl
             << "Controlhub errors: " << m_ipBusErrs.ControlHubErr << std::endl;
+  errstream << "errors by class:" << std::endl;
+  for (int errClass = 0; errClass < GEMHwRetryPolicy::ErrorClass::N_CLASSES; ++errClass)
+    errstream << GEMHwRetryPolicy::errorClassName(errClass) << ": "
+              << m_ipBusErrClasses.Errors[errClass] << std::endl;
+  errstream << "Retries: "        << m_ipBusErrClasses.Retries                << std::endl
+            << "Gave up: "        << m_ipBusErrClasses.GaveUp                 << std::endl
+            << "Backoff [ms]: "   << m_ipBusErrClasses.BackoffUsec/1000       << std::endl;
   CMSGEMOS_TRACE(errstream);
   return errstream.str();
 }
@@ -116,13 +217,45 @@ void gem::hw::GEMHwDevice::setup(std::string const& deviceName)
 //****************Methods implemented for convenience on uhal devices****************//
 ///////////////////////////////////////////////////////////////////////////////////////
 
+gem::hw::GEMHwDevice::RegHandle gem::hw::GEMHwDevice::resolve(std::string const& name)
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+
+  auto cached = m_regHandles.find(name);
+  if (cached != m_regHandles.end())
+    return cached->second;
+
+  RegHandle handle;
+  try {
+    uhal::Node const& node = this->getNode(name);
+    handle.name       = name;
+    handle.node       = &node;
+    handle.address    = node.getAddress();
+    handle.mask       = node.getMask();
+    handle.generation = m_handleGeneration;
+  } catch (uhal::exception::exception const& err) {
+    std::string msg = toolbox::toString("Unable to resolve register '%s': %s", name.c_str(), err.what());
+    CMSGEMOS_ERROR("GEMHwDevice::" << msg);
+    XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+  }
+  m_regHandles.insert(std::make_pair(name, handle));
+  return handle;
+}
+
+void gem::hw::GEMHwDevice::invalidateHandles()
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+  m_regHandles.clear();
+  ++m_handleGeneration;
+  m_shadow.clear();
+}
+
 uint32_t gem::hw::GEMHwDevice::readReg(std::string const& name)
 {
   gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+  GEMHwProfiler::Probe probe(p_profiler.get(), GEMHwProfiler::AccessTypeT::READ, name);
   // uhal::HwInterface& hw = getGEMHwInterface();
 
-  unsigned retryCount = 0;
-  uint32_t res = 0x0;
   CMSGEMOS_DEBUG("GEMHwDevice::readReg " << name << std::endl
                  << "Path  "      << this->getNode(name).getPath()                << std::endl
                  << "Address 0x"  << std::hex << this->getNode(name).getAddress() << std::dec << std::endl
@@ -131,55 +264,30 @@ uint32_t gem::hw::GEMHwDevice::readReg(std::string const& name)
                  << "Mode "       << this->getNode(name).getMode()                << std::endl
                  << "Size "       << this->getNode(name).getSize()                << std::endl
                  << std::endl);
-  while (retryCount < MAX_IPBUS_RETRIES) {
-    ++retryCount;
-    try {
-      uhal::ValWord<uint32_t> val = this->getNode(name).read();
-      this->dispatch();
-      res = val.value();
-      CMSGEMOS_TRACE("GEMHwDevice::Successfully read register " << name.c_str() << " with value 0x"
-            << std::setfill('0') << std::setw(8) << std::hex << res << std::dec
-            << " retry count is " << retryCount << ". Should move on to next operation");
-      return res;
-    } catch (uhal::exception::exception const& err) {
-      std::string msgBase = toolbox::toString("Could not read register '%s' (uHAL)", name.c_str());
-      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
-      std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        ++retryCount;
-        if (retryCount > (MAX_IPBUS_RETRIES-1))
-          CMSGEMOS_DEBUG("GEMHwDevice::Failed to read register " << name <<
-                ". retryCount("<<retryCount<<")"
-                << std::endl);
-        updateErrorCounters(errCode);
-        continue;
-      } else {
-        CMSGEMOS_ERROR("GEMHwDevice::" << msg);
-        // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
-      }
-    } catch (std::exception const& err) {
-      std::string msgBase = toolbox::toString("Could not read register '%s' (std)", name.c_str());
-      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
-      CMSGEMOS_ERROR("GEMHwDevice::" << msg);
-      // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
-    }
-  }
-  std::string msg = toolbox::toString("Maximum number of retries reached, unable to read register %s",name.c_str());
-  CMSGEMOS_ERROR("GEMHwDevice::" << msg);
-  // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
-  return res;
+  return readNode(name, NULL);
+}
+
+uint32_t gem::hw::GEMHwDevice::readReg(RegHandle& handle)
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+
+  checkHandle(handle);
+  GEMHwProfiler::Probe probe(p_profiler.get(), GEMHwProfiler::AccessTypeT::READ, handle.name);
+  return readNode(handle.name, handle.node);
 }
 
 uint32_t gem::hw::GEMHwDevice::readReg(uint32_t const& address)
 {
   gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+  GEMHwProfiler::Probe probe(p_profiler.get(), GEMHwProfiler::AccessTypeT::READ,
+                             p_profiler ? toolbox::toString("0x%08x", address) : "");
   // uhal::HwInterface& hw = getGEMHwInterface();
 
   unsigned retryCount = 0;
   uint32_t res = 0x0;
   CMSGEMOS_TRACE("GEMHwDevice::gem::hw::GEMHwDevice::readReg 0x" << std::setfill('0') << std::setw(8)
         << std::hex << address << std::dec << std::endl);
-  while (retryCount < MAX_IPBUS_RETRIES) {
+  while (retryCount < p_retryPolicy->maxAttempts()) {
     ++retryCount;
     try {
       uhal::ValWord<uint32_t> val = this->getClient().read(address);
@@ -194,27 +302,22 @@ uint32_t gem::hw::GEMHwDevice::readReg(uint32_t const& address)
       std::string msgBase = toolbox::toString("Could not read register '0x%08x' (uHAL)", address);
       std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
       std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        ++retryCount;
-        if (retryCount > (MAX_IPBUS_RETRIES-1))
-          CMSGEMOS_DEBUG("GEMHwDevice::Failed to read register 0x" << std::setfill('0') << std::setw(8)
-                << std::hex << address << std::dec
-                << ". retryCount("<<retryCount<<")"
-                << std::endl);
-        updateErrorCounters(errCode);
+      if (retryAfterError(errCode, retryCount)) {
         continue;
       } else {
         CMSGEMOS_ERROR("GEMHwDevice::" << msg);
         // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
+        break;
       }
     } catch (std::exception const& err) {
       std::string msgBase = toolbox::toString("Could not read register '0x%08x' (std)", address);
       std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
       CMSGEMOS_ERROR("GEMHwDevice::" << msg);
       // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+      break;
     }
   }
-  std::string msg = toolbox::toString("Maximum number of retries reached, unable to read register 0x%08x",
+  std::string msg = toolbox::toString("Giving up, unable to read register 0x%08x",
                                       address);
   CMSGEMOS_ERROR("GEMHwDevice::" << msg);
   // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
@@ -224,13 +327,15 @@ uint32_t gem::hw::GEMHwDevice::readReg(uint32_t const& address)
 uint32_t gem::hw::GEMHwDevice::readReg(uint32_t const& address, uint32_t const& mask)
 {
   gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+  GEMHwProfiler::Probe probe(p_profiler.get(), GEMHwProfiler::AccessTypeT::READ,
+                             p_profiler ? toolbox::toString("0x%08x", address) : "");
   // uhal::HwInterface& hw = getGEMHwInterface();
 
   unsigned retryCount = 0;
   uint32_t res = 0x0;
   CMSGEMOS_TRACE("GEMHwDevice::gem::hw::GEMHwDevice::readReg 0x" << std::setfill('0') << std::setw(8)
         << std::hex << address << std::dec << std::endl);
-  while (retryCount < MAX_IPBUS_RETRIES) {
+  while (retryCount < p_retryPolicy->maxAttempts()) {
     ++retryCount;
     try {
       uhal::ValWord<uint32_t> val = this->getClient().read(address,mask);
@@ -246,28 +351,22 @@ uint32_t gem::hw::GEMHwDevice::readReg(uint32_t const& address, uint32_t const&
       std::string msgBase = toolbox::toString("Could not read register '0x%08x' (uHAL)", address);
       std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
       std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        ++retryCount;
-        if (retryCount > (MAX_IPBUS_RETRIES-1))
-          CMSGEMOS_DEBUG("GEMHwDevice::Failed to read register 0x" << std::setfill('0') << std::setw(8)
-                << std::hex << address << std::dec << " with mask "
-                << std::hex << address << std::dec
-                << ". retryCount("<<retryCount<<")"
-                << std::endl);
-        updateErrorCounters(errCode);
+      if (retryAfterError(errCode, retryCount)) {
         continue;
       } else {
         CMSGEMOS_ERROR("GEMHwDevice::" << msg);
         // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
+        break;
       }
     } catch (std::exception const& err) {
       std::string msgBase = toolbox::toString("Could not read register '0x%08x' (std)", address);
       std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
       CMSGEMOS_ERROR("GEMHwDevice::" << msg);
       // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+      break;
     }
   }
-  std::string msg = toolbox::toString("Maximum number of retries reached, unable to read register 0x%08x",
+  std::string msg = toolbox::toString("Giving up, unable to read register 0x%08x",
                                       address);
   CMSGEMOS_ERROR("GEMHwDevice::" << msg);
   // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
@@ -276,18 +375,21 @@ uint32_t gem::hw::GEMHwDevice::readReg(uint32_t const& address, uint32_t const&
 
 uint32_t gem::hw::GEMHwDevice::readMaskedAddress(std::string const& name)
 {
-  uint32_t address = this->getNode(name).getAddress();
-  uint32_t mask    = this->getNode(name).getMask();
-  return readReg(address,mask);
+  RegHandle handle = resolve(name);
+  return readReg(handle.address,handle.mask);
 }
 
 void gem::hw::GEMHwDevice::readRegs(register_pair_list &regList, int const& freq)
 {
   gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+  GEMHwProfiler::Probe probe(p_profiler.get(), GEMHwProfiler::AccessTypeT::READ_LIST);
+  if (probe.enabled())
+    for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
+      probe.add(curReg->first);
   // uhal::HwInterface& hw = getGEMHwInterface();
 
   unsigned retryCount = 0;
-  while (retryCount < MAX_IPBUS_RETRIES) {
+  while (retryCount < p_retryPolicy->maxAttempts()) {
     ++retryCount;
     try {
       std::vector<std::pair<std::string,uhal::ValWord<uint32_t> > > vals;
@@ -320,12 +422,12 @@ void gem::hw::GEMHwDevice::readRegs(register_pair_list &regList, int const& freq
         msgBase += toolbox::toString(" '%s'", curReg->first.c_str());
       std::string msg     = toolbox::toString("%s (uHAL): %s.", msgBase.c_str(), err.what());
       std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        updateErrorCounters(errCode);
+      if (retryAfterError(errCode, retryCount)) {
         continue;
       } else {
         CMSGEMOS_ERROR("GEMHwDevice::" << msg);
         // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
+        break;
       }
     } catch (std::exception const& err) {
       std::string msgBase = "Could not read from register in list:";
@@ -334,9 +436,10 @@ void gem::hw::GEMHwDevice::readRegs(register_pair_list &regList, int const& freq
       std::string msg = toolbox::toString("%s (std): %s.", msgBase.c_str(), err.what());
       CMSGEMOS_ERROR("GEMHwDevice::" << msg);
       // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+      break;
     }
   }
-  std::string msg = toolbox::toString("Maximum number of retries reached, unable to read registers");
+  std::string msg = toolbox::toString("Giving up, unable to read registers");
   CMSGEMOS_ERROR("GEMHwDevice::" << msg);
   // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
 }
@@ -344,10 +447,14 @@ void gem::hw::GEMHwDevice::readRegs(register_pair_list &regList, int const& freq
 void gem::hw::GEMHwDevice::readRegs(addressed_register_pair_list &regList, int const& freq)
 {
   gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+  GEMHwProfiler::Probe probe(p_profiler.get(), GEMHwProfiler::AccessTypeT::READ_LIST);
+  if (probe.enabled())
+    for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
+      probe.add(toolbox::toString("0x%08x", curReg->first));
   // uhal::HwInterface& hw = getGEMHwInterface();
 
   unsigned retryCount = 0;
-  while (retryCount < MAX_IPBUS_RETRIES) {
+  while (retryCount < p_retryPolicy->maxAttempts()) {
     ++retryCount;
     try {
       std::vector<std::pair<uint32_t, uhal::ValWord<uint32_t> > > vals;
@@ -380,12 +487,12 @@ void gem::hw::GEMHwDevice::readRegs(addressed_register_pair_list &regList, int c
         msgBase += toolbox::toString(" '0x%08x mask 0x%08x'", curReg->first);
       std::string msg     = toolbox::toString("%s (uHAL): %s.", msgBase.c_str(), err.what());
       std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        updateErrorCounters(errCode);
+      if (retryAfterError(errCode, retryCount)) {
         continue;
       } else {
         CMSGEMOS_ERROR("GEMHwDevice::" << msg);
         // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
+        break;
       }
     } catch (std::exception const& err) {
       std::string msgBase = "Could not read from register in list:";
@@ -394,9 +501,10 @@ void gem::hw::GEMHwDevice::readRegs(addressed_register_pair_list &regList, int c
       std::string msg = toolbox::toString("%s (std): %s.", msgBase.c_str(), err.what());
       CMSGEMOS_ERROR("GEMHwDevice::" << msg);
       // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+      break;
     }
   }
-  std::string msg = toolbox::toString("Maximum number of retries reached, unable to read registers");
+  std::string msg = toolbox::toString("Giving up, unable to read registers");
   CMSGEMOS_ERROR("GEMHwDevice::" << msg);
   // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
 }
@@ -404,10 +512,14 @@ void gem::hw::GEMHwDevice::readRegs(addressed_register_pair_list &regList, int c
 void gem::hw::GEMHwDevice::readRegs(masked_register_pair_list &regList, int const& freq)
 {
   gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+  GEMHwProfiler::Probe probe(p_profiler.get(), GEMHwProfiler::AccessTypeT::READ_LIST);
+  if (probe.enabled())
+    for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
+      probe.add(toolbox::toString("0x%08x", curReg->first.first));
   // uhal::HwInterface& hw = getGEMHwInterface();
 
   unsigned retryCount = 0;
-  while (retryCount < MAX_IPBUS_RETRIES) {
+  while (retryCount < p_retryPolicy->maxAttempts()) {
     ++retryCount;
     try {
       std::vector<std::pair<std::pair<uint32_t,uint32_t>,uhal::ValWord<uint32_t> > > vals;
@@ -441,12 +553,12 @@ void gem::hw::GEMHwDevice::readRegs(masked_register_pair_list &regList, int cons
         msgBase += toolbox::toString(" '0x%08x mask 0x%08x'", curReg->first.first, curReg->first.second);
       std::string msg     = toolbox::toString("%s (uHAL): %s.", msgBase.c_str(), err.what());
       std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        updateErrorCounters(errCode);
+      if (retryAfterError(errCode, retryCount)) {
         continue;
       } else {
         CMSGEMOS_ERROR("GEMHwDevice::" << msg);
         // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
+        break;
       }
     } catch (std::exception const& err) {
       std::string msgBase = "Could not read from register in list:";
@@ -455,9 +567,10 @@ void gem::hw::GEMHwDevice::readRegs(masked_register_pair_list &regList, int cons
       std::string msg = toolbox::toString("%s (std): %s.", msgBase.c_str(), err.what());
       CMSGEMOS_ERROR("GEMHwDevice::" << msg);
       // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+      break;
     }
   }
-  std::string msg = toolbox::toString("Maximum number of retries reached, unable to read registers");
+  std::string msg = toolbox::toString("Giving up, unable to read registers");
   CMSGEMOS_ERROR("GEMHwDevice::" << msg);
   // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
 }
@@ -465,9 +578,9 @@ void gem::hw::GEMHwDevice::readRegs(masked_register_pair_list &regList, int cons
 void gem::hw::GEMHwDevice::writeReg(std::string const& name, uint32_t const val)
 {
   gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+  GEMHwProfiler::Probe probe(p_profiler.get(), GEMHwProfiler::AccessTypeT::WRITE, name);
   // uhal::HwInterface& hw = getGEMHwInterface();
 
-  unsigned retryCount = 0;
   CMSGEMOS_DEBUG("GEMHwDevice::writeReg " << name << std::endl
                  << "Path  "      << this->getNode(name).getPath() << std::endl
                  << "Address 0x"  << std::hex << this->getNode(name).getAddress() << std::dec << std::endl
@@ -476,70 +589,27 @@ void gem::hw::GEMHwDevice::writeReg(std::string const& name, uint32_t const val)
                  << "Mode "       << this->getNode(name).getMode() << std::endl
                  << "Size "       << this->getNode(name).getSize() << std::endl
                  << std::endl);
-  while (retryCount < MAX_IPBUS_RETRIES) {
-    ++retryCount;
-    try {
-      uhal::ValWord<uint32_t> ival;
-      if (this->getNode(name).getPermission() != uhal::defs::WRITE)
-        ival = this->getNode(name).read();
-      this->getNode(name).write(val);
-      uhal::ValWord<uint32_t> rval;
-      if (this->getNode(name).getPermission() != uhal::defs::WRITE)
-        rval = this->getNode(name).read();
-      this->dispatch();
-      if (this->getNode(name).getPermission() != uhal::defs::WRITE)
-        CMSGEMOS_DEBUG("GEMHwDevice::writeReg initial: "
-                       << std::hex << ival.value() << std::dec
-                       << ", write val: " << std::hex << val << std::dec
-                       << ", readback: "  << std::hex << rval.value() << std::dec
-                       << std::endl);
-      if (this->getNode(name).getPermission() != uhal::defs::WRITE)
-        if (rval.value() != val) {
-          std::string msgBase = toolbox::toString("WriteValueMismatch write (0x%x) to register '%s' resulted in 0x%x (uHAL)",
-                                                  val, name.c_str(),rval.value());
-          XCEPT_RAISE(gem::hw::exception::WriteValueMismatch, toolbox::toString("%s.", msgBase.c_str()));
-        }
-      return;
-    } catch (uhal::exception::exception const& err) {
-      std::string msgBase = toolbox::toString("Could not write to register '%s' (uHAL)", name.c_str());
-      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
-      std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        ++retryCount;
-        if (retryCount > (MAX_IPBUS_RETRIES-1))
-          CMSGEMOS_DEBUG("GEMHwDevice::Failed to write value 0x" << std::hex<< val << std::dec << " to register " << name <<
-                ". retryCount("<<retryCount<<")"
-                << std::endl);
-        updateErrorCounters(errCode);
-        continue;
-      } else {
-        CMSGEMOS_ERROR("GEMHwDevice::" << msg);
-        // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
-      }
-    } catch (gem::hw::exception::WriteValueMismatch const& err) {
-      std::string msgBase = toolbox::toString("Could not write to register '%s' (uHAL)", name.c_str());
-      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
-      std::string errCode = toolbox::toString("%s",err.what());
-      CMSGEMOS_ERROR("GEMHwDevice::" << msg);
-    } catch (std::exception const& err) {
-      std::string msgBase = toolbox::toString("Could not write to register '%s' (std)", name.c_str());
-      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
-      CMSGEMOS_ERROR("GEMHwDevice::" << msg);
-      // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
-    }
-  }
-  std::string msg = toolbox::toString("Maximum number of retries reached, unable to write to register %s",name.c_str());
-  CMSGEMOS_ERROR("GEMHwDevice::" << msg);
-  // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+  writeNode(name, NULL, val);
+}
+
+void gem::hw::GEMHwDevice::writeReg(RegHandle& handle, uint32_t const val)
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+
+  checkHandle(handle);
+  GEMHwProfiler::Probe probe(p_profiler.get(), GEMHwProfiler::AccessTypeT::WRITE, handle.name);
+  writeNode(handle.name, handle.node, val);
 }
 
 void gem::hw::GEMHwDevice::writeReg(uint32_t const& address, uint32_t const val)
 {
   gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+  GEMHwProfiler::Probe probe(p_profiler.get(), GEMHwProfiler::AccessTypeT::WRITE,
+                             p_profiler ? toolbox::toString("0x%08x", address) : "");
   // uhal::HwInterface& hw = getGEMHwInterface();
 
   unsigned retryCount = 0;
-  while (retryCount < MAX_IPBUS_RETRIES) {
+  while (retryCount < p_retryPolicy->maxAttempts()) {
     ++retryCount;
     try {
       uhal::ValWord<uint32_t> ival = this->getClient().read(address);
@@ -556,23 +626,19 @@ void gem::hw::GEMHwDevice::writeReg(uint32_t const& address, uint32_t const val)
                                                 val,address,rval.value());
         XCEPT_RAISE(gem::hw::exception::WriteValueMismatch, toolbox::toString("%s.", msgBase.c_str()));
       }
+      // the register names behind the address are unknown, the shadow image can't be trusted anymore
+      m_shadow.clear();
       return;
     } catch (uhal::exception::exception const& err) {
       std::string msgBase = toolbox::toString("Could not write to register '0x%08x' (uHAL)", address);
       std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
       std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        ++retryCount;
-        if (retryCount > (MAX_IPBUS_RETRIES-1))
-          CMSGEMOS_DEBUG("GEMHwDevice::Failed to write value 0x" << std::hex<< val << std::dec << " to register 0x"
-                << std::setfill('0') << std::setw(8) << std::hex << address << std::dec
-                << ". retryCount("<<retryCount<<")"
-                << std::endl);
-        updateErrorCounters(errCode);
+      if (retryAfterError(errCode, retryCount)) {
         continue;
       } else {
         CMSGEMOS_ERROR("GEMHwDevice::" << msg);
         // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
+        break;
       }
     } catch (gem::hw::exception::WriteValueMismatch const& err) {
       std::string msgBase = toolbox::toString("Could not write to register '0x%08x' (uHAL)", address);
@@ -584,9 +650,10 @@ void gem::hw::GEMHwDevice::writeReg(uint32_t const& address, uint32_t const val)
       std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
       CMSGEMOS_ERROR("GEMHwDevice::" << msg);
       // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+      break;
     }
   }
-  std::string msg = toolbox::toString("Maximum number of retries reached, unable to write to register 0x%08x",
+  std::string msg = toolbox::toString("Giving up, unable to write to register 0x%08x",
                                       address);
   CMSGEMOS_ERROR("GEMHwDevice::" << msg);
   // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
@@ -595,10 +662,14 @@ void gem::hw::GEMHwDevice::writeReg(uint32_t const& address, uint32_t const val)
 void gem::hw::GEMHwDevice::writeRegs(register_pair_list const& regList, int const& freq)
 {
   gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+  GEMHwProfiler::Probe probe(p_profiler.get(), GEMHwProfiler::AccessTypeT::WRITE_LIST);
+  if (probe.enabled())
+    for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
+      probe.add(curReg->first);
   // uhal::HwInterface& hw = getGEMHwInterface();
 
   unsigned retryCount = 0;
-  while (retryCount < MAX_IPBUS_RETRIES) {
+  while (retryCount < p_retryPolicy->maxAttempts()) {
     ++retryCount;
     try {
       int counter{0}, dispatchcounter{0};
@@ -616,6 +687,8 @@ void gem::hw::GEMHwDevice::writeRegs(register_pair_list const& regList, int cons
       }
       CMSGEMOS_DEBUG("GEMHwDevice::writeRegs dispatched " << dispatchcounter
             << " calls for " << counter << " registers");
+      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
+        m_shadow.refresh(curReg->first, curReg->second);
       return;
     } catch (uhal::exception::exception const& err) {
       std::string msgBase = "Could not write to register in list:";
@@ -623,12 +696,12 @@ void gem::hw::GEMHwDevice::writeRegs(register_pair_list const& regList, int cons
         msgBase += toolbox::toString(" '%s'", curReg->first.c_str());
       std::string msg     = toolbox::toString("%s (uHAL): %s.", msgBase.c_str(), err.what());
       std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        updateErrorCounters(errCode);
+      if (retryAfterError(errCode, retryCount)) {
         continue;
       } else {
         CMSGEMOS_ERROR("GEMHwDevice::" << msg);
         // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
+        break;
       }
     } catch (std::exception const& err) {
       std::string msgBase = "Could not write to register in list:";
@@ -637,8 +710,74 @@ void gem::hw::GEMHwDevice::writeRegs(register_pair_list const& regList, int cons
       std::string msg = toolbox::toString("%s (std): %s.", msgBase.c_str(), err.what());
       CMSGEMOS_ERROR("GEMHwDevice::" << msg);
       // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+      break;
     }
   }
+  // some of the writes may have gone through, the next writeChangedRegs() must write them all
+  for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
+    m_shadow.erase(curReg->first);
+}
+
+size_t gem::hw::GEMHwDevice::writeChangedRegs(register_pair_list const& regList)
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+
+  register_pair_list changed;
+  for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg) {
+    uint32_t known = 0;
+    if (m_shadow.lookup(curReg->first, known) && known == curReg->second)
+      continue;
+    changed.push_back(*curReg);
+  }
+
+  if (!changed.empty()) {
+    GEMHwTransaction trans(*this);
+    for (auto curReg = changed.begin(); curReg != changed.end(); ++curReg)
+      trans.write(curReg->first, curReg->second);
+    try {
+      trans.commit();
+    } catch (gem::hw::exception::HardwareProblem const& err) {
+      // some of the writes may have gone through, make sure they are all repeated next time
+      for (auto curReg = changed.begin(); curReg != changed.end(); ++curReg)
+        m_shadow.erase(curReg->first);
+      throw;
+    }
+    for (auto curReg = changed.begin(); curReg != changed.end(); ++curReg)
+      m_shadow.update(curReg->first, curReg->second);
+  }
+
+  CMSGEMOS_DEBUG("GEMHwDevice::writeChangedRegs wrote " << changed.size()
+                 << " of " << regList.size() << " registers");
+  return changed.size();
+}
+
+size_t gem::hw::GEMHwDevice::verifyShadow(size_t const maxRegs)
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+
+  GEMHwShadow::entry_list expected = m_shadow.nextSlice(maxRegs);
+  if (expected.empty())
+    return 0;
+
+  GEMHwTransaction trans(*this);
+  std::vector<std::shared_future<uint32_t> > actual;
+  actual.reserve(expected.size());
+  for (auto curReg = expected.begin(); curReg != expected.end(); ++curReg)
+    actual.push_back(trans.read(curReg->first));
+  trans.commit();
+
+  size_t nMismatches = 0;
+  for (size_t i = 0; i < expected.size(); ++i) {
+    uint32_t const val = actual.at(i).get();
+    if (val == expected.at(i).second)
+      continue;
+    ++nMismatches;
+    CMSGEMOS_WARN("GEMHwDevice::verifyShadow register " << expected.at(i).first
+                  << " is 0x" << std::hex << val << ", 0x" << expected.at(i).second << std::dec
+                  << " was written, it will be written again at the next configuration");
+    m_shadow.refresh(expected.at(i).first, val);
+  }
+  return nMismatches;
 }
 
 void gem::hw::GEMHwDevice::writeValueToRegs(std::vector<std::string> const& regNames, uint32_t const& regValue, int const& freq)
@@ -676,6 +815,7 @@ std::vector<uint32_t> gem::hw::GEMHwDevice::readBlock(std::string const& name)
 std::vector<uint32_t> gem::hw::GEMHwDevice::readBlock(std::string const& name, size_t const& numWords)
 {
   gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+  GEMHwProfiler::Probe probe(p_profiler.get(), GEMHwProfiler::AccessTypeT::READ_BLOCK, name, numWords);
   // uhal::HwInterface& hw = getGEMHwInterface();
 
   std::vector<uint32_t> res(numWords);
@@ -684,7 +824,7 @@ std::vector<uint32_t> gem::hw::GEMHwDevice::readBlock(std::string const& name, s
   if (numWords < 1)
     return res;
 
-  while (retryCount < MAX_IPBUS_RETRIES) {
+  while (retryCount < p_retryPolicy->maxAttempts()) {
     ++retryCount;
     try {
       uhal::ValVector<uint32_t> values = this->getNode(name).readBlock(numWords);
@@ -695,27 +835,22 @@ std::vector<uint32_t> gem::hw::GEMHwDevice::readBlock(std::string const& name, s
       std::string msgBase = toolbox::toString("Could not read block '%s' (uHAL)", name.c_str());
       std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
       std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        ++retryCount;
-        if (retryCount > (MAX_IPBUS_RETRIES-1))
-          CMSGEMOS_DEBUG("GEMHwDevice::Failed to read block " << name << " with " << numWords << " words" <<
-                ". retryCount("<<retryCount<<")" << std::endl
-                << "error was " << errCode
-                << std::endl);
-        updateErrorCounters(errCode);
+      if (retryAfterError(errCode, retryCount)) {
         continue;
       } else {
         CMSGEMOS_ERROR("GEMHwDevice::" << msg);
         // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
+        break;
       }
     } catch (std::exception const& err) {
       std::string msgBase = toolbox::toString("Could not read block '%s' (std)", name.c_str());
       std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
       CMSGEMOS_ERROR("GEMHwDevice::" << msg);
       // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+      break;
     }
   }
-  std::string msg = toolbox::toString("Maximum number of retries reached, unable to read block");
+  std::string msg = toolbox::toString("Giving up, unable to read block");
   CMSGEMOS_ERROR("GEMHwDevice::" << msg);
   // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
   return res;
@@ -738,13 +873,14 @@ uint32_t gem::hw::GEMHwDevice::readBlock(std::string const& name, uint32_t* buff
 void gem::hw::GEMHwDevice::writeBlock(std::string const& name, std::vector<uint32_t> const values)
 {
   gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+  GEMHwProfiler::Probe probe(p_profiler.get(), GEMHwProfiler::AccessTypeT::WRITE_BLOCK, name, values.size());
   if (values.size() < 1)
     return;
 
   // uhal::HwInterface& hw = getGEMHwInterface();
 
   unsigned retryCount = 0;
-  while (retryCount < MAX_IPBUS_RETRIES) {
+  while (retryCount < p_retryPolicy->maxAttempts()) {
     ++retryCount;
     try {
       this->getNode(name).writeBlock(values);
@@ -754,26 +890,22 @@ void gem::hw::GEMHwDevice::writeBlock(std::string const& name, std::vector<uint3
       std::string msgBase = toolbox::toString("Could not write to block '%s' (uHAL)", name.c_str());
       std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
       std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        ++retryCount;
-        if (retryCount > (MAX_IPBUS_RETRIES-1))
-          CMSGEMOS_DEBUG("GEMHwDevice::Failed to write block " << name <<
-                ". retryCount("<<retryCount<<")"
-                << std::endl);
-        updateErrorCounters(errCode);
+      if (retryAfterError(errCode, retryCount)) {
         continue;
       } else {
         CMSGEMOS_ERROR("GEMHwDevice::" << msg);
         // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
+        break;
       }
     } catch (std::exception const& err) {
       std::string msgBase = toolbox::toString("Could not write to block '%s' (std)", name.c_str());
       std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
       CMSGEMOS_ERROR("GEMHwDevice::" << msg);
       // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+      break;
     }
   }
-  std::string msg = toolbox::toString("Maximum number of retries reached, unable to write block %s",name.c_str());
+  std::string msg = toolbox::toString("Giving up, unable to write block %s",name.c_str());
   CMSGEMOS_ERROR("GEMHwDevice::" << msg);
   // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
 }
@@ -805,15 +937,184 @@ void gem::hw::GEMHwDevice::zeroFIFO(std::string const& name)
   return writeReg(name+".FLUSH",0x0);
 }
 
+void gem::hw::GEMHwDevice::dispatch()
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+  GEMHwProfiler::Probe probe(p_profiler.get(), GEMHwProfiler::AccessTypeT::DISPATCH, "", 0);
+  uhal::HwInterface::dispatch();
+}
+
+void gem::hw::GEMHwDevice::enableProfiler(bool const enable)
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+  if (enable && !p_profiler) {
+    p_profiler = std::make_shared<GEMHwProfiler>(getDeviceID().empty() ? getLoggerName() : getDeviceID());
+    CMSGEMOS_INFO("GEMHwDevice::enableProfiler IPbus accesses are now profiled");
+  } else if (!enable && p_profiler) {
+    p_profiler.reset();
+    CMSGEMOS_INFO("GEMHwDevice::enableProfiler IPbus accesses are no longer profiled");
+  }
+}
+
+std::shared_ptr<gem::hw::GEMHwProfiler> gem::hw::GEMHwDevice::getProfiler() const
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+  return p_profiler;
+}
+
 bool gem::hw::GEMHwDevice::knownErrorCode(std::string const& errCode) const {
-  return ((errCode.find("amount of data")              != std::string::npos) ||
-          (errCode.find("INFO CODE = 0x4L")            != std::string::npos) ||
-          (errCode.find("INFO CODE = 0x6L")            != std::string::npos) ||
-          (errCode.find("timed out")                   != std::string::npos) ||
-          (errCode.find("had response field = 0x04")   != std::string::npos) ||
-          (errCode.find("had response field = 0x06")   != std::string::npos) ||
-          (errCode.find("ControlHub error code is: 3") != std::string::npos) ||
-          (errCode.find("ControlHub error code is: 4") != std::string::npos));
+  return p_retryPolicy->isTransient(p_retryPolicy->classify(errCode));
+}
+
+void gem::hw::GEMHwDevice::checkHandle(RegHandle& handle)
+{
+  if (handle.name.empty()) {
+    std::string msg = "Unresolved register handle, obtain it from resolve(<register name>)";
+    CMSGEMOS_ERROR("GEMHwDevice::" << msg);
+    XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+  }
+
+  if (handle.node == NULL || handle.generation != m_handleGeneration)
+    handle = resolve(handle.name);
+}
+
+uint32_t gem::hw::GEMHwDevice::readNode(std::string const& name, uhal::Node const* node)
+{
+  unsigned retryCount = 0;
+  uint32_t res = 0x0;
+  while (retryCount < p_retryPolicy->maxAttempts()) {
+    ++retryCount;
+    try {
+      uhal::ValWord<uint32_t> val = node ? node->read() : this->getNode(name).read();
+      this->dispatch();
+      res = val.value();
+      CMSGEMOS_TRACE("GEMHwDevice::Successfully read register " << name.c_str() << " with value 0x"
+            << std::setfill('0') << std::setw(8) << std::hex << res << std::dec
+            << " retry count is " << retryCount << ". Should move on to next operation");
+      return res;
+    } catch (uhal::exception::exception const& err) {
+      std::string msgBase = toolbox::toString("Could not read register '%s' (uHAL)", name.c_str());
+      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
+      std::string errCode = toolbox::toString("%s",err.what());
+      if (retryAfterError(errCode, retryCount)) {
+        continue;
+      } else {
+        CMSGEMOS_ERROR("GEMHwDevice::" << msg);
+        // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
+        break;
+      }
+    } catch (std::exception const& err) {
+      std::string msgBase = toolbox::toString("Could not read register '%s' (std)", name.c_str());
+      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
+      CMSGEMOS_ERROR("GEMHwDevice::" << msg);
+      // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+      break;
+    }
+  }
+  std::string msg = toolbox::toString("Giving up, unable to read register %s",name.c_str());
+  CMSGEMOS_ERROR("GEMHwDevice::" << msg);
+  // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+  return res;
+}
+
+void gem::hw::GEMHwDevice::writeNode(std::string const& name, uhal::Node const* node, uint32_t const val)
+{
+  unsigned retryCount = 0;
+  while (retryCount < p_retryPolicy->maxAttempts()) {
+    ++retryCount;
+    try {
+      uhal::Node const& reg = node ? *node : this->getNode(name);
+      bool const readable   = reg.getPermission() != uhal::defs::WRITE;
+      reg.write(val);
+      uhal::ValWord<uint32_t> rval;
+      if (readable)
+        rval = reg.read();
+      this->dispatch();
+      if (readable) {
+        CMSGEMOS_DEBUG("GEMHwDevice::writeReg write val: " << std::hex << val << std::dec
+                       << ", readback: " << std::hex << rval.value() << std::dec
+                       << std::endl);
+        if (rval.value() != val) {
+          std::string msgBase = toolbox::toString("WriteValueMismatch write (0x%x) to register '%s' resulted in 0x%x (uHAL)",
+                                                  val, name.c_str(), rval.value());
+          XCEPT_RAISE(gem::hw::exception::WriteValueMismatch, toolbox::toString("%s.", msgBase.c_str()));
+        }
+      }
+      m_shadow.refresh(name, val);
+      return;
+    } catch (uhal::exception::exception const& err) {
+      std::string msgBase = toolbox::toString("Could not write to register '%s' (uHAL)", name.c_str());
+      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
+      std::string errCode = toolbox::toString("%s",err.what());
+      if (retryAfterError(errCode, retryCount)) {
+        continue;
+      } else {
+        CMSGEMOS_ERROR("GEMHwDevice::" << msg);
+        // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
+        break;
+      }
+    } catch (gem::hw::exception::WriteValueMismatch const& err) {
+      std::string msgBase = toolbox::toString("Could not write to register '%s' (uHAL)", name.c_str());
+      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
+      CMSGEMOS_ERROR("GEMHwDevice::" << msg);
+    } catch (std::exception const& err) {
+      std::string msgBase = toolbox::toString("Could not write to register '%s' (std)", name.c_str());
+      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
+      CMSGEMOS_ERROR("GEMHwDevice::" << msg);
+      // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+      break;
+    }
+  }
+  // the register holds an unknown value, the next writeChangedRegs() must write it
+  m_shadow.erase(name);
+  std::string msg = toolbox::toString("Giving up, unable to write to register %s",name.c_str());
+  CMSGEMOS_ERROR("GEMHwDevice::" << msg);
+  // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+}
+
+bool gem::hw::GEMHwDevice::retryAfterError(std::string const& errCode, unsigned const attempt)
+{
+  int const errClass = countError(errCode);
+
+  if (!p_retryPolicy->shouldRetry(errClass, attempt)) {
+    ++m_ipBusErrClasses.GaveUp;
+    CMSGEMOS_DEBUG("GEMHwDevice::retryAfterError not retrying after " << attempt << " attempt(s), "
+                   << GEMHwRetryPolicy::errorClassName(errClass) << ": " << errCode);
+    return false;
+  }
+
+  unsigned const delay = p_retryPolicy->backoffUsec(errClass, attempt);
+  ++m_ipBusErrClasses.Retries;
+  m_ipBusErrClasses.BackoffUsec += delay;
+  CMSGEMOS_DEBUG("GEMHwDevice::retryAfterError " << GEMHwRetryPolicy::errorClassName(errClass)
+                 << " on attempt " << attempt << ", retrying in " << delay << " us");
+  if (delay > 0) {
+    // other threads may use the device meanwhile, the failed access is queued again after the wait
+    m_hwLock.unlock();
+    std::this_thread::sleep_for(std::chrono::microseconds(delay));
+    m_hwLock.lock();
+  }
+  return true;
+}
+
+int gem::hw::GEMHwDevice::countError(std::string const& errCode)
+{
+  int const errClass = p_retryPolicy->classify(errCode);
+  updateErrorCounters(errCode);
+  ++m_ipBusErrClasses.Errors[errClass];
+  return errClass;
+}
+
+void gem::hw::GEMHwDevice::setRetryPolicy(std::shared_ptr<GEMHwRetryPolicy> policy)
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+  p_retryPolicy = policy ? policy : std::make_shared<GEMHwRetryPolicy>();
+}
+
+std::shared_ptr<gem::hw::GEMHwRetryPolicy> gem::hw::GEMHwDevice::getRetryPolicy() const
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+  return p_retryPolicy;
 }
 
 
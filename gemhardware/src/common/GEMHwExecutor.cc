@@ -0,0 +1,296 @@
+/**
+ * class: GEMHwExecutor
+ * description: Per-device I/O thread executing queued register requests in coalesced transactions
+ */
+
+#include "gem/hw/GEMHwExecutor.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "gem/hw/GEMHwDevice.h"
+#include "gem/hw/GEMHwTransaction.h"
+
+void gem::hw::GEMHwExecutor::Request::complete()
+{
+  switch (type) {
+  case RequestType::READ:
+    wordResult.set_value(wordVal);
+    break;
+  case RequestType::READ_BLOCK:
+    blockResult.set_value(std::move(blockVal));
+    break;
+  default:
+    doneResult.set_value();
+    break;
+  }
+}
+
+void gem::hw::GEMHwExecutor::Request::fail(std::exception_ptr err)
+{
+  switch (type) {
+  case RequestType::READ:
+    wordResult.set_exception(err);
+    break;
+  case RequestType::READ_BLOCK:
+    blockResult.set_exception(err);
+    break;
+  default:
+    doneResult.set_exception(err);
+    break;
+  }
+}
+
+void gem::hw::GEMHwExecutor::Request::notify(log4cplus::Logger& logger)
+{
+  if (!onComplete)
+    return;
+
+  log4cplus::Logger m_gemLogger = logger;
+  try {
+    onComplete();
+  } catch (std::exception const& e) {
+    CMSGEMOS_ERROR("GEMHwExecutor: completion callback for " << regName << " threw: " << e.what());
+  } catch (...) {
+    CMSGEMOS_ERROR("GEMHwExecutor: completion callback for " << regName << " threw an unknown exception");
+  }
+}
+
+gem::hw::GEMHwExecutor::GEMHwExecutor(GEMHwDevice& device, size_t const maxBatch, unsigned const windowUsec) :
+  m_device(device),
+  m_maxBatch(std::max(maxBatch, size_t(1))),
+  m_windowUsec(windowUsec),
+  m_gemLogger(log4cplus::Logger::getInstance(device.getLoggerName())),
+  m_nQueued(0),
+  m_stopping(false),
+  m_requestCount(0),
+  m_batchCount(0)
+{
+  m_thread = std::thread(&GEMHwExecutor::run, this);
+  CMSGEMOS_INFO("GEMHwExecutor: started I/O thread for " << device.getDeviceID()
+                << " with batches of up to " << m_maxBatch << " requests");
+}
+
+gem::hw::GEMHwExecutor::~GEMHwExecutor()
+{
+  {
+    std::lock_guard<std::mutex> guard(m_queueMutex);
+    m_stopping = true;
+  }
+  m_queueCondition.notify_all();
+  if (m_thread.joinable())
+    m_thread.join();
+  CMSGEMOS_INFO("GEMHwExecutor: stopped I/O thread after " << m_requestCount.load() << " requests in "
+                << m_batchCount.load() << " batches");
+}
+
+std::shared_future<uint32_t> gem::hw::GEMHwExecutor::readReg(std::string const& regName, int const priority,
+                                                             word_callback callback)
+{
+  request_ptr request = std::make_shared<Request>();
+  request->type    = RequestType::READ;
+  request->regName = regName;
+  std::shared_future<uint32_t> result = request->wordResult.get_future().share();
+  if (callback)
+    request->onComplete = [callback, result]() { callback(result); };
+  enqueue(request, priority);
+  return result;
+}
+
+std::shared_future<std::vector<uint32_t> > gem::hw::GEMHwExecutor::readBlock(std::string const& regName,
+                                                                              size_t const nWords,
+                                                                              int const priority,
+                                                                              block_callback callback)
+{
+  request_ptr request = std::make_shared<Request>();
+  request->type    = RequestType::READ_BLOCK;
+  request->regName = regName;
+  request->nWords  = nWords;
+  std::shared_future<std::vector<uint32_t> > result = request->blockResult.get_future().share();
+  if (callback)
+    request->onComplete = [callback, result]() { callback(result); };
+  enqueue(request, priority);
+  return result;
+}
+
+std::shared_future<void> gem::hw::GEMHwExecutor::writeReg(std::string const& regName, uint32_t const val,
+                                                          int const priority, done_callback callback)
+{
+  request_ptr request = std::make_shared<Request>();
+  request->type    = RequestType::WRITE;
+  request->regName = regName;
+  request->value   = val;
+  std::shared_future<void> result = request->doneResult.get_future().share();
+  if (callback)
+    request->onComplete = [callback, result]() { callback(result); };
+  enqueue(request, priority);
+  return result;
+}
+
+std::shared_future<void> gem::hw::GEMHwExecutor::submit(std::function<void(GEMHwDevice&)> task,
+                                                        int const priority)
+{
+  request_ptr request = std::make_shared<Request>();
+  request->type = RequestType::TASK;
+  request->task = task;
+  std::shared_future<void> result = request->doneResult.get_future().share();
+  enqueue(request, priority);
+  return result;
+}
+
+size_t gem::hw::GEMHwExecutor::queued() const
+{
+  std::lock_guard<std::mutex> guard(m_queueMutex);
+  return m_nQueued;
+}
+
+void gem::hw::GEMHwExecutor::enqueue(request_ptr request, int const priority)
+{
+  int const queue = std::min(std::max(priority, 0), static_cast<int>(Priority::N_PRIORITIES)-1);
+  // from a callback, the future could only become ready after the callback returns
+  if (!request->onComplete && std::this_thread::get_id() == m_thread.get_id()) {
+    std::string msg = "GEMHwExecutor: request for " + request->regName
+      + " issued from the I/O thread of the device without a callback, waiting for it would deadlock";
+    CMSGEMOS_ERROR(msg);
+    XCEPT_RAISE(gem::hw::exception::SoftwareProblem, msg);
+  }
+  {
+    std::lock_guard<std::mutex> guard(m_queueMutex);
+    if (m_stopping) {
+      std::string msg = "GEMHwExecutor is stopping, request for " + request->regName + " refused";
+      CMSGEMOS_WARN(msg);
+      XCEPT_RAISE(gem::hw::exception::SoftwareProblem, msg);
+    }
+    m_queues[queue].push_back(request);
+    ++m_nQueued;
+  }
+  m_queueCondition.notify_one();
+}
+
+void gem::hw::GEMHwExecutor::run()
+{
+  GEMHwProfiler::CallerScope scope("GEMHwExecutor");
+  std::vector<request_ptr> batch;
+  batch.reserve(m_maxBatch);
+  while (true) {
+    batch.clear();
+    {
+      std::unique_lock<std::mutex> lock(m_queueMutex);
+      m_queueCondition.wait(lock, [this] { return m_stopping || m_nQueued > 0; });
+      if (m_nQueued == 0)
+        return;  // stopping with nothing left to do
+
+      // give other threads the chance to add to a batch that is not full yet
+      if (m_windowUsec > 0 && m_nQueued < m_maxBatch && !m_stopping)
+        m_queueCondition.wait_for(lock, std::chrono::microseconds(m_windowUsec),
+                                  [this] { return m_stopping || m_nQueued >= m_maxBatch; });
+
+      // highest priority first, a task is never combined with other requests
+      bool full = false;
+      for (int prio = 0; prio < Priority::N_PRIORITIES && !full; ++prio) {
+        std::deque<request_ptr>& queue = m_queues[prio];
+        while (!queue.empty() && !full) {
+          bool const isTask = queue.front()->type == RequestType::TASK;
+          if (isTask && !batch.empty())
+            break;
+          batch.push_back(queue.front());
+          queue.pop_front();
+          --m_nQueued;
+          full = isTask || batch.size() >= m_maxBatch;
+        }
+        full = full || (!queue.empty());
+      }
+    }
+
+    m_requestCount.fetch_add(batch.size(), std::memory_order_relaxed);
+    m_batchCount.fetch_add(1, std::memory_order_relaxed);
+    if (batch.front()->type == RequestType::TASK)
+      executeTask(batch.front());
+    else
+      execute(batch);
+  }
+}
+
+void gem::hw::GEMHwExecutor::executeTask(request_ptr request)
+{
+  try {
+    request->task(m_device);
+    request->complete();
+  } catch (...) {
+    request->fail(std::current_exception());
+  }
+  request->notify(m_gemLogger);
+}
+
+bool gem::hw::GEMHwExecutor::repeatable(Request const& request)
+{
+  switch (request.type) {
+  case RequestType::READ:
+    return true;
+  case RequestType::READ_BLOCK:
+    // reading a FIFO port again loses the words the failed attempt popped
+    try {
+      return m_device.resolve(request.regName).node->getMode() != uhal::defs::NON_INCREMENTAL;
+    } catch (gem::hw::exception::HardwareProblem const&) {
+      return false;
+    }
+  default:
+    // the chunk of a write may have been applied before the batch failed
+    return false;
+  }
+}
+
+void gem::hw::GEMHwExecutor::execute(std::vector<request_ptr>& batch)
+{
+  std::vector<request_ptr> queued;
+  try {
+    GEMHwTransaction trans(m_device);
+    for (auto request = batch.begin(); request != batch.end(); ++request) {
+      try {
+        switch ((*request)->type) {
+        case RequestType::READ:
+          trans.read((*request)->regName, (*request)->wordVal);
+          break;
+        case RequestType::READ_BLOCK:
+          trans.readBlock((*request)->regName, (*request)->blockVal, (*request)->nWords);
+          break;
+        case RequestType::WRITE:
+          trans.write((*request)->regName, (*request)->value);
+          break;
+        }
+        queued.push_back(*request);
+      } catch (...) {
+        // register not in the address table, only this request fails
+        (*request)->fail(std::current_exception());
+        (*request)->notify(m_gemLogger);
+      }
+    }
+    trans.commit();
+  } catch (...) {
+    std::exception_ptr const err = std::current_exception();
+    if (queued.size() > 1) {
+      // only the reads are sent again, the others fail with the error of the batch
+      CMSGEMOS_DEBUG("GEMHwExecutor: batch of " << queued.size() << " requests failed, retrying the reads one by one");
+      for (auto request = queued.begin(); request != queued.end(); ++request) {
+        if (repeatable(**request)) {
+          std::vector<request_ptr> single(1, *request);
+          execute(single);
+        } else {
+          CMSGEMOS_WARN("GEMHwExecutor: batch failed, not retrying the request for " << (*request)->regName
+                        << ", it may have been applied");
+          (*request)->fail(err);
+          (*request)->notify(m_gemLogger);
+        }
+      }
+    } else if (!queued.empty()) {
+      queued.front()->fail(err);
+      queued.front()->notify(m_gemLogger);
+    }
+    return;
+  }
+
+  for (auto request = queued.begin(); request != queued.end(); ++request)
+    (*request)->complete();
+  for (auto request = queued.begin(); request != queued.end(); ++request)
+    (*request)->notify(m_gemLogger);
+}
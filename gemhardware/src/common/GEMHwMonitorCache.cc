@@ -0,0 +1,371 @@
+/**
+ * class: GEMHwMonitorCache
+ * description: Monitoring values of a board read once for all its monitors
+ */
+
+#include "gem/hw/GEMHwMonitorCache.h"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+#include "gem/hw/GEMHwExecutor.h"
+#include "gem/hw/GEMHwProfiler.h"
+#include "gem/hw/GEMHwTransaction.h"
+#include "gem/hw/exception/Exception.h"
+
+const uint32_t gem::hw::GEMHwMonitorCache::DEFAULT_POLL_MSEC;
+const uint32_t gem::hw::GEMHwMonitorCache::DROPPED_RETRY_MSEC;
+const uint32_t gem::hw::GEMHwMonitorCache::DROPPED_RETRY_MAX_MSEC;
+
+std::shared_ptr<gem::hw::GEMHwMonitorCache> gem::hw::GEMHwMonitorCache::getCache(GEMHwDevice& device)
+{
+  static std::mutex registryMutex;
+  static std::map<std::string, std::weak_ptr<GEMHwMonitorCache> > registry;
+
+  std::string const board = device.uri();
+  std::lock_guard<std::mutex> guard(registryMutex);
+  std::shared_ptr<GEMHwMonitorCache> cache = registry[board].lock();
+  if (!cache) {
+    cache = std::make_shared<GEMHwMonitorCache>(board);
+    registry[board] = cache;
+  }
+  return cache;
+}
+
+gem::hw::GEMHwMonitorCache::GEMHwMonitorCache(std::string const& board) :
+  m_board(board),
+  m_gemLogger(log4cplus::Logger::getInstance("GEMHwMonitorCache")),
+  m_nextId(0),
+  m_nRefreshes(0),
+  m_refreshing(false),
+  m_stop(false)
+{
+  m_poller = std::thread(&GEMHwMonitorCache::poll, this);
+}
+
+gem::hw::GEMHwMonitorCache::~GEMHwMonitorCache()
+{
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_stop = true;
+  }
+  m_pollCondition.notify_all();
+  if (m_poller.joinable())
+    m_poller.join();
+}
+
+gem::hw::GEMHwMonitorCache::subscription_id gem::hw::GEMHwMonitorCache::subscribe(GEMHwDevice& device,
+                                                                                std::vector<GEMHwDevice::RegHandle> const& regs,
+                                                                                uint32_t const pollMsec)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  subscription_id const id = m_nextId++;
+  Subscriber& subscriber = m_subscribers[id];
+  subscriber.device   = &device;
+  subscriber.pollMsec = std::max(pollMsec, 1U);
+  for (auto reg = regs.begin(); reg != regs.end(); ++reg) {
+    reg_key const key(reg->address, reg->mask);
+    m_entries[key].readers.push_back(std::make_pair(id, *reg));
+    subscriber.keys.push_back(key);
+  }
+  CMSGEMOS_DEBUG("GEMHwMonitorCache::subscribe " << m_board << ": subscription " << id << " of "
+                 << regs.size() << " registers every " << subscriber.pollMsec << "ms, "
+                 << m_entries.size() << " distinct registers for " << m_subscribers.size() << " subscribers");
+  // the poll period may have become shorter
+  m_pollCondition.notify_all();
+  return id;
+}
+
+void gem::hw::GEMHwMonitorCache::unsubscribe(subscription_id const id)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  // the refresh in flight may be reading through the device of the subscription
+  m_refreshCondition.wait(lock, [this] { return !m_refreshing; });
+  auto subscriber = m_subscribers.find(id);
+  if (subscriber == m_subscribers.end())
+    return;
+
+  for (auto key = subscriber->second.keys.begin(); key != subscriber->second.keys.end(); ++key) {
+    auto entry = m_entries.find(*key);
+    if (entry == m_entries.end())
+      continue;
+    std::vector<std::pair<subscription_id, GEMHwDevice::RegHandle> >& readers = entry->second.readers;
+    for (auto reader = readers.begin(); reader != readers.end(); ++reader) {
+      if (reader->first == id) {
+        readers.erase(reader);
+        break;
+      }
+    }
+    if (readers.empty())
+      m_entries.erase(entry);
+  }
+  m_subscribers.erase(subscriber);
+  CMSGEMOS_DEBUG("GEMHwMonitorCache::unsubscribe " << m_board << ": subscription " << id << ", "
+                 << m_entries.size() << " distinct registers for " << m_subscribers.size() << " subscribers");
+}
+
+void gem::hw::GEMHwMonitorCache::setPaused(subscription_id const id, bool const paused)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  auto subscriber = m_subscribers.find(id);
+  if (subscriber == m_subscribers.end() || subscriber->second.paused == paused)
+    return;
+  subscriber->second.paused = paused;
+  CMSGEMOS_DEBUG("GEMHwMonitorCache::setPaused " << m_board << ": subscription " << id
+                 << (paused ? " paused" : " resumed"));
+  // the poll period may have changed
+  m_pollCondition.notify_all();
+}
+
+gem::hw::GEMHwMonitorCache::clock::time_point gem::hw::GEMHwMonitorCache::fetch(subscription_id const id,
+                                                                              std::vector<uint32_t>& values,
+                                                                              clock::duration const& maxAge,
+                                                                              std::vector<bool>* dropped)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  clock::time_point now = clock::now();
+  while (true) {
+    // checked again after every wait, the subscription may have been dropped meanwhile
+    if (!m_subscribers.count(id)) {
+      std::stringstream msg;
+      msg << "GEMHwMonitorCache::fetch " << m_board << ": no subscription " << id;
+      XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg.str());
+    }
+
+    std::vector<reg_key> const& keys = m_subscribers.at(id).keys;
+    bool stale = false;
+    for (auto key = keys.begin(); key != keys.end() && !stale; ++key) {
+      Entry const& entry = m_entries.at(*key);
+      stale = !entry.dropped && now - entry.timestamp > maxAge;
+    }
+    if (!stale)
+      break;
+    // the refresh in flight may bring fresh enough values
+    if (m_refreshing) {
+      m_refreshCondition.wait(lock);
+      continue;
+    }
+    readBoard(lock, id);
+    break;
+  }
+
+  // dropped registers keep the value of their last read, and do not make the others look stale
+  std::vector<reg_key> const& keys = m_subscribers.at(id).keys;
+  clock::time_point oldest = clock::time_point::max();
+  values.resize(keys.size());
+  if (dropped)
+    dropped->assign(keys.size(), false);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    Entry const& entry = m_entries.at(keys.at(i));
+    values.at(i) = entry.value;
+    if (entry.dropped) {
+      if (dropped)
+        dropped->at(i) = true;
+      continue;
+    }
+    oldest = std::min(oldest, entry.timestamp);
+  }
+  return oldest == clock::time_point::max() ? now : oldest;
+}
+
+void gem::hw::GEMHwMonitorCache::refresh()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_refreshCondition.wait(lock, [this] { return !m_refreshing; });
+  readBoard(lock, m_nextId);
+}
+
+bool gem::hw::GEMHwMonitorCache::readDevice(GEMHwDevice& device, std::vector<Read>& reads, size_t const offset)
+{
+  try {
+    GEMHwTransaction trans(device);
+    for (auto read = reads.begin(); read != reads.end(); ++read)
+      trans.read(read->handle, read->value);
+    trans.commit();
+    for (auto read = reads.begin(); read != reads.end(); ++read)
+      read->ok = true;
+    return true;
+  } catch (gem::hw::exception::HardwareProblem const&) {
+  }
+
+  // a register failing, e.g., with a bus error, fails the whole transaction, the registers are then
+  // read one by one up to the first failure: an unreachable device costs a single read more, and
+  // starting from another register on every refresh keeps a broken first register from hiding the
+  // device behind it
+  bool answered = false;
+  for (size_t n = 0; n < reads.size(); ++n) {
+    Read& read = reads.at((offset + n) % reads.size());
+    try {
+      GEMHwTransaction trans(device);
+      trans.read(read.handle, read.value);
+      trans.commit();
+      read.ok  = true;
+      answered = true;
+    } catch (gem::hw::exception::HardwareProblem const&) {
+      read.failed = answered;
+      return answered;
+    }
+  }
+  return true;
+}
+
+void gem::hw::GEMHwMonitorCache::readBoard(std::unique_lock<std::mutex>& lock, subscription_id const requester)
+{
+  clock::time_point const now = clock::now();
+  m_lastRefresh = now;
+  if (m_entries.empty())
+    return;
+
+  gem::hw::GEMHwProfiler::CallerScope profilerScope("GEMHwMonitorCache");
+
+  // every register is read through the device of its first reader that wants it now, one
+  // transaction per device, the registers of paused subscriptions only are left alone, and so are
+  // the dropped ones until their retry
+  std::map<GEMHwDevice*, std::vector<Read> > byDevice;
+  for (auto entry = m_entries.begin(); entry != m_entries.end(); ++entry) {
+    if (entry->second.dropped && now < entry->second.retryAt)
+      continue;
+    std::vector<std::pair<subscription_id, GEMHwDevice::RegHandle> > const& readers = entry->second.readers;
+    for (size_t r = 0; r < readers.size(); ++r) {
+      Subscriber const& subscriber = m_subscribers.at(readers.at(r).first);
+      if (!subscriber.paused || readers.at(r).first == requester) {
+        Read read;
+        read.key    = entry->first;
+        read.handle = readers.at(r).second;
+        byDevice[subscriber.device].push_back(read);
+        break;
+      }
+    }
+  }
+
+  // the board is read without the lock, the subscriptions cannot go away meanwhile as unsubscribe()
+  // waits for the end of the refresh
+  size_t const offset = m_nRefreshes;
+  m_refreshing = true;
+  lock.unlock();
+
+  std::stringstream errors;
+  clock::time_point start;
+  clock::time_point timestamp;
+  try {
+    start = clock::now();
+    for (auto device = byDevice.begin(); device != byDevice.end(); ++device) {
+      std::vector<Read>& reads = device->second;
+      bool reachable = false;
+      auto readAll = [&reads, &reachable, offset](GEMHwDevice& dev) {
+        reachable = readDevice(dev, reads, offset % reads.size());
+      };
+      try {
+        // with an I/O thread, monitoring waits behind readout and configuration requests
+        std::shared_ptr<GEMHwExecutor> executor = device->first->getExecutor();
+        if (executor)
+          executor->submit(readAll, GEMHwExecutor::Priority::MONITOR).get();
+        else
+          readAll(*(device->first));
+      } catch (gem::hw::exception::HardwareProblem const& e) {
+        errors << device->first->getDeviceID() << ": " << e.what() << " ";
+        continue;
+      }
+      if (!reachable)
+        errors << device->first->getDeviceID() << ": no register could be read ";
+    }
+    // all values share the timestamp of the middle of the reads
+    timestamp = start + (clock::now() - start)/2;
+  } catch (...) {
+    lock.lock();
+    m_refreshing = false;
+    m_refreshCondition.notify_all();
+    throw;
+  }
+
+  lock.lock();
+  m_refreshing = false;
+  ++m_nRefreshes;
+  m_refreshCondition.notify_all();
+
+  for (auto device = byDevice.begin(); device != byDevice.end(); ++device) {
+    std::vector<Read> const& reads = device->second;
+    for (auto read = reads.begin(); read != reads.end(); ++read) {
+      auto entry = m_entries.find(read->key);
+      // unsubscribed meanwhile
+      if (entry == m_entries.end())
+        continue;
+      if (read->ok) {
+        if (entry->second.dropped)
+          CMSGEMOS_INFO("GEMHwMonitorCache::refresh " << m_board << ": " << read->handle.name
+                        << " can be read again");
+        entry->second.value     = read->value;
+        entry->second.timestamp = timestamp;
+        entry->second.dropped   = false;
+        entry->second.failures  = 0;
+      } else if (read->failed) {
+        // others of the device could be read, so this register is broken, leave it out for a while
+        uint32_t const doublings = std::min(entry->second.failures, 16U);
+        uint64_t const backoff   = std::min(static_cast<uint64_t>(DROPPED_RETRY_MSEC) << doublings,
+                                            static_cast<uint64_t>(DROPPED_RETRY_MAX_MSEC));
+        ++entry->second.failures;
+        entry->second.dropped = true;
+        entry->second.retryAt = clock::now() + std::chrono::milliseconds(backoff);
+        CMSGEMOS_ERROR("GEMHwMonitorCache::refresh " << m_board << ": unable to read "
+                       << read->handle.name << ", trying again in " << backoff << "ms");
+      }
+    }
+  }
+
+  if (!errors.str().empty()) {
+    std::string msg = "GEMHwMonitorCache::refresh " + m_board + ": unable to read " + errors.str();
+    XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+  }
+}
+
+void gem::hw::GEMHwMonitorCache::poll()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_stop) {
+    // paused subscriptions do not ask for polling
+    uint32_t pollMsec = std::numeric_limits<uint32_t>::max();
+    for (auto subscriber = m_subscribers.begin(); subscriber != m_subscribers.end(); ++subscriber)
+      if (!subscriber->second.paused)
+        pollMsec = std::min(pollMsec, subscriber->second.pollMsec);
+    if (pollMsec == std::numeric_limits<uint32_t>::max()) {
+      m_pollCondition.wait(lock);
+      continue;
+    }
+
+    // a refresh requested by fetch() in the meantime counts as a poll
+    clock::time_point const next = m_lastRefresh + std::chrono::milliseconds(pollMsec);
+    if (clock::now() < next) {
+      m_pollCondition.wait_until(lock, next);
+      continue;
+    }
+    if (m_refreshing) {
+      m_refreshCondition.wait(lock);
+      continue;
+    }
+
+    try {
+      readBoard(lock, m_nextId);
+    } catch (gem::hw::exception::HardwareProblem const& e) {
+      CMSGEMOS_WARN("GEMHwMonitorCache::poll " << e.what());
+    }
+  }
+}
+
+size_t gem::hw::GEMHwMonitorCache::size() const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_entries.size();
+}
+
+size_t gem::hw::GEMHwMonitorCache::subscribers() const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_subscribers.size();
+}
+
+uint64_t gem::hw::GEMHwMonitorCache::getRefreshCount() const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_nRefreshes;
+}
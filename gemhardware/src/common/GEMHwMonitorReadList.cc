@@ -0,0 +1,175 @@
+/**
+ * class: GEMHwMonitorReadList
+ * description: Batched read of the hardware monitorables of a GEMMonitor
+ */
+
+#include "gem/hw/GEMHwMonitorReadList.h"
+
+typedef gem::base::utils::GEMInfoSpaceToolBox GEMInfoSpaceToolBox;
+typedef gem::base::utils::GEMInfoSpaceToolBox::UpdateType GEMUpdateType;
+
+gem::hw::GEMHwMonitorReadList::GEMHwMonitorReadList(log4cplus::Logger& logger, uint32_t const pollMsec) :
+  m_gemLogger(logger),
+  m_nMonitorables(0),
+  m_pollMsec(pollMsec),
+  m_subscription(0),
+  m_paused(false)
+{
+}
+
+gem::hw::GEMHwMonitorReadList::~GEMHwMonitorReadList()
+{
+  clear();
+}
+
+void gem::hw::GEMHwMonitorReadList::clear()
+{
+  if (p_cache)
+    p_cache->unsubscribe(m_subscription);
+  p_cache.reset();
+  m_items.clear();
+  m_counters.clear();
+  m_values.clear();
+  m_dropped.clear();
+  m_nMonitorables = 0;
+}
+
+void gem::hw::GEMHwMonitorReadList::setPaused(bool const paused)
+{
+  m_paused = paused;
+  if (p_cache)
+    p_cache->setPaused(m_subscription, m_paused);
+}
+
+bool gem::hw::GEMHwMonitorReadList::isDropped(Item const& item) const
+{
+  return m_dropped.at(item.lowerIdx) || (item.is64 && m_dropped.at(item.upperIdx));
+}
+
+void gem::hw::GEMHwMonitorReadList::build(GEMHwDevice& device, monitorable_sets const& sets,
+                                          std::string const& prefix)
+{
+  clear();
+  std::vector<GEMHwDevice::RegHandle> regs;
+  std::string const base = prefix.empty() ? "" : prefix + ".";
+  for (auto monlist = sets.begin(); monlist != sets.end(); ++monlist) {
+    m_nMonitorables += monlist->second.size();
+    for (auto monitem = monlist->second.begin(); monitem != monlist->second.end(); ++monitem) {
+      std::string const regName = base + monitem->second.regname;
+      Item item;
+      item.infoSpace = monitem->second.infoSpace;
+      item.name      = monitem->first;
+      try {
+        switch (monitem->second.updatetype) {
+        case GEMUpdateType::HW8:
+        case GEMUpdateType::HW16:
+        case GEMUpdateType::HW24:
+        case GEMUpdateType::HW32:
+        case GEMUpdateType::PROCESS:
+        case GEMUpdateType::TRACKER:
+          item.lower = device.resolve(regName);
+          break;
+        case GEMUpdateType::HW64:
+          item.is64  = true;
+          item.lower = device.resolve(regName+".LOWER");
+          item.upper = device.resolve(regName+".UPPER");
+          break;
+        case GEMUpdateType::I2CSTAT:
+          item.is64  = true;
+          item.lower = device.resolve(regName+".Strobe."+monitem->first);
+          item.upper = device.resolve(regName+".Ack."+monitem->first);
+          break;
+        case GEMUpdateType::NOUPDATE:
+          continue;
+        default:
+          CMSGEMOS_ERROR("GEMHwMonitorReadList: Unknown update type encountered for " << monitem->first);
+          continue;
+        }
+      } catch (gem::hw::exception::HardwareProblem const& e) {
+        CMSGEMOS_ERROR("GEMHwMonitorReadList: not monitoring " << monitem->first << ": " << e.what());
+        continue;
+      }
+      item.lowerIdx = regs.size();
+      regs.push_back(item.lower);
+      if (item.is64) {
+        item.upperIdx = regs.size();
+        regs.push_back(item.upper);
+      }
+
+      if (monitem->second.format == "raw/rate" && monitem->second.updatetype != GEMUpdateType::I2CSTAT) {
+        if (item.is64)
+          item.counter = m_counters.addCounter(item.name, item.lower, item.upper);
+        else
+          item.counter = m_counters.addCounter(item.name, item.lower);
+        std::string const rateName = GEMInfoSpaceToolBox::getRateItemName(item.name);
+        std::string const avgName  = GEMInfoSpaceToolBox::getRateItemName(item.name, true);
+        if (!item.infoSpace->find(rateName))
+          item.infoSpace->createDouble(rateName, 0., NULL, GEMUpdateType::NOUPDATE,
+                                       "Rate of "+item.name+" over the last monitoring interval (Hz)", "rate");
+        if (!item.infoSpace->find(avgName))
+          item.infoSpace->createDouble(avgName, 0., NULL, GEMUpdateType::NOUPDATE,
+                                       "Moving average of the rate of "+item.name+" (Hz)", "rate");
+      }
+      m_items.push_back(item);
+    }
+  }
+
+  // the monitors of a board share its cache, registers they have in common are read once
+  p_cache        = GEMHwMonitorCache::getCache(device);
+  m_subscription = p_cache->subscribe(device, regs, m_pollMsec);
+  if (m_paused)
+    p_cache->setPaused(m_subscription, true);
+  CMSGEMOS_DEBUG("GEMHwMonitorReadList: built list of " << m_items.size()
+                 << " items, " << m_counters.size() << " of them counters, from "
+                 << m_nMonitorables << " monitorables, the cache of " << p_cache->getBoard()
+                 << " reads " << p_cache->size() << " registers for " << p_cache->subscribers() << " subscribers");
+}
+
+void gem::hw::GEMHwMonitorReadList::update(GEMHwDevice& device, monitorable_sets const& sets,
+                                           std::string const& prefix)
+{
+  size_t nMonitorables = 0;
+  for (auto monlist = sets.begin(); monlist != sets.end(); ++monlist)
+    nMonitorables += monlist->second.size();
+  if (nMonitorables != m_nMonitorables)
+    build(device, sets, prefix);
+
+  if (m_items.empty())
+    return;
+
+  GEMHwMonitorCache::clock::time_point timestamp;
+  try {
+    timestamp = p_cache->fetch(m_subscription, m_values, std::chrono::milliseconds(m_pollMsec), &m_dropped);
+  } catch (gem::hw::exception::HardwareProblem const& e) {
+    CMSGEMOS_ERROR("GEMHwMonitorReadList: unable to read the monitorables, keeping the previous values: "
+                   << e.what());
+    return;
+  }
+
+  // all counters share the timestamp of the cache, so their rates cover the same interval
+  for (auto item = m_items.begin(); item != m_items.end(); ++item)
+    if (item->counter >= 0 && !isDropped(*item))
+      m_counters.set(static_cast<size_t>(item->counter), m_values.at(item->lowerIdx),
+                     item->is64 ? m_values.at(item->upperIdx) : 0);
+  m_counters.update(timestamp);
+
+  for (auto item = m_items.begin(); item != m_items.end(); ++item) {
+    // the registers the cache no longer reads keep their last values in the info space
+    if (isDropped(*item))
+      continue;
+    if (item->counter >= 0) {
+      GEMHwCounterSnapshot::Counter const& counter = m_counters.getCounter(static_cast<size_t>(item->counter));
+      if (item->is64)
+        item->infoSpace->setUInt64(item->name, counter.value());
+      else
+        item->infoSpace->setUInt32(item->name, counter.LowerVal);
+      if (counter.Rate.valid()) {
+        item->infoSpace->setDouble(GEMInfoSpaceToolBox::getRateItemName(item->name),       counter.Rate.getRate());
+        item->infoSpace->setDouble(GEMInfoSpaceToolBox::getRateItemName(item->name, true), counter.Rate.getAverageRate());
+      }
+    } else if (item->is64)
+      item->infoSpace->setUInt64(item->name, (((uint64_t)m_values.at(item->upperIdx)) << 32) + m_values.at(item->lowerIdx));
+    else
+      item->infoSpace->setUInt32(item->name, m_values.at(item->lowerIdx));
+  }
+}
@@ -0,0 +1,258 @@
+/**
+ * class: GEMHwProfiler
+ * description: Statistics of the IPbus accesses of a device, per register, calling subsystem and access type
+ */
+
+#include "gem/hw/GEMHwProfiler.h"
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+
+namespace {
+  std::string const UNTAGGED_CALLER = "(untagged)";
+
+  thread_local std::string t_caller = UNTAGGED_CALLER;
+
+  size_t latencyBin(uint64_t const usec)
+  {
+    size_t bin = 0;
+    while (bin < gem::hw::GEMHwProfiler::N_LATENCY_BINS-1 && (usec >> (bin+1)) != 0)
+      ++bin;
+    return bin;
+  }
+
+  std::string htmlEscape(std::string const& text)
+  {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (auto c = text.begin(); c != text.end(); ++c) {
+      switch (*c) {
+      case '&':  escaped.append("&amp;");  break;
+      case '<':  escaped.append("&lt;");   break;
+      case '>':  escaped.append("&gt;");   break;
+      case '"':  escaped.append("&quot;"); break;
+      case '\'': escaped.append("&#39;");  break;
+      default:   escaped.append(1, *c);
+      }
+    }
+    return escaped;
+  }
+
+  bool moreTime(gem::hw::GEMHwProfiler::Entry const& lhs, gem::hw::GEMHwProfiler::Entry const& rhs)
+  {
+    return lhs.TotalUsec > rhs.TotalUsec;
+  }
+}
+
+const size_t gem::hw::GEMHwProfiler::N_LATENCY_BINS;
+
+gem::hw::GEMHwProfiler::CallerScope::CallerScope(std::string const& caller) :
+  m_previous(t_caller)
+{
+  t_caller = caller;
+}
+
+gem::hw::GEMHwProfiler::CallerScope::~CallerScope()
+{
+  t_caller = m_previous;
+}
+
+gem::hw::GEMHwProfiler::Probe::Probe(GEMHwProfiler* profiler, AccessType const type) :
+  p_profiler(profiler),
+  m_type(type)
+{
+  if (p_profiler)
+    m_start = std::chrono::steady_clock::now();
+}
+
+gem::hw::GEMHwProfiler::Probe::Probe(GEMHwProfiler* profiler, AccessType const type,
+                                     std::string const& regName, size_t const nWords) :
+  p_profiler(profiler),
+  m_type(type)
+{
+  if (p_profiler) {
+    m_registers.push_back(std::make_pair(regName, nWords));
+    m_start = std::chrono::steady_clock::now();
+  }
+}
+
+gem::hw::GEMHwProfiler::Probe::~Probe()
+{
+  if (!p_profiler)
+    return;
+
+  uint64_t const usec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start).count();
+  if (m_registers.size() == 1) {
+    p_profiler->record(m_type, m_registers.front().first, m_registers.front().second, usec);
+    return;
+  }
+
+  // a list access is shared among its registers by payload, so that the totals add up to the access
+  uint64_t nWords = 0;
+  for (auto reg = m_registers.begin(); reg != m_registers.end(); ++reg)
+    nWords += std::max<size_t>(reg->second, 1);
+  uint64_t remaining = usec;
+  for (auto reg = m_registers.begin(); reg != m_registers.end(); ++reg) {
+    uint64_t share = (reg+1 == m_registers.end()) ? remaining : usec*std::max<size_t>(reg->second, 1)/nWords;
+    remaining -= share;
+    p_profiler->record(m_type, reg->first, reg->second, share);
+  }
+}
+
+void gem::hw::GEMHwProfiler::Probe::add(std::string const& regName, size_t const nWords)
+{
+  if (p_profiler)
+    m_registers.push_back(std::make_pair(regName, nWords));
+}
+
+gem::hw::GEMHwProfiler::GEMHwProfiler(std::string const& deviceID) :
+  m_deviceID(deviceID),
+  m_start(std::chrono::system_clock::now())
+{
+}
+
+void gem::hw::GEMHwProfiler::record(AccessType const type, std::string const& regName,
+                                    size_t const nWords, uint64_t const usec)
+{
+  std::string const& caller = currentCaller();
+  std::lock_guard<std::mutex> guard(m_mutex);
+  Entry& entry = m_entries[std::make_tuple(regName, caller, static_cast<int>(type))];
+  if (entry.Count == 0) {
+    entry.Register = regName;
+    entry.Caller   = caller;
+    entry.Type     = type;
+  }
+  ++entry.Count;
+  entry.Bytes     += 4*nWords;
+  entry.TotalUsec += usec;
+  if (usec > entry.MaxUsec)
+    entry.MaxUsec = usec;
+  ++entry.Latency.at(latencyBin(usec));
+}
+
+std::vector<gem::hw::GEMHwProfiler::Entry> gem::hw::GEMHwProfiler::getEntries() const
+{
+  std::vector<Entry> entries;
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    entries.reserve(m_entries.size());
+    for (auto entry = m_entries.begin(); entry != m_entries.end(); ++entry)
+      entries.push_back(entry->second);
+  }
+  std::stable_sort(entries.begin(), entries.end(), moreTime);
+  return entries;
+}
+
+std::map<std::string, std::pair<uint64_t, uint64_t> > gem::hw::GEMHwProfiler::getCallerTotals() const
+{
+  std::map<std::string, std::pair<uint64_t, uint64_t> > totals;
+  std::lock_guard<std::mutex> guard(m_mutex);
+  for (auto entry = m_entries.begin(); entry != m_entries.end(); ++entry) {
+    // dispatches are already accounted in the accesses they complete
+    if (entry->second.Type == AccessTypeT::DISPATCH)
+      continue;
+    std::pair<uint64_t, uint64_t>& total = totals[entry->second.Caller];
+    total.first  += entry->second.Count;
+    total.second += entry->second.TotalUsec;
+  }
+  return totals;
+}
+
+void gem::hw::GEMHwProfiler::reset()
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  m_entries.clear();
+  m_start = std::chrono::system_clock::now();
+}
+
+void gem::hw::GEMHwProfiler::printHTML(std::ostream& out, size_t const maxEntries) const
+{
+  std::map<std::string, std::pair<uint64_t, uint64_t> > const totals = getCallerTotals();
+  std::vector<Entry> const entries = getEntries();
+
+  out << "<h3>" << htmlEscape(m_deviceID) << "</h3>" << std::endl
+      << "<table class=\"xdaq-table\">" << std::endl
+      << "<thead><tr><th>Caller</th><th>Register accesses</th><th>Time (ms)</th></tr></thead>" << std::endl
+      << "<tbody>" << std::endl;
+  for (auto total = totals.begin(); total != totals.end(); ++total)
+    out << "<tr><td>" << htmlEscape(total->first) << "</td>"
+        << "<td>" << total->second.first << "</td>"
+        << "<td>" << total->second.second/1000 << "</td></tr>" << std::endl;
+  out << "</tbody>" << std::endl
+      << "</table>" << std::endl;
+
+  out << "<table class=\"xdaq-table\">" << std::endl
+      << "<thead><tr><th>Register</th><th>Caller</th><th>Access</th><th>Count</th><th>Bytes</th>"
+      << "<th>Time (ms)</th><th>Mean (us)</th><th>Max (us)</th></tr></thead>" << std::endl
+      << "<tbody>" << std::endl;
+  size_t nShown = 0;
+  for (auto entry = entries.begin(); entry != entries.end(); ++entry) {
+    if (maxEntries && nShown++ == maxEntries)
+      break;
+    out << "<tr><td>" << htmlEscape(entry->Register) << "</td>"
+        << "<td>" << htmlEscape(entry->Caller) << "</td>"
+        << "<td>" << getAccessTypeName(entry->Type) << "</td>"
+        << "<td>" << entry->Count << "</td>"
+        << "<td>" << entry->Bytes << "</td>"
+        << "<td>" << entry->TotalUsec/1000 << "</td>"
+        << "<td>" << entry->TotalUsec/entry->Count << "</td>"
+        << "<td>" << entry->MaxUsec << "</td></tr>" << std::endl;
+  }
+  out << "</tbody>" << std::endl
+      << "</table>" << std::endl;
+}
+
+void gem::hw::GEMHwProfiler::dump(std::ostream& out) const
+{
+  std::time_t start;
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    start = std::chrono::system_clock::to_time_t(m_start);
+  }
+  std::time_t const now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+
+  out << "# device " << m_deviceID << ", from " << start << " to " << now << " (" << (now - start) << "s)" << std::endl
+      << "# register\tcaller\taccess\tcount\tbytes\ttotal_us\tmax_us\tlatency bins (<2us, <4us, ...)" << std::endl;
+  std::vector<Entry> const entries = getEntries();
+  for (auto entry = entries.begin(); entry != entries.end(); ++entry) {
+    out << (entry->Register.empty() ? "-" : entry->Register)
+        << "\t" << entry->Caller
+        << "\t" << getAccessTypeName(entry->Type)
+        << "\t" << entry->Count
+        << "\t" << entry->Bytes
+        << "\t" << entry->TotalUsec
+        << "\t" << entry->MaxUsec;
+    for (auto bin = entry->Latency.begin(); bin != entry->Latency.end(); ++bin)
+      out << "\t" << *bin;
+    out << std::endl;
+  }
+}
+
+bool gem::hw::GEMHwProfiler::dumpToFile(std::string const& fileName) const
+{
+  std::ofstream out(fileName.c_str(), std::ios::trunc);
+  if (!out)
+    return false;
+  dump(out);
+  return static_cast<bool>(out.flush());
+}
+
+std::string gem::hw::GEMHwProfiler::getAccessTypeName(AccessType const type)
+{
+  switch (type) {
+  case AccessTypeT::READ:        return "read";
+  case AccessTypeT::WRITE:       return "write";
+  case AccessTypeT::READ_LIST:   return "readList";
+  case AccessTypeT::WRITE_LIST:  return "writeList";
+  case AccessTypeT::READ_BLOCK:  return "readBlock";
+  case AccessTypeT::WRITE_BLOCK: return "writeBlock";
+  case AccessTypeT::DISPATCH:    return "dispatch";
+  default:                       return "unknown";
+  }
+}
+
+std::string const& gem::hw::GEMHwProfiler::currentCaller()
+{
+  return t_caller;
+}
@@ -0,0 +1,117 @@
+/**
+ * class: GEMHwRetryPolicy
+ * description: Classification of IPbus errors and backoff between retries of a register access
+ */
+
+#include "gem/hw/GEMHwRetryPolicy.h"
+
+#include <algorithm>
+#include <random>
+
+const unsigned gem::hw::GEMHwRetryPolicy::DEFAULT_MAX_ATTEMPTS;
+const unsigned gem::hw::GEMHwRetryPolicy::DEFAULT_BASE_DELAY_US;
+const unsigned gem::hw::GEMHwRetryPolicy::DEFAULT_MAX_DELAY_US;
+
+namespace {
+  bool contains(std::string const& errCode, char const* what)
+  {
+    return errCode.find(what) != std::string::npos;
+  }
+}
+
+gem::hw::GEMHwRetryPolicy::GEMHwRetryPolicy(unsigned const maxAttempts,
+                                            unsigned const baseDelayUsec,
+                                            unsigned const maxDelayUsec) :
+  m_maxAttempts(std::max(maxAttempts, 1U)),
+  m_baseDelayUsec(baseDelayUsec),
+  m_maxDelayUsec(std::max(maxDelayUsec, baseDelayUsec))
+{
+}
+
+gem::hw::GEMHwRetryPolicy::~GEMHwRetryPolicy()
+{
+}
+
+int gem::hw::GEMHwRetryPolicy::classify(std::string const& errCode) const
+{
+  // uhal exception messages, IPbus 2.0 info codes 0x4/0x5 are bus errors, 0x6/0x7 bus timeouts
+  if (contains(errCode, "No branch found") ||
+      contains(errCode, "access denied")   ||
+      contains(errCode, "Access Denied")   ||
+      contains(errCode, "forbidden by bit mask"))
+    return ErrorClass::BAD_ADDRESS;
+  // only ControlHub codes 3 and 4 are transient, as in GEMHwDevice::knownErrorCode
+  if (contains(errCode, "ControlHub error code is: 3") ||
+      contains(errCode, "ControlHub error code is: 4"))
+    return ErrorClass::HUB_BUSY;
+  if (contains(errCode, "timed out")                 ||
+      contains(errCode, "Timeout")                   ||
+      contains(errCode, "INFO CODE = 0x6L")          ||
+      contains(errCode, "INFO CODE = 0x7L")          ||
+      contains(errCode, "had response field = 0x06") ||
+      contains(errCode, "had response field = 0x07"))
+    return ErrorClass::TIMEOUT;
+  if (contains(errCode, "INFO CODE = 0x4L")          ||
+      contains(errCode, "INFO CODE = 0x5L")          ||
+      contains(errCode, "had response field = 0x04") ||
+      contains(errCode, "had response field = 0x05"))
+    return ErrorClass::BUS_ERROR;
+  if (contains(errCode, "amount of data"))
+    return ErrorClass::BAD_HEADER;
+  return ErrorClass::UNKNOWN;
+}
+
+bool gem::hw::GEMHwRetryPolicy::isTransient(int const errClass) const
+{
+  switch (errClass) {
+  case ErrorClass::TIMEOUT:
+  case ErrorClass::HUB_BUSY:
+  case ErrorClass::BAD_HEADER:
+  case ErrorClass::BUS_ERROR:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool gem::hw::GEMHwRetryPolicy::shouldRetry(int const errClass, unsigned const attempt) const
+{
+  if (!isTransient(errClass) || attempt >= m_maxAttempts)
+    return false;
+  if (errClass == ErrorClass::BUS_ERROR)
+    return attempt < 2;
+  return true;
+}
+
+unsigned gem::hw::GEMHwRetryPolicy::backoffUsec(int const errClass, unsigned const attempt) const
+{
+  uint64_t delay = m_baseDelayUsec;
+  if (errClass == ErrorClass::HUB_BUSY)
+    delay *= 4;
+  delay <<= std::min(attempt > 0 ? attempt-1 : 0U, 16U);
+  delay = std::min(delay, static_cast<uint64_t>(m_maxDelayUsec));
+  if (delay < 2)
+    return delay;
+
+  static thread_local std::mt19937 engine(std::random_device{}());
+  std::uniform_int_distribution<uint64_t> jitter(0, delay/2);
+  return delay - delay/2 + jitter(engine);
+}
+
+std::string gem::hw::GEMHwRetryPolicy::errorClassName(int const errClass)
+{
+  switch (errClass) {
+  case ErrorClass::TIMEOUT:
+    return "Timeout";
+  case ErrorClass::HUB_BUSY:
+    return "ControlHub busy";
+  case ErrorClass::BAD_HEADER:
+    return "Bad header";
+  case ErrorClass::BUS_ERROR:
+    return "Bus error";
+  case ErrorClass::BAD_ADDRESS:
+    return "Bad address";
+  default:
+    return "Unknown";
+  }
+}
@@ -0,0 +1,74 @@
+/**
+ * class: GEMHwShadow
+ * description: Last known values of the configuration registers of a device
+ */
+
+#include "gem/hw/GEMHwShadow.h"
+
+#include <algorithm>
+
+gem::hw::GEMHwShadow::GEMHwShadow()
+{
+}
+
+bool gem::hw::GEMHwShadow::lookup(std::string const& regName, uint32_t& val) const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  auto entry = m_values.find(regName);
+  if (entry == m_values.end())
+    return false;
+  val = entry->second;
+  return true;
+}
+
+void gem::hw::GEMHwShadow::update(std::string const& regName, uint32_t const val)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  m_values[regName] = val;
+}
+
+void gem::hw::GEMHwShadow::refresh(std::string const& regName, uint32_t const val)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  auto entry = m_values.find(regName);
+  if (entry != m_values.end())
+    entry->second = val;
+}
+
+void gem::hw::GEMHwShadow::erase(std::string const& regName)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  m_values.erase(regName);
+}
+
+void gem::hw::GEMHwShadow::clear()
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  m_values.clear();
+  m_cursor.clear();
+}
+
+size_t gem::hw::GEMHwShadow::size() const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_values.size();
+}
+
+gem::hw::GEMHwShadow::entry_list gem::hw::GEMHwShadow::nextSlice(size_t const maxEntries)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  entry_list slice;
+  if (m_values.empty())
+    return slice;
+
+  size_t const nEntries = (maxEntries == 0) ? m_values.size() : std::min(maxEntries, m_values.size());
+  auto entry = m_cursor.empty() ? m_values.begin() : m_values.upper_bound(m_cursor);
+  while (slice.size() < nEntries) {
+    if (entry == m_values.end())
+      entry = m_values.begin();
+    slice.push_back(*entry);
+    ++entry;
+  }
+  m_cursor = slice.back().first;
+  return slice;
+}
@@ -0,0 +1,134 @@
+/**
+ * class: GEMHwTaskGroup
+ * description: Runs independent hardware tasks concurrently on a bounded number of threads
+ */
+
+#include "gem/hw/GEMHwTaskGroup.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <sstream>
+#include <thread>
+
+#include "xcept/Exception.h"
+
+const size_t gem::hw::GEMHwTaskGroup::DEFAULT_MAX_WORKERS;
+
+gem::hw::GEMHwTaskGroup::GEMHwTaskGroup(size_t const maxWorkers) :
+  m_maxWorkers(std::max(maxWorkers, static_cast<size_t>(1)))
+{
+}
+
+void gem::hw::GEMHwTaskGroup::add(std::string const& target, std::string const& serialKey,
+                                  std::function<void()> task)
+{
+  auto chain = m_chainIndex.find(serialKey);
+  if (chain == m_chainIndex.end()) {
+    chain = m_chainIndex.insert(std::make_pair(serialKey, m_chains.size())).first;
+    m_chains.push_back(std::vector<size_t>());
+  }
+  m_chains.at(chain->second).push_back(m_tasks.size());
+
+  Task newTask;
+  newTask.target = target;
+  newTask.work   = task;
+  m_tasks.push_back(newTask);
+}
+
+std::vector<gem::hw::GEMHwTaskGroup::Result> gem::hw::GEMHwTaskGroup::run()
+{
+  std::vector<Result> results(m_tasks.size());
+  for (size_t i = 0; i < m_tasks.size(); ++i)
+    results.at(i).Target = m_tasks.at(i).target;
+
+  size_t const nWorkers = std::min(m_maxWorkers, m_chains.size());
+  if (nWorkers <= 1) {
+    for (auto chain = m_chains.begin(); chain != m_chains.end(); ++chain)
+      runChain(*chain, results);
+  } else {
+    // every worker takes the next chain not yet started, each result is written by one thread only
+    std::atomic<size_t> nextChain(0);
+    std::vector<std::thread> workers;
+    workers.reserve(nWorkers);
+    try {
+      for (size_t w = 0; w < nWorkers; ++w)
+        workers.emplace_back([this, &nextChain, &results]() {
+            size_t chain;
+            while ((chain = nextChain.fetch_add(1)) < m_chains.size())
+              runChain(m_chains.at(chain), results);
+          });
+    } catch (...) {
+      // the running workers reference the locals of this call, they must be done before it returns
+      nextChain.store(m_chains.size());
+      for (auto worker = workers.begin(); worker != workers.end(); ++worker)
+        worker->join();
+      m_tasks.clear();
+      m_chains.clear();
+      m_chainIndex.clear();
+      throw;
+    }
+    for (auto worker = workers.begin(); worker != workers.end(); ++worker)
+      worker->join();
+  }
+
+  m_tasks.clear();
+  m_chains.clear();
+  m_chainIndex.clear();
+  return results;
+}
+
+void gem::hw::GEMHwTaskGroup::runChain(std::vector<size_t> const& chain, std::vector<Result>& results) const
+{
+  std::string failed;
+  for (auto index = chain.begin(); index != chain.end(); ++index) {
+    Result& result = results.at(*index);
+    if (!failed.empty()) {
+      result.Error = "not run after the failure of " + failed;
+      continue;
+    }
+
+    auto t1 = std::chrono::steady_clock::now();
+    try {
+      m_tasks.at(*index).work();
+      result.Succeeded = true;
+    } catch (xcept::Exception const& e) {
+      result.Error = e.what();
+    } catch (std::exception const& e) {
+      result.Error = e.what();
+    } catch (...) {
+      result.Error = "unknown exception";
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    result.DurationUsec = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+
+    if (!result.Succeeded)
+      failed = result.Target;
+  }
+}
+
+std::string gem::hw::GEMHwTaskGroup::failureSummary(std::vector<Result> const& results)
+{
+  std::stringstream summary;
+  for (auto result = results.begin(); result != results.end(); ++result)
+    if (!result->Succeeded)
+      summary << result->Target << ": " << result->Error << std::endl;
+  return summary.str();
+}
+
+std::string gem::hw::GEMHwTaskGroup::logResults(log4cplus::Logger& logger, std::string const& action,
+                                                std::vector<Result> const& results)
+{
+  log4cplus::Logger m_gemLogger = logger;
+  uint64_t slowest = 0;
+  for (auto result = results.begin(); result != results.end(); ++result) {
+    CMSGEMOS_DEBUG(action << " " << result->Target << " took " << result->DurationUsec << "us");
+    if (result->DurationUsec > slowest)
+      slowest = result->DurationUsec;
+    if (!result->Succeeded)
+      CMSGEMOS_ERROR(action << " " << result->Target << " failed: " << result->Error);
+  }
+  CMSGEMOS_INFO(action << " " << results.size() << " tasks, the slowest took " << slowest/1000 << "ms");
+  return failureSummary(results);
+}
@@ -0,0 +1,299 @@
+/**
+ * class: GEMHwTransaction
+ * description: Queue of register operations on a GEMHwDevice, executed with one dispatch per IPbus packet
+ */
+
+#include "gem/hw/GEMHwTransaction.h"
+
+#include <exception>
+
+const size_t gem::hw::GEMHwTransaction::DEFAULT_MAX_PACKET_WORDS;
+
+// IPbus 2.0 word counts, every transaction starts with one header word in both directions
+size_t gem::hw::GEMHwTransaction::Operation::requestWords() const
+{
+  switch (type) {
+  case OperationType::READ:
+    return 2;
+  case OperationType::WRITE:
+    // uhal turns a write to a masked node into an RMW
+    return (handle.mask == 0xffffffff) ? 3 : 4;
+  case OperationType::READ_BLOCK:
+    // uhal splits block reads into transactions of at most 255 words
+    return 2*((nWords+254)/255);
+  case OperationType::RMW_BITS:
+    return 4;
+  default:
+    return 0;
+  }
+}
+
+size_t gem::hw::GEMHwTransaction::Operation::replyWords() const
+{
+  switch (type) {
+  case OperationType::READ:
+    return 2;
+  case OperationType::WRITE:
+    return (handle.mask == 0xffffffff) ? 1 : 2;
+  case OperationType::READ_BLOCK:
+    return nWords + (nWords+254)/255;
+  case OperationType::RMW_BITS:
+    return 2;
+  default:
+    return 0;
+  }
+}
+
+// a chunk is only sent again if sending it twice leaves the board as sending it once
+bool gem::hw::GEMHwTransaction::Operation::repeatable() const
+{
+  switch (type) {
+  case OperationType::READ:
+    return true;
+  case OperationType::READ_BLOCK:
+    // reading a FIFO port again loses the words the failed attempt popped
+    return handle.node->getMode() != uhal::defs::NON_INCREMENTAL;
+  default:
+    // a write may have been applied, and may have triggered an action, before the reply was lost,
+    // and an RMW applied twice does not give the same result
+    return false;
+  }
+}
+
+gem::hw::GEMHwTransaction::GEMHwTransaction(GEMHwDevice& device, size_t const maxPacketWords) :
+  m_device(device),
+  m_maxPacketWords(maxPacketWords),
+  m_dispatchCount(0),
+  m_gemLogger(device.m_gemLogger)
+{
+}
+
+gem::hw::GEMHwTransaction::~GEMHwTransaction()
+{
+  if (!m_operations.empty())
+    CMSGEMOS_DEBUG("GEMHwTransaction::~GEMHwTransaction dropping " << m_operations.size()
+                   << " operations that were never committed");
+}
+
+gem::hw::GEMHwTransaction::Operation& gem::hw::GEMHwTransaction::queue(int const type,
+                                                                       GEMHwDevice::RegHandle const& handle)
+{
+  m_operations.push_back(Operation());
+  Operation& op = m_operations.back();
+  op.type   = type;
+  op.handle = handle;
+  return op;
+}
+
+std::shared_future<uint32_t> gem::hw::GEMHwTransaction::read(std::string const& regName)
+{
+  return read(m_device.resolve(regName));
+}
+
+std::shared_future<uint32_t> gem::hw::GEMHwTransaction::read(GEMHwDevice::RegHandle const& handle)
+{
+  return queue(OperationType::READ, handle).wordResult.get_future().share();
+}
+
+void gem::hw::GEMHwTransaction::read(std::string const& regName, uint32_t& value)
+{
+  read(m_device.resolve(regName), value);
+}
+
+void gem::hw::GEMHwTransaction::read(GEMHwDevice::RegHandle const& handle, uint32_t& value)
+{
+  queue(OperationType::READ, handle).wordRef = &value;
+}
+
+std::shared_future<std::vector<uint32_t> > gem::hw::GEMHwTransaction::readBlock(std::string const& regName,
+                                                                                 size_t const nWords)
+{
+  GEMHwDevice::RegHandle handle = m_device.resolve(regName);
+  Operation& op = queue(OperationType::READ_BLOCK, handle);
+  op.nWords = nWords ? nWords : handle.node->getSize();
+  return op.blockResult.get_future().share();
+}
+
+void gem::hw::GEMHwTransaction::readBlock(std::string const& regName, std::vector<uint32_t>& values,
+                                          size_t const nWords)
+{
+  GEMHwDevice::RegHandle handle = m_device.resolve(regName);
+  Operation& op = queue(OperationType::READ_BLOCK, handle);
+  op.nWords   = nWords ? nWords : handle.node->getSize();
+  op.blockRef = &values;
+}
+
+void gem::hw::GEMHwTransaction::write(std::string const& regName, uint32_t const val)
+{
+  write(m_device.resolve(regName), val);
+}
+
+void gem::hw::GEMHwTransaction::write(GEMHwDevice::RegHandle const& handle, uint32_t const val)
+{
+  queue(OperationType::WRITE, handle).value = val;
+}
+
+std::shared_future<uint32_t> gem::hw::GEMHwTransaction::rmwBits(std::string const& regName,
+                                                                uint32_t const andTerm, uint32_t const orTerm)
+{
+  Operation& op = queue(OperationType::RMW_BITS, m_device.resolve(regName));
+  op.value  = andTerm;
+  op.orTerm = orTerm;
+  return op.wordResult.get_future().share();
+}
+
+void gem::hw::GEMHwTransaction::commit()
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_device.m_hwLock);
+
+  m_dispatchCount = 0;
+  if (m_operations.empty())
+    return;
+
+  // handles resolved before an address table change are resolved again
+  for (auto op = m_operations.begin(); op != m_operations.end(); ++op)
+    if (op->handle.generation != m_device.m_handleGeneration)
+      op->handle = m_device.resolve(op->handle.name);
+
+  std::string error;
+  op_iterator first = m_operations.begin();
+  size_t requestWords = 1, replyWords = 1;  // packet headers
+  for (op_iterator op = m_operations.begin(); op != m_operations.end(); ++op) {
+    // an operation larger than a packet goes on its own, uhal fragments it
+    if (op != first &&
+        ((requestWords + op->requestWords() > m_maxPacketWords) ||
+         (replyWords   + op->replyWords()   > m_maxPacketWords))) {
+      error = execute(first, op);
+      if (!error.empty())
+        break;
+      first = op;
+      requestWords = 1;
+      replyWords   = 1;
+    }
+    requestWords += op->requestWords();
+    replyWords   += op->replyWords();
+  }
+  if (error.empty())
+    error = execute(first, m_operations.end());
+
+  size_t const nOperations = m_operations.size();
+  if (!error.empty()) {
+    std::string msg = toolbox::toString("Transaction failed after %d dispatches: %s", (int)m_dispatchCount, error.c_str());
+    fail(first, m_operations.end(), msg);
+    m_operations.clear();
+    CMSGEMOS_ERROR("GEMHwTransaction::commit " << msg);
+    XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+  }
+  m_operations.clear();
+
+  CMSGEMOS_DEBUG("GEMHwTransaction::commit dispatched " << m_dispatchCount
+                 << " calls for " << nOperations << " operations");
+}
+
+std::string gem::hw::GEMHwTransaction::execute(op_iterator first, op_iterator last)
+{
+  if (first == last)
+    return "";
+
+  // one entry per register, with the time of the packet it was part of
+  GEMHwProfiler* profiler = m_device.p_profiler.get();
+  GEMHwProfiler::Probe readProbe(profiler,  GEMHwProfiler::AccessTypeT::READ_LIST);
+  GEMHwProfiler::Probe writeProbe(profiler, GEMHwProfiler::AccessTypeT::WRITE_LIST);
+  GEMHwProfiler::Probe blockProbe(profiler, GEMHwProfiler::AccessTypeT::READ_BLOCK);
+  if (profiler) {
+    for (op_iterator op = first; op != last; ++op) {
+      if (op->type == OperationType::READ)
+        readProbe.add(op->handle.name);
+      else if (op->type == OperationType::READ_BLOCK)
+        blockProbe.add(op->handle.name, op->nWords);
+      else
+        writeProbe.add(op->handle.name);
+    }
+  }
+
+  bool repeatable = true;
+  for (op_iterator op = first; op != last && repeatable; ++op)
+    repeatable = op->repeatable();
+
+  std::string errCode;
+  unsigned retryCount = 0;
+  while (retryCount < m_device.p_retryPolicy->maxAttempts()) {
+    ++retryCount;
+    try {
+      std::vector<uhal::ValWord<uint32_t> >   words;
+      std::vector<uhal::ValVector<uint32_t> > blocks;
+      for (op_iterator op = first; op != last; ++op) {
+        switch (op->type) {
+        case OperationType::READ:
+          words.push_back(op->handle.node->read());
+          break;
+        case OperationType::WRITE:
+          op->handle.node->write(op->value);
+          break;
+        case OperationType::READ_BLOCK:
+          blocks.push_back(op->handle.node->readBlock(op->nWords));
+          break;
+        case OperationType::RMW_BITS:
+          words.push_back(m_device.getClient().rmw_bits(op->handle.address, op->value, op->orTerm));
+          break;
+        }
+      }
+      m_device.dispatch();
+      ++m_dispatchCount;
+
+      auto word  = words.begin();
+      auto block = blocks.begin();
+      for (op_iterator op = first; op != last; ++op) {
+        if (op->type == OperationType::READ || op->type == OperationType::RMW_BITS) {
+          uint32_t const val = (word++)->value();
+          if (op->wordRef)
+            *(op->wordRef) = val;
+          op->wordResult.set_value(val);
+        } else if (op->type == OperationType::READ_BLOCK) {
+          std::vector<uint32_t> vals(block->begin(), block->end());
+          ++block;
+          if (op->blockRef)
+            *(op->blockRef) = vals;
+          op->blockResult.set_value(std::move(vals));
+        }
+      }
+      return "";
+    } catch (uhal::exception::exception const& err) {
+      errCode = toolbox::toString("%s",err.what());
+      if (!repeatable) {
+        // counted as given up on, as retryAfterError does for the errors it does not retry
+        m_device.countError(errCode);
+        ++m_device.m_ipBusErrClasses.GaveUp;
+        return toolbox::toString("%s (not retried, the chunk writes to the board and may have been applied)",
+                                 errCode.c_str());
+      }
+      if (m_device.retryAfterError(errCode, retryCount))
+        continue;
+      return errCode;
+    } catch (std::exception const& err) {
+      return toolbox::toString("%s",err.what());
+    }
+  }
+  return toolbox::toString("Giving up after %d attempts, last error was %s", retryCount, errCode.c_str());
+}
+
+void gem::hw::GEMHwTransaction::fail(op_iterator first, op_iterator last, std::string const& msg)
+{
+  std::exception_ptr err;
+  try {
+    XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+  } catch (...) {
+    err = std::current_exception();
+  }
+
+  for (op_iterator op = first; op != last; ++op) {
+    try {
+      if (op->type == OperationType::READ_BLOCK)
+        op->blockResult.set_exception(err);
+      else
+        op->wordResult.set_exception(err);
+    } catch (std::future_error const&) {
+      // already satisfied before the chunk failed
+    }
+  }
+}
@@ -1,6 +1,13 @@
 #include "gem/hw/HwGenericAMC.h"
 
+#include <algorithm>
+#include <chrono>
 #include <iomanip>
+#include <thread>
+
+#include "gem/hw/GEMHwTransaction.h"
+
+const uint32_t gem::hw::HwGenericAMC::PHASE_SAMPLE_INTERVAL_USEC;
 
 // // define the consts
 // const unsigned gem::hw::HwGenericAMC::N_GTX;
@@ -299,6 +306,44 @@ void gem::hw::HwGenericAMC::LinkReset(uint8_t const& gtx, uint8_t const& resets)
 }
 
 
+void gem::hw::HwGenericAMC::resetLinkCounters()
+{
+  GEMHwTransaction trans(*this);
+  trans.write(getDeviceBaseNode()+".OH_LINKS.CTRL.CNT_RESET", 0x1);
+  trans.write(getDeviceBaseNode()+".TRIGGER.CTRL.CNT_RESET",  0x1);
+  trans.commit();
+}
+
+std::vector<gem::hw::HwGenericAMC::AMCLinkHealth> gem::hw::HwGenericAMC::getLinkHealth(uint32_t const& linkMask)
+{
+  static const std::array<std::string, 4> triggerErrors = {{"LINK0_MISSED_COMMA_CNT", "LINK1_MISSED_COMMA_CNT",
+                                                            "LINK0_NOT_VALID_CNT",    "LINK1_NOT_VALID_CNT"}};
+  uint32_t const nLinks = std::min(m_maxLinks, static_cast<uint32_t>(gem::hw::utils::N_GTX));
+  std::vector<AMCLinkHealth> health;
+  for (uint32_t link = 0; link < nLinks; ++link)
+    if ((linkMask >> link) & (m_links >> link) & 0x1) {
+      AMCLinkHealth linkHealth;
+      linkHealth.Link = link;
+      health.push_back(linkHealth);
+    }
+
+  std::vector<std::array<uint32_t, 4> > triggerCounts(health.size());
+  GEMHwTransaction trans(*this);
+  for (size_t i = 0; i < health.size(); ++i) {
+    int const link = health.at(i).Link;
+    trans.read(getDeviceBaseNode()+toolbox::toString(".OH_LINKS.OH%d.TRACK_LINK_ERROR_CNT", link), health.at(i).TrackingErrors);
+    trans.read(getDeviceBaseNode()+toolbox::toString(".OH_LINKS.OH%d.VFAT_BLOCK_CNT",       link), health.at(i).DataPackets);
+    for (size_t c = 0; c < triggerErrors.size(); ++c)
+      trans.read(getDeviceBaseNode()+toolbox::toString(".TRIGGER.OH%d.", link)+triggerErrors.at(c), triggerCounts.at(i).at(c));
+  }
+  trans.commit();
+
+  for (size_t i = 0; i < health.size(); ++i)
+    for (size_t c = 0; c < triggerErrors.size(); ++c)
+      health.at(i).TriggerErrors += triggerCounts.at(i).at(c);
+  return health;
+}
+
 gem::hw::HwGenericAMC::AMCIPBusCounters gem::hw::HwGenericAMC::getIPBusCounters(uint8_t const& gtx,
                                                                                 uint8_t const& mode)
 {
@@ -686,9 +731,30 @@ int gem::hw::HwGenericAMC::checkPLLLock(uint32_t readAttempts)
   } GEM_CATCH_RPC_ERROR("HwGenericAMC::checkPLLLock", gem::hw::exception::Exception);
 }
 
+uint32_t gem::hw::HwGenericAMC::samplePLLLock(uint32_t const nSamples, uint32_t const intervalUsec)
+{
+  if (nSamples == 0)
+    return 0;
+
+  RegHandle handle = resolve(getDeviceBaseNode()+".TTC.STATUS.CLK.PHASE_LOCKED");
+  uint32_t nLocked = 0;
+  std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < nSamples; ++i) {
+    if (i > 0) {
+      next += std::chrono::microseconds(intervalUsec);
+      std::this_thread::sleep_until(next);
+    }
+    if (readReg(handle) != 0)
+      ++nLocked;
+  }
+
+  CMSGEMOS_DEBUG("HwGenericAMC::samplePLLLock locked in " << nLocked << " of " << nSamples << " samples");
+  return nLocked;
+}
+
 double gem::hw::HwGenericAMC::getMMCMPhaseMean(uint32_t readAttempts)
 {
-  if (readAttempts == 1) {
+  if (readAttempts <= 1) {
     return double(readReg(getDeviceBaseNode(), "TTC.STATUS.CLK.TTC_PM_PHASE_MEAN"));
   } else {
     try {
@@ -711,13 +777,17 @@ double gem::hw::HwGenericAMC::getMMCMPhaseMean(uint32_t readAttempts)
 
 double gem::hw::HwGenericAMC::getMMCMPhaseMedian(uint32_t readAttempts)
 {
-  CMSGEMOS_WARN("HwGenericAMC::getMMCMPhaseMedian is not implemented, returning the mean");
-  return getMMCMPhaseMean(readAttempts);
+  return getMMCMPhaseStatistics(readAttempts).getMedian();
+}
+
+gem::hw::utils::GEMPhaseStatistics gem::hw::HwGenericAMC::getMMCMPhaseStatistics(uint32_t readAttempts)
+{
+  return samplePhase("TTC.STATUS.CLK.TTC_PM_PHASE", readAttempts);
 }
 
 double gem::hw::HwGenericAMC::getGTHPhaseMean(uint32_t readAttempts)
 {
-  if (readAttempts == 1) {
+  if (readAttempts <= 1) {
     return readReg(getDeviceBaseNode(), "TTC.STATUS.CLK.GTH_PM_PHASE_MEAN");
   } else {
     try {
@@ -740,8 +810,34 @@ double gem::hw::HwGenericAMC::getGTHPhaseMean(uint32_t readAttempts)
 
 double gem::hw::HwGenericAMC::getGTHPhaseMedian(uint32_t readAttempts)
 {
-  CMSGEMOS_WARN("HwGenericAMC::getGTHPhaseMedian is not implemented, returning the mean");
-  return getGTHPhaseMean(readAttempts);
+  return getGTHPhaseStatistics(readAttempts).getMedian();
+}
+
+gem::hw::utils::GEMPhaseStatistics gem::hw::HwGenericAMC::getGTHPhaseStatistics(uint32_t readAttempts)
+{
+  return samplePhase("TTC.STATUS.CLK.GTH_PM_PHASE", readAttempts);
+}
+
+gem::hw::utils::GEMPhaseStatistics gem::hw::HwGenericAMC::samplePhase(std::string const& regName, uint32_t const nSamples,
+                                                                      uint32_t const intervalUsec)
+{
+  if (nSamples == 0)
+    XCEPT_RAISE(gem::hw::exception::ValueError,
+                "HwGenericAMC::samplePhase " + regName + " needs at least one sample");
+
+  gem::hw::utils::GEMPhaseStatistics stats;
+  RegHandle handle = resolve(getDeviceBaseNode()+"."+regName);
+  std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < nSamples; ++i) {
+    if (i > 0) {
+      next += std::chrono::microseconds(intervalUsec);
+      std::this_thread::sleep_until(next);
+    }
+    stats.add(static_cast<double>(readReg(handle)));
+  }
+
+  CMSGEMOS_DEBUG("HwGenericAMC::samplePhase " << regName << " " << stats.toString());
+  return stats;
 }
 
 void gem::hw::HwGenericAMC::ttcCounterReset()
@@ -898,6 +994,71 @@ uint32_t gem::hw::HwGenericAMC::getOptoHybridClusterCount(uint8_t const& oh, uin
   return readReg(getDeviceBaseNode(), toolbox::toString("TRIGGER.OH%d.CLUSTER_SIZE_%d_CNT",(int)oh,(int)cs));
 }
 
+gem::hw::HwGenericAMC::AMCTriggerRates gem::hw::HwGenericAMC::getTriggerRates(bool const& withCounts)
+{
+  std::vector<RegHandle> rateRegs, countRegs;
+  {
+    gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+    if (m_triggerRateRegs.empty())
+      resolveTriggerRateRegisters();
+    rateRegs = m_triggerRateRegs;
+    if (withCounts)
+      countRegs = m_triggerCountRegs;
+  }
+
+  size_t const nOH = (rateRegs.size()-1)/(1+gem::hw::utils::N_CLUSTER_SIZES);
+  AMCTriggerRates rates;
+  rates.TriggerRate.resize(nOH, 0);
+  rates.ClusterRate.resize(nOH, cluster_counters());
+  if (withCounts) {
+    rates.TriggerCount.resize(nOH, 0);
+    rates.ClusterCount.resize(nOH, cluster_counters());
+  }
+
+  GEMHwTransaction trans(*this);
+  auto rateReg = rateRegs.begin();
+  trans.read(*rateReg++, rates.ORTriggerRate);
+  for (size_t oh = 0; oh < nOH; ++oh) {
+    trans.read(*rateReg++, rates.TriggerRate.at(oh));
+    for (size_t cs = 0; cs < gem::hw::utils::N_CLUSTER_SIZES; ++cs)
+      trans.read(*rateReg++, rates.ClusterRate.at(oh).at(cs));
+  }
+  if (withCounts) {
+    auto countReg = countRegs.begin();
+    for (size_t oh = 0; oh < nOH; ++oh) {
+      trans.read(*countReg++, rates.TriggerCount.at(oh));
+      for (size_t cs = 0; cs < gem::hw::utils::N_CLUSTER_SIZES; ++cs)
+        trans.read(*countReg++, rates.ClusterCount.at(oh).at(cs));
+    }
+  }
+
+  std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+  trans.commit();
+  rates.Timestamp = start + (std::chrono::steady_clock::now() - start)/2;
+  return rates;
+}
+
+void gem::hw::HwGenericAMC::resolveTriggerRateRegisters()
+{
+  uint32_t const nOH = std::min(m_maxLinks, static_cast<uint32_t>(gem::hw::utils::N_GTX));
+  std::string const base = getDeviceBaseNode() + ".TRIGGER.";
+
+  std::vector<RegHandle> rateRegs, countRegs;
+  rateRegs.push_back(resolve(base+"STATUS.OR_TRIGGER_RATE"));
+  for (uint32_t oh = 0; oh < nOH; ++oh) {
+    std::string const ohNode = base + toolbox::toString("OH%d.", oh);
+    rateRegs.push_back(resolve(ohNode+"TRIGGER_RATE"));
+    countRegs.push_back(resolve(ohNode+"TRIGGER_CNT"));
+    for (uint32_t cs = 0; cs < gem::hw::utils::N_CLUSTER_SIZES; ++cs) {
+      rateRegs.push_back(resolve(ohNode+toolbox::toString("CLUSTER_SIZE_%d_RATE", cs)));
+      countRegs.push_back(resolve(ohNode+toolbox::toString("CLUSTER_SIZE_%d_CNT", cs)));
+    }
+  }
+  m_triggerRateRegs.swap(rateRegs);
+  m_triggerCountRegs.swap(countRegs);
+  CMSGEMOS_DEBUG("HwGenericAMC::resolveTriggerRateRegisters resolved the rates of " << nOH << " OptoHybrids");
+}
+
 uint32_t gem::hw::HwGenericAMC::getOptoHybridDebugLastCluster(uint8_t const& oh, uint8_t const& cs)
 {
   return readReg(getDeviceBaseNode(), toolbox::toString("TRIGGER.OH%d.DEBUG_LAST_CLUSTER_%d",(int)oh,(int)cs));
@@ -8,12 +8,21 @@
 #include "amc13/AMC13.hh"
 #include "amc13/Exception.hh"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
 #include <gem/hw/amc13/AMC13Readout.h>
+#include <gem/readout/GEMReadoutResources.h>
+#include <gem/readout/GEMCompressedWriter.h>
 #include <gem/utils/soap/GEMSOAPToolBox.h>
 #include <gem/readout/exception/Exception.h>
 
 XDAQ_INSTANTIATOR_IMPL(gem::hw::amc13::AMC13Readout);
 
+const uint32_t gem::hw::amc13::AMC13Readout::MONITOR_BUFFER_EVENTS;
+
 gem::hw::amc13::AMC13Readout::AMC13Readout(xdaq::ApplicationStub* stub)
   throw (xdaq::exception::Exception) :
   gem::readout::GEMReadoutApplication(stub),
@@ -44,11 +53,25 @@ gem::hw::amc13::AMC13Readout::AMC13Readout(xdaq::ApplicationStub* stub)
         );
   cnt = 0;
   nwrote_global = 0;
+  p_pendingEvent = NULL;
+  m_pendingSize  = 0;
   CMSGEMOS_DEBUG("AMC13Readout ctor end");
 }
 
 gem::hw::amc13::AMC13Readout::~AMC13Readout()
 {
+  dropPendingEvent();
+}
+
+void gem::hw::amc13::AMC13Readout::dropPendingEvent()
+{
+  if (!p_pendingEvent)
+    return;
+  CMSGEMOS_WARN("AMC13Readout::dropPendingEvent dropping an event of " << m_pendingSize
+                << " words that was read out but never written");
+  free(p_pendingEvent);
+  p_pendingEvent = NULL;
+  m_pendingSize  = 0;
 }
 
 void gem::hw::amc13::AMC13Readout::actionPerformed(xdata::Event& event)
@@ -114,6 +137,8 @@ void gem::hw::amc13::AMC13Readout::configureAction()
   // grab these from the config, updated through SOAP too
   //m_outFileName  = m_readoutSettings.bag.fileName.toString();
   gem::readout::GEMReadoutApplication::configureAction();
+  // the monitor buffer is drained in whole events, as many as are there once a read is worth it
+  configureDrainController(1, MONITOR_BUFFER_EVENTS, std::numeric_limits<uint32_t>::max());
 }
 
 void gem::hw::amc13::AMC13Readout::startAction()
@@ -122,6 +147,7 @@ void gem::hw::amc13::AMC13Readout::startAction()
   CMSGEMOS_DEBUG("AMC13Readout::startAction begin");
   cnt = 0;
   nwrote_global = 0;
+  dropPendingEvent();
   gem::readout::GEMReadoutApplication::startAction();
 }
 
@@ -166,7 +192,7 @@ int gem::hw::amc13::AMC13Readout::readout(unsigned int expected,
                                           std::vector< ::toolbox::mem::Reference* >& data)
 {
   try {
-    return dumpData();
+    return dumpData(data);
   } catch (amc13Exception const& e) {
     std::stringstream msg;
     msg << "AMC13Readout::readout error " << e.what();
@@ -186,7 +212,7 @@ int gem::hw::amc13::AMC13Readout::readout(unsigned int expected,
 }
 
 
-int gem::hw::amc13::AMC13Readout::dumpData()
+int gem::hw::amc13::AMC13Readout::dumpData(std::vector< ::toolbox::mem::Reference* >& data)
 {
   CMSGEMOS_DEBUG("AMC13Readout::dumpData begin");
   size_t siz;
@@ -196,6 +222,10 @@ int gem::hw::amc13::AMC13Readout::dumpData()
   //FILE *fp;
   //fp = fopen(m_outFileName.c_str(), "a");
   int nwrote = 0;
+  bool throttled = false;
+  // events read by the previous pass and the time it took, fed back to the drain controller
+  uint32_t nDrained = 0;
+  double   drainUsec = 0.;
 
   CMSGEMOS_DEBUG("File for output open");
   while (true) {
@@ -219,18 +249,59 @@ int gem::hw::amc13::AMC13Readout::dumpData()
       CMSGEMOS_ERROR(msg.str());
       XCEPT_RAISE(gem::hw::amc13::exception::ReadoutProblem,msg.str());
     }
+    if (nDrained)
+      m_drainController.update(nDrained, drainUsec, nevt);
+    nDrained = 0;
+    // the batch follows the occupancy trend and the read latency, a deferred read leaves the events
+    // in the buffer for the next poll
+    uint32_t const batch = m_drainController.nextBatch(nevt);
+    if (nevt && !batch && !p_pendingEvent) {
+      CMSGEMOS_DEBUG("AMC13Readout::dumpData deferring the read of " << std::dec << nevt << " events");
+      break;
+    }
+    nevt = std::min(nevt, static_cast<int>(batch));
+    // the event kept by the previous drain is written first
+    if (p_pendingEvent)
+      ++nevt;
     CMSGEMOS_DEBUG("Trying to read " << std::dec << nevt << " events" << std::endl);
     if (nevt) {
       std::stringstream chunkfilename;
       chunkfilename << m_outFileName.substr(0,m_outFileName.length()-4)
                     << "_chunk_" << cnt << ".dat";
-      std::ofstream outf(chunkfilename.str().c_str(),std::ios_base::app | std::ios::binary);
+      // with compression enabled the writer thread owns the file, otherwise write it directly
+      gem::readout::GEMCompressedWriter* writer = outputWriter(chunkfilename.str());
+      std::ofstream outf;
+      if (!writer) {
+        if (!p_outBuffer)
+          p_outBuffer = allocateReadoutBuffer(4*1024*1024);
+        outf.rdbuf()->pubsetbuf(p_outBuffer->data(), p_outBuffer->size());
+        outf.open(chunkfilename.str().c_str(),std::ios_base::app | std::ios::binary);
+      }
 
+      std::chrono::steady_clock::time_point const drainStart = std::chrono::steady_clock::now();
       for (int i = 0; i < nevt; i++) {
+        // leave the events in the AMC13 buffer while the writer or the stream consumer is behind
+        if (((writer || isStreaming()) && poolThrottled()) || streamThrottled()) {
+          CMSGEMOS_DEBUG("AMC13Readout::dumpData frame pool above watermark or out of stream credits, deferring "
+                         << std::dec << (nevt-i) << " events");
+          if (writer)
+            writer->flush();
+          throttled = true;
+          break;
+        }
         if ( (i % 100) == 0)
           CMSGEMOS_DEBUG("calling readEvent " << std::dec << i << "..." << std::endl);
         try {
-          pEvt = p_amc13->readEvent(siz, rc);
+          if (p_pendingEvent) {
+            // read out by the previous drain while no frame was free
+            pEvt = p_pendingEvent;
+            siz  = m_pendingSize;
+            rc   = 0;
+            p_pendingEvent = NULL;
+          } else {
+            pEvt = p_amc13->readEvent(siz, rc);
+            ++nDrained;
+          }
         } catch (amc13Exception const& e) {
           std::stringstream msg;
           msg << "AMC13Readout::readout error " << e.what();
@@ -249,7 +320,38 @@ int gem::hw::amc13::AMC13Readout::dumpData()
         }
         if (rc == 0 && siz > 0 && pEvt != NULL) {
           // fwrite(pEvt, sizeof(uint64_t), siz, fp);
-          outf.write((char*)pEvt, siz*sizeof(uint64_t));
+          if (writer || isStreaming()) {
+            // the single copy out of the AMC13 library buffer, the writer and the stream share the frame
+            size_t const evtSize = siz*sizeof(uint64_t);
+            toolbox::mem::Reference* frame = allocateEventFrame(evtSize);
+            if (!frame) {
+              // keep this event for the next drain and leave the others in the AMC13 buffer
+              CMSGEMOS_DEBUG("AMC13Readout::dumpData no free frame, deferring "
+                             << std::dec << (nevt-i) << " events");
+              p_pendingEvent = pEvt;
+              m_pendingSize  = siz;
+              if (writer)
+                writer->flush();
+              throttled = true;
+              break;
+            }
+            data.push_back(frame);
+            char* evt = static_cast<char*>(frame->getDataLocation()) + eventOffset();
+            try {
+              std::memcpy(evt, pEvt, evtSize);
+              if (writer)
+                writer->write(frame, eventOffset(), evtSize);
+              else
+                outf.write(evt, evtSize);
+            } catch (gem::readout::exception::OutputProblem const& e) {
+              free(pEvt);
+              throw;
+            }
+            // events that cannot be streamed are counted and logged by streamFrame
+            if (isStreaming())
+              streamFrame(frame, evtSize, 1);
+          } else
+            outf.write((char*)pEvt, siz*sizeof(uint64_t));
           ++nwrote;
           ++nwrote_global;
         } else {
@@ -259,7 +361,9 @@ int gem::hw::amc13::AMC13Readout::dumpData()
         if (pEvt)
           free(pEvt);
       }
-      outf.close();
+      drainUsec = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now()-drainStart).count();
+      if (!writer)
+        outf.close();
       m_duration = ( std::clock() - m_start ) / (double) CLOCKS_PER_SEC;
       if ((nwrote_global/10000 > cnt) || ((cnt > 0) && (m_duration > 30))) {
         cnt++;
@@ -270,6 +374,8 @@ int gem::hw::amc13::AMC13Readout::dumpData()
       CMSGEMOS_DEBUG("Monitor buffer empty" << std::endl);
       break;
     }
+    if (throttled)
+      break;
   }
   CMSGEMOS_DEBUG("Closing file" << std::endl);
   // fclose(fp);
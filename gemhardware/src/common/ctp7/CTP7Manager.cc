@@ -9,6 +9,7 @@
 #include "gem/hw/ctp7/CTP7Manager.h"
 
 #include "gem/hw/ctp7/HwCTP7.h"
+#include "gem/hw/GEMHwConnectionRegistry.h"
 #include "gem/hw/ctp7/CTP7Monitor.h"
 #include "gem/hw/ctp7/CTP7ManagerWeb.h"
 
@@ -509,6 +510,8 @@ void gem::hw::ctp7::CTP7Manager::resetAction()
       continue;
     }
   }
+  // the next initializeAction reads the connection file again
+  gem::hw::GEMHwConnectionRegistry::getInstance().clear();
   // gem::base::GEMFSMApplication::resetAction();
 }
 
@@ -17,7 +17,8 @@ typedef gem::base::utils::GEMInfoSpaceToolBox::UpdateType GEMUpdateType;
 
 gem::hw::ctp7::CTP7Monitor::CTP7Monitor(std::shared_ptr<HwCTP7> ctp7, CTP7Manager* ctp7Manager, int const& index) :
   GEMMonitor(ctp7Manager->getApplicationLogger(), static_cast<xdaq::Application*>(ctp7Manager), index),
-  p_ctp7(ctp7)
+  p_ctp7(ctp7),
+  m_readList(m_gemLogger)
 {
   // application info space is added in the base class constructor
   // addInfoSpace("Application", ctp7Manager->getApplicationInfoSpace());
@@ -205,58 +206,9 @@ gem::hw::ctp7::CTP7Monitor::~CTP7Monitor()
 
 void gem::hw::ctp7::CTP7Monitor::updateMonitorables()
 {
-  // define how to update the desired values
-  // get SYSTEM monitorables
-  // can this be split into two loops, one just to do a list read, the second to fill the InfoSpace with the returned values
+  // all hardware monitorables are read in one batched transaction, then filled into the InfoSpaces
   CMSGEMOS_DEBUG("CTP7Monitor: Updating monitorables");
-  for (auto monlist = m_monitorableSetsMap.begin(); monlist != m_monitorableSetsMap.end(); ++monlist) {
-    CMSGEMOS_DEBUG("CTP7Monitor: Updating monitorables in set " << monlist->first);
-    for (auto monitem = monlist->second.begin(); monitem != monlist->second.end(); ++monitem) {
-      CMSGEMOS_DEBUG("CTP7Monitor: Updating monitorable " << monitem->first);
-      std::stringstream regName;
-      regName << monitem->second.regname;
-      uint32_t address = p_ctp7->getNode(regName.str()).getAddress();
-      uint32_t mask    = p_ctp7->getNode(regName.str()).getMask();
-      if (monitem->second.updatetype == GEMUpdateType::HW8) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_ctp7->readReg(address,mask));
-      } else if (monitem->second.updatetype == GEMUpdateType::HW16) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_ctp7->readReg(address,mask));
-      } else if (monitem->second.updatetype == GEMUpdateType::HW24) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_ctp7->readReg(address,mask));
-      } else if (monitem->second.updatetype == GEMUpdateType::HW32) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_ctp7->readReg(address,mask));
-      } else if (monitem->second.updatetype == GEMUpdateType::HW64) {
-        address = p_ctp7->getNode(regName.str()+".LOWER").getAddress();
-        mask    = p_ctp7->getNode(regName.str()+".LOWER").getMask();
-        uint32_t lower = p_ctp7->readReg(address,mask);
-        address = p_ctp7->getNode(regName.str()+".UPPER").getAddress();
-        mask    = p_ctp7->getNode(regName.str()+".UPPER").getMask();
-        uint32_t upper = p_ctp7->readReg(address,mask);
-        (monitem->second.infoSpace)->setUInt64(monitem->first, (((uint64_t)upper) << 32) + lower);
-      } else if (monitem->second.updatetype == GEMUpdateType::I2CSTAT) {
-        std::stringstream strobeReg;
-        strobeReg << regName.str() << ".Strobe." << monitem->first;
-        address = p_ctp7->getNode(strobeReg.str()).getAddress();
-        mask    = p_ctp7->getNode(strobeReg.str()).getMask();
-        uint32_t strobe = p_ctp7->readReg(address,mask);
-        std::stringstream ackReg;
-        ackReg << regName.str() << ".Ack." << monitem->first;
-        address = p_ctp7->getNode(ackReg.str()).getAddress();
-        mask    = p_ctp7->getNode(ackReg.str()).getMask();
-        uint32_t ack = p_ctp7->readReg(address,mask);
-        (monitem->second.infoSpace)->setUInt64(monitem->first, (((uint64_t)ack) << 32) + strobe);
-      } else if (monitem->second.updatetype == GEMUpdateType::PROCESS) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_ctp7->readReg(address,mask));
-      } else if (monitem->second.updatetype == GEMUpdateType::TRACKER) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_ctp7->readReg(address,mask));
-      } else if (monitem->second.updatetype == GEMUpdateType::NOUPDATE) {
-        continue;
-      } else {
-        CMSGEMOS_ERROR("CTP7Monitor: Unknown update type encountered");
-        continue;
-      }
-    } // end loop over items in list
-  } // end loop over monitorableSets
+  m_readList.update(*p_ctp7, m_monitorableSetsMap, "");
 }
 
 void gem::hw::ctp7::CTP7Monitor::buildMonitorPage(xgi::Output* out)
@@ -338,6 +290,7 @@ void gem::hw::ctp7::CTP7Monitor::reset()
   }
 
   CMSGEMOS_DEBUG("CTP7Monitor::reset - clearing all maps");
+  m_readList.clear();
   m_infoSpaceMap.clear();
   m_infoSpaceMonitorableSetMap.clear();
   m_monitorableSetInfoSpaceMap.clear();
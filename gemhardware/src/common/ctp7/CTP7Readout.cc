@@ -19,6 +19,7 @@
 #include <sstream>
 #include <cstdlib>
 #include <vector>
+#include <chrono>
 
 #include <boost/lexical_cast.hpp>
 #include <boost/format.hpp>
@@ -39,7 +40,6 @@ gem::hw::ctp7::CTP7Readout::CTP7Readout(xdaq::ApplicationStub* stub) :
 {
   xoap::bind(this,&CTP7Readout::updateScanParameters,"UpdateScanParameter","urn:CTP7Readout-soap:1");
   //xoap::bind(this,&CTP7Readout::queueDepth,          "QueueDepth",         "urn:CTP7Readout-soap:1");
-  p_appInfoSpace->fireItemAvailable("QueueDepth", &m_queueDepth);
 }
 
 gem::hw::ctp7::CTP7Readout::~CTP7Readout()
@@ -74,6 +74,7 @@ void gem::hw::ctp7::CTP7Readout::initializeAction()
     XCEPT_RAISE(gem::hw::ctp7::exception::Exception, "initializeAction failed");
   }
   CMSGEMOS_DEBUG("CTP7Readout::initializeAction connected");
+  startQueueDepthTimer();
 }
 
 
@@ -90,6 +91,8 @@ void gem::hw::ctp7::CTP7Readout::configureAction()
   m_vfat = 0;
   m_event = 0;
   m_sumVFAT = 0;
+  gem::readout::GEMReadoutApplication::configureAction();
+  configureDrainController(kUPDATE7, gem::readout::GEMDrainController::TRACKING_FIFO_WORDS);
 }
 
 void gem::hw::ctp7::CTP7Readout::startAction()
@@ -146,50 +149,40 @@ uint32_t* gem::hw::ctp7::CTP7Readout::getCTP7Data(uint8_t const& gtx, uint32_t c
 {
   uint32_t *point = &counter[0];
 
-  CMSGEMOS_DEBUG("CTP7Readout::getCTP7Data Starting while loop readout "
-        << std::endl << "FIFO VFAT block depth 0x" << std::hex
-        << p_ctp7->getFIFOVFATBlockOccupancy(gtx)
-        << std::endl << "FIFO depth 0x" << std::hex
-        << p_ctp7->getFIFOOccupancy(gtx)
-        );
-  while ( p_ctp7->getFIFOVFATBlockOccupancy(gtx) ) {
+  typedef std::chrono::steady_clock clock;
+
+  uint32_t occupancy = p_ctp7->getFIFOOccupancy(gtx);
+  CMSGEMOS_DEBUG("CTP7Readout::getCTP7Data starting drain, FIFO depth 0x" << std::hex << occupancy << std::dec);
+
+  // batch size is chosen by the drain controller from the occupancy trend and the read latency
+  while (uint32_t nWords = m_drainController.nextBatch(occupancy)) {
     CMSGEMOS_DEBUG("CTP7Readout::getCTP7Data initiating call to getTrackingData(gtx,"
-          << p_ctp7->getFIFOVFATBlockOccupancy(gtx) << ")");
-    std::vector<uint32_t> data = p_ctp7->getTrackingData(gtx, p_ctp7->getFIFOVFATBlockOccupancy(gtx));
-    CMSGEMOS_DEBUG("CTP7Readout::getCTP7Data"
-          << std::endl << "FIFO VFAT block depth 0x" << std::hex
-          << p_ctp7->getFIFOVFATBlockOccupancy(gtx)
-          << std::endl << "FIFO depth 0x" << std::hex
-          << p_ctp7->getFIFOOccupancy(gtx)
-          );
+          << nWords/kUPDATE7 << ")");
+    clock::time_point readStart = clock::now();
+    std::vector<uint32_t> data = p_ctp7->getTrackingData(gtx, nWords/kUPDATE7);
+    clock::time_point readEnd = clock::now();
 
     uint32_t contqueue = 0;
     for (auto iword = data.begin(); iword != data.end(); ++iword) {
       contqueue++;
       //gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_queueLock);
-      CMSGEMOS_DEBUG(" ::getCTP7Data pushing into queue 0x"
+      CMSGEMOS_TRACE(" ::getCTP7Data pushing into queue 0x"
             << std::setfill('0') << std::setw(8) << std::hex << *iword << std::dec );
       m_dataque.push(*iword);
       if (contqueue%kUPDATE7 == 0 &&  contqueue != 0) {
         m_contvfats++;
-        CMSGEMOS_DEBUG(" ::getCTP7Data counter " << contqueue << " contvfats " << m_contvfats
-              << " m_dataque.size " << m_dataque.size());
       }
     }
-    CMSGEMOS_DEBUG(" ::getCTP7Data end of while loop do we go again?" << std::endl
-          << " FIFO VFAT block occupancy  0x" << std::hex << p_ctp7->getFIFOVFATBlockOccupancy(gtx)
-          << std::endl
-          << " FIFO occupancy             0x" << std::hex << p_ctp7->getFIFOOccupancy(gtx) << std::endl
-          << " hasTrackingData            0x" << std::hex << p_ctp7->hasTrackingData(gtx)  << std::endl
-          );
-  }// while(p_ctp7->getFIFOVFATBlockOccupancy(gtx))
-  CMSGEMOS_DEBUG("CTP7Readout::getCTP7Data"
-        << std::endl
-        << " FIFO VFAT block occupancy  0x" << std::hex << p_ctp7->getFIFOVFATBlockOccupancy(gtx)
-        << std::endl
-        << " FIFO occupancy             0x" << std::hex << p_ctp7->getFIFOOccupancy(gtx) << std::endl
-        << " hasTrackingData            0x" << std::hex << p_ctp7->hasTrackingData(gtx)  << std::endl
-        );
+    updateQueueDepth(m_dataque.size());
+
+    occupancy = p_ctp7->getFIFOOccupancy(gtx);
+    m_drainController.update(data.size(),
+                             std::chrono::duration<double, std::micro>(readEnd-readStart).count(),
+                             occupancy);
+    CMSGEMOS_DEBUG(" ::getCTP7Data read " << data.size() << " words, contvfats " << m_contvfats
+          << " m_dataque.size " << m_dataque.size()
+          << " FIFO occupancy 0x" << std::hex << occupancy << std::dec);
+  }
   return point;
 }
 
@@ -281,9 +274,7 @@ uint32_t* gem::hw::ctp7::CTP7Readout::GEMEventMaker(uint32_t counter[5])
   CMSGEMOS_DEBUG(" ::GEMEventMaker m_event " << m_event << " m_vfats.size " << m_vfats.size() << std::hex << " ES 0x" << ES << std::dec );
   //}//end of event selection
 
-  m_queueDepth = m_dataque.size();
-  p_appInfoSpace->fireItemValueRetrieve("QueueDepth");
-  p_appInfoSpace->fireItemValueChanged("QueueDepth");
+  updateQueueDepth(m_dataque.size());
 
   counter[0] = m_vfat;
   counter[1] = m_event;
@@ -0,0 +1,637 @@
+/**
+ * class: EmulatorBoard
+ * description: Register content of one emulated board, built from its uhal address tables
+ */
+
+#include "gem/hw/emulator/EmulatorBoard.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <memory>
+#include <sstream>
+
+#include "gem/hw/exception/Exception.h"
+
+namespace {
+  unsigned shiftOf(uint32_t const mask)
+  {
+    return mask ? __builtin_ctz(mask) : 0;
+  }
+
+  uint32_t getField(uint32_t const word, uint32_t const mask)
+  {
+    return (word & mask) >> shiftOf(mask);
+  }
+
+  uint32_t setField(uint32_t const word, uint32_t const mask, uint32_t const value)
+  {
+    return (word & ~mask) | ((value << shiftOf(mask)) & mask);
+  }
+
+  std::string upper(std::string name)
+  {
+    std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+    return name;
+  }
+
+  std::string leafOf(std::string const& name)
+  {
+    size_t const dot = name.rfind('.');
+    return (dot == std::string::npos) ? name : name.substr(dot+1);
+  }
+
+  std::string parentOf(std::string const& name)
+  {
+    size_t const dot = name.rfind('.');
+    return (dot == std::string::npos) ? "" : name.substr(0, dot);
+  }
+
+  bool contains(std::string const& name, std::string const& part)
+  {
+    return name.find(part) != std::string::npos;
+  }
+
+  bool endsWith(std::string const& name, std::string const& end)
+  {
+    return name.size() >= end.size() && name.compare(name.size()-end.size(), end.size(), end) == 0;
+  }
+
+  bool isCounterName(std::string const& leaf, std::string const& name)
+  {
+    return endsWith(leaf, "CNT") || endsWith(leaf, "COUNT") || contains(name, "COUNTERS.");
+  }
+
+  bool isErrorName(std::string const& leaf)
+  {
+    char const* errors[] = {"ERR", "MISSED", "NOT_VALID", "TIMEOUT", "CRC", "OVF", "UNF"};
+    for (auto error = std::begin(errors); error != std::end(errors); ++error)
+      if (contains(leaf, *error))
+        return true;
+    return false;
+  }
+
+  uint32_t pseudoRandom(uint32_t const address, uint64_t const index)
+  {
+    // splitmix64, the same words for the same address and index on every run
+    uint64_t z = ((static_cast<uint64_t>(address) << 32) ^ index) + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return static_cast<uint32_t>(z ^ (z >> 31));
+  }
+}
+
+gem::hw::emulator::EmulatorBoard::Settings::Settings() :
+  CounterRate(1000.),
+  ErrorCounterRate(0.),
+  FIFORate(100000.),
+  FIFODepth(4096),
+  BroadcastUsec(50),
+  ScanMsec(100),
+  DataSource(pseudoRandom)
+{
+}
+
+uint64_t gem::hw::emulator::EmulatorBoard::Counter::count(clock::time_point const& now) const
+{
+  double const seconds = std::chrono::duration<double>(now - start).count();
+  return base + static_cast<uint64_t>(rate*seconds);
+}
+
+gem::hw::emulator::EmulatorBoard::EmulatorBoard(std::string const& name, Settings const& settings) :
+  m_name(name),
+  m_settings(settings),
+  m_gemLogger(log4cplus::Logger::getInstance("EmulatorBoard"))
+{
+  if (!m_settings.DataSource)
+    m_settings.DataSource = pseudoRandom;
+}
+
+void gem::hw::emulator::EmulatorBoard::addAddressTable(GEMHwAddressTable const& table)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  GEMHwAddressTable::register_map const& registers = table.getRegisters();
+  m_registers.insert(registers.begin(), registers.end());
+  build();
+}
+
+size_t gem::hw::emulator::EmulatorBoard::size() const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_words.size();
+}
+
+void gem::hw::emulator::EmulatorBoard::build()
+{
+  // the values written so far survive a rebuild, the behaviours start over
+  std::unordered_map<uint32_t, Word> previous;
+  previous.swap(m_words);
+  m_counters.clear();
+  m_counterIndex.clear();
+  m_queues.clear();
+  m_readHooks.clear();
+  m_readActions.clear();
+  m_writeHooks.clear();
+
+  for (auto reg = m_registers.begin(); reg != m_registers.end(); ++reg) {
+    GEMHwAddressTable::Register const& r = reg->second;
+    if (r.Mode == uhal::defs::HIERARCHICAL)
+      continue;
+    bool const port   = (r.Mode == uhal::defs::NON_INCREMENTAL);
+    uint32_t const nWords = port ? 1 : std::max(r.Size, 1U);
+    for (uint32_t i = 0; i < nWords; ++i) {
+      Word& word = m_words[r.Address+i];
+      if (r.Permission & uhal::defs::READ)
+        word.readMask |= r.Mask;
+      if (r.Permission & uhal::defs::WRITE)
+        word.writeMask |= r.Mask;
+      word.port = word.port || port;
+    }
+  }
+  for (auto word = m_words.begin(); word != m_words.end(); ++word) {
+    auto old = previous.find(word->first);
+    if (old != previous.end())
+      word->second.value = old->second.value;
+  }
+
+  // the broadcast and scan results are not fed by the data source, they go first
+  addBroadcasts();
+  addScans();
+  addFIFOs();
+  addCounters();
+  addStatus();
+
+  CMSGEMOS_INFO("EmulatorBoard::build " << m_name << ": " << m_registers.size() << " nodes, "
+                << m_words.size() << " words, " << m_counters.size() << " counters, "
+                << m_queues.size() << " FIFOs");
+}
+
+void gem::hw::emulator::EmulatorBoard::addCounters()
+{
+  clock::time_point const now = clock::now();
+  for (auto reg = m_registers.begin(); reg != m_registers.end(); ++reg) {
+    GEMHwAddressTable::Register const& r = reg->second;
+    if (r.Mode != uhal::defs::SINGLE || r.Permission != uhal::defs::READ || m_queues.count(r.Address))
+      continue;
+    std::string const name = upper(reg->first);
+    std::string leaf = leafOf(name);
+    unsigned shift = 0;
+    // 64-bit counters are two nodes named after the counter
+    if (leaf == "LOWER" || leaf == "UPPER") {
+      shift = (leaf == "UPPER") ? 32 : 0;
+      leaf  = leafOf(parentOf(name));
+    }
+    if (!isCounterName(leaf, name))
+      continue;
+
+    Counter counter;
+    counter.name    = reg->first;
+    counter.address = r.Address;
+    counter.mask    = r.Mask;
+    counter.shift   = shift;
+    counter.rate    = isErrorName(leaf) ? m_settings.ErrorCounterRate : m_settings.CounterRate;
+    counter.base    = 0;
+    counter.start   = now;
+    m_counterIndex[r.Address].push_back(m_counters.size());
+    m_counters.push_back(counter);
+  }
+
+  // a counter reset clears the counters of its block, GEM_AMC.OH_LINKS.CTRL.CNT_RESET those under GEM_AMC.OH_LINKS
+  for (auto reg = m_registers.begin(); reg != m_registers.end(); ++reg) {
+    GEMHwAddressTable::Register const& r = reg->second;
+    std::string const leaf = upper(leafOf(reg->first));
+    if (r.Mode != uhal::defs::SINGLE || !(r.Permission & uhal::defs::WRITE) || !contains(leaf, "RESET") ||
+        !(contains(leaf, "CNT") || contains(leaf, "COUNT")))
+      continue;
+    std::string block = parentOf(reg->first);
+    std::string const blockLeaf = upper(leafOf(block));
+    if (blockLeaf == "CTRL" || blockLeaf == "CONTROL" || blockLeaf == "COUNTERS")
+      block = parentOf(block);
+
+    std::vector<size_t> counters;
+    for (size_t i = 0; i < m_counters.size(); ++i)
+      if (block.empty() || m_counters.at(i).name.compare(0, block.size()+1, block+".") == 0)
+        counters.push_back(i);
+    uint32_t const mask = r.Mask;
+    addWriteHook(r.Address, [this, counters, mask](uint32_t const word) {
+        if (!getField(word, mask))
+          return;
+        clock::time_point const now = clock::now();
+        for (auto i = counters.begin(); i != counters.end(); ++i) {
+          m_counters.at(*i).base  = 0;
+          m_counters.at(*i).start = now;
+        }
+      });
+  }
+}
+
+void gem::hw::emulator::EmulatorBoard::addStatus()
+{
+  for (auto reg = m_registers.begin(); reg != m_registers.end(); ++reg) {
+    GEMHwAddressTable::Register const& r = reg->second;
+    if (r.Mode != uhal::defs::SINGLE || r.Permission != uhal::defs::READ ||
+        m_counterIndex.count(r.Address) || m_queues.count(r.Address))
+      continue;
+    std::string const leaf = upper(leafOf(reg->first));
+    uint32_t const mask = r.Mask;
+    if (leaf == "RATE" || endsWith(leaf, "_RATE")) {
+      uint32_t const rate = static_cast<uint32_t>(m_settings.CounterRate);
+      addReadHook(r.Address, [mask, rate](uint32_t const word) { return setField(word, mask, rate); });
+    } else if ((contains(leaf, "LOCK") && !contains(leaf, "UNLOCK")) || contains(leaf, "READY")) {
+      Word& word = m_words.at(r.Address);
+      word.value = setField(word.value, mask, 0x1);
+    }
+  }
+}
+
+void gem::hw::emulator::EmulatorBoard::addFIFOs()
+{
+  for (auto reg = m_registers.begin(); reg != m_registers.end(); ++reg) {
+    GEMHwAddressTable::Register const& r = reg->second;
+    if (r.Mode != uhal::defs::NON_INCREMENTAL || !(r.Permission & uhal::defs::READ) || m_queues.count(r.Address))
+      continue;
+    uint32_t const address = r.Address;
+    getQueue(address, true);
+
+    std::string const parent = parentOf(reg->first);
+    std::vector<std::string> const siblings = getChildren(parent);
+    uint32_t const depth = m_settings.FIFODepth;
+    for (auto sibling = siblings.begin(); sibling != siblings.end(); ++sibling) {
+      GEMHwAddressTable::Register const* s = findRegister(parent.empty() ? *sibling : parent+"."+*sibling);
+      if (!s || s->Mode != uhal::defs::SINGLE)
+        continue;
+      std::string const leaf = upper(*sibling);
+      uint32_t const mask = s->Mask;
+      std::function<uint32_t(size_t const)> status;
+      if (contains(leaf, "DEPTH") || contains(leaf, "OCCUPANCY"))
+        status = [](size_t const size) { return static_cast<uint32_t>(size); };
+      else if (contains(leaf, "EMPTY"))
+        status = [](size_t const size) { return static_cast<uint32_t>(size == 0); };
+      else if (contains(leaf, "FULL"))
+        status = [depth](size_t const size) { return static_cast<uint32_t>(size >= depth); };
+      else if (contains(leaf, "VALID"))
+        status = [](size_t const size) { return static_cast<uint32_t>(size > 0); };
+
+      if (status && (s->Permission & uhal::defs::READ)) {
+        addReadHook(s->Address, [this, address, mask, status](uint32_t const word) {
+            Queue& queue = m_queues.at(address);
+            fill(address, queue);
+            return setField(word, mask, status(queue.words.size()));
+          });
+      } else if ((s->Permission & uhal::defs::WRITE) && (contains(leaf, "RESET") || contains(leaf, "FLUSH")) &&
+                 !contains(leaf, "CNT") && !contains(leaf, "COUNT")) {
+        addWriteHook(s->Address, [this, address, mask](uint32_t const word) {
+            if (!getField(word, mask))
+              return;
+            Queue& queue = m_queues.at(address);
+            queue.words.clear();
+            queue.lastFill = clock::now();
+          });
+      }
+    }
+  }
+}
+
+void gem::hw::emulator::EmulatorBoard::addBroadcasts()
+{
+  std::string const request = ".BROADCAST.REQUEST.";
+  for (auto reg = m_registers.begin(); reg != m_registers.end(); ++reg) {
+    size_t const pos = upper(reg->first).find(request);
+    if (pos == std::string::npos || reg->second.Mode != uhal::defs::SINGLE)
+      continue;
+    // e.g. GEM_AMC.OH.OH0.GEB, GEM_AMC.OH.OH0.GEB.Broadcast and ContReg0
+    std::string const base    = reg->first.substr(0, pos);
+    std::string const bcast   = reg->first.substr(0, pos + request.size() - std::string(".REQUEST.").size());
+    std::string const regName = reg->first.substr(pos + request.size());
+    GEMHwAddressTable::Register const* results = findRegister(bcast+".Results");
+    GEMHwAddressTable::Register const* running = findRegister(bcast+".Running");
+    GEMHwAddressTable::Register const* reset   = findRegister(bcast+".Reset");
+    std::string const maskName = findRegister(bcast+".Mask") ? bcast+".Mask" : "";
+
+    std::vector<std::pair<uint32_t, std::string> > vfats;
+    for (uint32_t vfat = 0; vfat < 24; ++vfat) {
+      std::stringstream vfatName;
+      vfatName << base << ".VFATS.VFAT" << vfat << "." << regName;
+      if (findRegister(vfatName.str()))
+        vfats.push_back(std::make_pair(vfat, vfatName.str()));
+    }
+
+    // the request, running, results and reset nodes of a block share its state
+    std::shared_ptr<clock::time_point> runningUntil = std::make_shared<clock::time_point>();
+    uint32_t const resultsAddress = results ? results->Address : 0;
+    if (results)
+      getQueue(resultsAddress, false);
+    clock::duration const duration = std::chrono::microseconds(m_settings.BroadcastUsec);
+    uint32_t const requestMask = reg->second.Mask;
+
+    addReadAction(reg->second.Address, [this, vfats, maskName, results, resultsAddress, runningUntil, duration](uint32_t const) {
+        uint32_t const mask = maskName.empty() ? 0 : readField(maskName);
+        if (results) {
+          Queue& queue = m_queues.at(resultsAddress);
+          queue.words.clear();
+          for (auto vfat = vfats.begin(); vfat != vfats.end(); ++vfat)
+            if (!((mask >> vfat->first) & 0x1))
+              queue.words.push_back((vfat->first << 8) | (readField(vfat->second) & 0xff));
+        }
+        *runningUntil = clock::now() + duration;
+      });
+    addWriteHook(reg->second.Address, [this, vfats, maskName, requestMask, runningUntil, duration](uint32_t const word) {
+        uint32_t const mask = maskName.empty() ? 0 : readField(maskName);
+        for (auto vfat = vfats.begin(); vfat != vfats.end(); ++vfat)
+          if (!((mask >> vfat->first) & 0x1))
+            writeField(vfat->second, getField(word, requestMask));
+        *runningUntil = clock::now() + duration;
+      });
+
+    // the nodes shared by all the registers of the block get their hooks once
+    if (running && !m_readHooks.count(running->Address)) {
+      uint32_t const mask = running->Mask;
+      addReadHook(running->Address, [mask, runningUntil](uint32_t const word) {
+          return setField(word, mask, clock::now() < *runningUntil ? 0x1 : 0x0);
+        });
+    }
+    if (reset && !m_writeHooks.count(reset->Address)) {
+      uint32_t const mask = reset->Mask;
+      addWriteHook(reset->Address, [this, mask, results, resultsAddress, runningUntil](uint32_t const word) {
+          if (!getField(word, mask))
+            return;
+          if (results)
+            m_queues.at(resultsAddress).words.clear();
+          *runningUntil = clock::time_point();
+        });
+    }
+  }
+}
+
+void gem::hw::emulator::EmulatorBoard::addScans()
+{
+  for (auto reg = m_registers.begin(); reg != m_registers.end(); ++reg) {
+    std::string const name = upper(reg->first);
+    if (!contains(name, ".SCANCONTROLLER.") || !endsWith(name, ".START") || reg->second.Mode != uhal::defs::SINGLE)
+      continue;
+    std::string const base = parentOf(reg->first);
+    GEMHwAddressTable::Register const* status = findRegister(base+".MONITOR.STATUS");
+    GEMHwAddressTable::Register const* reset  = findRegister(base+".RESET");
+
+    // THLAT has one RESULTS FIFO, ULTRA one per VFAT
+    std::vector<uint32_t> results;
+    GEMHwAddressTable::Register const* single = findRegister(base+".RESULTS");
+    if (single && single->Mode != uhal::defs::HIERARCHICAL) {
+      results.push_back(single->Address);
+    } else {
+      for (uint32_t vfat = 0; vfat < 24; ++vfat) {
+        std::stringstream vfatName;
+        vfatName << base << ".RESULTS.VFAT" << vfat;
+        GEMHwAddressTable::Register const* result = findRegister(vfatName.str());
+        if (result)
+          results.push_back(result->Address);
+      }
+    }
+    for (auto result = results.begin(); result != results.end(); ++result)
+      getQueue(*result, false);
+
+    std::shared_ptr<clock::time_point> runningUntil = std::make_shared<clock::time_point>();
+    clock::duration const duration = std::chrono::milliseconds(m_settings.ScanMsec);
+    uint32_t const startMask = reg->second.Mask;
+    addWriteHook(reg->second.Address, [this, base, results, startMask, runningUntil, duration](uint32_t const word) {
+        if (!getField(word, startMask))
+          return;
+        uint32_t const min    = findRegister(base+".CONF.MIN")    ? readField(base+".CONF.MIN")    : 0;
+        uint32_t const max    = findRegister(base+".CONF.MAX")    ? readField(base+".CONF.MAX")    : 0;
+        uint32_t const ntrigs = findRegister(base+".CONF.NTRIGS") ? readField(base+".CONF.NTRIGS") : 0;
+        uint32_t step         = findRegister(base+".CONF.STEP")   ? readField(base+".CONF.STEP")   : 1;
+        step = std::max(step, 1U);
+        double const width = std::max(1., (static_cast<double>(max) - min)/10.);
+        for (size_t i = 0; i < results.size(); ++i) {
+          // each VFAT gets its own threshold around the middle of the range
+          double const middle = (static_cast<double>(min) + max)/2. + static_cast<double>(i % 5) - 2.;
+          Queue& queue = m_queues.at(results.at(i));
+          queue.words.clear();
+          for (uint32_t point = min; point <= max; point += step) {
+            uint32_t const hits = static_cast<uint32_t>(ntrigs/(1. + std::exp((point - middle)/width)));
+            queue.words.push_back(((point & 0xff) << 24) | (hits & 0xffffff));
+          }
+        }
+        *runningUntil = clock::now() + duration;
+      });
+    if (status) {
+      uint32_t const mask = status->Mask;
+      addReadHook(status->Address, [mask, runningUntil](uint32_t const word) {
+          return setField(word, mask, clock::now() < *runningUntil ? 0x1 : 0x0);
+        });
+    }
+    if (reset) {
+      uint32_t const mask = reset->Mask;
+      addWriteHook(reset->Address, [this, mask, results, runningUntil](uint32_t const word) {
+          if (!getField(word, mask))
+            return;
+          for (auto result = results.begin(); result != results.end(); ++result)
+            m_queues.at(*result).words.clear();
+          *runningUntil = clock::time_point();
+        });
+    }
+  }
+}
+
+gem::hw::GEMHwAddressTable::Register const* gem::hw::emulator::EmulatorBoard::findRegister(std::string const& regName) const
+{
+  auto reg = m_registers.find(regName);
+  return (reg == m_registers.end()) ? nullptr : &(reg->second);
+}
+
+std::vector<std::string> gem::hw::emulator::EmulatorBoard::getChildren(std::string const& parent) const
+{
+  std::string const prefix = parent.empty() ? "" : parent + ".";
+  std::vector<std::string> children;
+  for (auto reg = m_registers.begin(); reg != m_registers.end(); ++reg) {
+    if (reg->first.compare(0, prefix.size(), prefix) != 0)
+      continue;
+    std::string const child = reg->first.substr(prefix.size());
+    if (!child.empty() && !contains(child, "."))
+      children.push_back(child);
+  }
+  return children;
+}
+
+gem::hw::emulator::EmulatorBoard::Queue& gem::hw::emulator::EmulatorBoard::getQueue(uint32_t const address,
+                                                                                bool const synthetic)
+{
+  Queue& queue = m_queues[address];
+  queue.synthetic = synthetic;
+  queue.lastFill  = clock::now();
+  return queue;
+}
+
+void gem::hw::emulator::EmulatorBoard::fill(uint32_t const address, Queue& queue)
+{
+  if (!queue.synthetic)
+    return;
+  clock::time_point const now = clock::now();
+  if (queue.words.size() >= m_settings.FIFODepth || m_settings.FIFORate <= 0.) {
+    queue.lastFill = now;
+    return;
+  }
+  double const seconds = std::chrono::duration<double>(now - queue.lastFill).count();
+  uint64_t const nWords = static_cast<uint64_t>(m_settings.FIFORate*seconds);
+  if (nWords == 0)
+    return;
+  // the fraction of a word not produced yet is kept for the next fill
+  queue.lastFill += std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(nWords/m_settings.FIFORate));
+  uint64_t const room = m_settings.FIFODepth - queue.words.size();
+  for (uint64_t i = 0; i < std::min(nWords, room); ++i)
+    queue.words.push_back(m_settings.DataSource(address, queue.produced++));
+}
+
+bool gem::hw::emulator::EmulatorBoard::read(uint32_t const address, uint32_t& value)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return readLocked(address, value);
+}
+
+bool gem::hw::emulator::EmulatorBoard::write(uint32_t const address, uint32_t const value)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return writeLocked(address, value);
+}
+
+bool gem::hw::emulator::EmulatorBoard::rmwBits(uint32_t const address, uint32_t const andTerm, uint32_t const orTerm,
+                                               uint32_t& previous)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  if (!readLocked(address, previous))
+    return false;
+  return writeLocked(address, (previous & andTerm) | orTerm);
+}
+
+bool gem::hw::emulator::EmulatorBoard::rmwSum(uint32_t const address, uint32_t const addend, uint32_t& previous)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  if (!readLocked(address, previous))
+    return false;
+  return writeLocked(address, previous + addend);
+}
+
+bool gem::hw::emulator::EmulatorBoard::readLocked(uint32_t const address, uint32_t& value)
+{
+  auto word = m_words.find(address);
+  if (word == m_words.end() || !word->second.readMask)
+    return false;
+
+  auto queue = m_queues.find(address);
+  if (word->second.port && queue != m_queues.end()) {
+    fill(address, queue->second);
+    value = 0x0;
+    if (!queue->second.words.empty()) {
+      value = queue->second.words.front();
+      queue->second.words.pop_front();
+    }
+    return true;
+  }
+
+  auto actions = m_readActions.find(address);
+  if (actions != m_readActions.end())
+    for (auto action = actions->second.begin(); action != actions->second.end(); ++action)
+      (*action)(word->second.value);
+  value = readWord(address) & word->second.readMask;
+  return true;
+}
+
+bool gem::hw::emulator::EmulatorBoard::writeLocked(uint32_t const address, uint32_t const value)
+{
+  auto word = m_words.find(address);
+  if (word == m_words.end() || !word->second.writeMask)
+    return false;
+
+  // a write-only port is a FIFO of the firmware, the words are consumed
+  if (!(word->second.port && !word->second.readMask))
+    writeWord(address, (word->second.value & ~word->second.writeMask) | (value & word->second.writeMask));
+
+  auto hooks = m_writeHooks.find(address);
+  if (hooks != m_writeHooks.end())
+    for (auto hook = hooks->second.begin(); hook != hooks->second.end(); ++hook)
+      (*hook)(value);
+  return true;
+}
+
+uint32_t gem::hw::emulator::EmulatorBoard::readWord(uint32_t const address)
+{
+  uint32_t value = m_words.at(address).value;
+  auto counters = m_counterIndex.find(address);
+  if (counters != m_counterIndex.end()) {
+    clock::time_point const now = clock::now();
+    for (auto i = counters->second.begin(); i != counters->second.end(); ++i) {
+      Counter const& counter = m_counters.at(*i);
+      value = setField(value, counter.mask, static_cast<uint32_t>(counter.count(now) >> counter.shift));
+    }
+  }
+  auto hooks = m_readHooks.find(address);
+  if (hooks != m_readHooks.end())
+    for (auto hook = hooks->second.begin(); hook != hooks->second.end(); ++hook)
+      value = (*hook)(value);
+  return value;
+}
+
+void gem::hw::emulator::EmulatorBoard::writeWord(uint32_t const address, uint32_t const value)
+{
+  m_words.at(address).value = value;
+}
+
+uint32_t gem::hw::emulator::EmulatorBoard::readField(std::string const& regName)
+{
+  GEMHwAddressTable::Register const* reg = findRegister(regName);
+  if (!reg || !m_words.count(reg->Address)) {
+    std::string msg = "EmulatorBoard " + m_name + ": no register " + regName;
+    XCEPT_RAISE(gem::hw::exception::ConfigurationProblem, msg);
+  }
+  auto queue = m_queues.find(reg->Address);
+  if (m_words.at(reg->Address).port && queue != m_queues.end()) {
+    fill(reg->Address, queue->second);
+    return queue->second.words.empty() ? 0x0 : queue->second.words.front();
+  }
+  return getField(readWord(reg->Address), reg->Mask);
+}
+
+void gem::hw::emulator::EmulatorBoard::writeField(std::string const& regName, uint32_t const value)
+{
+  GEMHwAddressTable::Register const* reg = findRegister(regName);
+  if (!reg || !m_words.count(reg->Address)) {
+    std::string msg = "EmulatorBoard " + m_name + ": no register " + regName;
+    XCEPT_RAISE(gem::hw::exception::ConfigurationProblem, msg);
+  }
+  Word& word = m_words.at(reg->Address);
+  word.value = setField(word.value, reg->Mask, value);
+
+  auto counters = m_counterIndex.find(reg->Address);
+  if (counters != m_counterIndex.end()) {
+    for (auto i = counters->second.begin(); i != counters->second.end(); ++i) {
+      Counter& counter = m_counters.at(*i);
+      if (counter.mask != reg->Mask)
+        continue;
+      counter.base  = static_cast<uint64_t>(value) << counter.shift;
+      counter.start = clock::now();
+    }
+  }
+}
+
+uint32_t gem::hw::emulator::EmulatorBoard::getAddress(std::string const& regName) const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  GEMHwAddressTable::Register const* reg = findRegister(regName);
+  if (!reg) {
+    std::string msg = "EmulatorBoard " + m_name + ": no register " + regName;
+    XCEPT_RAISE(gem::hw::exception::ConfigurationProblem, msg);
+  }
+  return reg->Address;
+}
+
+uint32_t gem::hw::emulator::EmulatorBoard::peek(std::string const& regName)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return readField(regName);
+}
+
+void gem::hw::emulator::EmulatorBoard::poke(std::string const& regName, uint32_t const value)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  writeField(regName, value);
+}
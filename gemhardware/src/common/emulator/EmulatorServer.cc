@@ -0,0 +1,458 @@
+/**
+ * class: EmulatorServer
+ * description: IPbus 2.0 UDP target serving emulated boards
+ */
+
+#include "gem/hw/emulator/EmulatorServer.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <sstream>
+
+#include "gem/hw/GEMHwAddressTable.h"
+#include "gem/hw/exception/Exception.h"
+
+namespace {
+  // IPbus 2.0 packet types
+  uint32_t const PACKET_CONTROL = 0x0;
+  uint32_t const PACKET_STATUS  = 0x1;
+  uint32_t const PACKET_RESEND  = 0x2;
+
+  // IPbus 2.0 transaction types
+  uint32_t const TRANS_READ      = 0x0;
+  uint32_t const TRANS_WRITE     = 0x1;
+  uint32_t const TRANS_NI_READ   = 0x2;
+  uint32_t const TRANS_NI_WRITE  = 0x3;
+  uint32_t const TRANS_RMW_BITS  = 0x4;
+  uint32_t const TRANS_RMW_SUM   = 0x5;
+
+  // IPbus 2.0 transaction info codes
+  uint32_t const INFO_SUCCESS     = 0x0;
+  uint32_t const INFO_BAD_HEADER  = 0x1;
+  uint32_t const INFO_READ_ERROR  = 0x4;
+  uint32_t const INFO_WRITE_ERROR = 0x5;
+  uint32_t const INFO_REQUEST     = 0xf;
+
+  size_t const HISTORY_SIZE = 4;  ///< packet headers kept for the status reply
+
+  uint32_t packetHeader(uint16_t const id, uint32_t const type)
+  {
+    return 0x200000f0 | (static_cast<uint32_t>(id) << 8) | type;
+  }
+
+  bool isPacketHeader(uint32_t const word)
+  {
+    return (word & 0xf00000f0) == 0x200000f0;
+  }
+
+  uint32_t replyHeader(uint32_t const request, uint32_t const nWords, uint32_t const info)
+  {
+    return (request & 0xffff00f0) | ((nWords & 0xff) << 8) | info;
+  }
+
+  void remember(std::deque<uint32_t>& history, uint32_t const header)
+  {
+    history.push_back(header);
+    if (history.size() > HISTORY_SIZE)
+      history.pop_front();
+  }
+}
+
+const size_t   gem::hw::emulator::EmulatorServer::MAX_PACKET_BYTES;
+const uint32_t gem::hw::emulator::EmulatorServer::N_REPLY_BUFFERS;
+
+gem::hw::emulator::EmulatorServer::Settings::Settings() :
+  LatencyUsec(0),
+  JitterUsec(0),
+  RequestLossRate(0.),
+  ReplyLossRate(0.),
+  BusErrorRate(0.),
+  Seed(0)
+{
+}
+
+gem::hw::emulator::EmulatorServer::EmulatorServer(Settings const& settings) :
+  m_settings(settings),
+  m_gemLogger(log4cplus::Logger::getInstance("EmulatorServer")),
+  m_random(settings.Seed),
+  m_running(false)
+{
+}
+
+gem::hw::emulator::EmulatorServer::~EmulatorServer()
+{
+  stop();
+  std::lock_guard<std::mutex> guard(m_mutex);
+  for (auto endpoint = m_endpoints.begin(); endpoint != m_endpoints.end(); ++endpoint)
+    ::close(endpoint->second.socket);
+}
+
+void gem::hw::emulator::EmulatorServer::addBoard(uint16_t const port, std::shared_ptr<EmulatorBoard> board)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  if (m_endpoints.count(port)) {
+    std::stringstream msg;
+    msg << "EmulatorServer::addBoard port " << port << " already serves "
+        << m_endpoints.at(port).board->getName();
+    XCEPT_RAISE(gem::hw::exception::ConfigurationProblem, msg.str());
+  }
+
+  int const sock = ::socket(AF_INET, SOCK_DGRAM, 0);
+  if (sock < 0) {
+    std::string msg = "EmulatorServer::addBoard unable to create a socket: " + std::string(std::strerror(errno));
+    XCEPT_RAISE(gem::hw::exception::ConfigurationProblem, msg);
+  }
+  int const reuse = 1;
+  ::setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  struct sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family      = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port        = htons(port);
+  if (::bind(sock, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0) {
+    std::stringstream msg;
+    msg << "EmulatorServer::addBoard unable to bind port " << port << ": " << std::strerror(errno);
+    ::close(sock);
+    XCEPT_RAISE(gem::hw::exception::ConfigurationProblem, msg.str());
+  }
+
+  Endpoint& endpoint = m_endpoints[port];
+  endpoint.port   = port;
+  endpoint.socket = sock;
+  endpoint.board  = board;
+  if (m_running)
+    endpoint.server = std::thread(&EmulatorServer::serve, this, std::ref(endpoint));
+  CMSGEMOS_INFO("EmulatorServer::addBoard " << board->getName() << " on port " << port
+                << ", " << board->size() << " words");
+}
+
+std::vector<uint16_t> gem::hw::emulator::EmulatorServer::addBoards(std::string const& connectionFile,
+                                                                  EmulatorBoard::Settings const& settings)
+{
+  std::string const uri = (connectionFile.find("://") == std::string::npos) ?
+    "file://" + connectionFile : connectionFile;
+  uhal::ConnectionManager manager(uri);
+
+  // the devices behind the same port, e.g., an AMC and its OptoHybrids, are one board
+  std::map<uint16_t, std::shared_ptr<EmulatorBoard> > boards;
+  std::vector<std::string> const devices = manager.getDevices();
+  for (auto device = devices.begin(); device != devices.end(); ++device) {
+    uhal::HwInterface hw = manager.getDevice(*device);
+    uint16_t const port  = getPort(hw.uri());
+    if (port == 0) {
+      std::string msg = "EmulatorServer::addBoards no port in " + hw.uri() + " of " + *device;
+      XCEPT_RAISE(gem::hw::exception::ConfigurationProblem, msg);
+    }
+
+    std::shared_ptr<EmulatorBoard> board = getBoard(port);
+    if (!board) {
+      std::shared_ptr<EmulatorBoard>& newBoard = boards[port];
+      if (!newBoard)
+        newBoard = std::make_shared<EmulatorBoard>(*device, settings);
+      board = newBoard;
+    }
+    board->addAddressTable(GEMHwAddressTable(hw));
+    CMSGEMOS_DEBUG("EmulatorServer::addBoards " << *device << " (" << hw.uri() << ") on port " << port);
+  }
+
+  std::vector<uint16_t> ports;
+  for (auto board = boards.begin(); board != boards.end(); ++board) {
+    addBoard(board->first, board->second);
+    ports.push_back(board->first);
+  }
+  return ports;
+}
+
+std::shared_ptr<gem::hw::emulator::EmulatorBoard> gem::hw::emulator::EmulatorServer::getBoard(uint16_t const port) const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  auto endpoint = m_endpoints.find(port);
+  return (endpoint == m_endpoints.end()) ? nullptr : endpoint->second.board;
+}
+
+uint16_t gem::hw::emulator::EmulatorServer::getPort(std::string const& uri)
+{
+  // chtcp-2.0://host:10203?target=amc-s2g01:50001 is served on the port of the target
+  std::string address = uri;
+  size_t const target = address.find("target=");
+  if (target != std::string::npos) {
+    address = address.substr(target + std::string("target=").size());
+  } else {
+    size_t const protocol = address.find("://");
+    if (protocol != std::string::npos)
+      address = address.substr(protocol + 3);
+  }
+  address = address.substr(0, address.find_first_of("/?&"));
+
+  size_t const colon = address.rfind(':');
+  if (colon == std::string::npos)
+    return 0;
+  unsigned long const port = std::strtoul(address.c_str() + colon + 1, NULL, 10);
+  return (port > 0xffff) ? 0 : static_cast<uint16_t>(port);
+}
+
+void gem::hw::emulator::EmulatorServer::start()
+{
+  if (m_running)
+    return;
+  try {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_running = true;
+    for (auto endpoint = m_endpoints.begin(); endpoint != m_endpoints.end(); ++endpoint)
+      endpoint->second.server = std::thread(&EmulatorServer::serve, this, std::ref(endpoint->second));
+    CMSGEMOS_INFO("EmulatorServer::start serving " << m_endpoints.size() << " boards");
+  } catch (...) {
+    stop();
+    throw;
+  }
+}
+
+void gem::hw::emulator::EmulatorServer::stop()
+{
+  m_running = false;
+  // the serving threads take m_mutex, they are joined without it
+  std::vector<std::thread> servers;
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    for (auto endpoint = m_endpoints.begin(); endpoint != m_endpoints.end(); ++endpoint)
+      if (endpoint->second.server.joinable())
+        servers.push_back(std::move(endpoint->second.server));
+  }
+  for (auto server = servers.begin(); server != servers.end(); ++server)
+    server->join();
+}
+
+gem::hw::emulator::EmulatorServer::Statistics gem::hw::emulator::EmulatorServer::getStatistics() const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_statistics;
+}
+
+void gem::hw::emulator::EmulatorServer::serve(Endpoint& endpoint)
+{
+  std::vector<uint8_t> buffer(MAX_PACKET_BYTES*2);
+  struct pollfd fd;
+  fd.fd     = endpoint.socket;
+  fd.events = POLLIN;
+  while (m_running) {
+    fd.revents = 0;
+    // wake up regularly to notice stop()
+    if (::poll(&fd, 1, 100) <= 0 || !(fd.revents & POLLIN))
+      continue;
+
+    struct sockaddr_in from;
+    socklen_t fromLength = sizeof(from);
+    ssize_t const nBytes = ::recvfrom(fd.fd, buffer.data(), buffer.size(), 0,
+                                      reinterpret_cast<struct sockaddr*>(&from), &fromLength);
+    if (nBytes < 4 || nBytes % 4)
+      continue;
+
+    std::vector<uint32_t> request(nBytes/4);
+    std::memcpy(request.data(), buffer.data(), nBytes);
+    // the byte order qualifier of the packet header tells the byte order of the whole packet
+    bool const swapped = !isPacketHeader(request.front());
+    if (swapped)
+      for (auto word = request.begin(); word != request.end(); ++word)
+        *word = __builtin_bswap32(*word);
+    if (!isPacketHeader(request.front()))
+      continue;
+
+    std::vector<uint32_t> reply;
+    uint32_t delayUsec = m_settings.LatencyUsec;
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      ++m_statistics.Requests;
+      if (chance(m_settings.RequestLossRate)) {
+        ++m_statistics.Dropped;
+        continue;
+      }
+      handle(endpoint, request, reply);
+      if (reply.empty())
+        continue;
+      // a lost reply is still in the history, the client can ask for it again
+      if (chance(m_settings.ReplyLossRate)) {
+        ++m_statistics.Dropped;
+        continue;
+      }
+      if (m_settings.JitterUsec)
+        delayUsec += std::uniform_int_distribution<uint32_t>(0, m_settings.JitterUsec)(m_random);
+      ++m_statistics.Replies;
+    }
+
+    // only the board of this thread waits
+    if (delayUsec)
+      std::this_thread::sleep_for(std::chrono::microseconds(delayUsec));
+    if (swapped)
+      for (auto word = reply.begin(); word != reply.end(); ++word)
+        *word = __builtin_bswap32(*word);
+    if (::sendto(fd.fd, reply.data(), reply.size()*4, 0,
+                 reinterpret_cast<struct sockaddr*>(&from), fromLength) < 0)
+      CMSGEMOS_WARN("EmulatorServer::serve port " << endpoint.port << " unable to reply: "
+                    << std::strerror(errno));
+  }
+}
+
+void gem::hw::emulator::EmulatorServer::handle(Endpoint& endpoint, std::vector<uint32_t> const& request,
+                                               std::vector<uint32_t>& reply)
+{
+  uint32_t const header = request.front();
+  uint16_t const id     = (header >> 8) & 0xffff;
+  switch (header & 0xf) {
+  case PACKET_STATUS:
+    handleStatus(endpoint, reply);
+    break;
+  case PACKET_RESEND:
+    {
+      auto previous = endpoint.replies.find(id);
+      if (previous != endpoint.replies.end()) {
+        reply = previous->second;
+        ++m_statistics.Resent;
+      }
+    }
+    break;
+  case PACKET_CONTROL:
+    handleControl(endpoint, request, reply);
+    break;
+  default:
+    CMSGEMOS_DEBUG("EmulatorServer::handle unknown packet type in header 0x" << std::hex << header << std::dec);
+    break;
+  }
+}
+
+void gem::hw::emulator::EmulatorServer::handleControl(Endpoint& endpoint, std::vector<uint32_t> const& request,
+                                                      std::vector<uint32_t>& reply)
+{
+  uint32_t const header = request.front();
+  uint16_t const id     = (header >> 8) & 0xffff;
+  // packet ID 0 is not checked nor kept, any other must be the next one
+  if (id != 0 && id != endpoint.nextId) {
+    ++m_statistics.OutOfSequence;
+    CMSGEMOS_DEBUG("EmulatorServer::handleControl port " << endpoint.port << ": packet " << id
+                   << " out of sequence, expected " << endpoint.nextId);
+    return;
+  }
+
+  reply.push_back(header);
+  size_t pos = 1;
+  while (pos < request.size() && transaction(*(endpoint.board), request, pos, reply)) {}
+
+  remember(endpoint.received, header);
+  remember(endpoint.sent, header);
+  if (id == 0)
+    return;
+  endpoint.nextId = (id == 0xffff) ? 1 : id + 1;
+  endpoint.replies[id] = reply;
+  endpoint.replyOrder.push_back(id);
+  if (endpoint.replyOrder.size() > N_REPLY_BUFFERS) {
+    endpoint.replies.erase(endpoint.replyOrder.front());
+    endpoint.replyOrder.pop_front();
+  }
+}
+
+void gem::hw::emulator::EmulatorServer::handleStatus(Endpoint& endpoint, std::vector<uint32_t>& reply) const
+{
+  reply.assign(16, 0x0);
+  reply.at(0) = packetHeader(0, PACKET_STATUS);
+  reply.at(1) = MAX_PACKET_BYTES;
+  reply.at(2) = N_REPLY_BUFFERS;
+  reply.at(3) = packetHeader(endpoint.nextId, PACKET_CONTROL);
+  // words 4 to 7 are the traffic history, not recorded
+  for (size_t i = 0; i < endpoint.received.size(); ++i)
+    reply.at(8+i) = endpoint.received.at(endpoint.received.size()-1-i);
+  for (size_t i = 0; i < endpoint.sent.size(); ++i)
+    reply.at(12+i) = endpoint.sent.at(endpoint.sent.size()-1-i);
+}
+
+bool gem::hw::emulator::EmulatorServer::transaction(EmulatorBoard& board, std::vector<uint32_t> const& request,
+                                                    size_t& pos, std::vector<uint32_t>& reply)
+{
+  uint32_t const header = request.at(pos);
+  uint32_t const nWords = (header >> 8) & 0xff;
+  uint32_t const type   = (header >> 4) & 0xf;
+  if ((header >> 28) != 0x2 || (header & 0xf) != INFO_REQUEST || pos + 1 >= request.size()) {
+    reply.push_back(replyHeader(header, 0, INFO_BAD_HEADER));
+    return false;
+  }
+  uint32_t const address = request.at(pos+1);
+  bool const busError    = chance(m_settings.BusErrorRate);
+
+  switch (type) {
+  case TRANS_READ:
+  case TRANS_NI_READ:
+    {
+      size_t const headerPos = reply.size();
+      reply.push_back(replyHeader(header, nWords, INFO_SUCCESS));
+      for (uint32_t i = 0; i < nWords; ++i) {
+        uint32_t value = 0;
+        if (busError || !board.read((type == TRANS_READ) ? address + i : address, value)) {
+          // the words read before the error are returned
+          reply.at(headerPos) = replyHeader(header, i, INFO_READ_ERROR);
+          ++m_statistics.BusErrors;
+          return false;
+        }
+        reply.push_back(value);
+      }
+      pos += 2;
+    }
+    return true;
+  case TRANS_WRITE:
+  case TRANS_NI_WRITE:
+    if (pos + 2 + nWords > request.size()) {
+      reply.push_back(replyHeader(header, 0, INFO_BAD_HEADER));
+      return false;
+    }
+    for (uint32_t i = 0; i < nWords; ++i) {
+      if (busError || !board.write((type == TRANS_WRITE) ? address + i : address, request.at(pos+2+i))) {
+        reply.push_back(replyHeader(header, i, INFO_WRITE_ERROR));
+        ++m_statistics.BusErrors;
+        return false;
+      }
+    }
+    reply.push_back(replyHeader(header, nWords, INFO_SUCCESS));
+    pos += 2 + nWords;
+    return true;
+  case TRANS_RMW_BITS:
+  case TRANS_RMW_SUM:
+    {
+      size_t const length = (type == TRANS_RMW_BITS) ? 4 : 3;
+      if (pos + length > request.size()) {
+        reply.push_back(replyHeader(header, 0, INFO_BAD_HEADER));
+        return false;
+      }
+      uint32_t previous = 0;
+      bool const done = !busError && ((type == TRANS_RMW_BITS) ?
+                                      board.rmwBits(address, request.at(pos+2), request.at(pos+3), previous) :
+                                      board.rmwSum(address, request.at(pos+2), previous));
+      if (!done) {
+        reply.push_back(replyHeader(header, 0, INFO_WRITE_ERROR));
+        ++m_statistics.BusErrors;
+        return false;
+      }
+      reply.push_back(replyHeader(header, 1, INFO_SUCCESS));
+      reply.push_back(previous);
+      pos += length;
+    }
+    return true;
+  default:
+    // the configuration space of the firmware is not emulated
+    reply.push_back(replyHeader(header, 0, INFO_BAD_HEADER));
+    return false;
+  }
+}
+
+bool gem::hw::emulator::EmulatorServer::chance(double const rate)
+{
+  if (rate <= 0.)
+    return false;
+  return std::uniform_real_distribution<double>(0., 1.)(m_random) < rate;
+}
@@ -0,0 +1,125 @@
+/**
+ * executable: gem_hw_emulator
+ * description: Serve the boards of a uhal connection file from emulated registers
+ */
+
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+
+#include "log4cplus/configurator.h"
+#include "uhal/uhal.hpp"
+
+#include "gem/hw/emulator/EmulatorServer.h"
+#include "gem/hw/exception/Exception.h"
+
+namespace {
+  volatile sig_atomic_t stopRequested = 0;
+
+  void requestStop(int)
+  {
+    stopRequested = 1;
+  }
+
+  void usage(char const* name)
+  {
+    std::cerr << "Usage: " << name << " [options] <connection file>" << std::endl
+              << "Serves every device of the connection file on the port of its URI, e.g.," << std::endl
+              << "ipbusudp-2.0://localhost:50001, devices on the same port share one board." << std::endl
+              << "  --latency <us>        time added before every reply" << std::endl
+              << "  --jitter <us>         maximum random time added on top of the latency" << std::endl
+              << "  --request-loss <f>    fraction of the requests dropped" << std::endl
+              << "  --reply-loss <f>      fraction of the replies dropped" << std::endl
+              << "  --bus-errors <f>      fraction of the transactions failing with a bus error" << std::endl
+              << "  --counter-rate <Hz>   rate of the counters" << std::endl
+              << "  --error-rate <Hz>     rate of the error counters" << std::endl
+              << "  --fifo-rate <words/s> rate at which the FIFOs fill" << std::endl
+              << "  --fifo-depth <words>  depth of the FIFOs" << std::endl
+              << "  --seed <n>            seed of the losses and errors" << std::endl;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  gem::hw::emulator::EmulatorServer::Settings link;
+  gem::hw::emulator::EmulatorBoard::Settings  board;
+
+  static struct option const options[] = {
+    {"latency",      required_argument, NULL, 'l'},
+    {"jitter",       required_argument, NULL, 'j'},
+    {"request-loss", required_argument, NULL, 'q'},
+    {"reply-loss",   required_argument, NULL, 'r'},
+    {"bus-errors",   required_argument, NULL, 'b'},
+    {"counter-rate", required_argument, NULL, 'c'},
+    {"error-rate",   required_argument, NULL, 'e'},
+    {"fifo-rate",    required_argument, NULL, 'f'},
+    {"fifo-depth",   required_argument, NULL, 'd'},
+    {"seed",         required_argument, NULL, 's'},
+    {"help",         no_argument,       NULL, 'h'},
+    {NULL, 0, NULL, 0}
+  };
+
+  int option;
+  while ((option = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+    switch (option) {
+    case 'l': link.LatencyUsec       = std::strtoul(optarg, NULL, 10); break;
+    case 'j': link.JitterUsec        = std::strtoul(optarg, NULL, 10); break;
+    case 'q': link.RequestLossRate   = std::strtod(optarg, NULL);      break;
+    case 'r': link.ReplyLossRate     = std::strtod(optarg, NULL);      break;
+    case 'b': link.BusErrorRate      = std::strtod(optarg, NULL);      break;
+    case 's': link.Seed              = std::strtoul(optarg, NULL, 10); break;
+    case 'c': board.CounterRate      = std::strtod(optarg, NULL);      break;
+    case 'e': board.ErrorCounterRate = std::strtod(optarg, NULL);      break;
+    case 'f': board.FIFORate         = std::strtod(optarg, NULL);      break;
+    case 'd': board.FIFODepth        = std::strtoul(optarg, NULL, 10); break;
+    case 'h':
+      usage(argv[0]);
+      return 0;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  log4cplus::BasicConfigurator::doConfigure();
+  signal(SIGINT,  requestStop);
+  signal(SIGTERM, requestStop);
+
+  gem::hw::emulator::EmulatorServer server(link);
+  try {
+    std::vector<uint16_t> const ports = server.addBoards(argv[optind], board);
+    std::cout << "Serving " << ports.size() << " boards from " << argv[optind] << std::endl;
+    server.start();
+  } catch (gem::hw::exception::ConfigurationProblem const& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  } catch (uhal::exception::exception const& e) {
+    // e.g., a connection file or address table that cannot be parsed
+    std::cerr << "Unable to load " << argv[optind] << ": " << e.what() << std::endl;
+    return 1;
+  } catch (std::exception const& e) {
+    std::cerr << "Unable to serve " << argv[optind] << ": " << e.what() << std::endl;
+    return 1;
+  }
+
+  while (!stopRequested)
+    ::usleep(100000);
+  server.stop();
+
+  gem::hw::emulator::EmulatorServer::Statistics const stats = server.getStatistics();
+  std::cout << "Requests "          << stats.Requests
+            << ", replies "         << stats.Replies
+            << ", dropped "         << stats.Dropped
+            << ", out of sequence " << stats.OutOfSequence
+            << ", resent "          << stats.Resent
+            << ", bus errors "      << stats.BusErrors << std::endl;
+  return 0;
+}
@@ -8,9 +8,11 @@
 
 #include "gem/hw/glib/GLIBManager.h"
 
+#include <ctime>
 #include <iterator>
 
 #include "gem/hw/glib/HwGLIB.h"
+#include "gem/hw/GEMHwConnectionRegistry.h"
 #include "gem/hw/glib/GLIBMonitor.h"
 #include "gem/hw/glib/GLIBManagerWeb.h"
 
@@ -57,7 +59,11 @@ gem::hw::glib::GLIBManager::GLIBManager(xdaq::ApplicationStub* stub) :
   m_amcEnableMask(0),
   m_uhalPhaseShift(false),
   m_bc0LockPhaseShift(false),
-  m_relockPhase(true)
+  m_relockPhase(true),
+  m_useIOThread(false),
+  m_maxConfigureThreads(gem::hw::GEMHwTaskGroup::DEFAULT_MAX_WORKERS),
+  m_profileIPbus(false),
+  m_ipbusProfileDir("")
 {
   m_glibInfo.setSize(MAX_AMCS_PER_CRATE);
 
@@ -67,6 +73,10 @@ gem::hw::glib::GLIBManager::GLIBManager(xdaq::ApplicationStub* stub) :
   p_appInfoSpace->fireItemAvailable("UHALPhaseShift",    &m_uhalPhaseShift);
   p_appInfoSpace->fireItemAvailable("BC0LockPhaseShift", &m_bc0LockPhaseShift);
   p_appInfoSpace->fireItemAvailable("RelockPhase",       &m_relockPhase);
+  p_appInfoSpace->fireItemAvailable("UseIOThread",       &m_useIOThread);
+  p_appInfoSpace->fireItemAvailable("MaxConfigureThreads", &m_maxConfigureThreads);
+  p_appInfoSpace->fireItemAvailable("ProfileIPbus",      &m_profileIPbus);
+  p_appInfoSpace->fireItemAvailable("IPbusProfileDir",   &m_ipbusProfileDir);
 
   p_appInfoSpace->addItemRetrieveListener("AllGLIBsInfo",      this);
   p_appInfoSpace->addItemRetrieveListener("AMCSlots",          this);
@@ -74,6 +84,10 @@ gem::hw::glib::GLIBManager::GLIBManager(xdaq::ApplicationStub* stub) :
   p_appInfoSpace->addItemRetrieveListener("UHALPhaseShift",    this);
   p_appInfoSpace->addItemRetrieveListener("BC0LockPhaseShift", this);
   p_appInfoSpace->addItemRetrieveListener("RelockPhase",       this);
+  p_appInfoSpace->addItemRetrieveListener("UseIOThread",       this);
+  p_appInfoSpace->addItemRetrieveListener("MaxConfigureThreads", this);
+  p_appInfoSpace->addItemRetrieveListener("ProfileIPbus",      this);
+  p_appInfoSpace->addItemRetrieveListener("IPbusProfileDir",   this);
   p_appInfoSpace->addItemChangedListener( "AllGLIBsInfo",      this);
   p_appInfoSpace->addItemChangedListener( "AMCSlots",          this);
   p_appInfoSpace->addItemChangedListener( "ConnectionFile",    this);
@@ -82,6 +96,9 @@ gem::hw::glib::GLIBManager::GLIBManager(xdaq::ApplicationStub* stub) :
   p_appInfoSpace->addItemChangedListener( "RelockPhase",       this);
 
   xgi::bind(this, &GLIBManager::dumpGLIBFIFO, "dumpGLIBFIFO");
+  xgi::bind(this, &GLIBManager::dumpIPbusProfiles, "dumpIPbusProfiles");
+  xgi::bind(this, &GLIBManager::triggerRates, "triggerRates");
+  xgi::bind(this, &GLIBManager::linkHealth, "linkHealth");
 
   // initialize the GLIB application objects
   CMSGEMOS_DEBUG("GLIBManager::Connecting to the GLIBManagerWeb interface");
@@ -179,6 +196,7 @@ void gem::hw::glib::GLIBManager::initializeAction()
   throw (gem::hw::glib::exception::Exception)
 {
   CMSGEMOS_DEBUG("GLIBManager::initializeAction begin");
+  gem::hw::GEMHwProfiler::CallerScope profilerScope("GLIBManager::initializeAction");
   // FIXME make me more streamlined
   for (unsigned slot = 0; slot < MAX_AMCS_PER_CRATE; ++slot) {
     CMSGEMOS_DEBUG("GLIBManager::looping over slots(" << (slot+1) << ") and finding expected cards");
@@ -239,6 +257,10 @@ void gem::hw::glib::GLIBManager::initializeAction()
       CMSGEMOS_DEBUG("GLIBManager::obtaining pointer to HwGLIB");
       m_glibs.at(slot) = glib_shared_ptr(new gem::hw::glib::HwGLIB(deviceName, m_connectionFile.toString()));
       glib_shared_ptr amc = m_glibs.at(slot);
+      if (m_profileIPbus.value_)
+        amc->enableProfiler();
+      if (m_useIOThread.value_)
+        amc->startExecutor();
       if (amc->isHwConnected()) {
         CMSGEMOS_DEBUG("GLIBManager::Creating InfoSpace items for GLIB device " << deviceName);
 
@@ -247,6 +269,8 @@ void gem::hw::glib::GLIBManager::initializeAction()
 
         // maybe better to raise exception here and fail if not connected, as we expected the card to be here?
         createGLIBInfoSpaceItems(is_glibs.at(slot), amc);
+        m_triggerRates.addAMC(slot+1, amc);
+        m_linkHealth.addAMC(slot+1, amc, (0x1 << amc->getSupportedOptoHybrids()) - 1);
 
         if (!m_disableMonitoring) {
           m_glibMonitors.at(slot) = std::shared_ptr<GLIBMonitor>(new GLIBMonitor(amc, this, slot+1));
@@ -317,6 +341,20 @@ void gem::hw::glib::GLIBManager::configureAction()
 {
   CMSGEMOS_DEBUG("GLIBManager::configureAction");
 
+  // all the AMCs must be connected before any monitor is paused, so that an error leaves none paused
+  for (unsigned slot = 0; slot < MAX_AMCS_PER_CRATE; ++slot) {
+    if (!m_glibInfo[slot].bag.present || m_glibs.at(slot)->isHwConnected())
+      continue;
+    std::stringstream msg;
+    msg << "GLIBManager::configureAction GLIB in slot " << (slot+1) << " is not connected";
+    CMSGEMOS_ERROR(msg.str());
+    // fireEvent("Fail");
+    XCEPT_RAISE(gem::hw::glib::exception::Exception, msg.str());
+  }
+
+  // the AMCs are independent, they are configured concurrently
+  gem::hw::GEMHwTaskGroup slotTasks(m_maxConfigureThreads.value_);
+
   // FIXME make me more streamlined
   for (unsigned slot = 0; slot < MAX_AMCS_PER_CRATE; ++slot) {
     // usleep(10); // just for testing the timing of different applications
@@ -325,134 +363,151 @@ void gem::hw::glib::GLIBManager::configureAction()
     if (!info.present)
       continue;
 
-    glib_shared_ptr amc = m_glibs.at(slot);
-    if (amc->isHwConnected()) {
+    if (m_glibMonitors.at(slot))
+      m_glibMonitors.at(slot)->pauseMonitoring();
+
+    slotTasks.add(toolbox::toString("GLIB in slot %d", slot+1),
+                  toolbox::toString("%d", slot),
+                  [this, slot]() { configureSlot(slot); });
+  }
+
+  auto resumeMonitors = [this]() {
+    for (unsigned slot = 0; slot < MAX_AMCS_PER_CRATE; ++slot)
       if (m_glibMonitors.at(slot))
-        m_glibMonitors.at(slot)->pauseMonitoring();
+        m_glibMonitors.at(slot)->resumeMonitoring();
+  };
 
-      bool enableZS     = info.enableZS.value_;
-      bool doPhaseShift = m_uhalPhaseShift.value_;
-      uint32_t runType  = 0x0;
-      try { // FIXME if we fail, do we go to error?
-        // amc->ttcMMCMPhaseShift(m_relockPhase.value_, m_bc0LockPhaseShift.value_);
-        amc->configureDAQModule(enableZS, doPhaseShift, runType, 0xfaac, m_relockPhase.value_, m_bc0LockPhaseShift.value_);
-      } GEM_CATCH_RPC_ERROR("GLIBManager::configureAction", gem::hw::glib::exception::ConfigurationProblem);
-
-      // amc->scaHardResetEnable(false);
-      // amc->resetL1ACount();
-      // amc->resetCalPulseCount();
-
-      // if (m_uhalPhaseShift.value_) {
-      //   CMSGEMOS_INFO("GLIBManager::configureAction uhal phase shifting disabled");
-      //   try { // if we fail, do we go to error?
-      //     amc->ttcMMCMPhaseShift(m_relockPhase.value_, m_bc0LockPhaseShift.value_);
-      //   } GEM_CATCH_RPC_ERROR("GLIBManager::configureAction", gem::hw::glib::exception::PhaseShiftError);
-      // }
-
-      // // reset the DAQ (could move this to HwGenericAMC and eventually  a corresponding RPC module
-      // try { // FIXME if we fail, do we go to error?
-      //   amc->configure(info.enableZS.value_,0x0,0xfaac);
-      //   // amc->setL1AEnable(false);
-      //   // amc->disableDAQLink();
-      //   // amc->resetDAQLink();
-      //   // amc->enableDAQLink(0x4);  // FIXME
-      //   // amc->setZS(info.enableZS.value_);
-      //   // amc->setDAQLinkRunType(0x0);
-      //   // amc->setDAQLinkRunParameters(0xfaac);
-      // } GEM_CATCH_RPC_ERROR("GLIBManager::configureAction", gem::hw::glib::exception::ConfigurationProblem);
-      // catch (xhal::utils::XHALRPCNotConnectedException const& e) {
-      //   std::stringstream errmsg;
-      //   errmsg << "GLIBManager::configureAction unable to configure: " << e.what();
-      //   // fireEvent("Fail");
-      //   XCEPT_RAISE(gem::hw::glib::exception::ConfigurationProblem, errmsg.str());
-      // } catch (xhal::utils::XHALRPCException const& e) {
-      //   std::stringstream errmsg;
-      //   errmsg << "GLIBManager::configureAction unable to configure: " << e.what();
-      //   // fireEvent("Fail");
-      //   XCEPT_RAISE(gem::hw::glib::exception::ConfigurationProblem, errmsg.str());
-      // } catch (gem::hw::exception::RPCMethodError const& e) {
-      //   std::stringstream errmsg;
-      //   errmsg << "GLIBManager::configureAction unable to configure: " << e.what();
-      //   // fireEvent("Fail");
-      //   XCEPT_RAISE(gem::hw::glib::exception::ConfigurationProblem, errmsg.str());
-      // }
+  std::vector<gem::hw::GEMHwTaskGroup::Result> results;
+  try {
+    results = slotTasks.run();
+  } catch (...) {
+    resumeMonitors();
+    throw;
+  }
+  resumeMonitors();
 
-      if (m_scanType.value_ == 2) {
-        CMSGEMOS_INFO("GLIBManager::configureAction: FIRST  " << m_scanMin.value_);
+  gem::hw::GEMHwTaskGroup::checkResults<gem::hw::glib::exception::Exception>(m_gemLogger,
+                                                                            "GLIBManager::configureAction",
+                                                                            results);
+  CMSGEMOS_INFO("GLIBManager::configureAction end");
+}
+
+void gem::hw::glib::GLIBManager::configureSlot(unsigned const slot)
+{
+  gem::hw::GEMHwProfiler::CallerScope profilerScope("GLIBManager::configureAction");
+  GLIBInfo& info = m_glibInfo[slot].bag;
+  glib_shared_ptr amc = m_glibs.at(slot);
+
+  bool enableZS     = info.enableZS.value_;
+  bool doPhaseShift = m_uhalPhaseShift.value_;
+  uint32_t runType  = 0x0;
+  try { // FIXME if we fail, do we go to error?
+    // amc->ttcMMCMPhaseShift(m_relockPhase.value_, m_bc0LockPhaseShift.value_);
+    amc->configureDAQModule(enableZS, doPhaseShift, runType, 0xfaac, m_relockPhase.value_, m_bc0LockPhaseShift.value_);
+  } GEM_CATCH_RPC_ERROR("GLIBManager::configureAction", gem::hw::glib::exception::ConfigurationProblem);
+
+  // amc->scaHardResetEnable(false);
+  // amc->resetL1ACount();
+  // amc->resetCalPulseCount();
+
+  // if (m_uhalPhaseShift.value_) {
+  //   CMSGEMOS_INFO("GLIBManager::configureAction uhal phase shifting disabled");
+  //   try { // if we fail, do we go to error?
+  //     amc->ttcMMCMPhaseShift(m_relockPhase.value_, m_bc0LockPhaseShift.value_);
+  //   } GEM_CATCH_RPC_ERROR("GLIBManager::configureAction", gem::hw::glib::exception::PhaseShiftError);
+  // }
+
+  // // reset the DAQ (could move this to HwGenericAMC and eventually  a corresponding RPC module
+  // try { // FIXME if we fail, do we go to error?
+  //   amc->configure(info.enableZS.value_,0x0,0xfaac);
+  //   // amc->setL1AEnable(false);
+  //   // amc->disableDAQLink();
+  //   // amc->resetDAQLink();
+  //   // amc->enableDAQLink(0x4);  // FIXME
+  //   // amc->setZS(info.enableZS.value_);
+  //   // amc->setDAQLinkRunType(0x0);
+  //   // amc->setDAQLinkRunParameters(0xfaac);
+  // } GEM_CATCH_RPC_ERROR("GLIBManager::configureAction", gem::hw::glib::exception::ConfigurationProblem);
+  // catch (xhal::utils::XHALRPCNotConnectedException const& e) {
+  //   std::stringstream errmsg;
+  //   errmsg << "GLIBManager::configureAction unable to configure: " << e.what();
+  //   // fireEvent("Fail");
+  //   XCEPT_RAISE(gem::hw::glib::exception::ConfigurationProblem, errmsg.str());
+  // } catch (xhal::utils::XHALRPCException const& e) {
+  //   std::stringstream errmsg;
+  //   errmsg << "GLIBManager::configureAction unable to configure: " << e.what();
+  //   // fireEvent("Fail");
+  //   XCEPT_RAISE(gem::hw::glib::exception::ConfigurationProblem, errmsg.str());
+  // } catch (gem::hw::exception::RPCMethodError const& e) {
+  //   std::stringstream errmsg;
+  //   errmsg << "GLIBManager::configureAction unable to configure: " << e.what();
+  //   // fireEvent("Fail");
+  //   XCEPT_RAISE(gem::hw::glib::exception::ConfigurationProblem, errmsg.str());
+  // }
+
+  if (m_scanType.value_ == 2) {
+    CMSGEMOS_INFO("GLIBManager::configureAction: FIRST  " << m_scanMin.value_);
 
 	amc->setDAQLinkRunType(0x2);
 	amc->setDAQLinkRunParameter(0x1,m_scanMin.value_);
 	// amc->setDAQLinkRunParameter(0x2,VT1);  // set these at start so DQM has them?
 	// amc->setDAQLinkRunParameter(0x3,VT2);  // set these at start so DQM has them?
-      } else if (m_scanType.value_ == 3) {
+  } else if (m_scanType.value_ == 3) {
 	uint32_t initialVT1 = m_scanMin.value_;
 	uint32_t initialVT2 = 0;  // std::max(0,(uint32_t)m_scanMax.value_);
-        CMSGEMOS_INFO("GLIBManager::configureAction FIRST VT1 " << initialVT1 << " VT2 " << initialVT2);
+    CMSGEMOS_INFO("GLIBManager::configureAction FIRST VT1 " << initialVT1 << " VT2 " << initialVT2);
 
 	amc->setDAQLinkRunType(0x3);
 	// amc->setDAQLinkRunParameter(0x1,latency);  // set this at start so DQM has it?
 	amc->setDAQLinkRunParameter(0x2,initialVT1);
 	amc->setDAQLinkRunParameter(0x3,initialVT2);
-      } else {
+  } else {
 	amc->setDAQLinkRunType(0x1);
 	amc->setDAQLinkRunParameters(0xfaac);
-      }
-
-      // what else is required for configuring the GLIB?
-      // need to reset optical links?
-      // reset counters?
-      // setup run mode?
-      // setup DAQ mode?
-
-      // temp workaround, call confAllChambers python script?
-      // if P5 config?
-      // if (m_setupLocation.toString().rfind("P5") != std::string::npos) {
-      CMSGEMOS_INFO("GLIBManager::configureAction running confAllChambers for P5 setup");
-      std::stringstream confcmd;
-      // FIXME hard coded for now, but super hacky garbage
-      confcmd << "confAllChambers.py -s" << (slot+1)
-              << " --shelf="   << info.crateID.toString()
-              << " --ztrim="   << 4.0
-              << " --vt1bump=" << 10
-              << " --config --run";
-      CMSGEMOS_INFO("GLIBManager::configureAction executing " << confcmd.str());
-      int retval = std::system(confcmd.str().c_str());
-      if (retval) {
-        std::stringstream msg;
-        msg << "GLIBManager::configureAction unable to configure chambers: " << retval;
-        CMSGEMOS_WARN(msg.str());
-        // fireEvent("Fail");
-        // XCEPT_RAISE(gem::hw::glib::exception::Exception, msg.str());
-        // XCEPT_RAISE(gem::hw::glib::exception::ConfigurationProblem, msg.str());
-      }
-      // }
-      std::stringstream statuscmd;
-      // FIXME hard coded for now, but super hacky garbage
-      statuscmd << "amc_info_uhal.py -s" << (slot+1)
-                << " --shelf="           << info.crateID.toString();
-      CMSGEMOS_INFO("GLIBManager::configureAction running " << statuscmd.str() << " after configuring");
-      retval = std::system(statuscmd.str().c_str());
-      if (retval) {
-        std::stringstream msg;
-        msg << "GLIBManager::configureAction unable to check AMC status: " << retval;
-        CMSGEMOS_WARN(msg.str());
-        // fireEvent("Fail");
-        // XCEPT_RAISE(gem::hw::glib::exception::Exception, msg.str());
-        // XCEPT_RAISE(gem::hw::glib::exception::ConfigurationProblem, msg.str());
-      }
-
-      if (m_glibMonitors.at(slot))
-        m_glibMonitors.at(slot)->resumeMonitoring();
-    } else {
-      std::stringstream msg;
-      msg << "GLIBManager::configureAction GLIB in slot " << (slot+1) << " is not connected";
-      CMSGEMOS_ERROR(msg.str());
-      // fireEvent("Fail");
-      XCEPT_RAISE(gem::hw::glib::exception::Exception, msg.str());
-    }
   }
 
-  CMSGEMOS_INFO("GLIBManager::configureAction end");
+  // what else is required for configuring the GLIB?
+  // need to reset optical links?
+  // reset counters?
+  // setup run mode?
+  // setup DAQ mode?
+
+  // temp workaround, call confAllChambers python script?
+  // if P5 config?
+  // if (m_setupLocation.toString().rfind("P5") != std::string::npos) {
+  CMSGEMOS_INFO("GLIBManager::configureAction running confAllChambers for P5 setup");
+  std::stringstream confcmd;
+  // FIXME hard coded for now, but super hacky garbage
+  confcmd << "confAllChambers.py -s" << (slot+1)
+          << " --shelf="   << info.crateID.toString()
+          << " --ztrim="   << 4.0
+          << " --vt1bump=" << 10
+          << " --config --run";
+  CMSGEMOS_INFO("GLIBManager::configureAction executing " << confcmd.str());
+  int retval = std::system(confcmd.str().c_str());
+  if (retval) {
+    std::stringstream msg;
+    msg << "GLIBManager::configureAction unable to configure chambers: " << retval;
+    CMSGEMOS_WARN(msg.str());
+    // fireEvent("Fail");
+    // XCEPT_RAISE(gem::hw::glib::exception::Exception, msg.str());
+    // XCEPT_RAISE(gem::hw::glib::exception::ConfigurationProblem, msg.str());
+  }
+  // }
+  std::stringstream statuscmd;
+  // FIXME hard coded for now, but super hacky garbage
+  statuscmd << "amc_info_uhal.py -s" << (slot+1)
+            << " --shelf="           << info.crateID.toString();
+  CMSGEMOS_INFO("GLIBManager::configureAction running " << statuscmd.str() << " after configuring");
+  retval = std::system(statuscmd.str().c_str());
+  if (retval) {
+    std::stringstream msg;
+    msg << "GLIBManager::configureAction unable to check AMC status: " << retval;
+    CMSGEMOS_WARN(msg.str());
+    // fireEvent("Fail");
+    // XCEPT_RAISE(gem::hw::glib::exception::Exception, msg.str());
+    // XCEPT_RAISE(gem::hw::glib::exception::ConfigurationProblem, msg.str());
+  }
 }
 
 void gem::hw::glib::GLIBManager::startAction()
@@ -469,6 +524,7 @@ void gem::hw::glib::GLIBManager::startAction()
   }
 
   CMSGEMOS_INFO("GLIBManager::startAction begin");
+  gem::hw::GEMHwProfiler::CallerScope profilerScope("GLIBManager::startAction");
   // what is required for starting the GLIB?
   // FIXME make me more streamlined
   for (unsigned slot = 0; slot < MAX_AMCS_PER_CRATE; ++slot) {
@@ -489,6 +545,9 @@ void gem::hw::glib::GLIBManager::startAction()
       // amc->enableDAQModule(info.enableZS.value_);
 
       amc->ttcModuleReset();
+      // the module reset clears the TTC command counters
+      if (m_glibMonitors.at(slot))
+        m_glibMonitors.at(slot)->resetRates();
       amc->enableDAQLink(0x4);  // FIXME
       amc->resetDAQLink();
       amc->setZS(info.enableZS.value_);
@@ -617,6 +676,7 @@ void gem::hw::glib::GLIBManager::stopAction()
   throw (gem::hw::glib::exception::Exception)
 {
   CMSGEMOS_INFO("GLIBManager::stopAction begin");
+  gem::hw::GEMHwProfiler::CallerScope profilerScope("GLIBManager::stopAction");
   // FIXME make me more streamlined
   for (unsigned slot = 0; slot < MAX_AMCS_PER_CRATE; ++slot) {
     // usleep(10);
@@ -656,6 +716,7 @@ void gem::hw::glib::GLIBManager::stopAction()
         m_glibMonitors.at(slot)->resumeMonitoring();
     }
   }
+  dumpIPbusProfiles();
   usleep(10);  // just for testing the timing of different applications
   CMSGEMOS_INFO("GLIBManager::stopAction end");
 }
@@ -712,6 +773,9 @@ void gem::hw::glib::GLIBManager::resetAction()
   // unregister listeners and items in info spaces
 
   CMSGEMOS_DEBUG("GLIBManager::resetAction begin");
+  // the AMCs are added again by the next initializeAction
+  m_triggerRates.clear();
+  m_linkHealth.clear();
   // FIXME make me more streamlined
   for (unsigned slot = 0; slot < MAX_AMCS_PER_CRATE; ++slot) {
     // usleep(10);  // just for testing the timing of different applications
@@ -765,6 +829,8 @@ void gem::hw::glib::GLIBManager::resetAction()
       continue;
     }
   }
+  // the next initializeAction reads the connection file again
+  gem::hw::GEMHwConnectionRegistry::getInstance().clear();
   // gem::base::GEMFSMApplication::resetAction();
   CMSGEMOS_INFO("GLIBManager::resetAction end");
 }
@@ -924,3 +990,40 @@ void gem::hw::glib::GLIBManager::dumpGLIBFIFO(xgi::Input* in, xgi::Output* out)
 {
   dynamic_cast<GLIBManagerWeb*>(p_gemWebInterface)->dumpGLIBFIFO(in, out);
 }
+
+void gem::hw::glib::GLIBManager::dumpIPbusProfiles()
+{
+  if (m_ipbusProfileDir.toString().empty())
+    return;
+
+  long const stamp = static_cast<long>(std::time(nullptr));
+  for (unsigned slot = 0; slot < MAX_AMCS_PER_CRATE; ++slot) {
+    glib_shared_ptr amc = m_glibs.at(slot);
+    if (!amc)
+      continue;
+    std::shared_ptr<gem::hw::GEMHwProfiler> profiler = amc->getProfiler();
+    if (!profiler)
+      continue;
+    std::string const fileName = toolbox::toString("%s/%s-%ld.ipbusprofile", m_ipbusProfileDir.toString().c_str(),
+                                                   profiler->getDeviceID().c_str(), stamp);
+    if (profiler->dumpToFile(fileName))
+      CMSGEMOS_INFO("GLIBManager::dumpIPbusProfiles wrote " << fileName);
+    else
+      CMSGEMOS_WARN("GLIBManager::dumpIPbusProfiles unable to write " << fileName);
+  }
+}
+
+void gem::hw::glib::GLIBManager::dumpIPbusProfiles(xgi::Input* in, xgi::Output* out)
+{
+  dynamic_cast<GLIBManagerWeb*>(p_gemWebInterface)->dumpIPbusProfiles(in, out);
+}
+
+void gem::hw::glib::GLIBManager::triggerRates(xgi::Input* in, xgi::Output* out)
+{
+  dynamic_cast<GLIBManagerWeb*>(p_gemWebInterface)->triggerRates(in, out);
+}
+
+void gem::hw::glib::GLIBManager::linkHealth(xgi::Input* in, xgi::Output* out)
+{
+  dynamic_cast<GLIBManagerWeb*>(p_gemWebInterface)->linkHealth(in, out);
+}
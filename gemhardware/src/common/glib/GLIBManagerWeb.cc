@@ -7,10 +7,13 @@
 #include "xcept/tools.h"
 
 #include "gem/hw/glib/GLIBManager.h"
+#include "gem/hw/glib/HwGLIB.h"
 #include "gem/hw/glib/GLIBMonitor.h"
 
 #include "gem/hw/glib/exception/Exception.h"
 
+#include "gem/base/GEMState.h"
+
 gem::hw::glib::GLIBManagerWeb::GLIBManagerWeb(gem::hw::glib::GLIBManager* glibApp) :
   gem::base::GEMWebApplication(glibApp)
 {
@@ -64,6 +67,9 @@ void gem::hw::glib::GLIBManagerWeb::expertPage(xgi::Input* in, xgi::Output* out)
   *out << "      <div class=\"xdaq-tab\" title=\"Data FIFO dump page\"/>"  << std::endl;
   fifoDumpPage(in, out);
   *out << "      </div>" << std::endl;
+  *out << "      <div class=\"xdaq-tab\" title=\"IPbus profile\"/>"  << std::endl;
+  ipbusProfilePage(in, out);
+  *out << "      </div>" << std::endl;
   *out << "    </div>" << std::endl;
 }
 
@@ -193,6 +199,96 @@ void gem::hw::glib::GLIBManagerWeb::fifoDumpPage(xgi::Input* in, xgi::Output* ou
   *out << cgicc::br()       << std::endl;
 }
 
+void gem::hw::glib::GLIBManagerWeb::ipbusProfilePage(xgi::Input* in, xgi::Output* out)
+  throw (xgi::exception::Exception)
+{
+  CMSGEMOS_DEBUG("GLIBManagerWeb::ipbusProfilePage");
+  // IPbus accesses of every GLIB, if the manager was configured with ProfileIPbus
+  *out << cgicc::a("Dump all profiles as text")
+    .set("href", "/" + p_gemApp->m_urn + "/dumpIPbusProfiles") << cgicc::br() << std::endl;
+  bool profiled = false;
+  for (unsigned int i = 0; i < gem::base::GEMApplication::MAX_AMCS_PER_CRATE; ++i) {
+    auto card = dynamic_cast<gem::hw::glib::GLIBManager*>(p_gemFSMApp)->m_glibs.at(i);
+    if (!card)
+      continue;
+    std::shared_ptr<gem::hw::GEMHwProfiler> profiler = card->getProfiler();
+    if (profiler) {
+      profiler->printHTML(*out);
+      profiled = true;
+    }
+  }
+  if (!profiled)
+    *out << "No GLIB is profiled, set ProfileIPbus in the configuration" << cgicc::br() << std::endl;
+}
+
+void gem::hw::glib::GLIBManagerWeb::dumpIPbusProfiles(xgi::Input* in, xgi::Output* out)
+  throw (xgi::exception::Exception)
+{
+  CMSGEMOS_DEBUG("GLIBManagerWeb::dumpIPbusProfiles");
+  out->getHTTPResponseHeader().addHeader("Content-Type", "text/plain");
+  for (unsigned int i = 0; i < gem::base::GEMApplication::MAX_AMCS_PER_CRATE; ++i) {
+    auto card = dynamic_cast<gem::hw::glib::GLIBManager*>(p_gemFSMApp)->m_glibs.at(i);
+    if (!card)
+      continue;
+    std::shared_ptr<gem::hw::GEMHwProfiler> profiler = card->getProfiler();
+    if (profiler)
+      profiler->dump(*out);
+  }
+}
+
+void gem::hw::glib::GLIBManagerWeb::triggerRates(xgi::Input* in, xgi::Output* out)
+  throw (xgi::exception::Exception)
+{
+  // the rates are read on every request, all GLIBs at once, so a page can refresh them as often as it needs
+  CMSGEMOS_DEBUG("GLIBManagerWeb::triggerRates");
+  out->getHTTPResponseHeader().addHeader("Content-Type", "application/json");
+  gem::hw::GEMHwCrateTriggerRates& rates = dynamic_cast<gem::hw::glib::GLIBManager*>(p_gemFSMApp)->m_triggerRates;
+  if (!rates.empty()) {
+    gem::hw::GEMHwProfiler::CallerScope profilerScope("GLIBManagerWeb::triggerRates");
+    if (!rates.poll())
+      CMSGEMOS_WARN("GLIBManagerWeb::triggerRates unable to read the rates of some GLIBs");
+  }
+  rates.printJSON(*out);
+}
+
+void gem::hw::glib::GLIBManagerWeb::linkHealth(xgi::Input* in, xgi::Output* out)
+  throw (xgi::exception::Exception)
+{
+  // linkHealth?reset=1 resets the link counters of every GLIB before the check, only out of a run
+  CMSGEMOS_DEBUG("GLIBManagerWeb::linkHealth");
+  cgicc::Cgicc cgi(in);
+  bool const resetCounters = cgi.getElement("reset") != cgi.getElements().end() &&
+    cgi.getElement("reset")->getIntegerValue() != 0;
+
+  out->getHTTPResponseHeader().addHeader("Content-Type", "application/json");
+  gem::hw::glib::GLIBManager* glibManager = dynamic_cast<gem::hw::glib::GLIBManager*>(p_gemFSMApp);
+  toolbox::fsm::State const state = glibManager->getCurrentFSMState();
+  if (resetCounters && state != gem::base::STATE_HALTED && state != gem::base::STATE_CONFIGURED) {
+    CMSGEMOS_WARN("GLIBManagerWeb::linkHealth refusing to reset the link counters in state "
+                  << glibManager->getCurrentState());
+    out->getHTTPResponseHeader().getStatusCode(409);
+    out->getHTTPResponseHeader().getReasonPhrase("Conflict");
+    *out << "{\"error\":\"the link counters can only be reset in the Halted or Configured state\"}" << std::endl;
+    return;
+  }
+
+  gem::hw::GEMHwCrateLinkHealth& health = glibManager->m_linkHealth;
+  std::vector<gem::hw::GEMHwCrateLinkHealth::AMCResult> results;
+  if (!health.empty()) {
+    gem::hw::GEMHwProfiler::CallerScope profilerScope("GLIBManagerWeb::linkHealth");
+    results = health.check(resetCounters);
+  }
+
+  bool healthy = true;
+  for (auto amc = results.begin(); amc != results.end(); ++amc)
+    healthy = healthy && amc->healthy();
+  if (healthy)
+    CMSGEMOS_INFO("GLIBManagerWeb::linkHealth" << std::endl << gem::hw::GEMHwCrateLinkHealth::summary(results));
+  else
+    CMSGEMOS_WARN("GLIBManagerWeb::linkHealth" << std::endl << gem::hw::GEMHwCrateLinkHealth::summary(results));
+  gem::hw::GEMHwCrateLinkHealth::printJSON(*out, results);
+}
+
 void gem::hw::glib::GLIBManagerWeb::jsonUpdate(xgi::Input* in, xgi::Output* out)
   throw (xgi::exception::Exception)
 {
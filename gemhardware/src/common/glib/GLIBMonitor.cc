@@ -17,7 +17,8 @@ typedef gem::base::utils::GEMInfoSpaceToolBox::UpdateType GEMUpdateType;
 
 gem::hw::glib::GLIBMonitor::GLIBMonitor(std::shared_ptr<HwGLIB> glib, GLIBManager* glibManager, int const& index) :
   GEMMonitor(glibManager->getApplicationLogger(), static_cast<xdaq::Application*>(glibManager), index),
-  p_glib(glib)
+  p_glib(glib),
+  m_readList(m_gemLogger)
 {
   // application info space is added in the base class constructor
   // addInfoSpace("Application", glibManager->getApplicationInfoSpace());
@@ -95,37 +96,38 @@ void gem::hw::glib::GLIBMonitor::setupHwMonitoring()
   addMonitorableSet("GTX_LINKS", "HWMonitoring");
   addMonitorableSet("GBT_LINKS", "HWMonitoring");
   */
+  // TTC command counters are latched together each cycle, with their rates
   addMonitorableSet("COUNTERS", "HWMonitoring");
   addMonitorable("COUNTERS", "HWMonitoring",
                  std::make_pair("L1A", "TTC.CMD_COUNTERS.L1A"),
-                 GEMUpdateType::HW32, "dec");
+                 GEMUpdateType::HW32, "raw/rate");
   addMonitorable("COUNTERS", "HWMonitoring",
                  std::make_pair("BC0", "TTC.CMD_COUNTERS.BC0"),
-                 GEMUpdateType::HW32, "dec");
+                 GEMUpdateType::HW32, "raw/rate");
   addMonitorable("COUNTERS", "HWMonitoring",
                  std::make_pair("EC0", "TTC.CMD_COUNTERS.EC0"),
-                 GEMUpdateType::HW32, "dec");
+                 GEMUpdateType::HW32, "raw/rate");
   addMonitorable("COUNTERS", "HWMonitoring",
                  std::make_pair("RESYNC", "TTC.CMD_COUNTERS.RESYNC"),
-                 GEMUpdateType::HW32, "dec");
+                 GEMUpdateType::HW32, "raw/rate");
   addMonitorable("COUNTERS", "HWMonitoring",
                  std::make_pair("OC0", "TTC.CMD_COUNTERS.OC0"),
-                 GEMUpdateType::HW32, "dec");
+                 GEMUpdateType::HW32, "raw/rate");
   addMonitorable("COUNTERS", "HWMonitoring",
                  std::make_pair("HARD_RESET", "TTC.CMD_COUNTERS.HARD_RESET"),
-                 GEMUpdateType::HW32, "dec");
+                 GEMUpdateType::HW32, "raw/rate");
   addMonitorable("COUNTERS", "HWMonitoring",
                  std::make_pair("CalPulse", "TTC.CMD_COUNTERS.CALPULSE"),
-                 GEMUpdateType::HW32, "dec");
+                 GEMUpdateType::HW32, "raw/rate");
   addMonitorable("COUNTERS", "HWMonitoring",
                  std::make_pair("START", "TTC.CMD_COUNTERS.START"),
-                 GEMUpdateType::HW32, "dec");
+                 GEMUpdateType::HW32, "raw/rate");
   addMonitorable("COUNTERS", "HWMonitoring",
                  std::make_pair("STOP", "TTC.CMD_COUNTERS.STOP"),
-                 GEMUpdateType::HW32, "dec");
+                 GEMUpdateType::HW32, "raw/rate");
   addMonitorable("COUNTERS", "HWMonitoring",
                  std::make_pair("TEST_SYNC", "TTC.CMD_COUNTERS.TEST_SYNC"),
-                 GEMUpdateType::HW32, "dec");
+                 GEMUpdateType::HW32, "raw/rate");
 
   addMonitorableSet("DAQ Status", "HWMonitoring");
   addMonitorable("DAQ Status", "HWMonitoring",
@@ -366,58 +368,10 @@ gem::hw::glib::GLIBMonitor::~GLIBMonitor()
 
 void gem::hw::glib::GLIBMonitor::updateMonitorables()
 {
-  // define how to update the desired values
-  // get SYSTEM monitorables
-  // can this be split into two loops, one just to do a list read, the second to fill the InfoSpace with the returned values
+  // all hardware monitorables are read in one batched transaction, then filled into the InfoSpaces
   CMSGEMOS_DEBUG("GLIBMonitor: Updating monitorables");
-  for (auto monlist = m_monitorableSetsMap.begin(); monlist != m_monitorableSetsMap.end(); ++monlist) {
-    CMSGEMOS_DEBUG("GLIBMonitor: Updating monitorables in set " << monlist->first);
-    for (auto monitem = monlist->second.begin(); monitem != monlist->second.end(); ++monitem) {
-      CMSGEMOS_DEBUG("GLIBMonitor: Updating monitorable " << monitem->first);
-      std::stringstream regName;
-      regName << p_glib->getDeviceBaseNode() << "." << monitem->second.regname;
-      uint32_t address = p_glib->getNode(regName.str()).getAddress();
-      uint32_t mask    = p_glib->getNode(regName.str()).getMask();
-      if (monitem->second.updatetype == GEMUpdateType::HW8) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_glib->readReg(address,mask));
-      } else if (monitem->second.updatetype == GEMUpdateType::HW16) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_glib->readReg(address,mask));
-      } else if (monitem->second.updatetype == GEMUpdateType::HW24) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_glib->readReg(address,mask));
-      } else if (monitem->second.updatetype == GEMUpdateType::HW32) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_glib->readReg(address,mask));
-      } else if (monitem->second.updatetype == GEMUpdateType::HW64) {
-        address = p_glib->getNode(regName.str()+".LOWER").getAddress();
-        mask    = p_glib->getNode(regName.str()+".LOWER").getMask();
-        uint32_t lower = p_glib->readReg(address,mask);
-        address = p_glib->getNode(regName.str()+".UPPER").getAddress();
-        mask    = p_glib->getNode(regName.str()+".UPPER").getMask();
-        uint32_t upper = p_glib->readReg(address,mask);
-        (monitem->second.infoSpace)->setUInt64(monitem->first, (((uint64_t)upper) << 32) + lower);
-      } else if (monitem->second.updatetype == GEMUpdateType::I2CSTAT) {
-        std::stringstream strobeReg;
-        strobeReg << regName.str() << ".Strobe." << monitem->first;
-        address = p_glib->getNode(strobeReg.str()).getAddress();
-        mask    = p_glib->getNode(strobeReg.str()).getMask();
-        uint32_t strobe = p_glib->readReg(address,mask);
-        std::stringstream ackReg;
-        ackReg << regName.str() << ".Ack." << monitem->first;
-        address = p_glib->getNode(ackReg.str()).getAddress();
-        mask    = p_glib->getNode(ackReg.str()).getMask();
-        uint32_t ack = p_glib->readReg(address,mask);
-        (monitem->second.infoSpace)->setUInt64(monitem->first, (((uint64_t)ack) << 32) + strobe);
-      } else if (monitem->second.updatetype == GEMUpdateType::PROCESS) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_glib->readReg(address,mask));
-      } else if (monitem->second.updatetype == GEMUpdateType::TRACKER) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_glib->readReg(address,mask));
-      } else if (monitem->second.updatetype == GEMUpdateType::NOUPDATE) {
-        continue;
-      } else {
-        CMSGEMOS_ERROR("GLIBMonitor: Unknown update type encountered");
-        continue;
-      }
-    } // end loop over items in list
-  } // end loop over monitorableSets
+  gem::hw::GEMHwProfiler::CallerScope profilerScope("GLIBMonitor");
+  m_readList.update(*p_glib, m_monitorableSetsMap, p_glib->getDeviceBaseNode());
 }
 
 void gem::hw::glib::GLIBMonitor::buildMonitorPage(xgi::Output* out)
@@ -464,9 +418,23 @@ void gem::hw::glib::GLIBMonitor::buildMonitorPage(xgi::Output* out)
         CMSGEMOS_DEBUG("GLIBMonitor::" << monitem->first << " formatted to "
               << (monitem->second.infoSpace)->getFormattedItem(monitem->first,monitem->second.format));
         // this will be repeated for every GLIBMonitor in the GLIBManager..., need a better unique ID
-        *out << "<td id=\"" << monitem->second.infoSpace->name() << "-" << monitem->first << "\">" << std::endl
-             << (monitem->second.infoSpace)->getFormattedItem(monitem->first,monitem->second.format)
-             << "</td>"   << std::endl;
+        if (monitem->second.format == "raw/rate") {
+          // count and averaged rate are updated separately
+          std::string const isName   = monitem->second.infoSpace->name();
+          std::string const rateName = gem::base::utils::GEMInfoSpaceToolBox::getRateItemName(monitem->first, true);
+          *out << "<td>" << std::endl
+               << "<span id=\"" << isName << "-" << monitem->first << "\">"
+               << (monitem->second.infoSpace)->getFormattedItem(monitem->first, "dec") << "</span>"
+               << " / "
+               << "<span id=\"" << isName << "-" << rateName << "\">"
+               << (monitem->second.infoSpace->find(rateName) ?
+                   monitem->second.infoSpace->getFormattedItem(rateName, "rate") : "") << "</span>"
+               << "</td>"   << std::endl;
+        } else {
+          *out << "<td id=\"" << monitem->second.infoSpace->name() << "-" << monitem->first << "\">" << std::endl
+               << (monitem->second.infoSpace)->getFormattedItem(monitem->first,monitem->second.format)
+               << "</td>"   << std::endl;
+        }
 
         *out << "<td>"    << std::endl
              << monitem->second.regname
@@ -761,6 +729,7 @@ void gem::hw::glib::GLIBMonitor::reset()
   }
 
   CMSGEMOS_DEBUG("GLIBMonitor::reset - clearing all maps");
+  m_readList.clear();
   m_infoSpaceMap.clear();
   m_infoSpaceMonitorableSetMap.clear();
   m_monitorableSetInfoSpaceMap.clear();
@@ -13,6 +13,7 @@
 #include <sstream>
 #include <cstdlib>
 #include <vector>
+#include <chrono>
 
 #include "boost/format.hpp"
 #include "boost/lexical_cast.hpp"
@@ -38,7 +39,6 @@ gem::hw::glib::GLIBReadout::GLIBReadout(xdaq::ApplicationStub* stub) :
 {
   xoap::bind(this,&GLIBReadout::updateScanParameters,"UpdateScanParameter","urn:GLIBReadout-soap:1");
   //xoap::bind(this,&GLIBReadout::queueDepth,          "QueueDepth",         "urn:GLIBReadout-soap:1");
-  p_appInfoSpace->fireItemAvailable("QueueDepth", &m_queueDepth);
 }
 
 gem::hw::glib::GLIBReadout::~GLIBReadout()
@@ -73,6 +73,7 @@ void gem::hw::glib::GLIBReadout::initializeAction()
     XCEPT_RAISE(gem::hw::glib::exception::Exception, "initializeAction failed");
   }
   CMSGEMOS_DEBUG("GLIBReadout::initializeAction connected");
+  startQueueDepthTimer();
 
 }
 
@@ -90,6 +91,8 @@ void gem::hw::glib::GLIBReadout::configureAction()
   m_vfat = 0;
   m_event = 0;
   m_sumVFAT = 0;
+  gem::readout::GEMReadoutApplication::configureAction();
+  configureDrainController(kUPDATE7, gem::readout::GEMDrainController::TRACKING_FIFO_WORDS);
 }
 
 void gem::hw::glib::GLIBReadout::startAction()
@@ -147,50 +150,40 @@ uint32_t* gem::hw::glib::GLIBReadout::getGLIBData(uint8_t const& gtx, uint32_t c
 {
   uint32_t *point = &counter[0];
 
-  CMSGEMOS_DEBUG("GLIBReadout::getGLIBData Starting while loop readout "
-        << std::endl << "FIFO VFAT block depth 0x" << std::hex
-        << p_glib->getFIFOVFATBlockOccupancy(gtx)
-        << std::endl << "FIFO depth 0x" << std::hex
-        << p_glib->getFIFOOccupancy(gtx)
-        );
-  while ( p_glib->getFIFOVFATBlockOccupancy(gtx) ) {
+  typedef std::chrono::steady_clock clock;
+
+  uint32_t occupancy = p_glib->getFIFOOccupancy(gtx);
+  CMSGEMOS_DEBUG("GLIBReadout::getGLIBData starting drain, FIFO depth 0x" << std::hex << occupancy << std::dec);
+
+  // batch size is chosen by the drain controller from the occupancy trend and the read latency
+  while (uint32_t nWords = m_drainController.nextBatch(occupancy)) {
     CMSGEMOS_DEBUG("GLIBReadout::getGLIBData initiating call to getTrackingData(gtx,"
-          << p_glib->getFIFOVFATBlockOccupancy(gtx) << ")");
-    std::vector<uint32_t> data = p_glib->getTrackingData(gtx, p_glib->getFIFOVFATBlockOccupancy(gtx));
-    CMSGEMOS_DEBUG("GLIBReadout::getGLIBData"
-          << std::endl << "FIFO VFAT block depth 0x" << std::hex
-          << p_glib->getFIFOVFATBlockOccupancy(gtx)
-          << std::endl << "FIFO depth 0x" << std::hex
-          << p_glib->getFIFOOccupancy(gtx)
-          );
+          << nWords/kUPDATE7 << ")");
+    clock::time_point readStart = clock::now();
+    std::vector<uint32_t> data = p_glib->getTrackingData(gtx, nWords/kUPDATE7);
+    clock::time_point readEnd = clock::now();
 
     uint32_t contqueue = 0;
     for (auto iword = data.begin(); iword != data.end(); ++iword) {
       contqueue++;
       //gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_queueLock);
-      CMSGEMOS_DEBUG(" ::getGLIBData pushing into queue 0x"
+      CMSGEMOS_TRACE(" ::getGLIBData pushing into queue 0x"
             << std::setfill('0') << std::setw(8) << std::hex << *iword << std::dec );
       m_dataque.push(*iword);
       if (contqueue%kUPDATE7 == 0 &&  contqueue != 0) {
         m_contvfats++;
-        CMSGEMOS_DEBUG(" ::getGLIBData counter " << contqueue << " contvfats " << m_contvfats
-              << " m_dataque.size " << m_dataque.size());
       }
     }
-    CMSGEMOS_DEBUG(" ::getGLIBData end of while loop do we go again?" << std::endl
-          << " FIFO VFAT block occupancy  0x" << std::hex << p_glib->getFIFOVFATBlockOccupancy(gtx)
-          << std::endl
-          << " FIFO occupancy             0x" << std::hex << p_glib->getFIFOOccupancy(gtx) << std::endl
-          << " hasTrackingData            0x" << std::hex << p_glib->hasTrackingData(gtx)  << std::endl
-          );
-  }// while(p_glib->getFIFOVFATBlockOccupancy(gtx))
-  CMSGEMOS_DEBUG("GLIBReadout::getGLIBData"
-        << std::endl
-        << " FIFO VFAT block occupancy  0x" << std::hex << p_glib->getFIFOVFATBlockOccupancy(gtx)
-        << std::endl
-        << " FIFO occupancy             0x" << std::hex << p_glib->getFIFOOccupancy(gtx) << std::endl
-        << " hasTrackingData            0x" << std::hex << p_glib->hasTrackingData(gtx)  << std::endl
-        );
+    updateQueueDepth(m_dataque.size());
+
+    occupancy = p_glib->getFIFOOccupancy(gtx);
+    m_drainController.update(data.size(),
+                             std::chrono::duration<double, std::micro>(readEnd-readStart).count(),
+                             occupancy);
+    CMSGEMOS_DEBUG(" ::getGLIBData read " << data.size() << " words, contvfats " << m_contvfats
+          << " m_dataque.size " << m_dataque.size()
+          << " FIFO occupancy 0x" << std::hex << occupancy << std::dec);
+  }
   return point;
 }
 
@@ -282,9 +275,7 @@ uint32_t* gem::hw::glib::GLIBReadout::GEMEventMaker(uint32_t counter[5])
   CMSGEMOS_DEBUG(" ::GEMEventMaker m_event " << m_event << " m_vfats.size " << m_vfats.size() << std::hex << " ES 0x" << ES << std::dec );
   //}//end of event selection
 
-  m_queueDepth = m_dataque.size();
-  p_appInfoSpace->fireItemValueRetrieve("QueueDepth");
-  p_appInfoSpace->fireItemValueChanged("QueueDepth");
+  updateQueueDepth(m_dataque.size());
 
   counter[0] = m_vfat;
   counter[1] = m_event;
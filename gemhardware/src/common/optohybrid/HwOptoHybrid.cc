@@ -6,6 +6,8 @@
 
 #include "gem/hw/optohybrid/HwOptoHybrid.h"
 
+#include "gem/hw/GEMHwTransaction.h"
+
 // gem::hw::optohybrid::HwOptoHybrid::HwOptoHybrid() :
 //   gem::hw::GEMHwDevice::GEMHwDevice("HwOptoHybrid"),
 //   //monOptoHybrid_(0)
@@ -251,6 +253,69 @@ std::vector<uint32_t> gem::hw::optohybrid::HwOptoHybrid::broadcastRead(std::stri
   return readBlock(regName.str(),std::bitset<32>(~mask).count());
 }
 
+std::map<std::string, std::vector<uint32_t> > gem::hw::optohybrid::HwOptoHybrid::broadcastRead(
+  std::vector<std::string> const& names,
+  uint32_t const& mask,
+  bool            reset)
+{
+  std::map<std::string, std::vector<uint32_t> > results;
+  size_t const nChips = std::bitset<32>(~mask).count();
+  if (names.empty() || nChips == 0) {
+    for (auto name = names.begin(); name != names.end(); ++name)
+      results[*name] = std::vector<uint32_t>();
+    return results;
+  }
+
+  // no other broadcast may be issued to this device until all results are in
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
+  auto t1 = std::chrono::high_resolution_clock::now();
+  std::string const bcast = getDeviceBaseNode() + ".GEB.Broadcast.";
+  size_t   nDispatches = 0;
+  uint32_t running     = 0;
+
+  GEMHwTransaction trans(*this);
+  if (reset)
+    trans.write(bcast+"Reset", 0x1);
+  trans.write(bcast+"Mask", mask);
+  trans.read(bcast+"Request."+names.front());
+  trans.read(bcast+"Running", running);
+  trans.commit();
+  nDispatches += trans.dispatchCount();
+
+  for (auto name = names.begin(); name != names.end(); ++name) {
+    unsigned nPolls = 0;
+    while (running) {
+      if (++nPolls > BCAST_MAX_POLLS) {
+        std::string msg = toolbox::toString("HwOptoHybrid::broadcastRead request on %s did not finish",
+                                            name->c_str());
+        CMSGEMOS_ERROR(msg);
+        XCEPT_RAISE(gem::hw::optohybrid::exception::HardwareProblem, msg);
+      }
+      CMSGEMOS_TRACE("HwOptoHybrid::broadcastRead transaction on "
+            << *name << " is still running...");
+      usleep(10);
+      running = readReg(bcast+"Running");
+      ++nDispatches;
+    }
+
+    // results of this request are read before the next request replaces them
+    trans.readBlock(bcast+"Results", results[*name], nChips);
+    auto next = std::next(name);
+    if (next != names.end()) {
+      trans.read(bcast+"Request."+*next);
+      trans.read(bcast+"Running", running);
+    }
+    trans.commit();
+    nDispatches += trans.dispatchCount();
+  }
+
+  auto t2 = std::chrono::high_resolution_clock::now();
+  CMSGEMOS_DEBUG("HwOptoHybrid::broadcastRead " << names.size() << " registers in " << nDispatches
+        << " dispatches, lasted "
+        << std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count() << "ns");
+  return results;
+}
+
 void gem::hw::optohybrid::HwOptoHybrid::broadcastWrite(std::string const& name,
                                                        uint32_t    const& value,
                                                        uint32_t    const& mask,
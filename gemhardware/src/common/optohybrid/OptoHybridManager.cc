@@ -8,7 +8,10 @@
 
 #include "gem/hw/optohybrid/OptoHybridManager.h"
 
+#include <ctime>
+
 #include "gem/hw/optohybrid/HwOptoHybrid.h"
+#include "gem/hw/GEMHwConnectionRegistry.h"
 #include "gem/hw/optohybrid/OptoHybridMonitor.h"
 #include "gem/hw/optohybrid/OptoHybridManagerWeb.h"
 
@@ -133,17 +136,29 @@ void gem::hw::optohybrid::OptoHybridManager::CommonVFATSettings::registerFields(
 }
 
 gem::hw::optohybrid::OptoHybridManager::OptoHybridManager(xdaq::ApplicationStub* stub) :
-  gem::base::GEMFSMApplication(stub)
+  gem::base::GEMFSMApplication(stub),
+  m_maxConfigureThreads(gem::hw::GEMHwTaskGroup::DEFAULT_MAX_WORKERS),
+  m_diffConfigure(false),
+  m_profileIPbus(false),
+  m_ipbusProfileDir("")
 {
   m_optohybridInfo.setSize(MAX_OPTOHYBRIDS_PER_AMC*MAX_AMCS_PER_CRATE);
 
   p_appInfoSpace->fireItemAvailable("AllOptoHybridsInfo", &m_optohybridInfo);
   // p_appInfoSpace->fireItemAvailable("AMCSlots",           &m_amcSlots);
   p_appInfoSpace->fireItemAvailable("ConnectionFile",     &m_connectionFile);
+  p_appInfoSpace->fireItemAvailable("MaxConfigureThreads", &m_maxConfigureThreads);
+  p_appInfoSpace->fireItemAvailable("DiffConfigure",      &m_diffConfigure);
+  p_appInfoSpace->fireItemAvailable("ProfileIPbus",       &m_profileIPbus);
+  p_appInfoSpace->fireItemAvailable("IPbusProfileDir",    &m_ipbusProfileDir);
 
   p_appInfoSpace->addItemRetrieveListener("AllOptoHybridsInfo", this);
   // p_appInfoSpace->addItemRetrieveListener("AMCSlots",           this);
   p_appInfoSpace->addItemRetrieveListener("ConnectionFile",     this);
+  p_appInfoSpace->addItemRetrieveListener("MaxConfigureThreads", this);
+  p_appInfoSpace->addItemRetrieveListener("DiffConfigure",      this);
+  p_appInfoSpace->addItemRetrieveListener("ProfileIPbus",       this);
+  p_appInfoSpace->addItemRetrieveListener("IPbusProfileDir",    this);
   p_appInfoSpace->addItemChangedListener( "AllOptoHybridsInfo", this);
   // p_appInfoSpace->addItemChangedListener( "AMCSlots",           this);
   p_appInfoSpace->addItemChangedListener( "ConnectionFile",     this);
@@ -207,6 +222,9 @@ void gem::hw::optohybrid::OptoHybridManager::initializeAction()
   throw (gem::hw::optohybrid::exception::Exception)
 {
   CMSGEMOS_DEBUG("OptoHybridManager::initializeAction begin");
+  // the links are independent, they are connected to and scanned for VFATs concurrently
+  gem::hw::GEMHwTaskGroup linkTasks(m_maxConfigureThreads.value_);
+
   // FIXME make me more streamlined
   for (unsigned slot = 0; slot < MAX_AMCS_PER_CRATE; ++slot) {
     CMSGEMOS_DEBUG("OptoHybridManager::initializeAction looping over slots(" << (slot+1) << ") and finding expected cards");
@@ -247,87 +265,56 @@ void gem::hw::optohybrid::OptoHybridManager::initializeAction()
                                                                                                     true));
       }
 
-      try {
-        CMSGEMOS_DEBUG("OptoHybridManager::initializeAction obtaining pointer to HwOptoHybrid " << deviceName
-              << " (slot " << slot+1 << ")"
-              << " (link " << link   << ")");
-        m_optohybrids.at(slot).at(link) = optohybrid_shared_ptr(new gem::hw::optohybrid::HwOptoHybrid(deviceName,m_connectionFile.toString()));
-      } catch (gem::hw::optohybrid::exception::Exception const& e) {
-        std::stringstream msg;
-        msg << "OptoHybridManager::initializeAction caught exception " << e.what();
-        CMSGEMOS_ERROR(msg.str());
-        XCEPT_RAISE(gem::hw::optohybrid::exception::Exception, msg.str());
-      } catch (toolbox::net::exception::MalformedURN const& e) {
-        std::stringstream msg;
-        msg << "OptoHybridManager::initializeAction caught exception " << e.what();
-        CMSGEMOS_ERROR(msg.str());
-        XCEPT_RAISE(gem::hw::optohybrid::exception::Exception, msg.str());
-      } catch (std::exception const& e) {
-        std::stringstream msg;
-        msg << "OptoHybridManager::initializeAction caught exception " << e.what();
-        CMSGEMOS_ERROR(msg.str());
-        XCEPT_RAISE(gem::hw::optohybrid::exception::Exception, msg.str());
-      }
-      CMSGEMOS_DEBUG("OptoHybridManager::initializeAction connected");
-      // set the web view to be empty or grey
-      // if (!info.present.value_) continue;
-      // p_gemWebInterface->optohybridInSlot(slot);
+      linkTasks.add(toolbox::toString("OptoHybrid on link %d of AMC in slot %d", link, slot+1),
+                    deviceName,
+                    [this, slot, link, deviceName]() { initializeLink(slot, link, deviceName); });
+    }
+  }
+
+  gem::hw::GEMHwTaskGroup::checkResults<gem::hw::optohybrid::exception::Exception>(m_gemLogger,
+                                                                                  "OptoHybridManager::initializeAction",
+                                                                                  linkTasks.run());
+
+  // the InfoSpaces and monitors belong to the application, they are set up from this thread only
+  for (unsigned slot = 0; slot < MAX_AMCS_PER_CRATE; ++slot) {
+    for (unsigned link = 0; link < MAX_OPTOHYBRIDS_PER_AMC; ++link) {
+      unsigned int index = (slot*MAX_OPTOHYBRIDS_PER_AMC)+link;
+      if (!m_optohybridInfo[index].bag.present)
+        continue;
 
       CMSGEMOS_DEBUG("OptoHybridManager::initializeAction grabbing pointer to hardware device");
       optohybrid_shared_ptr optohybrid = m_optohybrids.at(slot).at(link);
-      if (optohybrid->isHwConnected()) {
-        // get connected VFATs
-        m_vfatMapping.at(slot).at(link)   = optohybrid->getConnectedVFATs(true);
-        CMSGEMOS_INFO("OptoHybridManager::initializeAction Obtained vfatMapping");
-        // all the rest of these are related to the first by bitwise logic, can avoid doing the 4 calls
-        m_trackingMask.at(slot).at(link)  = optohybrid->getConnectedVFATMask(true);
-        CMSGEMOS_INFO("OptoHybridManager::initializeAction Obtained trackingMask");
-        m_broadcastList.at(slot).at(link) = m_trackingMask.at(slot).at(link);
-        CMSGEMOS_INFO("OptoHybridManager::initializeAction Obtained broadcastList");
-        m_sbitMask.at(slot).at(link) = m_trackingMask.at(slot).at(link);
-        CMSGEMOS_INFO("OptoHybridManager::initializeAction Obtained sbitMask");
-
-        createOptoHybridInfoSpaceItems(is_optohybrids.at(slot).at(link), optohybrid);
-        CMSGEMOS_INFO("OptoHybridManager::initializeAction looping over created VFAT devices");
-        for (auto mapit = m_vfatMapping.at(slot).at(link).begin();
-             mapit != m_vfatMapping.at(slot).at(link).end(); ++mapit) {
-          CMSGEMOS_INFO("OptoHybridManager::initializeAction VFAT" << (int)mapit->first << " has chipID "
-               << std::hex << (int)mapit->second << std::dec << " (from map)");
-          // gem::hw::vfat::HwVFAT2& vfatDevice = optohybrid->getVFATDevice(mapit->first);
-          // CMSGEMOS_INFO("OptoHybridManager::initializeAction VFAT" << (int)mapit->first << " has chipID "
-          //      << std::hex << (int)vfatDevice.getChipID() << std::dec << " (from HW device) ");
-        }
 
-        if (!m_disableMonitoring) {
-          m_optohybridMonitors.at(slot).at(link) = std::shared_ptr<OptoHybridMonitor>(new OptoHybridMonitor(optohybrid, this, index));
-          m_optohybridMonitors.at(slot).at(link)->addInfoSpace("HWMonitoring", is_optohybrids.at(slot).at(link));
-          m_optohybridMonitors.at(slot).at(link)->setupHwMonitoring();
-          m_optohybridMonitors.at(slot).at(link)->startMonitoring();
-        }
+      createOptoHybridInfoSpaceItems(is_optohybrids.at(slot).at(link), optohybrid);
+      CMSGEMOS_INFO("OptoHybridManager::initializeAction looping over created VFAT devices");
+      for (auto mapit = m_vfatMapping.at(slot).at(link).begin();
+           mapit != m_vfatMapping.at(slot).at(link).end(); ++mapit) {
+        CMSGEMOS_INFO("OptoHybridManager::initializeAction VFAT" << (int)mapit->first << " has chipID "
+             << std::hex << (int)mapit->second << std::dec << " (from map)");
+        // gem::hw::vfat::HwVFAT2& vfatDevice = optohybrid->getVFATDevice(mapit->first);
+        // CMSGEMOS_INFO("OptoHybridManager::initializeAction VFAT" << (int)mapit->first << " has chipID "
+        //      << std::hex << (int)vfatDevice.getChipID() << std::dec << " (from HW device) ");
+      }
 
-        CMSGEMOS_INFO("OptoHybridManager::initializeAction OptoHybrid connected on link "
-             << link << " to AMC in slot " << (slot+1) << std::endl
-             << "Tracking mask: 0x" << std::hex << std::setw(8) << std::setfill('0')
-             << m_trackingMask.at(slot).at(link)
-             << std::dec << std::endl
-             << "Broadcst mask: 0x" << std::hex << std::setw(8) << std::setfill('0')
-             << m_broadcastList.at(slot).at(link)
-             << std::dec << std::endl
-             << "    SBit mask: 0x" << std::hex << std::setw(8) << std::setfill('0')
-             << m_sbitMask.at(slot).at(link)
-             << std::dec << std::endl
-             );
-        optohybrid->setVFATMask(m_trackingMask.at(slot).at(link));
-        optohybrid->setSBitMask(m_sbitMask.at(slot).at(link));
-        // turn off any that are excluded by the additional mask?
-      } else {
-        std::stringstream msg;
-        msg << "OptoHybridManager::initializeAction OptoHybrid connected on link "
-            << link << " to AMC in slot " << (slot+1) << " is not responding";
-        CMSGEMOS_ERROR(msg.str());
-        // fireEvent("Fail");
-        XCEPT_RAISE(gem::hw::optohybrid::exception::Exception, msg.str());
+      if (!m_disableMonitoring) {
+        m_optohybridMonitors.at(slot).at(link) = std::shared_ptr<OptoHybridMonitor>(new OptoHybridMonitor(optohybrid, this, index));
+        m_optohybridMonitors.at(slot).at(link)->addInfoSpace("HWMonitoring", is_optohybrids.at(slot).at(link));
+        m_optohybridMonitors.at(slot).at(link)->setupHwMonitoring();
+        m_optohybridMonitors.at(slot).at(link)->startMonitoring();
       }
+
+      CMSGEMOS_INFO("OptoHybridManager::initializeAction OptoHybrid connected on link "
+           << link << " to AMC in slot " << (slot+1) << std::endl
+           << "Tracking mask: 0x" << std::hex << std::setw(8) << std::setfill('0')
+           << m_trackingMask.at(slot).at(link)
+           << std::dec << std::endl
+           << "Broadcst mask: 0x" << std::hex << std::setw(8) << std::setfill('0')
+           << m_broadcastList.at(slot).at(link)
+           << std::dec << std::endl
+           << "    SBit mask: 0x" << std::hex << std::setw(8) << std::setfill('0')
+           << m_sbitMask.at(slot).at(link)
+           << std::dec << std::endl
+           );
       // FOR MISHA
       // hardware should be connected, can update ldqm_db for teststand/local runs
     }
@@ -335,25 +322,80 @@ void gem::hw::optohybrid::OptoHybridManager::initializeAction()
   CMSGEMOS_INFO("OptoHybridManager::initializeAction end");
 }
 
+void gem::hw::optohybrid::OptoHybridManager::initializeLink(unsigned const slot, unsigned const link,
+                                                            std::string const& deviceName)
+{
+  gem::hw::GEMHwProfiler::CallerScope profilerScope("OptoHybridManager::initializeAction");
+  try {
+    CMSGEMOS_DEBUG("OptoHybridManager::initializeAction obtaining pointer to HwOptoHybrid " << deviceName
+          << " (slot " << slot+1 << ")"
+          << " (link " << link   << ")");
+    m_optohybrids.at(slot).at(link) = optohybrid_shared_ptr(new gem::hw::optohybrid::HwOptoHybrid(deviceName,m_connectionFile.toString()));
+  } catch (gem::hw::optohybrid::exception::Exception const& e) {
+    std::stringstream msg;
+    msg << "OptoHybridManager::initializeAction caught exception " << e.what();
+    CMSGEMOS_ERROR(msg.str());
+    XCEPT_RAISE(gem::hw::optohybrid::exception::Exception, msg.str());
+  } catch (toolbox::net::exception::MalformedURN const& e) {
+    std::stringstream msg;
+    msg << "OptoHybridManager::initializeAction caught exception " << e.what();
+    CMSGEMOS_ERROR(msg.str());
+    XCEPT_RAISE(gem::hw::optohybrid::exception::Exception, msg.str());
+  } catch (std::exception const& e) {
+    std::stringstream msg;
+    msg << "OptoHybridManager::initializeAction caught exception " << e.what();
+    CMSGEMOS_ERROR(msg.str());
+    XCEPT_RAISE(gem::hw::optohybrid::exception::Exception, msg.str());
+  }
+  CMSGEMOS_DEBUG("OptoHybridManager::initializeAction connected");
+
+  optohybrid_shared_ptr optohybrid = m_optohybrids.at(slot).at(link);
+  if (m_profileIPbus.value_)
+    optohybrid->enableProfiler();
+  if (optohybrid->isHwConnected()) {
+    // get connected VFATs
+    m_vfatMapping.at(slot).at(link)   = optohybrid->getConnectedVFATs(true);
+    CMSGEMOS_INFO("OptoHybridManager::initializeAction Obtained vfatMapping");
+    // all the rest of these are related to the first by bitwise logic, can avoid doing the 4 calls
+    m_trackingMask.at(slot).at(link)  = optohybrid->getConnectedVFATMask(true);
+    CMSGEMOS_INFO("OptoHybridManager::initializeAction Obtained trackingMask");
+    m_broadcastList.at(slot).at(link) = m_trackingMask.at(slot).at(link);
+    CMSGEMOS_INFO("OptoHybridManager::initializeAction Obtained broadcastList");
+    m_sbitMask.at(slot).at(link) = m_trackingMask.at(slot).at(link);
+    CMSGEMOS_INFO("OptoHybridManager::initializeAction Obtained sbitMask");
+
+    optohybrid->setVFATMask(m_trackingMask.at(slot).at(link));
+    optohybrid->setSBitMask(m_sbitMask.at(slot).at(link));
+    // turn off any that are excluded by the additional mask?
+  } else {
+    std::stringstream msg;
+    msg << "OptoHybridManager::initializeAction OptoHybrid connected on link "
+        << link << " to AMC in slot " << (slot+1) << " is not responding";
+    CMSGEMOS_ERROR(msg.str());
+    // fireEvent("Fail");
+    XCEPT_RAISE(gem::hw::optohybrid::exception::Exception, msg.str());
+  }
+}
+
 void gem::hw::optohybrid::OptoHybridManager::configureAction()
   throw (gem::hw::optohybrid::exception::Exception)
 {
   CMSGEMOS_DEBUG("OptoHybridManager::configureAction");
   // std::ofstream of
 
-  std::map<int,std::set<int> > hwMapping;
+  // the links are configured concurrently, the AMC registers shared by the links of a slot
+  // are set afterwards, from this thread
+  gem::hw::GEMHwTaskGroup linkTasks(m_maxConfigureThreads.value_);
+  std::vector<std::pair<unsigned, unsigned> > configured;
+
   // will the manager operate for all connected optohybrids, or only those connected to certain AMCs?
   // FIXME make me more streamlined
   for (unsigned slot = 0; slot < MAX_AMCS_PER_CRATE; ++slot) {
-    // usleep(10); // just for testing the timing of different applications
-    uint32_t inputMask = 0x0;
-
     for (unsigned link = 0; link < MAX_OPTOHYBRIDS_PER_AMC; ++link)
       if (m_optohybridMonitors.at(slot).at(link))
         m_optohybridMonitors.at(slot).at(link)->pauseMonitoring();
 
     for (unsigned link = 0; link < MAX_OPTOHYBRIDS_PER_AMC; ++link) {
-      // usleep(10); // just for testing the timing of different applications
       unsigned int index = (slot*MAX_OPTOHYBRIDS_PER_AMC)+link;
       CMSGEMOS_DEBUG("OptoHybridManager::index = " << index);
       OptoHybridInfo& info = m_optohybridInfo[index].bag;
@@ -362,143 +404,228 @@ void gem::hw::optohybrid::OptoHybridManager::configureAction()
       if (!info.present)
         continue;
 
-      CMSGEMOS_DEBUG("OptoHybridManager::configureAction::grabbing pointer to hardware device");
-      optohybrid_shared_ptr optohybrid = m_optohybrids.at(slot).at(link);
-
-      if (optohybrid->isHwConnected()) {
-        hwMapping[slot+1].insert(link);
-
-        CMSGEMOS_DEBUG("OptoHybridManager::configureAction::setting trigger source to 0x"
-             << std::hex << info.triggerSource.value_ << std::dec);
-        optohybrid->setTrigSource(info.triggerSource.value_);
-
-        // CMSGEMOS_DEBUG("OptoHybridManager::configureAction::setting sbit source to 0x"
-        //      << std::hex << info.sbitSource.value_ << std::dec);
-        // optohybrid->setSBitSource(info.sbitSource.value_);
-        CMSGEMOS_DEBUG("OptoHybridManager::setting reference clock source to 0x"
-             << std::hex << info.refClkSrc.value_ << std::dec);
-        optohybrid->setReferenceClock(info.refClkSrc.value_);
-
-        /*
-        CMSGEMOS_DEBUG("OptoHybridManager::setting vfat clock source to 0x" << std::hex << info.vfatClkSrc.value_ << std::dec);
-        optohybrid->setVFATClock(info.vfatClkSrc.value_,);
-        CMSGEMOS_DEBUG("OptoHybridManager::setting cdce clock source to 0x" << std::hex << info.cdceClkSrc.value_ << std::dec);
-        optohybrid->setSBitSource(info.cdceClkSrc.value_);
-        */
-        /*
-        for (unsigned olink = 0; olink < HwAMC::N_GTX; ++olink) {
-        }
-        */
+      configured.push_back(std::make_pair(slot, link));
+      linkTasks.add(toolbox::toString("OptoHybrid on link %d of AMC in slot %d", link, slot+1),
+                    toolbox::toString("%d.%d", slot, link),
+                    [this, slot, link]() { configureLink(slot, link); });
+    }
+  }
 
-        CMSGEMOS_DEBUG("OptoHybridManager::configureAction Setting output s-bit configuration parameters");
-        optohybrid->setHDMISBitMode(info.sbitConfig.bag.Mode.value_);
+  std::vector<gem::hw::GEMHwTaskGroup::Result> results;
+  try {
+    results = linkTasks.run();
+  } catch (...) {
+    for (unsigned slot = 0; slot < MAX_AMCS_PER_CRATE; ++slot)
+      for (unsigned link = 0; link < MAX_OPTOHYBRIDS_PER_AMC; ++link)
+        if (m_optohybridMonitors.at(slot).at(link))
+          m_optohybridMonitors.at(slot).at(link)->resumeMonitoring();
+    throw;
+  }
 
-        std::array<uint8_t, 6> sbitSources = {{
-            static_cast<uint8_t>(info.sbitConfig.bag.Output0Src.value_ & 0x1f),
-            static_cast<uint8_t>(info.sbitConfig.bag.Output1Src.value_ & 0x1f),
-            static_cast<uint8_t>(info.sbitConfig.bag.Output2Src.value_ & 0x1f),
-            static_cast<uint8_t>(info.sbitConfig.bag.Output3Src.value_ & 0x1f),
-            static_cast<uint8_t>(info.sbitConfig.bag.Output4Src.value_ & 0x1f),
-            static_cast<uint8_t>(info.sbitConfig.bag.Output5Src.value_ & 0x1f),
-          }};
+  // enable the DAQ inputs of the links that were configured
+  std::map<int,std::set<int> > hwMapping;
+  for (unsigned slot = 0; slot < MAX_AMCS_PER_CRATE; ++slot) {
+    uint32_t inputMask = 0x0;
+    optohybrid_shared_ptr optohybrid;
+    for (size_t i = 0; i < configured.size(); ++i) {
+      if (configured.at(i).first != slot || !results.at(i).Succeeded)
+        continue;
+      unsigned link = configured.at(i).second;
+      hwMapping[slot+1].insert(link);
+      inputMask |= (0x1<<link);
+      optohybrid = m_optohybrids.at(slot).at(link);
+    }
 
-        optohybrid->setHDMISBitSource(sbitSources);
+    if (optohybrid) {
+      // FIXME, should not be here or done like this
+      try {
+        uint32_t gtxMask = optohybrid->readReg("GEM_AMC.DAQ.CONTROL.INPUT_ENABLE_MASK");
+        optohybrid->writeReg("GEM_AMC.DAQ.CONTROL.INPUT_ENABLE_MASK", inputMask);
+        CMSGEMOS_INFO("OptoHybridManager::configureAction::AMC in slot " << (int)(slot+1)
+                      << " INPUT_ENABLE_MASK changed from " << std::hex << gtxMask
+                      << " to " << inputMask << std::dec);
+      } catch (xcept::Exception const& e) {
+        gem::hw::GEMHwTaskGroup::Result result;
+        result.Target = toolbox::toString("DAQ inputs of AMC in slot %d", slot+1);
+        result.Error  = e.what();
+        results.push_back(result);
+      }
+    }
 
-        std::vector<std::pair<uint8_t,uint32_t> > chipIDs = optohybrid->getConnectedVFATs();
+    for (unsigned link = 0; link < MAX_OPTOHYBRIDS_PER_AMC; ++link)
+      if (m_optohybridMonitors.at(slot).at(link))
+        m_optohybridMonitors.at(slot).at(link)->resumeMonitoring();
+  }
 
-        for (auto chip = chipIDs.begin(); chip != chipIDs.end(); ++chip)
-          if (chip->second)
-            CMSGEMOS_INFO("VFAT found in GEB slot " << std::setw(2) << (int)chip->first << " has ChipID "
-                 << "0x" << std::hex << std::setw(4) << chip->second << std::dec);
-          else
-            CMSGEMOS_INFO("No VFAT found in GEB slot " << std::setw(2) << (int)chip->first);
+  gem::hw::GEMHwTaskGroup::checkResults<gem::hw::optohybrid::exception::Exception>(m_gemLogger,
+                                                                                  "OptoHybridManager::configureAction",
+                                                                                  results);
+  CMSGEMOS_INFO("OptoHybridManager::configureAction end");
+}
 
-        uint32_t vfatMask = m_broadcastList.at(slot).at(link);
-        CMSGEMOS_INFO("Setting VFAT parameters with broadcast write using mask " << std::hex << vfatMask << std::dec);
+void gem::hw::optohybrid::OptoHybridManager::configureLink(unsigned const slot, unsigned const link)
+{
+  gem::hw::GEMHwProfiler::CallerScope profilerScope("OptoHybridManager::configureAction");
+  unsigned int index = (slot*MAX_OPTOHYBRIDS_PER_AMC)+link;
+  OptoHybridInfo& info = m_optohybridInfo[index].bag;
+
+  CMSGEMOS_DEBUG("OptoHybridManager::configureAction::grabbing pointer to hardware device");
+  optohybrid_shared_ptr optohybrid = m_optohybrids.at(slot).at(link);
+
+  if (optohybrid->isHwConnected()) {
+    std::array<uint8_t, 6> sbitSources = {{
+        static_cast<uint8_t>(info.sbitConfig.bag.Output0Src.value_ & 0x1f),
+        static_cast<uint8_t>(info.sbitConfig.bag.Output1Src.value_ & 0x1f),
+        static_cast<uint8_t>(info.sbitConfig.bag.Output2Src.value_ & 0x1f),
+        static_cast<uint8_t>(info.sbitConfig.bag.Output3Src.value_ & 0x1f),
+        static_cast<uint8_t>(info.sbitConfig.bag.Output4Src.value_ & 0x1f),
+        static_cast<uint8_t>(info.sbitConfig.bag.Output5Src.value_ & 0x1f),
+      }};
+
+    if (m_diffConfigure.value_) {
+      // restore what the hardware lost since the last configure, then write only what changed
+      // the VFAT registers are not written here (see setVFATsToDefaults below), HwVFAT2::writeImage
+      // with changedOnly keeps a shadow for each chip
+      try {
+        size_t nMismatches = optohybrid->verifyShadow();
+        if (nMismatches)
+          CMSGEMOS_WARN("OptoHybridManager::configureAction " << nMismatches
+                        << " registers changed since the last configure");
+
+        // the same registers and values as the setters of the full configuration below
+        register_pair_list settings = {
+          optohybrid->trigSourceSetting(info.triggerSource.value_),
+          optohybrid->referenceClockSetting(info.refClkSrc.value_),
+          optohybrid->hdmiSBitModeSetting(info.sbitConfig.bag.Mode.value_),
+          optohybrid->hdmiSBitSourceSetting(sbitSources)
+        };
+        size_t nWritten = optohybrid->writeChangedRegs(settings);
+        CMSGEMOS_INFO("OptoHybridManager::configureAction wrote " << nWritten << " of "
+                      << settings.size() << " OptoHybrid settings");
+      } catch (gem::hw::exception::HardwareProblem const& e) {
+        std::stringstream msg;
+        msg << "OptoHybridManager::configureAction unable to configure the OptoHybrid on link "
+            << (int)link << " in slot " << (int)(slot+1) << ": " << e.what();
+        CMSGEMOS_ERROR(msg.str());
+        XCEPT_RAISE(gem::hw::optohybrid::exception::Exception, msg.str());
+      }
+    } else {
+      CMSGEMOS_DEBUG("OptoHybridManager::configureAction::setting trigger source to 0x"
+           << std::hex << info.triggerSource.value_ << std::dec);
+      optohybrid->setTrigSource(info.triggerSource.value_);
+
+      // CMSGEMOS_DEBUG("OptoHybridManager::configureAction::setting sbit source to 0x"
+      //      << std::hex << info.sbitSource.value_ << std::dec);
+      // optohybrid->setSBitSource(info.sbitSource.value_);
+      CMSGEMOS_DEBUG("OptoHybridManager::setting reference clock source to 0x"
+           << std::hex << info.refClkSrc.value_ << std::dec);
+      optohybrid->setReferenceClock(info.refClkSrc.value_);
+
+      /*
+      CMSGEMOS_DEBUG("OptoHybridManager::setting vfat clock source to 0x" << std::hex << info.vfatClkSrc.value_ << std::dec);
+      optohybrid->setVFATClock(info.vfatClkSrc.value_,);
+      CMSGEMOS_DEBUG("OptoHybridManager::setting cdce clock source to 0x" << std::hex << info.cdceClkSrc.value_ << std::dec);
+      optohybrid->setSBitSource(info.cdceClkSrc.value_);
+      */
+      /*
+      for (unsigned olink = 0; olink < HwAMC::N_GTX; ++olink) {
+      }
+      */
 
-        std::map<std::string, uint8_t > vfatSettings;
-        vfatSettings["ContReg0"   ] = (uint8_t)(info.commonVFATSettings.bag.ContReg0.value_);
-        vfatSettings["ContReg1"   ] = (uint8_t)(info.commonVFATSettings.bag.ContReg1.value_);
-        vfatSettings["ContReg2"   ] = (uint8_t)(info.commonVFATSettings.bag.ContReg2.value_);
-        vfatSettings["ContReg3"   ] = (uint8_t)(info.commonVFATSettings.bag.ContReg3.value_);
-        vfatSettings["IPreampIn"  ] = (uint8_t)(info.commonVFATSettings.bag.IPreampIn.value_);
-        vfatSettings["IPreampFeed"] = (uint8_t)(info.commonVFATSettings.bag.IPreampFeed.value_);
-        vfatSettings["IPreampOut" ] = (uint8_t)(info.commonVFATSettings.bag.IPreampOut.value_);
-        vfatSettings["IShaper"    ] = (uint8_t)(info.commonVFATSettings.bag.IShaper.value_);
-        vfatSettings["IShaperFeed"] = (uint8_t)(info.commonVFATSettings.bag.IShaperFeed.value_);
-        vfatSettings["IComp"      ] = (uint8_t)(info.commonVFATSettings.bag.IComp.value_);
-        vfatSettings["VThreshold1"] = (uint8_t)(info.commonVFATSettings.bag.VThreshold1.value_);
-        vfatSettings["VThreshold2"] = (uint8_t)(info.commonVFATSettings.bag.VThreshold2.value_);
-        vfatSettings["Latency"    ] = (uint8_t)(info.commonVFATSettings.bag.Latency.value_);
+      CMSGEMOS_DEBUG("OptoHybridManager::configureAction Setting output s-bit configuration parameters");
+      optohybrid->setHDMISBitMode(info.sbitConfig.bag.Mode.value_);
 
-        if (m_scanType.value_ == 2) {
-          CMSGEMOS_INFO("OptoHybridManager::configureAction configureAction: FIRST Latency  " << m_scanMin.value_);
-          vfatSettings["Latency"    ] = (uint8_t)(m_scanMin.value_);
-          // FIXME optohybrid->setVFATsToDefaults(vfatSettings, vfatMask);
-          // HACK
-          // have to enable the pulse to the channel if using cal pulse latency scan
-          // but shouldn't mess with other settings... not possible here, so just a hack
-          // optohybrid->broadcastWrite("VFATChannels.ChanReg23",  0x40, vfatMask);
-          // optohybrid->broadcastWrite("VFATChannels.ChanReg124", 0x40, vfatMask);
-          // optohybrid->broadcastWrite("VFATChannels.ChanReg65",  0x40, vfatMask);
-          // optohybrid->broadcastWrite("VCal",                    0xaf, vfatMask);
-        } else if (m_scanType.value_ == 3) {
-          uint32_t initialVT1 = m_scanMin.value_;
-          // uint32_t VT1 = (m_scanMax.value_ - m_scanMin.value_);
-          uint32_t initialVT2 = 0; //std::max(0,(uint32_t)m_scanMax.value_);
-          CMSGEMOS_INFO("OptoHybridManager::configureAction FIRST VT1 " << initialVT1 << " VT2 " << initialVT2);
-          vfatSettings["VThreshold1"] = (uint8_t)(initialVT1&0xff);
-          vfatSettings["VThreshold2"] = (uint8_t)(initialVT2&0xff);
-          // FIXME optohybrid->setVFATsToDefaults(vfatSettings, vfatMask);
-        } else {
-          // FIXME optohybrid->setVFATsToDefaults(vfatSettings, vfatMask);
-        }
+      optohybrid->setHDMISBitSource(sbitSources);
+    }
 
-        std::array<std::string, 11> setupregs = {{"ContReg0", "ContReg2", "IPreampIn", "IPreampFeed", "IPreampOut",
-                                                  "IShaper", "IShaperFeed", "IComp", "Latency",
-                                                  "VThreshold1", "VThreshold2"}};
-
-        CMSGEMOS_INFO("Reading back values after setting defaults:");
-        for (auto reg = setupregs.begin(); reg != setupregs.end(); ++reg) {
-          std::vector<uint32_t> res = optohybrid->broadcastRead(*reg,vfatMask);
-          CMSGEMOS_INFO(*reg);
-          for (auto r = res.begin(); r != res.end(); ++r) {
-            CMSGEMOS_INFO(" 0x" << std::hex << std::setw(8) << std::setfill('0') << *r << std::dec);
-          }
-        }
+    std::vector<std::pair<uint8_t,uint32_t> > chipIDs = optohybrid->getConnectedVFATs();
 
-        // what else is required for configuring the OptoHybrid?
-        // need to reset optical links?
-        // reset counters?
+    for (auto chip = chipIDs.begin(); chip != chipIDs.end(); ++chip)
+      if (chip->second)
+        CMSGEMOS_INFO("VFAT found in GEB slot " << std::setw(2) << (int)chip->first << " has ChipID "
+             << "0x" << std::hex << std::setw(4) << chip->second << std::dec);
+      else
+        CMSGEMOS_INFO("No VFAT found in GEB slot " << std::setw(2) << (int)chip->first);
+
+    uint32_t vfatMask = m_broadcastList.at(slot).at(link);
+    CMSGEMOS_INFO("Setting VFAT parameters with broadcast write using mask " << std::hex << vfatMask << std::dec);
+
+    std::map<std::string, uint8_t > vfatSettings;
+    vfatSettings["ContReg0"   ] = (uint8_t)(info.commonVFATSettings.bag.ContReg0.value_);
+    vfatSettings["ContReg1"   ] = (uint8_t)(info.commonVFATSettings.bag.ContReg1.value_);
+    vfatSettings["ContReg2"   ] = (uint8_t)(info.commonVFATSettings.bag.ContReg2.value_);
+    vfatSettings["ContReg3"   ] = (uint8_t)(info.commonVFATSettings.bag.ContReg3.value_);
+    vfatSettings["IPreampIn"  ] = (uint8_t)(info.commonVFATSettings.bag.IPreampIn.value_);
+    vfatSettings["IPreampFeed"] = (uint8_t)(info.commonVFATSettings.bag.IPreampFeed.value_);
+    vfatSettings["IPreampOut" ] = (uint8_t)(info.commonVFATSettings.bag.IPreampOut.value_);
+    vfatSettings["IShaper"    ] = (uint8_t)(info.commonVFATSettings.bag.IShaper.value_);
+    vfatSettings["IShaperFeed"] = (uint8_t)(info.commonVFATSettings.bag.IShaperFeed.value_);
+    vfatSettings["IComp"      ] = (uint8_t)(info.commonVFATSettings.bag.IComp.value_);
+    vfatSettings["VThreshold1"] = (uint8_t)(info.commonVFATSettings.bag.VThreshold1.value_);
+    vfatSettings["VThreshold2"] = (uint8_t)(info.commonVFATSettings.bag.VThreshold2.value_);
+    vfatSettings["Latency"    ] = (uint8_t)(info.commonVFATSettings.bag.Latency.value_);
+
+    if (m_scanType.value_ == 2) {
+      CMSGEMOS_INFO("OptoHybridManager::configureAction configureAction: FIRST Latency  " << m_scanMin.value_);
+      vfatSettings["Latency"    ] = (uint8_t)(m_scanMin.value_);
+      // FIXME optohybrid->setVFATsToDefaults(vfatSettings, vfatMask);
+      // HACK
+      // have to enable the pulse to the channel if using cal pulse latency scan
+      // but shouldn't mess with other settings... not possible here, so just a hack
+      // optohybrid->broadcastWrite("VFATChannels.ChanReg23",  0x40, vfatMask);
+      // optohybrid->broadcastWrite("VFATChannels.ChanReg124", 0x40, vfatMask);
+      // optohybrid->broadcastWrite("VFATChannels.ChanReg65",  0x40, vfatMask);
+      // optohybrid->broadcastWrite("VCal",                    0xaf, vfatMask);
+    } else if (m_scanType.value_ == 3) {
+      uint32_t initialVT1 = m_scanMin.value_;
+      // uint32_t VT1 = (m_scanMax.value_ - m_scanMin.value_);
+      uint32_t initialVT2 = 0; //std::max(0,(uint32_t)m_scanMax.value_);
+      CMSGEMOS_INFO("OptoHybridManager::configureAction FIRST VT1 " << initialVT1 << " VT2 " << initialVT2);
+      vfatSettings["VThreshold1"] = (uint8_t)(initialVT1&0xff);
+      vfatSettings["VThreshold2"] = (uint8_t)(initialVT2&0xff);
+      // FIXME optohybrid->setVFATsToDefaults(vfatSettings, vfatMask);
+    } else {
+      // FIXME optohybrid->setVFATsToDefaults(vfatSettings, vfatMask);
+    }
 
-        // FIXME, should not be here or done like this
-        uint32_t gtxMask = optohybrid->readReg("GEM_AMC.DAQ.CONTROL.INPUT_ENABLE_MASK");
-        std::stringstream msg;
-        msg << "OptoHybridManager::configureAction::OptoHybrid connected on link " << (int)link
-            << " to AMC in slot " << (int)(slot+1) << " found, INPUT_ENABLE_MASK changed from "
-            << std::hex << gtxMask << std::dec;
-        gtxMask   |= (0x1<<link);
-        inputMask |= (0x1<<link);
-        optohybrid->writeReg("GEM_AMC.DAQ.CONTROL.INPUT_ENABLE_MASK", gtxMask);
-        optohybrid->writeReg("GEM_AMC.DAQ.CONTROL.INPUT_ENABLE_MASK", inputMask);
-        msg << " to " << std::hex << inputMask  << std::dec << std::endl;
-        CMSGEMOS_INFO(msg.str());
-      } else {
-        std::stringstream msg;
-        msg << "OptoHybridManager::configureAction::OptoHybrid connected on link " << (int)link
-            << " to AMC in slot " << (int)(slot+1) << " is not responding";
-        CMSGEMOS_ERROR(msg.str());
-        // fireEvent("Fail");
-        XCEPT_RAISE(gem::hw::optohybrid::exception::Exception, msg.str());
+    std::vector<std::string> setupregs = {"ContReg0", "ContReg2", "IPreampIn", "IPreampFeed", "IPreampOut",
+                                          "IShaper", "IShaperFeed", "IComp", "Latency",
+                                          "VThreshold1", "VThreshold2"};
+
+    try {
+      std::map<std::string, std::vector<uint32_t> > readback = optohybrid->broadcastRead(setupregs,vfatMask);
+      // one message per link, the links are configured concurrently
+      std::stringstream msg;
+      msg << "Reading back values after setting defaults on link " << link
+          << " of AMC in slot " << (slot+1) << ":" << std::endl;
+      for (auto reg = setupregs.begin(); reg != setupregs.end(); ++reg) {
+        std::vector<uint32_t> const& res = readback[*reg];
+        msg << *reg;
+        for (auto r = res.begin(); r != res.end(); ++r) {
+          msg << " 0x" << std::hex << std::setw(8) << std::setfill('0') << *r << std::dec;
+        }
+        msg << std::endl;
       }
+      CMSGEMOS_INFO(msg.str());
+    } catch (xcept::Exception& e) {
+      // fails the task of this link, checkResults reports it and its DAQ input stays disabled
+      std::stringstream msg;
+      msg << "OptoHybridManager::configureAction unable to read back the VFAT settings on link " << link
+          << " of AMC in slot " << (slot+1);
+      XCEPT_RETHROW(gem::hw::optohybrid::exception::Exception, msg.str(), e);
     }
 
-    for (unsigned link = 0; link < MAX_OPTOHYBRIDS_PER_AMC; ++link)
-      if (m_optohybridMonitors.at(slot).at(link))
-        m_optohybridMonitors.at(slot).at(link)->resumeMonitoring();
+    // what else is required for configuring the OptoHybrid?
+    // need to reset optical links?
+    // reset counters?
+  } else {
+    std::stringstream msg;
+    msg << "OptoHybridManager::configureAction::OptoHybrid connected on link " << (int)link
+        << " to AMC in slot " << (int)(slot+1) << " is not responding";
+    CMSGEMOS_ERROR(msg.str());
+    // fireEvent("Fail");
+    XCEPT_RAISE(gem::hw::optohybrid::exception::Exception, msg.str());
   }
-
-  CMSGEMOS_INFO("OptoHybridManager::configureAction end");
 }
 
 void gem::hw::optohybrid::OptoHybridManager::startAction()
@@ -513,6 +640,7 @@ void gem::hw::optohybrid::OptoHybridManager::startAction()
   }
 
   CMSGEMOS_DEBUG("OptoHybridManager::startAction");
+  gem::hw::GEMHwProfiler::CallerScope profilerScope("OptoHybridManager::startAction");
   // will the manager operate for all connected optohybrids, or only those connected to certain AMCs?
   // FIXME make me more streamlined
   for (unsigned slot = 0; slot < MAX_AMCS_PER_CRATE; ++slot) {
@@ -540,6 +668,8 @@ void gem::hw::optohybrid::OptoHybridManager::startAction()
         uint32_t vfatMask = m_broadcastList.at(slot).at(link);
         // reset counters
         optohybrid->counterReset();
+        if (m_optohybridMonitors.at(slot).at(link))
+          m_optohybridMonitors.at(slot).at(link)->resetRates();
         // // reset VFAT counters
         // optohybrid->resetVFATCRCCount();
 
@@ -673,6 +803,7 @@ void gem::hw::optohybrid::OptoHybridManager::stopAction()
   throw (gem::hw::optohybrid::exception::Exception)
 {
   CMSGEMOS_DEBUG("OptoHybridManager::stopAction");
+  gem::hw::GEMHwProfiler::CallerScope profilerScope("OptoHybridManager::stopAction");
   // will the manager operate for all connected optohybrids, or only those connected to certain AMCs?
   // FIXME make me more streamlined
   for (unsigned slot = 0; slot < MAX_AMCS_PER_CRATE; ++slot) {
@@ -743,9 +874,34 @@ void gem::hw::optohybrid::OptoHybridManager::stopAction()
       if (m_optohybridMonitors.at(slot).at(link))
         m_optohybridMonitors.at(slot).at(link)->resumeMonitoring();
   }
+  dumpIPbusProfiles();
   CMSGEMOS_INFO("OptoHybridManager::stopAction end");
 }
 
+void gem::hw::optohybrid::OptoHybridManager::dumpIPbusProfiles()
+{
+  if (m_ipbusProfileDir.toString().empty())
+    return;
+
+  long const stamp = static_cast<long>(std::time(nullptr));
+  for (unsigned slot = 0; slot < MAX_AMCS_PER_CRATE; ++slot) {
+    for (unsigned link = 0; link < MAX_OPTOHYBRIDS_PER_AMC; ++link) {
+      optohybrid_shared_ptr optohybrid = m_optohybrids.at(slot).at(link);
+      if (!optohybrid)
+        continue;
+      std::shared_ptr<gem::hw::GEMHwProfiler> profiler = optohybrid->getProfiler();
+      if (!profiler)
+        continue;
+      std::string const fileName = toolbox::toString("%s/%s-%ld.ipbusprofile", m_ipbusProfileDir.toString().c_str(),
+                                                     profiler->getDeviceID().c_str(), stamp);
+      if (profiler->dumpToFile(fileName))
+        CMSGEMOS_INFO("OptoHybridManager::dumpIPbusProfiles wrote " << fileName);
+      else
+        CMSGEMOS_WARN("OptoHybridManager::dumpIPbusProfiles unable to write " << fileName);
+    }
+  }
+}
+
 void gem::hw::optohybrid::OptoHybridManager::haltAction()
   throw (gem::hw::optohybrid::exception::Exception)
 {
@@ -802,6 +958,8 @@ void gem::hw::optohybrid::OptoHybridManager::resetAction()
       }
     }  // end loop on link < MAX_OPTOHYBRIDS_PER_AMC
   }  // end loop on slot < MAX_AMCS_PER_CRATE
+  // the next initializeAction reads the connection file again
+  gem::hw::GEMHwConnectionRegistry::getInstance().clear();
   CMSGEMOS_INFO("OptoHybridManager::resetAction end");
 }
 
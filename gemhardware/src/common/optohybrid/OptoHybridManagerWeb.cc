@@ -7,6 +7,7 @@
 #include "xcept/tools.h"
 
 #include "gem/hw/optohybrid/OptoHybridManager.h"
+#include "gem/hw/optohybrid/HwOptoHybrid.h"
 #include "gem/hw/optohybrid/OptoHybridMonitor.h"
 
 #include "gem/hw/optohybrid/exception/Exception.h"
@@ -56,7 +57,33 @@ void gem::hw::optohybrid::OptoHybridManagerWeb::expertPage(xgi::Input * in, xgi:
 {
   CMSGEMOS_INFO("OptoHybridManagerWeb::expertPage");
   //fill this page with the expert views for the OptoHybridManager
-  *out << "expertPage</br>" << std::endl;
+  *out << "    <div class=\"xdaq-tab-wrapper\">" << std::endl;
+  *out << "      <div class=\"xdaq-tab\" title=\"IPbus profile\"/>"  << std::endl;
+  ipbusProfilePage(in, out);
+  *out << "      </div>" << std::endl;
+  *out << "    </div>" << std::endl;
+}
+
+void gem::hw::optohybrid::OptoHybridManagerWeb::ipbusProfilePage(xgi::Input* in, xgi::Output* out)
+  throw (xgi::exception::Exception)
+{
+  CMSGEMOS_DEBUG("OptoHybridManagerWeb::ipbusProfilePage");
+  // IPbus accesses of every OptoHybrid, if the manager was configured with ProfileIPbus
+  bool profiled = false;
+  for (unsigned int i = 0; i < gem::base::GEMApplication::MAX_AMCS_PER_CRATE; ++i) {
+    for (unsigned int j = 0; j < gem::base::GEMApplication::MAX_OPTOHYBRIDS_PER_AMC; ++j) {
+      auto board = dynamic_cast<gem::hw::optohybrid::OptoHybridManager*>(p_gemFSMApp)->m_optohybrids.at(i).at(j);
+      if (!board)
+        continue;
+      std::shared_ptr<gem::hw::GEMHwProfiler> profiler = board->getProfiler();
+      if (profiler) {
+        profiler->printHTML(*out);
+        profiled = true;
+      }
+    }
+  }
+  if (!profiled)
+    *out << "No OptoHybrid is profiled, set ProfileIPbus in the configuration" << cgicc::br() << std::endl;
 }
 
 /*To be filled in with the application page code*/
@@ -23,7 +23,8 @@ gem::hw::optohybrid::OptoHybridMonitor::OptoHybridMonitor(std::shared_ptr<HwOpto
                                                           OptoHybridManager* optohybridManager,
                                                           int const& index) :
   GEMMonitor(optohybridManager->getApplicationLogger(), static_cast<xdaq::Application*>(optohybridManager), index),
-  p_optohybrid(optohybrid)
+  p_optohybrid(optohybrid),
+  m_readList(m_gemLogger)
 {
   // application info space is added in the base class constructor
   // addInfoSpace("Application", optohybridManager->getApplicationInfoSpace());
@@ -237,58 +238,18 @@ gem::hw::optohybrid::OptoHybridMonitor::~OptoHybridMonitor()
 
 void gem::hw::optohybrid::OptoHybridMonitor::updateMonitorables()
 {
-  // define how to update the desired values
-  // get SYSTEM monitorables
-  // can this be split into two loops, one just to do a list read, the second to fill the InfoSpace with the returned values
+  // all hardware monitorables are read in one batched transaction, then filled into the InfoSpaces
   CMSGEMOS_DEBUG("OptoHybridMonitor: Updating monitorables");
-  for (auto monlist = m_monitorableSetsMap.begin(); monlist != m_monitorableSetsMap.end(); ++monlist) {
-    CMSGEMOS_DEBUG("OptoHybridMonitor: Updating monitorables in set " << monlist->first);
-    for (auto monitem = monlist->second.begin(); monitem != monlist->second.end(); ++monitem) {
-      CMSGEMOS_DEBUG("OptoHybridMonitor: Updating monitorable " << monitem->first);
-      std::stringstream regName;
-      regName << p_optohybrid->getDeviceBaseNode() << "." << monitem->second.regname;
-      uint32_t address = p_optohybrid->getNode(regName.str()).getAddress();
-      uint32_t mask    = p_optohybrid->getNode(regName.str()).getMask();
-      if (monitem->second.updatetype == GEMUpdateType::HW8) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_optohybrid->readReg(address,mask));
-      } else if (monitem->second.updatetype == GEMUpdateType::HW16) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_optohybrid->readReg(address,mask));
-      } else if (monitem->second.updatetype == GEMUpdateType::HW24) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_optohybrid->readReg(address,mask));
-      } else if (monitem->second.updatetype == GEMUpdateType::HW32) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_optohybrid->readReg(address,mask));
-      } else if (monitem->second.updatetype == GEMUpdateType::HW64) {
-        address = p_optohybrid->getNode(regName.str()+".LOWER").getAddress();
-        mask    = p_optohybrid->getNode(regName.str()+".LOWER").getMask();
-        uint32_t lower = p_optohybrid->readReg(address,mask);
-        address = p_optohybrid->getNode(regName.str()+".UPPER").getAddress();
-        mask    = p_optohybrid->getNode(regName.str()+".UPPER").getMask();
-        uint32_t upper = p_optohybrid->readReg(address,mask);
-        (monitem->second.infoSpace)->setUInt64(monitem->first, (((uint64_t)upper) << 32) + lower);
-      } else if (monitem->second.updatetype == GEMUpdateType::I2CSTAT) {
-        std::stringstream strobeReg;
-        strobeReg << regName.str() << ".Strobe." << monitem->first;
-        address = p_optohybrid->getNode(strobeReg.str()).getAddress();
-        mask    = p_optohybrid->getNode(strobeReg.str()).getMask();
-        uint32_t strobe = p_optohybrid->readReg(address,mask);
-        std::stringstream ackReg;
-        ackReg << regName.str() << ".Ack." << monitem->first;
-        address = p_optohybrid->getNode(ackReg.str()).getAddress();
-        mask    = p_optohybrid->getNode(ackReg.str()).getMask();
-        uint32_t ack = p_optohybrid->readReg(address,mask);
-        (monitem->second.infoSpace)->setUInt64(monitem->first, (((uint64_t)ack) << 32) + strobe);
-      } else if (monitem->second.updatetype == GEMUpdateType::PROCESS) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_optohybrid->readReg(address,mask));
-      } else if (monitem->second.updatetype == GEMUpdateType::TRACKER) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_optohybrid->readReg(address,mask));
-      } else if (monitem->second.updatetype == GEMUpdateType::NOUPDATE) {
-        continue;
-      } else {
-        CMSGEMOS_ERROR("OptoHybridMonitor: Unknown update type encountered");
-        continue;
-      }
-    } // end loop over items in list
-  } // end loop over monitorableSets
+  gem::hw::GEMHwProfiler::CallerScope profilerScope("OptoHybridMonitor");
+  m_readList.update(*p_optohybrid, m_monitorableSetsMap, p_optohybrid->getDeviceBaseNode());
+
+  // check a few configuration registers per cycle against what was last written,
+  // a mismatch is logged and repaired by the next differential configure
+  try {
+    p_optohybrid->verifyShadow(16);
+  } catch (gem::hw::exception::HardwareProblem const& e) {
+    CMSGEMOS_WARN("OptoHybridMonitor: unable to verify the configuration registers: " << e.what());
+  }
 }
 
 void gem::hw::optohybrid::OptoHybridMonitor::buildMonitorPage(xgi::Output* out)
@@ -641,7 +602,8 @@ void gem::hw::optohybrid::OptoHybridMonitor::buildOtherCounterTable(xgi::Output*
   for (auto monitem = monset.begin(); monitem != monset.end(); ++monitem) {
     *out << "<tr>"    << std::endl;
 
-    std::string formatted = (monitem->second.infoSpace)->getFormattedItem(monitem->first,monitem->second.format);
+    // the count alone, the rate has its own column
+    std::string formatted = (monitem->second.infoSpace)->getFormattedItem(monitem->first, "dec");
 
     *out << "<td>"    << std::endl
          << monitem->first
@@ -655,9 +617,11 @@ void gem::hw::optohybrid::OptoHybridMonitor::buildOtherCounterTable(xgi::Output*
          << formatted
          << "</td>"   << std::endl;
 
-    // rate
-    *out << "<td id=\"" << monitem->second.infoSpace->name() << "-" << monitem->first << "\">" << std::endl
-         << formatted
+    // rate, averaged over the last monitoring cycles
+    std::string const rateName = gem::base::utils::GEMInfoSpaceToolBox::getRateItemName(monitem->first, true);
+    *out << "<td id=\"" << monitem->second.infoSpace->name() << "-" << rateName << "\">" << std::endl
+         << (monitem->second.infoSpace->find(rateName) ?
+             monitem->second.infoSpace->getFormattedItem(rateName, "rate") : "")
          << "</td>"   << std::endl;
 
     *out << "<td>"    << std::endl
@@ -777,6 +741,7 @@ void gem::hw::optohybrid::OptoHybridMonitor::reset()
   }
 
   CMSGEMOS_DEBUG("OptoHybridMonitor::reset - clearing all maps");
+  m_readList.clear();
   m_infoSpaceMap.clear();
   m_infoSpaceMonitorableSetMap.clear();
   m_monitorableSetInfoSpaceMap.clear();
@@ -0,0 +1,84 @@
+/**
+ * class: GEMCounterRate
+ * description: Instantaneous and averaged rates of a wrapping hardware counter
+ */
+
+#include "gem/hw/utils/GEMCounterRate.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  uint64_t widthMask(unsigned const width)
+  {
+    return (width >= 64) ? ~static_cast<uint64_t>(0) : ((static_cast<uint64_t>(1) << width) - 1);
+  }
+}
+
+gem::hw::utils::GEMCounterRate::GEMCounterRate(unsigned const width, double const timeConstant) :
+  m_width(std::min(std::max(width, 1U), 64U)),
+  m_mask(widthMask(m_width)),
+  m_timeConstant(timeConstant > 0. ? timeConstant : 1.)
+{
+  reset();
+}
+
+void gem::hw::utils::GEMCounterRate::reset()
+{
+  m_hasReading  = false;
+  m_hasRate     = false;
+  m_count       = 0;
+  m_total       = 0;
+  m_nWraps      = 0;
+  m_nResets     = 0;
+  m_rate        = 0.;
+  m_averageRate = 0.;
+  m_timestamp   = clock::time_point();
+}
+
+uint64_t gem::hw::utils::GEMCounterRate::increment(uint64_t const previous, uint64_t const current, unsigned const width)
+{
+  uint64_t const mask = widthMask(width);
+  return ((current & mask) - (previous & mask)) & mask;
+}
+
+bool gem::hw::utils::GEMCounterRate::update(uint64_t const count, clock::time_point const& timestamp)
+{
+  uint64_t const current = count & m_mask;
+  if (!m_hasReading) {
+    m_hasReading = true;
+    m_count      = current;
+    m_timestamp  = timestamp;
+    return false;
+  }
+
+  if (timestamp <= m_timestamp)
+    return false;
+
+  uint64_t const delta = increment(m_count, current, m_width);
+  double const seconds = std::chrono::duration<double>(timestamp - m_timestamp).count();
+  m_timestamp = timestamp;
+
+  if (delta > (m_mask >> 1)) {
+    // more than half the range, the counter was reset rather than wrapped
+    ++m_nResets;
+    m_count = current;
+    return false;
+  }
+
+  if (current < m_count)
+    ++m_nWraps;
+  m_count  = current;
+  m_total += delta;
+  m_rate   = delta/seconds;
+
+  if (!m_hasRate) {
+    m_averageRate = m_rate;
+    m_hasRate     = true;
+  } else {
+    // the weight of the new interval grows with its length
+    double const alpha = 1. - std::exp(-seconds/m_timeConstant);
+    m_averageRate += alpha*(m_rate - m_averageRate);
+  }
+  return true;
+}
@@ -0,0 +1,252 @@
+/**
+ * class: GEMPhaseStatistics
+ * description: Streaming statistics of phase samples, with P-square quantile estimators
+ */
+
+#include "gem/hw/utils/GEMPhaseStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+const size_t gem::hw::utils::GEMPhaseStatistics::N_TRACKED_QUANTILES;
+const std::array<double, gem::hw::utils::GEMPhaseStatistics::N_TRACKED_QUANTILES>
+  gem::hw::utils::GEMPhaseStatistics::TRACKED_QUANTILES = {{0.05, 0.25, 0.5, 0.75, 0.95}};
+
+gem::hw::utils::GEMStreamingQuantile::GEMStreamingQuantile(double const quantile) :
+  m_quantile(std::min(std::max(quantile, 0.), 1.))
+{
+  reset();
+}
+
+void gem::hw::utils::GEMStreamingQuantile::reset()
+{
+  m_count = 0;
+  m_heights.fill(0.);
+  m_positions  = {{1., 2., 3., 4., 5.}};
+  m_desired    = {{1., 1.+2*m_quantile, 1.+4*m_quantile, 3.+2*m_quantile, 5.}};
+  m_increments = {{0., m_quantile/2, m_quantile, (1.+m_quantile)/2, 1.}};
+}
+
+void gem::hw::utils::GEMStreamingQuantile::add(double const sample)
+{
+  if (m_count < 5) {
+    m_heights.at(m_count++) = sample;
+    if (m_count == 5)
+      std::sort(m_heights.begin(), m_heights.end());
+    return;
+  }
+  ++m_count;
+
+  // cell of the sample, the extreme markers follow the minimum and maximum
+  size_t cell;
+  if (sample < m_heights[0]) {
+    m_heights[0] = sample;
+    cell = 0;
+  } else if (sample >= m_heights[4]) {
+    m_heights[4] = sample;
+    cell = 3;
+  } else {
+    cell = 0;
+    while (sample >= m_heights[cell+1])
+      ++cell;
+  }
+
+  for (size_t i = cell+1; i < 5; ++i)
+    m_positions[i] += 1.;
+  for (size_t i = 0; i < 5; ++i)
+    m_desired[i] += m_increments[i];
+
+  // move the middle markers by one position if they are too far from their desired position
+  for (size_t i = 1; i < 4; ++i) {
+    double const offset = m_desired[i] - m_positions[i];
+    if ((offset >=  1. && m_positions[i+1] - m_positions[i] >  1.) ||
+        (offset <= -1. && m_positions[i-1] - m_positions[i] < -1.)) {
+      double const d = (offset > 0.) ? 1. : -1.;
+      double const parabolic = m_heights[i] + d/(m_positions[i+1] - m_positions[i-1])*
+        ((m_positions[i] - m_positions[i-1] + d)*(m_heights[i+1] - m_heights[i])/(m_positions[i+1] - m_positions[i]) +
+         (m_positions[i+1] - m_positions[i] - d)*(m_heights[i] - m_heights[i-1])/(m_positions[i] - m_positions[i-1]));
+      if (m_heights[i-1] < parabolic && parabolic < m_heights[i+1]) {
+        m_heights[i] = parabolic;
+      } else {
+        size_t const j = (d > 0.) ? i+1 : i-1;
+        m_heights[i] += d*(m_heights[j] - m_heights[i])/(m_positions[j] - m_positions[i]);
+      }
+      m_positions[i] += d;
+    }
+  }
+}
+
+double gem::hw::utils::GEMStreamingQuantile::get() const
+{
+  if (m_count == 0)
+    return 0.;
+  if (m_count >= 5)
+    return m_heights[2];
+
+  // nearest rank of the few samples so far
+  std::array<double, 5> sorted = m_heights;
+  std::sort(sorted.begin(), sorted.begin()+m_count);
+  size_t const rank = static_cast<size_t>(std::lround(m_quantile*(m_count-1)));
+  return sorted.at(rank);
+}
+
+gem::hw::utils::GEMPhaseStatistics::GEMPhaseStatistics(double const histLow, double const histHigh, size_t const nBins) :
+  m_histLow(histLow),
+  m_binWidth((histHigh > histLow && nBins > 0) ? (histHigh - histLow)/nBins : 1.),
+  m_histogram(std::max(nBins, static_cast<size_t>(1)), 0)
+{
+  for (size_t i = 0; i < N_TRACKED_QUANTILES; ++i)
+    m_quantiles.at(i) = GEMStreamingQuantile(TRACKED_QUANTILES.at(i));
+  reset();
+}
+
+void gem::hw::utils::GEMPhaseStatistics::reset()
+{
+  m_count      = 0;
+  m_mean       = 0.;
+  m_sumSquares = 0.;
+  m_min        = std::numeric_limits<double>::max();
+  m_max        = std::numeric_limits<double>::lowest();
+  for (auto quantile = m_quantiles.begin(); quantile != m_quantiles.end(); ++quantile)
+    quantile->reset();
+  m_merged = false;
+  std::fill(m_histogram.begin(), m_histogram.end(), 0);
+  m_underflow = 0;
+  m_overflow  = 0;
+}
+
+void gem::hw::utils::GEMPhaseStatistics::add(double const sample)
+{
+  ++m_count;
+  double const delta = sample - m_mean;
+  m_mean       += delta/m_count;
+  m_sumSquares += delta*(sample - m_mean);
+  if (sample < m_min)
+    m_min = sample;
+  if (sample > m_max)
+    m_max = sample;
+
+  for (auto quantile = m_quantiles.begin(); quantile != m_quantiles.end(); ++quantile)
+    quantile->add(sample);
+
+  if (sample < m_histLow) {
+    ++m_underflow;
+  } else {
+    size_t const bin = static_cast<size_t>((sample - m_histLow)/m_binWidth);
+    if (bin < m_histogram.size())
+      ++m_histogram[bin];
+    else
+      ++m_overflow;
+  }
+}
+
+void gem::hw::utils::GEMPhaseStatistics::add(std::vector<uint32_t> const& samples)
+{
+  for (auto sample = samples.begin(); sample != samples.end(); ++sample)
+    add(static_cast<double>(*sample));
+}
+
+double gem::hw::utils::GEMPhaseStatistics::getRMS() const
+{
+  return (m_count > 1) ? std::sqrt(m_sumSquares/m_count) : 0.;
+}
+
+double gem::hw::utils::GEMPhaseStatistics::getMedian() const
+{
+  return getPercentile(50.);
+}
+
+double gem::hw::utils::GEMPhaseStatistics::getPercentile(double const percentile) const
+{
+  if (m_count == 0)
+    return 0.;
+
+  double const fraction = std::min(std::max(percentile/100., 0.), 1.);
+  if (fraction == 0.)
+    return m_min;
+  if (fraction == 1.)
+    return m_max;
+
+  if (!m_merged)
+    for (auto quantile = m_quantiles.begin(); quantile != m_quantiles.end(); ++quantile)
+      if (std::fabs(quantile->getQuantile() - fraction) < 1e-9)
+        return quantile->get();
+
+  return histogramPercentile(fraction);
+}
+
+double gem::hw::utils::GEMPhaseStatistics::histogramPercentile(double const fraction) const
+{
+  // linear interpolation within the bin, the under and overflows are at the minimum and maximum
+  double const target = fraction*m_count;
+  double seen = static_cast<double>(m_underflow);
+  if (target <= seen)
+    return m_min;
+  for (size_t bin = 0; bin < m_histogram.size(); ++bin) {
+    double const inBin = static_cast<double>(m_histogram[bin]);
+    if (seen + inBin >= target && inBin > 0.) {
+      double const low  = std::max(getBinLowEdge(bin),   m_min);
+      double const high = std::min(getBinLowEdge(bin+1), m_max);
+      return low + (high - low)*(target - seen)/inBin;
+    }
+    seen += inBin;
+  }
+  return m_max;
+}
+
+void gem::hw::utils::GEMPhaseStatistics::merge(GEMPhaseStatistics const& other)
+{
+  if (other.m_count == 0)
+    return;
+
+  // Chan et al. combination of the means and squared differences
+  uint64_t const count = m_count + other.m_count;
+  double const delta = other.m_mean - m_mean;
+  m_sumSquares += other.m_sumSquares + delta*delta*m_count*other.m_count/count;
+  m_mean       += delta*other.m_count/count;
+  m_count       = count;
+  m_min = std::min(m_min, other.m_min);
+  m_max = std::max(m_max, other.m_max);
+  m_merged = true;
+
+  if (other.m_histLow == m_histLow && other.m_binWidth == m_binWidth &&
+      other.m_histogram.size() == m_histogram.size()) {
+    for (size_t bin = 0; bin < m_histogram.size(); ++bin)
+      m_histogram[bin] += other.m_histogram[bin];
+    m_underflow += other.m_underflow;
+    m_overflow  += other.m_overflow;
+  } else {
+    // rebin the other histogram by the centers of its bins
+    for (size_t bin = 0; bin < other.m_histogram.size(); ++bin) {
+      double const center = other.getBinLowEdge(bin) + other.m_binWidth/2;
+      if (center < m_histLow) {
+        m_underflow += other.m_histogram[bin];
+      } else {
+        size_t const target = static_cast<size_t>((center - m_histLow)/m_binWidth);
+        if (target < m_histogram.size())
+          m_histogram[target] += other.m_histogram[bin];
+        else
+          m_overflow += other.m_histogram[bin];
+      }
+    }
+    m_underflow += other.m_underflow;
+    m_overflow  += other.m_overflow;
+  }
+}
+
+std::string gem::hw::utils::GEMPhaseStatistics::toString() const
+{
+  std::stringstream os;
+  os << "samples " << m_count;
+  if (m_count > 0)
+    os << " mean "   << getMean()
+       << " rms "    << getRMS()
+       << " min "    << getMin()
+       << " p5 "     << getPercentile(5.)
+       << " median " << getMedian()
+       << " p95 "    << getPercentile(95.)
+       << " max "    << getMax();
+  return os.str();
+}
@@ -1,5 +1,6 @@
 #include "gem/hw/vfat/HwVFAT2.h"
 
+#include "gem/hw/GEMHwTransaction.h"
 #include "gem/hw/optohybrid/HwOptoHybrid.h"
 
 gem::hw::vfat::HwVFAT2::HwVFAT2(std::string const& vfatDevice,
@@ -106,7 +107,7 @@ std::string gem::hw::vfat::HwVFAT2::printErrorCounts() const {
             << "Invalid:    " << m_vfatErrors.Invalid    << std::endl
             << "RWMismatch: " << m_vfatErrors.RWMismatch << std::endl
             << gem::hw::GEMHwDevice::printErrorCounts() << std::endl;
-  CMSGEMOS_DEBUG(errstream);
+  CMSGEMOS_DEBUG(errstream.str());
   return errstream.str();
 }
 
@@ -302,15 +303,19 @@ void gem::hw::vfat::HwVFAT2::readVFAT2Counters()
 
 void gem::hw::vfat::HwVFAT2::readVFAT2Channel(uint8_t channel)
 {
-  uint8_t chanSettings = getChannelSettings(channel);
+  readVFAT2Channel(channel, getChannelSettings(channel));
+}
+
+void gem::hw::vfat::HwVFAT2::readVFAT2Channel(uint8_t channel, uint8_t chanSettings)
+{
   if (channel > 1)
     m_vfatParams.activeChannel = (unsigned)channel;
   m_vfatParams.channels[channel-1].fullChannelReg = chanSettings;
   m_vfatParams.channels[channel-1].calPulse0 = false;
   if (channel == 1)
-    m_vfatParams.channels[channel-1].calPulse0 = ((chanSettings&VFAT2ChannelBitMasks::CHANCAL0) << VFAT2ChannelBitShifts::CHANCAL0);
-  m_vfatParams.channels[channel-1].calPulse    = ((chanSettings&VFAT2ChannelBitMasks::CHANCAL ) << VFAT2ChannelBitShifts::CHANCAL );
-  m_vfatParams.channels[channel-1].mask        = ((chanSettings&VFAT2ChannelBitMasks::ISMASKED) << VFAT2ChannelBitShifts::ISMASKED);
+    m_vfatParams.channels[channel-1].calPulse0 = ((chanSettings&VFAT2ChannelBitMasks::CHANCAL0) >> VFAT2ChannelBitShifts::CHANCAL0);
+  m_vfatParams.channels[channel-1].calPulse    = ((chanSettings&VFAT2ChannelBitMasks::CHANCAL ) >> VFAT2ChannelBitShifts::CHANCAL );
+  m_vfatParams.channels[channel-1].mask        = ((chanSettings&VFAT2ChannelBitMasks::ISMASKED) >> VFAT2ChannelBitShifts::ISMASKED);
   m_vfatParams.channels[channel-1].trimDAC     = ((chanSettings&VFAT2ChannelBitMasks::TRIMDAC ) << VFAT2ChannelBitShifts::TRIMDAC );
   CMSGEMOS_DEBUG("readVFAT2Channel " << (unsigned)channel << " - 0x"
         << std::hex << static_cast<unsigned>(m_vfatParams.channels[channel-1].fullChannelReg) << std::dec << "::<"
@@ -323,20 +328,141 @@ void gem::hw::vfat::HwVFAT2::readVFAT2Channel(uint8_t channel)
 
 void gem::hw::vfat::HwVFAT2::readVFAT2Channels()
 {
+  std::vector<uint8_t> chanRegs;
+  readChannelRegs(chanRegs);
   for (uint8_t chan = 1; chan < 129; ++chan) {
     //readVFAT2Channel(m_vfatParams, chan);
-    readVFAT2Channel(chan);
+    readVFAT2Channel(chan, chanRegs.at(chan-1));
     CMSGEMOS_DEBUG("chan = "<< (unsigned)chan << "; activeChannel = " <<(unsigned)m_vfatParams.activeChannel << std::endl);
   }
 }
 
-void gem::hw::vfat::HwVFAT2::setAllSettings(const gem::hw::vfat::VFAT2ControlParams &params)
+gem::hw::vfat::HwVFAT2::image_register_list gem::hw::vfat::HwVFAT2::imageRegisters(VFAT2Image& image,
+                                                                                    bool withReadOnly)
+{
+  image_register_list regs = {
+    {"ContReg0",    &image.control0},
+    {"ContReg1",    &image.control1},
+    {"ContReg2",    &image.control2},
+    {"ContReg3",    &image.control3},
+    {"Latency",     &image.latency},
+    {"IPreampIn",   &image.iPreampIn},
+    {"IPreampFeed", &image.iPreampFeed},
+    {"IPreampOut",  &image.iPreampOut},
+    {"IShaper",     &image.iShaper},
+    {"IShaperFeed", &image.iShaperFeed},
+    {"IComp",       &image.iComp},
+    {"VCal",        &image.vCal},
+    {"VThreshold1", &image.vThresh1},
+    {"VThreshold2", &image.vThresh2},
+    {"CalPhase",    &image.calPhase}
+  };
+  for (unsigned chan = 1; chan < N_VFAT2_CHANNELS+1; ++chan)
+    regs.push_back(std::make_pair(toolbox::toString("VFATChannels.ChanReg%d", chan), &image.channels[chan-1]));
+  if (withReadOnly) {
+    regs.push_back(std::make_pair("ChipID0",   &image.chipID0));
+    regs.push_back(std::make_pair("ChipID1",   &image.chipID1));
+    regs.push_back(std::make_pair("UpsetReg",  &image.upsetReg));
+    regs.push_back(std::make_pair("HitCount0", &image.hitCount0));
+    regs.push_back(std::make_pair("HitCount1", &image.hitCount1));
+    regs.push_back(std::make_pair("HitCount2", &image.hitCount2));
+  }
+  return regs;
+}
+
+void gem::hw::vfat::HwVFAT2::readImage(VFAT2Image& image)
+{
+  image_register_list regs = imageRegisters(image, true);
+  std::vector<uint32_t> raw(regs.size(), 0x0);
+
+  GEMHwTransaction trans(*this);
+  for (size_t reg = 0; reg < regs.size(); ++reg)
+    trans.read(getDeviceBaseNode()+"."+regs[reg].first, raw[reg]);
+  trans.commit();
+
+  // same status bits as in readVFATReg
+  std::string failed;
+  for (size_t reg = 0; reg < regs.size(); ++reg) {
+    if ((raw[reg] >> 26) & 0x1) {
+      ++m_vfatErrors.Error;
+      failed += " " + regs[reg].first;
+      continue;
+    }
+    *(regs[reg].second) = raw[reg] & 0xff;
+  }
+  CMSGEMOS_DEBUG("HwVFAT2::readImage read " << regs.size() << " registers with "
+                 << trans.dispatchCount() << " dispatches");
+  if (!failed.empty()) {
+    std::string msg = "VFAT transaction error bit set reading registers" + failed;
+    CMSGEMOS_ERROR(msg);
+    XCEPT_RAISE(gem::hw::vfat::exception::TransactionError, msg);
+  }
+}
+
+size_t gem::hw::vfat::HwVFAT2::writeImage(VFAT2Image const& image, bool withLatency, bool changedOnly)
+{
+  VFAT2Image values = image;
+  image_register_list regs = imageRegisters(values, false);
+
+  register_pair_list settings;
+  for (auto reg = regs.begin(); reg != regs.end(); ++reg)
+    if (withLatency || reg->first != "Latency")
+      settings.push_back(std::make_pair(getDeviceBaseNode()+"."+reg->first, static_cast<uint32_t>(*(reg->second))));
+  // a full write is recorded in the shadow as well, for the next changedOnly write to compare with
+  if (!changedOnly)
+    invalidateShadow();
+  size_t const nWritten = writeChangedRegs(settings);
+  CMSGEMOS_DEBUG("HwVFAT2::writeImage wrote " << nWritten << " of " << settings.size() << " registers");
+  return nWritten;
+}
+
+void gem::hw::vfat::HwVFAT2::readChannelRegs(std::vector<uint8_t>& chanRegs)
 {
-  // want to lock the hardware while performing this operation
-  // when sending all these requests, might it be better to do a single transaction?
+  std::vector<uint32_t> raw(N_VFAT2_CHANNELS, 0x0);
+  GEMHwTransaction trans(*this);
+  for (unsigned chan = 1; chan < N_VFAT2_CHANNELS+1; ++chan)
+    trans.read(getDeviceBaseNode()+toolbox::toString(".VFATChannels.ChanReg%d", chan), raw[chan-1]);
+  trans.commit();
+
+  chanRegs.assign(N_VFAT2_CHANNELS, 0x0);
+  std::string failed;
+  for (unsigned chan = 1; chan < N_VFAT2_CHANNELS+1; ++chan) {
+    if ((raw[chan-1] >> 26) & 0x1) {
+      ++m_vfatErrors.Error;
+      failed += toolbox::toString(" %d", chan);
+      continue;
+    }
+    chanRegs[chan-1] = raw[chan-1] & 0xff;
+  }
+  if (!failed.empty()) {
+    std::string msg = "VFAT transaction error bit set reading channels" + failed;
+    CMSGEMOS_ERROR(msg);
+    XCEPT_RAISE(gem::hw::vfat::exception::TransactionError, msg);
+  }
+}
 
+size_t gem::hw::vfat::HwVFAT2::writeChannelRegs(std::vector<uint8_t> const& chanRegs, bool changedOnly)
+{
+  if (chanRegs.size() != N_VFAT2_CHANNELS) {
+    std::string msg = toolbox::toString("Expected %d channel settings, got %d",
+                                        N_VFAT2_CHANNELS, static_cast<int>(chanRegs.size()));
+    CMSGEMOS_ERROR(msg);
+    XCEPT_RAISE(gem::hw::exception::ValueError, msg);
+  }
+  register_pair_list settings;
+  for (unsigned chan = 1; chan < N_VFAT2_CHANNELS+1; ++chan)
+    settings.push_back(std::make_pair(getDeviceBaseNode()+toolbox::toString(".VFATChannels.ChanReg%d", chan),
+                                      static_cast<uint32_t>(chanRegs[chan-1])));
+  if (!changedOnly)
+    invalidateShadow();
+  return writeChangedRegs(settings);
+}
+
+size_t gem::hw::vfat::HwVFAT2::setAllSettings(const gem::hw::vfat::VFAT2ControlParams &params, bool changedOnly)
+{
   // check that the hardware is alive
   // check that the settings are non-empty?
+  VFAT2Image image;
   uint8_t cont0 = 0x0;
   uint8_t cont1 = 0x0;
   uint8_t cont2 = 0x0;
@@ -347,147 +473,121 @@ void gem::hw::vfat::HwVFAT2::setAllSettings(const gem::hw::vfat::VFAT2ControlPar
   setMSPolarity(     params.msPol     , cont0);
   setCalPolarity(    params.calPol    , cont0);
   setCalibrationMode(params.calibMode , cont0);
-  writeVFATReg("ContReg0", cont0);
+  image.control0 = cont0;
 
   setDACMode(          params.dacMode  , cont1);
   setProbeMode(        params.probeMode, cont1);
   setLVDSMode(         params.lvdsMode , cont1);
   setHitCountCycleTime(params.reHitCT  , cont1);
-  writeVFATReg("ContReg1", cont1);
+  image.control1 = cont1;
 
   setHitCountMode( params.hitCountMode, cont2);
   setMSPulseLength(params.msPulseLen  , cont2);
   setInputPadMode( params.digInSel    , cont2);
-  writeVFATReg("ContReg2", cont2);
+  image.control2 = cont2;
 
   setTrimDACRange(   params.trimDACRange   , cont3);
   setBandgapPad(     params.padBandGap     , cont3);
   sendTestPattern   (params.sendTestPattern, cont3);
-  writeVFATReg("ContReg3", cont3);
+  image.control3 = cont3;
 
-  setIPreampIn(  params.iPreampIn  );
-  setIPreampFeed(params.iPreampFeed);
-  setIPreampOut( params.iPreampOut );
-  setIShaper(    params.iShaper    );
-  setIShaperFeed(params.iShaperFeed);
-  setIComp(      params.iComp      );
+  image.iPreampIn   = params.iPreampIn;
+  image.iPreampFeed = params.iPreampFeed;
+  image.iPreampOut  = params.iPreampOut;
+  image.iShaper     = params.iShaper;
+  image.iShaperFeed = params.iShaperFeed;
+  image.iComp       = params.iComp;
 
-  setVCal(       params.vCal    );
-  setVThreshold1(params.vThresh1);
-  setVThreshold2(params.vThresh2);
-  setCalPhase(   params.calPhase);
+  image.vCal     = params.vCal;
+  image.vThresh1 = params.vThresh1;
+  image.vThresh2 = params.vThresh2;
+  image.calPhase = params.calPhase;
 
   // set the channel settings here
-  // channel 0/1
-  uint8_t chanReg = 0x0;
-  chanReg|=(params.channels[0].trimDAC   << VFAT2ChannelBitShifts::TRIMDAC );
-  chanReg|=(params.channels[0].mask      << VFAT2ChannelBitShifts::ISMASKED);
-  chanReg|=(params.channels[0].calPulse  << VFAT2ChannelBitShifts::CHANCAL );
-  chanReg|=(params.channels[0].calPulse0 << VFAT2ChannelBitShifts::CHANCAL0);
-  writeVFATReg("VFATChannels.ChanReg1", chanReg);
-
-  for (uint8_t chan = 2; chan < N_VFAT2_CHANNELS+1; ++chan) {
-    chanReg = 0x0;
+  for (uint8_t chan = 1; chan < N_VFAT2_CHANNELS+1; ++chan) {
+    uint8_t chanReg = 0x0;
     chanReg|=(params.channels[chan-1].trimDAC  << VFAT2ChannelBitShifts::TRIMDAC );
     chanReg|=(params.channels[chan-1].mask     << VFAT2ChannelBitShifts::ISMASKED);
     chanReg|=(params.channels[chan-1].calPulse << VFAT2ChannelBitShifts::CHANCAL );
-    writeVFATReg(toolbox::toString("VFATChannels.ChanReg%d", (unsigned)chan), (unsigned)chanReg);
+    // channel 0/1
+    if (chan == 1)
+      chanReg|=(params.channels[0].calPulse0 << VFAT2ChannelBitShifts::CHANCAL0);
+    image.channels[chan-1] = chanReg;
   }
+
+  // all registers in one transaction, the latency is left to setLatency as before
+  return writeImage(image, false, changedOnly);
 }
 
 void gem::hw::vfat::HwVFAT2::getAllSettings()
 {
-  // want to lock the hardware (and the params variable) while performing this operation
-  // when sending all these requests, might it be better to do a single transaction?
-  // check that the hardware is alive
-  // maybe find a way to do a single transaction, using the vector read/write?
-  // what is the performance cost/benefit
+  // all registers are read in a single transaction
+  // want to lock the params variable while performing this operation
 
   CMSGEMOS_DEBUG("getting all settings in HwVFAT2.cc");
+  VFAT2Image image;
   try {
-    uint8_t cont0 = readVFATReg("ContReg0");
-    uint8_t cont1 = readVFATReg("ContReg1");
-    uint8_t cont2 = readVFATReg("ContReg2");
-    uint8_t cont3 = readVFATReg("ContReg3");
-
-    m_vfatParams.control0 = static_cast<unsigned>(cont0);
-    m_vfatParams.control1 = static_cast<unsigned>(cont1);
-    m_vfatParams.control2 = static_cast<unsigned>(cont2);
-    m_vfatParams.control3 = static_cast<unsigned>(cont3);
-
-    m_vfatParams.runMode   = static_cast<VFAT2RunMode  >(getRunMode(        cont0));
-    m_vfatParams.trigMode  = static_cast<VFAT2TrigMode >(getTriggerMode(    cont0));
-    m_vfatParams.msPol     = static_cast<VFAT2MSPol    >(getMSPolarity(     cont0));
-    m_vfatParams.calPol    = static_cast<VFAT2CalPol   >(getCalPolarity(    cont0));
-    m_vfatParams.calibMode = static_cast<VFAT2CalibMode>(getCalibrationMode(cont0));
-
-    m_vfatParams.dacMode   = static_cast<VFAT2DACMode  >(getDACMode(          cont1));
-    m_vfatParams.probeMode = static_cast<VFAT2ProbeMode>(getProbeMode(        cont1));
-    m_vfatParams.lvdsMode  = static_cast<VFAT2LVDSMode >(getLVDSMode(         cont1));
-    m_vfatParams.reHitCT   = static_cast<VFAT2ReHitCT  >(getHitCountCycleTime(cont1));
-
-    m_vfatParams.hitCountMode = static_cast<VFAT2HitCountMode >(getHitCountMode( cont2));
-    m_vfatParams.msPulseLen   = static_cast<VFAT2MSPulseLength>(getMSPulseLength(cont2));
-    m_vfatParams.digInSel     = static_cast<VFAT2DigInSel     >(getInputPadMode( cont2));
-
-    m_vfatParams.trimDACRange    = static_cast<VFAT2TrimDACRange >(getTrimDACRange(   cont3));
-    m_vfatParams.padBandGap      = static_cast<VFAT2PadBandgap   >(getBandgapPad(     cont3));
-    m_vfatParams.sendTestPattern = static_cast<VFAT2DFTestPattern>(getTestPatternMode(cont3));
+    readImage(image);
   } catch (gem::hw::vfat::exception::TransactionError const& e) {
-    CMSGEMOS_WARN("Problem reading the control registers, transaction error bit set");
-  } catch (gem::hw::vfat::exception::InvalidTransaction const& e) {
-    CMSGEMOS_WARN("Problem reading the control registers, invalid transaction bit set");
-  } catch (gem::hw::vfat::exception::WrongTransaction const& e) {
-    CMSGEMOS_WARN("Problem reading the control registers, wrong transaction bit set");
+    // the registers with the error bit are not in the image, keep the previous settings
+    CMSGEMOS_WARN("Problem reading the VFAT registers, transaction error bit set: " << e.what());
+    return;
+  } catch (gem::hw::exception::HardwareProblem const& e) {
+    CMSGEMOS_WARN("Problem reading the VFAT registers: " << e.what());
+    return;
   }
 
-  try {
-    m_vfatParams.latency = getLatency();
-
-    m_vfatParams.iPreampIn   = getIPreampIn();
-    m_vfatParams.iPreampFeed = getIPreampFeed();
-    m_vfatParams.iPreampOut  = getIPreampOut();
-    m_vfatParams.iShaper     = getIShaper();
-    m_vfatParams.iShaperFeed = getIShaperFeed();
-    m_vfatParams.iComp       = getIComp();
-
-    m_vfatParams.vCal     = getVCal();
-    m_vfatParams.vThresh1 = getVThreshold1();
-    m_vfatParams.vThresh2 = getVThreshold2();
-    m_vfatParams.calPhase = getCalPhase();
-  } catch (gem::hw::vfat::exception::TransactionError const& e) {
-    CMSGEMOS_WARN("Problem reading the analog settings registers, transaction error bit set");
-  } catch (gem::hw::vfat::exception::InvalidTransaction const& e) {
-    CMSGEMOS_WARN("Problem reading the analog settings registers, invalid transaction bit set");
-  } catch (gem::hw::vfat::exception::WrongTransaction const& e) {
-    CMSGEMOS_WARN("Problem reading the analog settings registers, wrong transaction bit set");
-  }
+  uint8_t const cont0 = image.control0;
+  uint8_t const cont1 = image.control1;
+  uint8_t const cont2 = image.control2;
+  uint8_t const cont3 = image.control3;
+
+  m_vfatParams.control0 = static_cast<unsigned>(cont0);
+  m_vfatParams.control1 = static_cast<unsigned>(cont1);
+  m_vfatParams.control2 = static_cast<unsigned>(cont2);
+  m_vfatParams.control3 = static_cast<unsigned>(cont3);
+
+  m_vfatParams.runMode   = static_cast<VFAT2RunModeT >(getRunMode(        cont0));
+  m_vfatParams.trigMode  = static_cast<VFAT2TrigModeT>(getTriggerMode(    cont0));
+  m_vfatParams.msPol     = static_cast<VFAT2MSPolT   >(getMSPolarity(     cont0));
+  m_vfatParams.calPol    = static_cast<VFAT2CalPolT  >(getCalPolarity(    cont0));
+  m_vfatParams.calibMode = static_cast<VFAT2CalModeT >(getCalibrationMode(cont0));
+
+  m_vfatParams.dacMode   = static_cast<VFAT2DACModeT  >(getDACMode(          cont1));
+  m_vfatParams.probeMode = static_cast<VFAT2ProbeModeT>(getProbeMode(        cont1));
+  m_vfatParams.lvdsMode  = static_cast<VFAT2LVDSModeT >(getLVDSMode(         cont1));
+  m_vfatParams.reHitCT   = static_cast<VFAT2ReHitCTT  >(getHitCountCycleTime(cont1));
+
+  m_vfatParams.hitCountMode = static_cast<VFAT2HitCountModeT >(getHitCountMode( cont2));
+  m_vfatParams.msPulseLen   = static_cast<VFAT2MSPulseLengthT>(getMSPulseLength(cont2));
+  m_vfatParams.digInSel     = static_cast<VFAT2DigInSelT     >(getInputPadMode( cont2));
+
+  m_vfatParams.trimDACRange    = static_cast<VFAT2TrimDACRangeT >(getTrimDACRange(   cont3));
+  m_vfatParams.padBandGap      = static_cast<VFAT2PbBGT         >(getBandgapPad(     cont3));
+  m_vfatParams.sendTestPattern = static_cast<VFAT2DFTestPatternT>(getTestPatternMode(cont3));
+
+  m_vfatParams.latency = image.latency;
+
+  m_vfatParams.iPreampIn   = image.iPreampIn;
+  m_vfatParams.iPreampFeed = image.iPreampFeed;
+  m_vfatParams.iPreampOut  = image.iPreampOut;
+  m_vfatParams.iShaper     = image.iShaper;
+  m_vfatParams.iShaperFeed = image.iShaperFeed;
+  m_vfatParams.iComp       = image.iComp;
+
+  m_vfatParams.vCal     = image.vCal;
+  m_vfatParams.vThresh1 = image.vThresh1;
+  m_vfatParams.vThresh2 = image.vThresh2;
+  m_vfatParams.calPhase = image.calPhase;
 
   // counters
-  CMSGEMOS_DEBUG("getting all counters in HwVFAT2.cc");
-  // readVFAT2Counters(params);
-  try {
-    readVFAT2Counters();
-  } catch (gem::hw::vfat::exception::TransactionError const& e) {
-    CMSGEMOS_WARN("Problem reading the VFAT counter registers, transaction error bit set");
-  } catch (gem::hw::vfat::exception::InvalidTransaction const& e) {
-    CMSGEMOS_WARN("Problem reading the VFAT counter registers, invalid transaction bit set");
-  } catch (gem::hw::vfat::exception::WrongTransaction const& e) {
-    CMSGEMOS_WARN("Problem reading the VFAT counter registers, wrong transaction bit set");
-  }
+  m_vfatParams.chipID       = (image.chipID1<<8)|image.chipID0;
+  m_vfatParams.upsetCounter = image.upsetReg;
+  m_vfatParams.hitCounter   = (image.hitCount2<<16)|(image.hitCount1<<8)|image.hitCount0;
 
-  // set the channel settings here
-  CMSGEMOS_DEBUG("getting all channel settings in HwVFAT2.cc");
-  // readVFAT2Channels(params);
-  try {
-    readVFAT2Channels();
-  } catch (gem::hw::vfat::exception::TransactionError const& e) {
-    CMSGEMOS_WARN("Problem reading the VFAT channel registers, transaction error bit set");
-  } catch (gem::hw::vfat::exception::InvalidTransaction const& e) {
-    CMSGEMOS_WARN("Problem reading the VFAT channel registers, invalid transaction bit set");
-  } catch (gem::hw::vfat::exception::WrongTransaction const& e) {
-    CMSGEMOS_WARN("Problem reading the VFAT channel registers, wrong transaction bit set");
-  }
+  // channel settings
+  for (uint8_t chan = 1; chan < N_VFAT2_CHANNELS+1; ++chan)
+    readVFAT2Channel(chan, image.channels[chan-1]);
   CMSGEMOS_DEBUG("done getting all settings in HwVFAT2.cc");
 }
 
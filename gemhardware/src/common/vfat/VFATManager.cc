@@ -10,6 +10,7 @@
 #include "gem/hw/vfat/VFATManager.h"
 
 #include "gem/hw/vfat/HwVFAT2.h"
+#include "gem/hw/GEMHwConnectionRegistry.h"
 //#include "gem/hw/vfat/exception/Exception.h"
 
 XDAQ_INSTANTIATOR_IMPL(gem::hw::vfat::VFATManager);
@@ -359,6 +360,8 @@ void gem::hw::vfat::VFATManager::resetAction()
         is_vfats[slot]->fireItemRevoked("IPBusPort");
     }
   }
+  // the next initializeAction reads the connection file again
+  gem::hw::GEMHwConnectionRegistry::getInstance().clear();
 }
 
 /*
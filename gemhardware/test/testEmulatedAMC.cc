@@ -0,0 +1,520 @@
+#include "gem/hw/GEMHwAddressTable.h"
+#include "gem/hw/GEMHwExecutor.h"
+#include "gem/hw/GEMHwMonitorCache.h"
+#include "gem/hw/GEMHwRetryPolicy.h"
+#include "gem/hw/GEMHwTransaction.h"
+#include "gem/hw/HwGenericAMC.h"
+#include "gem/hw/exception/Exception.h"
+#include "gem/hw/optohybrid/HwOptoHybrid.h"
+#include "gem/hw/vfat/HwVFAT2.h"
+#include "gem/hw/emulator/EmulatorServer.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "toolbox/string.h"
+#include "uhal/uhal.hpp"
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE EmulatedAMC
+#include <boost/test/unit_test.hpp>
+
+using gem::hw::emulator::EmulatorServer;
+
+/**
+ * The address tables are not shipped with the sources, the tests pass without checking anything
+ * when GEM_ADDRESS_TABLE_PATH does not hold the tables of connections_emulator.xml
+ */
+#define REQUIRE_ADDRESS_TABLES()                                        \
+  if (!board) {                                                         \
+    BOOST_TEST_MESSAGE("skipped, the address tables of connections_emulator.xml are not in GEM_ADDRESS_TABLE_PATH"); \
+    return;                                                             \
+  }
+
+namespace {
+  // served on the port of gem.shelf01.amc01 in connections_emulator.xml
+  std::string const AMC_DEVICE  = "gem.shelf01.amc01";
+  uint16_t    const AMC_PORT    = 50001;
+  std::string const OH_DEVICE   = "gem.shelf01.amc01.optohybrid00";
+  std::string const OH_NODE     = "GEM_AMC.OH.OH0.GEB.";
+  std::string const VFAT_NODE   = "GEM_AMC.OH.OH0.GEB.VFATS.VFAT0.";
+  std::string const AMC_TABLE   = "uhal_gem_amc_glib.xml";
+  // the CTP7 of connections_emulator.xml, with the tracking data FIFOs
+  std::string const CTP7_DEVICE = "gem.shelf01.amc02";
+  std::string const FIFO_NODE   = "GEM_AMC.TRK_DATA.OptoHybrid_0.";
+
+  // ports of the boards served with a degraded link, one per test as uhal keeps its clients
+  uint16_t const LATENCY_PORT   = 50011;
+  uint16_t const BUS_ERROR_PORT = 50012;
+
+  std::string addressTablePath()
+  {
+    char const* path = std::getenv("GEM_ADDRESS_TABLE_PATH");
+    return path ? path : "";
+  }
+
+  bool haveAddressTables()
+  {
+    std::string const path = addressTablePath();
+    if (path.empty())
+      return false;
+    std::vector<std::string> const tables = {AMC_TABLE, "uhal_gem_amc_ctp7_amc.xml",
+                                             "uhal_gem_amc_ctp7_link00.xml", "uhal_gem_amc_ctp7_link01.xml"};
+    for (auto table = tables.begin(); table != tables.end(); ++table)
+      if (!std::ifstream((path + "/" + *table).c_str()).good())
+        return false;
+    return true;
+  }
+
+  /**
+   * The boards of connections_emulator.xml, from ${GEM_ADDRESS_TABLE_PATH} as the devices read it,
+   * served once for all the tests: uhal keeps its clients, and their packet IDs, between the tests.
+   * The server is not started without the address tables
+   */
+  EmulatorServer& getServer()
+  {
+    static EmulatorServer server;
+    static bool const haveTables = haveAddressTables();
+    if (haveTables && !server.isRunning()) {
+      server.addBoards(addressTablePath() + "/connections_emulator.xml");
+      server.start();
+    }
+    return server;
+  }
+
+  /**
+   * The AMC of connections_emulator.xml served alone on port, with the link settings given
+   */
+  std::shared_ptr<EmulatorServer> serveDegraded(uint16_t const port, EmulatorServer::Settings const& settings)
+  {
+    uhal::ConnectionManager manager("file://" + addressTablePath() + "/connections_emulator.xml");
+    uhal::HwInterface hw = manager.getDevice(AMC_DEVICE);
+    std::shared_ptr<gem::hw::emulator::EmulatorBoard> board =
+      std::make_shared<gem::hw::emulator::EmulatorBoard>(toolbox::toString("degraded%d", port));
+    board->addAddressTable(gem::hw::GEMHwAddressTable(hw));
+
+    std::shared_ptr<EmulatorServer> server = std::make_shared<EmulatorServer>(settings);
+    server->addBoard(port, board);
+    server->start();
+    return server;
+  }
+
+  std::string degradedURI(uint16_t const port)
+  {
+    return toolbox::toString("ipbusudp-2.0://localhost:%d", port);
+  }
+
+  std::string amcTable()
+  {
+    return "file://" + addressTablePath() + "/" + AMC_TABLE;
+  }
+
+  /**
+   * The default policy, without backoff, recording the class of every error it is asked about
+   */
+  class RecordingPolicy : public gem::hw::GEMHwRetryPolicy
+  {
+  public:
+    RecordingPolicy() : gem::hw::GEMHwRetryPolicy(DEFAULT_MAX_ATTEMPTS, 0, 0) {};
+
+    virtual int classify(std::string const& errCode) const
+    {
+      int const errClass = gem::hw::GEMHwRetryPolicy::classify(errCode);
+      classes.push_back(errClass);
+      return errClass;
+    }
+
+    mutable std::vector<int> classes;
+  };
+
+  struct EmulatedCrate {
+    EmulatedCrate() :
+      server(getServer()),
+      board(server.isRunning() ? server.getBoard(AMC_PORT) : nullptr)
+    {
+      if (server.isRunning())
+        BOOST_REQUIRE(board);
+    }
+
+    EmulatorServer& server;
+    std::shared_ptr<gem::hw::emulator::EmulatorBoard> board;
+  };
+}
+
+BOOST_FIXTURE_TEST_SUITE(EmulatedAMC, EmulatedCrate)
+
+BOOST_AUTO_TEST_CASE(Connect)
+{
+  REQUIRE_ADDRESS_TABLES();
+  // "GLIB"
+  board->poke("GEM_AMC.GEM_SYSTEM.BOARD_ID", 0x474c4942);
+  board->poke("GEM_AMC.GEM_SYSTEM.CONFIG.NUM_OF_OH", 2);
+
+  gem::hw::HwGenericAMC amc(AMC_DEVICE, "connections_emulator.xml");
+  BOOST_CHECK_EQUAL(amc.getBoardID(), "GLIB");
+  BOOST_CHECK_EQUAL(amc.getSupportedOptoHybrids(), 2U);
+  BOOST_CHECK(amc.isHwConnected());
+}
+
+BOOST_AUTO_TEST_CASE(ReadWrite)
+{
+  REQUIRE_ADDRESS_TABLES();
+  gem::hw::HwGenericAMC amc(AMC_DEVICE, "connections_emulator.xml");
+  amc.writeReg("GEM_AMC.TTC.CTRL.L1A_ENABLE", 0x1);
+  BOOST_CHECK_EQUAL(amc.readReg("GEM_AMC.TTC.CTRL.L1A_ENABLE"), 0x1U);
+  BOOST_CHECK_EQUAL(board->peek("GEM_AMC.TTC.CTRL.L1A_ENABLE"), 0x1U);
+  amc.writeReg("GEM_AMC.TTC.CTRL.L1A_ENABLE", 0x0);
+  BOOST_CHECK_EQUAL(amc.readReg("GEM_AMC.TTC.CTRL.L1A_ENABLE"), 0x0U);
+}
+
+BOOST_AUTO_TEST_CASE(Counters)
+{
+  REQUIRE_ADDRESS_TABLES();
+  gem::hw::HwGenericAMC amc(AMC_DEVICE, "connections_emulator.xml");
+  uint32_t const first = amc.getL1ACount();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  BOOST_CHECK_GT(amc.getL1ACount(), first);
+
+  // counting restarts from 0 after the counter reset
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  uint32_t const beforeReset = amc.getL1ACount();
+  amc.resetL1ACount();
+  BOOST_CHECK_LT(amc.getL1ACount(), beforeReset);
+}
+
+BOOST_AUTO_TEST_CASE(Statistics)
+{
+  REQUIRE_ADDRESS_TABLES();
+  gem::hw::HwGenericAMC amc(AMC_DEVICE, "connections_emulator.xml");
+  uint64_t const replies = server.getStatistics().Replies;
+  amc.readReg("GEM_AMC.TTC.CTRL.L1A_ENABLE");
+  EmulatorServer::Statistics const stats = server.getStatistics();
+  BOOST_CHECK_GT(stats.Replies, replies);
+  BOOST_CHECK_EQUAL(stats.Dropped, 0U);
+  BOOST_CHECK_EQUAL(stats.BusErrors, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(VFAT2Image)
+{
+  REQUIRE_ADDRESS_TABLES();
+  gem::hw::optohybrid::HwOptoHybrid oh(OH_DEVICE, "connections_emulator.xml");
+  gem::hw::vfat::HwVFAT2 vfat(oh, 0);
+
+  gem::hw::vfat::HwVFAT2::VFAT2Image image;
+  image.control0 = 0x37;
+  image.control2 = 0x30;
+  image.latency  = 0x5;
+  image.vThresh1 = 0x28;
+  image.vCal     = 0xc8;
+  for (unsigned chan = 0; chan < gem::hw::vfat::HwVFAT2::N_VFAT2_CHANNELS; ++chan)
+    image.channels[chan] = chan & 0x1f;
+  vfat.writeImage(image);
+  BOOST_CHECK_EQUAL(board->peek(VFAT_NODE+"ContReg0"), 0x37U);
+  BOOST_CHECK_EQUAL(board->peek(VFAT_NODE+"VFATChannels.ChanReg128"), 127U & 0x1f);
+
+  gem::hw::vfat::HwVFAT2::VFAT2Image readBack;
+  vfat.readImage(readBack);
+  BOOST_CHECK_EQUAL(readBack.control0, image.control0);
+  BOOST_CHECK_EQUAL(readBack.control2, image.control2);
+  BOOST_CHECK_EQUAL(readBack.latency,  image.latency);
+  BOOST_CHECK_EQUAL(readBack.vThresh1, image.vThresh1);
+  BOOST_CHECK_EQUAL(readBack.vCal,     image.vCal);
+  for (unsigned chan = 0; chan < gem::hw::vfat::HwVFAT2::N_VFAT2_CHANNELS; ++chan)
+    BOOST_CHECK_EQUAL(readBack.channels[chan], image.channels[chan]);
+
+  // the latency is left alone when asked to
+  image.latency = 0x9;
+  vfat.writeImage(image, false);
+  BOOST_CHECK_EQUAL(board->peek(VFAT_NODE+"Latency"), 0x5U);
+}
+
+BOOST_AUTO_TEST_CASE(VFAT2Channels)
+{
+  REQUIRE_ADDRESS_TABLES();
+  gem::hw::optohybrid::HwOptoHybrid oh(OH_DEVICE, "connections_emulator.xml");
+  gem::hw::vfat::HwVFAT2 vfat(oh, 0);
+
+  std::vector<uint8_t> chanRegs(gem::hw::vfat::HwVFAT2::N_VFAT2_CHANNELS, 0x20);
+  chanRegs[41] = 0x4f;
+  vfat.writeChannelRegs(chanRegs);
+  BOOST_CHECK_EQUAL(board->peek(VFAT_NODE+"VFATChannels.ChanReg42"), 0x4fU);
+
+  std::vector<uint8_t> readBack;
+  vfat.readChannelRegs(readBack);
+  BOOST_CHECK(readBack == chanRegs);
+
+  // a partial set of channels is refused before anything is written
+  chanRegs.pop_back();
+  BOOST_CHECK_THROW(vfat.writeChannelRegs(chanRegs), gem::hw::exception::ValueError);
+
+  // a VFAT that did not answer sets the transaction error bit
+  board->poke(VFAT_NODE+"VFATChannels.ChanReg7", 0x1 << 26);
+  BOOST_CHECK_THROW(vfat.readChannelRegs(readBack), gem::hw::vfat::exception::TransactionError);
+  board->poke(VFAT_NODE+"VFATChannels.ChanReg7", 0x20);
+}
+
+BOOST_AUTO_TEST_CASE(VFAT2ChangedOnly)
+{
+  REQUIRE_ADDRESS_TABLES();
+  gem::hw::optohybrid::HwOptoHybrid oh(OH_DEVICE, "connections_emulator.xml");
+  gem::hw::vfat::HwVFAT2 vfat(oh, 0);
+
+  gem::hw::vfat::HwVFAT2::VFAT2Image image;
+  image.control0 = 0x37;
+  image.vThresh1 = 0x28;
+  size_t const nRegs = vfat.writeImage(image);
+  BOOST_CHECK_GT(nRegs, gem::hw::vfat::HwVFAT2::N_VFAT2_CHANNELS);
+
+  // nothing changed, nothing written
+  BOOST_CHECK_EQUAL(vfat.writeImage(image, true, true), 0U);
+  image.vThresh1 = 0x30;
+  BOOST_CHECK_EQUAL(vfat.writeImage(image, true, true), 1U);
+  BOOST_CHECK_EQUAL(board->peek(VFAT_NODE+"VThreshold1"), 0x30U);
+
+  // a register changed behind the back of the device is found by the verification and written again
+  board->poke(VFAT_NODE+"ContReg0", 0x36);
+  BOOST_CHECK_EQUAL(vfat.verifyShadow(), 1U);
+  BOOST_CHECK_EQUAL(vfat.writeImage(image, true, true), 1U);
+  BOOST_CHECK_EQUAL(board->peek(VFAT_NODE+"ContReg0"), 0x37U);
+
+  // a full write writes everything again
+  BOOST_CHECK_EQUAL(vfat.writeImage(image), nRegs);
+}
+
+BOOST_AUTO_TEST_CASE(BroadcastRead)
+{
+  REQUIRE_ADDRESS_TABLES();
+  gem::hw::optohybrid::HwOptoHybrid oh(OH_DEVICE, "connections_emulator.xml");
+  board->poke(OH_NODE+"VFATS.VFAT2.VThreshold1", 0x0);
+
+  // VFAT0 and VFAT1 only
+  uint32_t const mask = 0xfffffffc;
+  oh.broadcastWrite("VThreshold1", 0x42, mask);
+  BOOST_CHECK_EQUAL(board->peek(OH_NODE+"VFATS.VFAT0.VThreshold1"), 0x42U);
+  BOOST_CHECK_EQUAL(board->peek(OH_NODE+"VFATS.VFAT1.VThreshold1"), 0x42U);
+  BOOST_CHECK_EQUAL(board->peek(OH_NODE+"VFATS.VFAT2.VThreshold1"), 0x0U);
+
+  board->poke(OH_NODE+"VFATS.VFAT1.Latency", 0x11);
+  std::vector<std::string> const regs = {"VThreshold1", "Latency"};
+  std::map<std::string, std::vector<uint32_t> > results = oh.broadcastRead(regs, mask);
+  BOOST_REQUIRE_EQUAL(results["VThreshold1"].size(), 2U);
+  BOOST_REQUIRE_EQUAL(results["Latency"].size(), 2U);
+  // one result per VFAT, (n << 8) | value
+  BOOST_CHECK_EQUAL(results["VThreshold1"].at(0) & 0xff, 0x42U);
+  BOOST_CHECK_EQUAL(results["VThreshold1"].at(1) & 0xff, 0x42U);
+  BOOST_CHECK_EQUAL((results["Latency"].at(1) >> 8) & 0xff, 1U);
+  BOOST_CHECK_EQUAL(results["Latency"].at(1) & 0xff, 0x11U);
+
+  // the single register read gives the same results
+  std::vector<uint32_t> const single = oh.broadcastRead("VThreshold1", mask);
+  BOOST_CHECK(single == results["VThreshold1"]);
+}
+
+BOOST_AUTO_TEST_CASE(FIFO)
+{
+  REQUIRE_ADDRESS_TABLES();
+  gem::hw::HwGenericAMC ctp7(CTP7_DEVICE, "connections_emulator.xml");
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  uint32_t const depth = ctp7.readReg(FIFO_NODE+"DEPTH");
+  BOOST_REQUIRE_GE(depth, 7U);
+  BOOST_CHECK_EQUAL(ctp7.readReg(FIFO_NODE+"ISEMPTY"), 0x0U);
+  std::vector<uint32_t> const block = ctp7.readBlock(FIFO_NODE+"FIFO", 7);
+  BOOST_CHECK_EQUAL(block.size(), 7U);
+
+  // flushed and read back in the same dispatch, before the FIFO fills again
+  uint32_t flushed = depth;
+  gem::hw::GEMHwTransaction trans(ctp7);
+  trans.write(FIFO_NODE+"FLUSH", 0x1);
+  trans.read(FIFO_NODE+"DEPTH", flushed);
+  trans.commit();
+  BOOST_CHECK_EQUAL(flushed, 0x0U);
+}
+
+BOOST_AUTO_TEST_CASE(ScanModule)
+{
+  REQUIRE_ADDRESS_TABLES();
+  gem::hw::optohybrid::HwOptoHybrid oh(OH_DEVICE, "connections_emulator.xml");
+
+  uint32_t const nTrigs = 100;
+  oh.configureScanModule(0x0, 0, 0, 0, 10, 1, nTrigs, false, true);
+  oh.startScanModule(nTrigs, false);
+  BOOST_CHECK_GT(oh.getScanStatus(false), 0U);
+
+  // waits for the end of the scan, one result per point, (point << 24) | hits
+  std::vector<uint32_t> const results = oh.getScanResults(11);
+  BOOST_REQUIRE_EQUAL(results.size(), 11U);
+  for (uint32_t point = 0; point < results.size(); ++point) {
+    BOOST_CHECK_EQUAL(results.at(point) >> 24, point);
+    BOOST_CHECK_LE(results.at(point) & 0xffffff, nTrigs);
+  }
+  BOOST_CHECK_EQUAL(oh.getScanStatus(false), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(Transaction)
+{
+  REQUIRE_ADDRESS_TABLES();
+  gem::hw::HwGenericAMC amc(AMC_DEVICE, "connections_emulator.xml");
+  board->poke("GEM_AMC.TTC.CTRL.L1A_ENABLE", 0x0);
+
+  gem::hw::GEMHwTransaction trans(amc);
+  trans.write("GEM_AMC.TTC.CTRL.L1A_ENABLE", 0x1);
+  std::shared_future<uint32_t> enabled = trans.read("GEM_AMC.TTC.CTRL.L1A_ENABLE");
+  uint32_t boardID = 0;
+  trans.read("GEM_AMC.GEM_SYSTEM.BOARD_ID", boardID);
+  BOOST_CHECK_EQUAL(trans.size(), 3U);
+  trans.commit();
+  BOOST_CHECK(trans.empty());
+  BOOST_CHECK_EQUAL(trans.dispatchCount(), 1U);
+  BOOST_CHECK_EQUAL(enabled.get(), 0x1U);
+  BOOST_CHECK_EQUAL(boardID, board->peek("GEM_AMC.GEM_SYSTEM.BOARD_ID"));
+
+  // operations that do not fit in one packet are split over several dispatches
+  gem::hw::GEMHwTransaction small(amc, 20);
+  std::vector<std::shared_future<uint32_t> > reads;
+  for (int i = 0; i < 50; ++i)
+    reads.push_back(small.read("GEM_AMC.TTC.CTRL.L1A_ENABLE"));
+  small.commit();
+  BOOST_CHECK_GT(small.dispatchCount(), 1U);
+  for (auto read = reads.begin(); read != reads.end(); ++read)
+    BOOST_CHECK_EQUAL(read->get(), 0x1U);
+
+  // an unknown register is refused when it is queued
+  BOOST_CHECK_THROW(trans.read("GEM_AMC.NO.SUCH.REGISTER"), gem::hw::exception::HardwareProblem);
+  board->poke("GEM_AMC.TTC.CTRL.L1A_ENABLE", 0x0);
+}
+
+BOOST_AUTO_TEST_CASE(Executor)
+{
+  REQUIRE_ADDRESS_TABLES();
+  gem::hw::HwGenericAMC amc(AMC_DEVICE, "connections_emulator.xml");
+  board->poke("GEM_AMC.TTC.CTRL.L1A_ENABLE", 0x1);
+
+  // requests arriving within the window share a dispatch
+  amc.startExecutor(64, 2000);
+  std::shared_ptr<gem::hw::GEMHwExecutor> executor = amc.getExecutor();
+  BOOST_REQUIRE(executor);
+  std::vector<std::shared_future<uint32_t> > reads;
+  for (int i = 0; i < 10; ++i)
+    reads.push_back(executor->readReg("GEM_AMC.TTC.CTRL.L1A_ENABLE"));
+  for (auto read = reads.begin(); read != reads.end(); ++read)
+    BOOST_CHECK_EQUAL(read->get(), 0x1U);
+  BOOST_CHECK_GE(executor->requestCount(), 10U);
+  BOOST_CHECK_LT(executor->batchCount(), executor->requestCount());
+
+  executor->writeReg("GEM_AMC.TTC.CTRL.L1A_ENABLE", 0x0).get();
+  BOOST_CHECK_EQUAL(board->peek("GEM_AMC.TTC.CTRL.L1A_ENABLE"), 0x0U);
+
+  executor->submit([](gem::hw::GEMHwDevice& device) {
+      device.writeReg("GEM_AMC.TTC.CTRL.L1A_ENABLE", 0x1);
+    }).get();
+  BOOST_CHECK_EQUAL(board->peek("GEM_AMC.TTC.CTRL.L1A_ENABLE"), 0x1U);
+
+  // the error of a failed request is rethrown by its future
+  std::shared_future<uint32_t> bad = executor->readReg("GEM_AMC.NO.SUCH.REGISTER");
+  BOOST_CHECK_THROW(bad.get(), gem::hw::exception::HardwareProblem);
+
+  amc.stopExecutor();
+  BOOST_CHECK(!amc.getExecutor());
+  board->poke("GEM_AMC.TTC.CTRL.L1A_ENABLE", 0x0);
+}
+
+BOOST_AUTO_TEST_CASE(MonitorCache)
+{
+  REQUIRE_ADDRESS_TABLES();
+  gem::hw::HwGenericAMC amc(AMC_DEVICE, "connections_emulator.xml");
+  board->poke("GEM_AMC.TTC.CTRL.L1A_ENABLE", 0x1);
+
+  std::shared_ptr<gem::hw::GEMHwMonitorCache> cache = gem::hw::GEMHwMonitorCache::getCache(amc);
+  BOOST_CHECK(cache == gem::hw::GEMHwMonitorCache::getCache(amc));
+
+  std::vector<gem::hw::GEMHwDevice::RegHandle> handles;
+  handles.push_back(amc.resolve("GEM_AMC.TTC.CTRL.L1A_ENABLE"));
+  handles.push_back(amc.resolve("GEM_AMC.GEM_SYSTEM.BOARD_ID"));
+  // polled rarely, the test reads through fetch only
+  gem::hw::GEMHwMonitorCache::subscription_id const id = cache->subscribe(amc, handles, 600000);
+  BOOST_CHECK_GE(cache->subscribers(), 1U);
+
+  std::vector<uint32_t> values;
+  gem::hw::GEMHwMonitorCache::clock::time_point const first = cache->fetch(id, values, std::chrono::seconds(0));
+  BOOST_REQUIRE_EQUAL(values.size(), 2U);
+  BOOST_CHECK_EQUAL(values.at(0), 0x1U);
+  BOOST_CHECK_EQUAL(values.at(1), board->peek("GEM_AMC.GEM_SYSTEM.BOARD_ID"));
+
+  // fresh values are served from the cache, stale ones are read again
+  board->poke("GEM_AMC.TTC.CTRL.L1A_ENABLE", 0x0);
+  BOOST_CHECK(cache->fetch(id, values, std::chrono::hours(1)) == first);
+  BOOST_CHECK_EQUAL(values.at(0), 0x1U);
+  BOOST_CHECK(cache->fetch(id, values, std::chrono::seconds(0)) > first);
+  BOOST_CHECK_EQUAL(values.at(0), 0x0U);
+
+  cache->unsubscribe(id);
+  BOOST_CHECK_THROW(cache->fetch(id, values, std::chrono::seconds(0)), gem::hw::exception::HardwareProblem);
+}
+
+BOOST_AUTO_TEST_CASE(Latency)
+{
+  REQUIRE_ADDRESS_TABLES();
+  EmulatorServer::Settings settings;
+  settings.LatencyUsec = 5000;
+  std::shared_ptr<EmulatorServer> degraded = serveDegraded(LATENCY_PORT, settings);
+  gem::hw::HwGenericAMC amc("gem.emulator.latency", degradedURI(LATENCY_PORT), amcTable());
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  amc.readReg("GEM_AMC.TTC.CTRL.L1A_ENABLE");
+  double const single = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now()-start).count();
+  BOOST_CHECK_GE(single, settings.LatencyUsec);
+
+  // ten reads in one dispatch wait for the latency once
+  gem::hw::GEMHwTransaction trans(amc);
+  for (int i = 0; i < 10; ++i)
+    trans.read("GEM_AMC.TTC.CTRL.L1A_ENABLE");
+  start = std::chrono::steady_clock::now();
+  trans.commit();
+  double const batch = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now()-start).count();
+  BOOST_CHECK_EQUAL(trans.dispatchCount(), 1U);
+  BOOST_CHECK_LT(batch, 5*settings.LatencyUsec);
+}
+
+BOOST_AUTO_TEST_CASE(RetryPolicy)
+{
+  REQUIRE_ADDRESS_TABLES();
+  EmulatorServer::Settings settings;
+  settings.BusErrorRate = 1.;
+  std::shared_ptr<EmulatorServer> degraded = serveDegraded(BUS_ERROR_PORT, settings);
+  gem::hw::HwGenericAMC amc("gem.emulator.buserror", degradedURI(BUS_ERROR_PORT), amcTable());
+  std::shared_ptr<RecordingPolicy> policy = std::make_shared<RecordingPolicy>();
+  amc.setRetryPolicy(policy);
+  BOOST_CHECK(amc.getRetryPolicy() == policy);
+
+  // a read is repeated once after a bus error
+  uint64_t busErrors = degraded->getStatistics().BusErrors;
+  gem::hw::GEMHwTransaction trans(amc);
+  std::shared_future<uint32_t> read = trans.read("GEM_AMC.TTC.CTRL.L1A_ENABLE");
+  BOOST_CHECK_THROW(trans.commit(), gem::hw::exception::HardwareProblem);
+  BOOST_CHECK_THROW(read.get(), gem::hw::exception::HardwareProblem);
+  BOOST_REQUIRE_EQUAL(policy->classes.size(), 2U);
+  BOOST_CHECK_EQUAL(policy->classes.at(0), gem::hw::GEMHwRetryPolicy::ErrorClass::BUS_ERROR);
+  BOOST_CHECK_EQUAL(degraded->getStatistics().BusErrors, busErrors + 2);
+
+  // a write is never repeated, but its error is still classified
+  busErrors = degraded->getStatistics().BusErrors;
+  trans.write("GEM_AMC.TTC.CTRL.L1A_ENABLE", 0x1);
+  BOOST_CHECK_THROW(trans.commit(), gem::hw::exception::HardwareProblem);
+  BOOST_CHECK_EQUAL(policy->classes.size(), 3U);
+  BOOST_CHECK_EQUAL(degraded->getStatistics().BusErrors, busErrors + 1);
+
+  // permanent errors, and accesses out of attempts, are never retried
+  gem::hw::GEMHwRetryPolicy const noRetry(1);
+  BOOST_CHECK(!noRetry.shouldRetry(gem::hw::GEMHwRetryPolicy::ErrorClass::TIMEOUT, 1));
+  BOOST_CHECK(!policy->shouldRetry(gem::hw::GEMHwRetryPolicy::ErrorClass::BAD_ADDRESS, 1));
+  BOOST_CHECK(policy->shouldRetry(gem::hw::GEMHwRetryPolicy::ErrorClass::TIMEOUT, 1));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,123 @@
+#include "gem/hw/utils/GEMCounterRate.h"
+
+#include <cmath>
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE GEMCounterRate
+#include <boost/test/unit_test.hpp>
+
+using gem::hw::utils::GEMCounterRate;
+
+namespace {
+  GEMCounterRate::clock::time_point at(double const seconds)
+  {
+    return GEMCounterRate::clock::time_point() +
+      std::chrono::duration_cast<GEMCounterRate::clock::duration>(std::chrono::duration<double>(seconds));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(CounterRate)
+
+BOOST_AUTO_TEST_CASE(Increment)
+{
+    BOOST_CHECK_EQUAL(GEMCounterRate::increment(10, 25, 32), 15U);
+    BOOST_CHECK_EQUAL(GEMCounterRate::increment(0xfffffff0, 0x10, 32), 0x20U);
+    BOOST_CHECK_EQUAL(GEMCounterRate::increment(0xff, 0x01, 8), 2U);
+    BOOST_CHECK_EQUAL(GEMCounterRate::increment(0x1ff, 0x101, 8), 2U);  // bits above the width are ignored
+    BOOST_CHECK_EQUAL(GEMCounterRate::increment(~0ULL, 1, 64), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(FirstReading)
+{
+    GEMCounterRate rate(32, 10.);
+    BOOST_CHECK(!rate.update(100, at(1.)));
+    BOOST_CHECK(!rate.valid());
+    BOOST_CHECK_EQUAL(rate.getCount(), 100U);
+    BOOST_CHECK_EQUAL(rate.getTotal(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(Rate)
+{
+    GEMCounterRate rate(32, 10.);
+    rate.update(100, at(1.));
+    BOOST_CHECK(rate.update(300, at(3.)));
+    BOOST_CHECK(rate.valid());
+    BOOST_CHECK_CLOSE(rate.getRate(), 100., 1e-6);
+    BOOST_CHECK_CLOSE(rate.getAverageRate(), 100., 1e-6);  // the first rate seeds the average
+    BOOST_CHECK_EQUAL(rate.getTotal(), 200U);
+}
+
+BOOST_AUTO_TEST_CASE(NotLater)
+{
+    GEMCounterRate rate(32, 10.);
+    rate.update(100, at(2.));
+    BOOST_CHECK(!rate.update(200, at(2.)));
+    BOOST_CHECK(!rate.update(200, at(1.)));
+    BOOST_CHECK(!rate.valid());
+    BOOST_CHECK_EQUAL(rate.getCount(), 100U);
+}
+
+BOOST_AUTO_TEST_CASE(Wrap)
+{
+    GEMCounterRate rate(32, 10.);
+    rate.update(0xffffff00, at(0.));
+    BOOST_CHECK(rate.update(0x100, at(1.)));
+    BOOST_CHECK_EQUAL(rate.getWraps(), 1U);
+    BOOST_CHECK_EQUAL(rate.getResets(), 0U);
+    BOOST_CHECK_CLOSE(rate.getRate(), 512., 1e-6);
+    BOOST_CHECK_EQUAL(rate.getTotal(), 0x200U);
+}
+
+BOOST_AUTO_TEST_CASE(CounterReset)
+{
+    GEMCounterRate rate(32, 10.);
+    rate.update(1000, at(0.));
+    rate.update(2000, at(1.));
+    // going back is more than half the range forward
+    BOOST_CHECK(!rate.update(10, at(2.)));
+    BOOST_CHECK_EQUAL(rate.getResets(), 1U);
+    BOOST_CHECK_EQUAL(rate.getWraps(), 0U);
+    BOOST_CHECK_EQUAL(rate.getCount(), 10U);
+    BOOST_CHECK_CLOSE(rate.getRate(), 1000., 1e-6);  // the rate of the previous interval is kept
+
+    // the counter restarts from the reading after the reset
+    BOOST_CHECK(rate.update(60, at(3.)));
+    BOOST_CHECK_CLOSE(rate.getRate(), 50., 1e-6);
+    BOOST_CHECK_EQUAL(rate.getTotal(), 1050U);
+}
+
+BOOST_AUTO_TEST_CASE(MovingAverage)
+{
+    GEMCounterRate rate(32, 10.);
+    rate.update(0, at(0.));
+    rate.update(100, at(1.));
+    rate.update(300, at(2.));
+    BOOST_CHECK_CLOSE(rate.getRate(), 200., 1e-6);
+    double const alpha = 1. - std::exp(-1./10.);
+    BOOST_CHECK_CLOSE(rate.getAverageRate(), 100. + alpha*100., 1e-6);
+
+    // a longer interval weighs more
+    GEMCounterRate slow(32, 10.);
+    slow.update(0, at(0.));
+    slow.update(100, at(1.));
+    slow.update(100+200*10, at(11.));
+    BOOST_CHECK_GT(slow.getAverageRate(), rate.getAverageRate());
+    BOOST_CHECK_LT(slow.getAverageRate(), 200.);
+}
+
+BOOST_AUTO_TEST_CASE(Reset)
+{
+    GEMCounterRate rate(32, 10.);
+    rate.update(0, at(0.));
+    rate.update(100, at(1.));
+    rate.reset();
+    BOOST_CHECK(!rate.valid());
+    BOOST_CHECK_EQUAL(rate.getTotal(), 0U);
+    // after a reset the next reading is a first reading, even if it is lower
+    BOOST_CHECK(!rate.update(5, at(2.)));
+    BOOST_CHECK_EQUAL(rate.getResets(), 0U);
+    BOOST_CHECK(rate.update(15, at(3.)));
+    BOOST_CHECK_CLOSE(rate.getRate(), 10., 1e-6);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
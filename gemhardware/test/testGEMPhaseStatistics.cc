@@ -0,0 +1,120 @@
+#include "gem/hw/utils/GEMPhaseStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE GEMPhaseStatistics
+#include <boost/test/unit_test.hpp>
+
+using gem::hw::utils::GEMPhaseStatistics;
+using gem::hw::utils::GEMStreamingQuantile;
+
+BOOST_AUTO_TEST_SUITE(PhaseStatistics)
+
+BOOST_AUTO_TEST_CASE(Empty)
+{
+    GEMPhaseStatistics stats;
+    BOOST_CHECK_EQUAL(stats.getCount(), 0U);
+    BOOST_CHECK_EQUAL(stats.getMedian(), 0.);
+    BOOST_CHECK_EQUAL(stats.getRMS(), 0.);
+}
+
+BOOST_AUTO_TEST_CASE(FewSamples)
+{
+    // up to five samples the quantiles are exact
+    GEMStreamingQuantile median(0.5);
+    median.add(30.);
+    median.add(10.);
+    median.add(20.);
+    BOOST_CHECK_EQUAL(median.get(), 20.);
+
+    GEMPhaseStatistics stats;
+    stats.add(std::vector<uint32_t>{{1, 2, 3, 4, 5}});
+    BOOST_CHECK_EQUAL(stats.getCount(), 5U);
+    BOOST_CHECK_CLOSE(stats.getMean(), 3., 1e-9);
+    BOOST_CHECK_CLOSE(stats.getRMS(), std::sqrt(2.), 1e-9);
+    BOOST_CHECK_EQUAL(stats.getMedian(), 3.);
+    BOOST_CHECK_EQUAL(stats.getMin(), 1.);
+    BOOST_CHECK_EQUAL(stats.getMax(), 5.);
+    BOOST_CHECK_EQUAL(stats.getPercentile(0.), 1.);
+    BOOST_CHECK_EQUAL(stats.getPercentile(100.), 5.);
+}
+
+BOOST_AUTO_TEST_CASE(StreamingQuantiles)
+{
+    std::mt19937 random(42);
+    std::normal_distribution<double> phase(2000., 50.);
+    std::vector<double> samples;
+    GEMPhaseStatistics stats;
+    for (int i = 0; i < 20000; ++i) {
+        samples.push_back(phase(random));
+        stats.add(samples.back());
+    }
+    std::sort(samples.begin(), samples.end());
+
+    double const exact[] = {samples.at(samples.size()/20),   samples.at(samples.size()/4), samples.at(samples.size()/2),
+                            samples.at(3*samples.size()/4), samples.at(19*samples.size()/20)};
+    double const percentiles[] = {5., 25., 50., 75., 95.};
+    for (size_t i = 0; i < 5; ++i)
+        BOOST_CHECK_SMALL(stats.getPercentile(percentiles[i]) - exact[i], 2.);
+    BOOST_CHECK_SMALL(stats.getMean() - 2000., 2.);
+    BOOST_CHECK_SMALL(stats.getRMS() - 50., 2.);
+
+    // other percentiles come from the histogram, within a bin of 64
+    BOOST_CHECK_SMALL(stats.getPercentile(10.) - samples.at(samples.size()/10), 64.);
+}
+
+BOOST_AUTO_TEST_CASE(Histogram)
+{
+    GEMPhaseStatistics stats(0., 100., 10);
+    stats.add(-1.);
+    stats.add(5.);
+    stats.add(15.);
+    stats.add(15.5);
+    stats.add(100.);
+    BOOST_CHECK_EQUAL(stats.getUnderflow(), 1U);
+    BOOST_CHECK_EQUAL(stats.getOverflow(), 1U);
+    BOOST_CHECK_EQUAL(stats.getHistogram().at(0), 1U);
+    BOOST_CHECK_EQUAL(stats.getHistogram().at(1), 2U);
+    BOOST_CHECK_EQUAL(stats.getBinLowEdge(3), 30.);
+}
+
+BOOST_AUTO_TEST_CASE(Merge)
+{
+    GEMPhaseStatistics first, second, all;
+    for (uint32_t i = 0; i < 100; ++i) {
+        first.add(1000. + i);
+        all.add(1000. + i);
+    }
+    for (uint32_t i = 0; i < 300; ++i) {
+        second.add(3000. + i);
+        all.add(3000. + i);
+    }
+    first.merge(second);
+    BOOST_CHECK_EQUAL(first.getCount(), all.getCount());
+    BOOST_CHECK_CLOSE(first.getMean(), all.getMean(), 1e-9);
+    BOOST_CHECK_CLOSE(first.getRMS(), all.getRMS(), 1e-9);
+    BOOST_CHECK_EQUAL(first.getMin(), 1000.);
+    BOOST_CHECK_EQUAL(first.getMax(), 3299.);
+    BOOST_CHECK(first.getHistogram() == all.getHistogram());
+    // the median is taken from the merged histogram
+    BOOST_CHECK_GE(first.getMedian(), 3000.);
+    BOOST_CHECK_LE(first.getMedian(), 3299.);
+}
+
+BOOST_AUTO_TEST_CASE(Reset)
+{
+    GEMPhaseStatistics stats;
+    stats.add(std::vector<uint32_t>{{10, 20, 30}});
+    stats.reset();
+    BOOST_CHECK_EQUAL(stats.getCount(), 0U);
+    stats.add(7.);
+    BOOST_CHECK_EQUAL(stats.getMin(), 7.);
+    BOOST_CHECK_EQUAL(stats.getMax(), 7.);
+    BOOST_CHECK_EQUAL(stats.getMedian(), 7.);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
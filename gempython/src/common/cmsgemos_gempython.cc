@@ -155,6 +155,9 @@ BOOST_PYTHON_MODULE(_cmsgemos_gempython) {
     .def("checkPLLLock",                     &gem::hw::HwGenericAMC::checkPLLLock)
     .def("getMMCMPhaseMean",                 &gem::hw::HwGenericAMC::getMMCMPhaseMean)
     .def("getGTHPhaseMean",                  &gem::hw::HwGenericAMC::getGTHPhaseMean)
+    // the medians sample the phase from the host, one read per millisecond
+    .def("getMMCMPhaseMedian",               &gem::hw::HwGenericAMC::getMMCMPhaseMedian)
+    .def("getGTHPhaseMedian",                &gem::hw::HwGenericAMC::getGTHPhaseMedian)
     .def("ttcCounterReset",                  &gem::hw::HwGenericAMC::ttcCounterReset)
     .def("getL1AEnable",                     &gem::hw::HwGenericAMC::getL1AEnable)
     .def("setL1AEnable",                     &gem::hw::HwGenericAMC::setL1AEnable)
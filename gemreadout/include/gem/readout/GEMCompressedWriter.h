@@ -0,0 +1,196 @@
+/** @file GEMCompressedWriter.h */
+
+#ifndef GEM_READOUT_GEMCOMPRESSEDWRITER_H
+#define GEM_READOUT_GEMCOMPRESSEDWRITER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <istream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "toolbox/mem/Reference.h"
+
+#include "gem/utils/GEMLogging.h"
+
+namespace gem {
+  namespace readout {
+
+    /**
+     * @brief Writes readout data to disk through a compression stage running on its own thread
+     * @details Data passed to write() is collected into blocks of roughly blockSize bytes.
+     *          A block is only closed between two write() calls, so a block always holds whole
+     *          events. Pool frames passed to write() are not copied, the block keeps a reference
+     *          to them until it has been written. Full blocks are handed to the writer thread,
+     *          which compresses them and writes each one as a frame:
+     *            FrameHeader (16 bytes) | compressed payload (compressedSize bytes)
+     *          A reader can skip from frame to frame using compressedSize without decompressing,
+     *          see readFrame(). With codec "none" the blocks are written unframed, and the file is
+     *          byte-identical to writing the data directly.
+     *          zlib (through boost::iostreams) is always available; zstd and lz4 are only available
+     *          when built with GEM_READOUT_USE_ZSTD/GEM_READOUT_USE_LZ4, otherwise zlib is used.
+     */
+    class GEMCompressedWriter
+      {
+      public:
+        struct Codecs {
+          enum ECodecs {
+            NONE = 0,
+            ZLIB = 1,
+            ZSTD = 2,
+            LZ4  = 3
+          } Codecs;
+        };
+
+        static const uint32_t FRAME_MAGIC = 0x5a4d4547;  ///< "GEMZ" in little endian
+
+        struct FrameHeader {
+          uint32_t magic;
+          uint16_t codec;
+          uint16_t reserved;
+          uint32_t rawSize;         ///< size of the block before compression
+          uint32_t compressedSize;  ///< size of the payload following the header
+        };
+
+        /**
+         * @param logger used to report the compression statistics and errors
+         * @param codec one of "none", "zlib", "zstd" or "lz4"
+         * @param blockSize target size of an uncompressed block in bytes
+         * @param level compression level, negative for the codec default
+         * @param maxQueued number of blocks waiting for the writer thread before write() blocks
+         */
+        GEMCompressedWriter(log4cplus::Logger& logger, std::string const& codec,
+                            size_t const blockSize=4*1024*1024, int const level=-1,
+                            size_t const maxQueued=4);
+
+        ~GEMCompressedWriter();
+
+        /**
+         * @brief Open the output file in append mode and start the writer thread
+         * @throws gem::readout::exception::OutputProblem if the file cannot be opened
+         */
+        void open(std::string const& fileName);
+
+        /**
+         * @brief Queue data for writing, blocks while the writer thread is maxQueued blocks behind
+         * @throws gem::readout::exception::OutputProblem if the writer thread failed
+         */
+        void write(char const* data, size_t const size);
+
+        /**
+         * @brief Queue a pool frame for writing without copying its payload
+         * The writer holds a duplicate of the reference until the frame is written, so the
+         * caller keeps ownership of frame and releases it as usual
+         * @throws gem::readout::exception::OutputProblem if the writer thread failed
+         */
+        void write(toolbox::mem::Reference* frame);
+
+        /**
+         * @brief Queue part of a pool frame for writing without copying it, e.g., the events behind an I2O header
+         * @param frame pool frame, the caller keeps ownership as for write(frame)
+         * @param offset start of the data in the frame, in bytes
+         * @param size size of the data in bytes
+         * @throws gem::readout::exception::OutputProblem if the writer thread failed
+         */
+        void write(toolbox::mem::Reference* frame, size_t const offset, size_t const size);
+
+        /**
+         * @brief Hand the partially filled block to the writer thread
+         * Use before waiting for pool frames to come back, the pending block holds references to them
+         */
+        void flush() { flushBlock(); };
+
+        /**
+         * @brief Flush the pending block, wait for the writer thread and close the file
+         */
+        void close();
+
+        bool isOpen() const { return m_thread.joinable(); };
+
+        int codec() const { return m_codec; };
+        std::string const& fileName() const { return m_fileName; };
+
+        uint64_t bytesIn()  const { return m_bytesIn.load(std::memory_order_relaxed); };
+        uint64_t bytesOut() const { return m_bytesOut.load(std::memory_order_relaxed); };
+
+        /**
+         * @brief Map a codec name to Codecs, unknown names map to NONE and
+         *        codecs that were not built in fall back to ZLIB
+         */
+        static int parseCodec(std::string const& codec);
+
+        static bool isAvailable(int const codec);
+
+        /**
+         * @brief File name suffix for the codec, e.g., ".zst", empty for NONE
+         */
+        static std::string extension(int const codec);
+
+        /**
+         * @brief Read and decompress the next frame from a framed file
+         * @param in stream positioned at a frame boundary
+         * @param raw filled with the uncompressed block
+         * @returns false at the end of the stream
+         * @throws gem::readout::exception::OutputProblem on a corrupt frame or an unavailable codec
+         */
+        static bool readFrame(std::istream& in, std::vector<char>& raw);
+
+      private:
+        /**
+         * @brief Data of one output block, either copied bytes or references to pool frames
+         */
+        typedef std::vector<std::pair<char const*, size_t> > piece_list;
+
+        struct Block {
+          std::vector<char>                     bytes;
+          std::vector<toolbox::mem::Reference*> frames;
+          piece_list                            framePieces;  ///< data of each frame in frames
+          size_t                                size;
+
+          Block() : size(0) {};
+          bool empty() const { return size == 0; };
+          void release();
+        };
+
+        void writerThread();
+        void flushBlock();
+
+        static void compress(int const codec, int const level, piece_list const& raw, size_t const rawSize,
+                             std::vector<char>& scratch, std::vector<char>& out);
+        static void decompress(int const codec, std::vector<char> const& in, std::vector<char>& raw);
+
+        log4cplus::Logger m_gemLogger;
+
+        int         m_codec;
+        int         m_level;
+        size_t      m_blockSize;
+        size_t      m_maxQueued;
+        std::string m_fileName;
+
+        std::ofstream     m_out;
+        std::thread       m_thread;
+        Block             m_block;  ///< block being filled by write()
+
+        std::mutex              m_queueMutex;
+        std::condition_variable m_queueCondition;
+        std::deque<Block>       m_queue;
+        bool                    m_closing;
+        std::string             m_error;  ///< set by the writer thread on failure
+
+        std::atomic<uint64_t> m_bytesIn;
+        std::atomic<uint64_t> m_bytesOut;
+
+        // Prevent copying
+        GEMCompressedWriter(GEMCompressedWriter const&);
+        GEMCompressedWriter& operator=(GEMCompressedWriter const&);
+      };
+
+  }  // namespace gem::readout
+}  // namespace gem
+
+#endif  // GEM_READOUT_GEMCOMPRESSEDWRITER_H
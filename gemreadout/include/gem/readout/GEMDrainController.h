@@ -0,0 +1,100 @@
+/** @file GEMDrainController.h */
+
+#ifndef GEM_READOUT_GEMDRAINCONTROLLER_H
+#define GEM_READOUT_GEMDRAINCONTROLLER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace gem {
+  namespace readout {
+
+    /**
+     * @brief Sizes the batches used to drain a hardware FIFO over IPbus
+     * @details The controller follows the FIFO occupancy trend (units arriving per
+     *          microsecond) and the latency of the reads (fixed cost plus cost per unit).
+     *          A read is only issued once it would carry at least as many units as arrive
+     *          during one read, so it does not send many tiny IPbus transactions, unless the
+     *          FIFO is above the target fill fraction or the read has already been deferred too
+     *          often. A batch never exceeds the configured maximum.
+     *          The unit is the one of the FIFO occupancy: 32-bit words for the tracking FIFOs of
+     *          the AMCs, batches then being whole VFAT blocks of at most a few IPbus packets, or
+     *          events for the monitor buffer of the AMC13.
+     */
+    class GEMDrainController
+      {
+      public:
+        /// maximum read payload of a single IPbus 2.0 UDP packet, in 32-bit words
+        static const uint32_t IPBUS_MAX_PAYLOAD_WORDS = 350;
+
+        /// capacity of the tracking FIFO of an AMC link, in 32-bit words
+        static const uint32_t TRACKING_FIFO_WORDS = 16384;
+
+        /**
+         * @param blockSize number of units in one block, batches are multiples of this
+         * @param fifoDepth capacity of the FIFO
+         * @param targetFill fill fraction above which the FIFO is always drained with the largest batch
+         * @param maxBatch maximum number of units in one batch, at least one block
+         */
+        GEMDrainController(uint32_t const blockSize=7,
+                           uint32_t const fifoDepth=TRACKING_FIFO_WORDS,
+                           double   const targetFill=0.5,
+                           uint32_t const maxBatch=8*IPBUS_MAX_PAYLOAD_WORDS);
+
+        /**
+         * @brief Change the controller parameters and reset the measured trends
+         */
+        void configure(uint32_t const blockSize, uint32_t const fifoDepth,
+                       double const targetFill, uint32_t const maxBatch);
+
+        /**
+         * @brief Number of units to read next
+         * @param occupancy current FIFO occupancy
+         * @returns the batch size, 0 if the read should be deferred
+         */
+        uint32_t nextBatch(uint32_t const occupancy);
+
+        /**
+         * @brief Feed back the result of a drain
+         * @param nRead number of units read
+         * @param latencyUsec duration of the read in microseconds
+         * @param occupancy FIFO occupancy measured after the read
+         */
+        void update(uint32_t const nRead, double const latencyUsec, uint32_t const occupancy);
+
+        uint32_t lastBatch()     const { return m_lastBatch.load(std::memory_order_relaxed); };
+        double   fillFraction()  const { return m_fillFraction.load(std::memory_order_relaxed); };
+        double   latencyUsec()   const { return m_latencyUsec.load(std::memory_order_relaxed); };
+        double   arrivalRate()   const { return m_arrivalRate; };  ///< units per microsecond
+        uint32_t maxBatch()      const { return m_maxBatch; };
+
+      private:
+        uint32_t roundToBlocks(uint32_t const n) const { return (n/m_blockSize)*m_blockSize; };
+
+        uint32_t m_blockSize;
+        uint32_t m_fifoDepth;
+        double   m_targetFill;
+        uint32_t m_maxBatch;
+
+        // exponentially weighted moving averages of the measured quantities
+        double   m_arrivalRate;    ///< units per microsecond entering the FIFO
+        double   m_fixedUsec;      ///< per-read cost
+        double   m_perUnitUsec;    ///< per-unit cost
+        uint32_t m_lastOccupancy;
+        std::chrono::steady_clock::time_point m_lastUpdate;
+        uint32_t m_deferred;
+
+        // read from the monitoring thread
+        std::atomic<uint32_t> m_lastBatch;
+        std::atomic<double>   m_fillFraction;
+        std::atomic<double>   m_latencyUsec;
+
+        static const uint32_t MAX_DEFERRALS = 16;
+      };
+
+  }  // namespace gem::readout
+}  // namespace gem
+
+#endif  // GEM_READOUT_GEMDRAINCONTROLLER_H
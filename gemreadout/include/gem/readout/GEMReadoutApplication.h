@@ -3,19 +3,28 @@
 #ifndef GEM_READOUT_GEMREADOUTAPPLICATION_H
 #define GEM_READOUT_GEMREADOUTAPPLICATION_H
 
+#include <atomic>
 #include <string>
 #include <queue>
+#include <mutex>
+#include <condition_variable>
 
 #include "i2o/i2o.h"
+#include "i2o/exception/Exception.h"
 
 #include "toolbox/Task.h"
 #include "toolbox/mem/Pool.h"
 #include "toolbox/SyncQueue.h"
+#include "toolbox/TimeVal.h"
+#include "toolbox/task/TimerFactory.h"
+#include "toolbox/task/TimerListener.h"
+#include "toolbox/task/TimerEvent.h"
 
 #include "xoap/MessageReference.h"
 #include "xoap/Method.h"
 
 #include "gem/base/GEMFSMApplication.h"
+#include "gem/readout/GEMDrainController.h"
 
 #include "gem/utils/GEMLogging.h"
 #include "gem/utils/Lock.h"
@@ -25,8 +34,10 @@ namespace gem {
   namespace readout {
 
     class GEMReadoutTask;
+    class GEMReadoutBuffer;
+    class GEMCompressedWriter;
 
-    class GEMReadoutApplication : public gem::base::GEMFSMApplication
+    class GEMReadoutApplication : public gem::base::GEMFSMApplication, public toolbox::task::TimerListener
       {
       public:
         static const int I2O_READOUT_NOTIFY;
@@ -62,8 +73,159 @@ namespace gem {
 
         int readoutTask();
 
+        /**
+         * @brief Publishes the readout queue depth into the application infospace
+         * Called from the queue depth timer, never from the readout thread
+         */
+        virtual void timeExpired(toolbox::task::TimerEvent& event);
+
+        /**
+         * @brief States of the adaptive poll policy used in readoutTask
+         *  - IDLE:    not running, blocked waiting for a command
+         *  - BUSY:    data was found on the last readout call
+         *  - SPIN:    no data, but still within the configured spin budget
+         *  - BACKOFF: no data, sleeping with an exponentially growing interval
+         */
+        struct PollStates {
+          enum EPollStates {
+            IDLE    = 0,
+            BUSY    = 1,
+            SPIN    = 2,
+            BACKOFF = 3
+          } PollStates;
+        };
+
       protected:
 
+        /**
+         * @brief Queue a command for the readout task and wake it up if it is backing off
+         */
+        void pushCommand(int const cmd);
+
+        /**
+         * @brief Record the current depth of the readout data queue
+         * Safe to call from the readout thread for every block, the infospace is only
+         * updated on the publication cadence in timeExpired
+         */
+        void updateQueueDepth(uint64_t const depth) { m_queueDepthCount.store(depth, std::memory_order_relaxed); };
+
+        /**
+         * @brief Reset the queue depth and start the publication timer, if it is not already running
+         */
+        void startQueueDepthTimer();
+
+        /**
+         * @brief Allocate a buffer using the numaNode, hugePages and bufferSize readout settings
+         * Call from the readout task so the memory is local to the CPUs it is pinned to
+         * @param defaultSize size in bytes used when bufferSize is not set
+         */
+        std::shared_ptr<GEMReadoutBuffer> allocateReadoutBuffer(size_t const defaultSize);
+
+        /**
+         * @brief Apply the drain settings to m_drainController
+         * @param blockSize size of a readout block in the unit of the FIFO occupancy, drain batches
+         *        are multiples of this
+         * @param defaultDepth capacity of the FIFO when the fifoDepth setting is 0
+         * @param maxBatch largest batch, 0 for drainMaxPackets IPbus packets of 32-bit words
+         */
+        void configureDrainController(uint32_t const blockSize, uint32_t const defaultDepth,
+                                      uint32_t const maxBatch=0);
+
+        /**
+         * @brief Compressed writer for the given output file, when compression is enabled
+         * The writer is kept open across calls and reopened when the file name changes; the
+         * codec extension is appended to the file name. Call only from the readout task.
+         * @param fileName name of the uncompressed output file
+         * @returns the writer, or NULL if compression is "none" and the caller writes the file itself
+         */
+        GEMCompressedWriter* outputWriter(std::string const& fileName);
+
+        /**
+         * @brief Flush and close the compressed writer, called by the readout task on stop
+         * Output errors are logged, the readout is already stopping
+         */
+        void closeOutputWriter();
+
+        /**
+         * @brief Whether the readout should stop taking events from the hardware
+         * Becomes true when the frame pool passes its high watermark and stays true until it
+         * drains below the low watermark, leaving the data in the hardware buffers as backpressure.
+         * Each true result is counted in PoolExhausted. Call only from the readout task.
+         */
+        bool poolThrottled();
+
+        /**
+         * @brief Get a frame of the given size from the event frame pool
+         * The data size of the frame is set to size. Frames returned in the data vector of
+         * readout() are released by the readout task afterwards.
+         * @returns the frame, or NULL if the pool is exhausted (counted in PoolExhausted)
+         */
+        toolbox::mem::Reference* allocateFrame(size_t const size);
+
+        /**
+         * @brief Get a frame for size bytes of events, with room for the I2O header in front
+         * The events go at eventOffset() in the frame, so the same frame can be written to the
+         * output file and passed to streamFrame() without copying the events again.
+         * @returns the frame, or NULL if the pool is exhausted (counted in PoolExhausted)
+         */
+        toolbox::mem::Reference* allocateEventFrame(size_t const size);
+
+        /**
+         * @brief Offset of the events in a frame from allocateEventFrame(), in bytes
+         */
+        static size_t eventOffset();
+
+        /**
+         * @brief Look up the consumer application from the stream settings
+         * @throws gem::readout::exception::ConfigurationProblem if the consumer is not in the zone
+         */
+        void configureStream();
+
+        bool isStreaming() const { return p_streamDestination != NULL; };
+
+        /**
+         * @brief Whether the readout should wait for the consumer before taking more events
+         * True while streaming with no credits left, each true result is counted in StreamCreditStalls
+         */
+        bool streamThrottled();
+
+        /**
+         * @brief Send events to the consumer as one I2O_READOUT_NOTIFY frame, using one credit
+         * Events that cannot be sent, for lack of credits or frames or because they do not fit in
+         * one I2O frame (256 kB), are dropped from the stream, logged and counted in StreamDropped.
+         * Call only from the readout task
+         * @param data whole events
+         * @param size size of data in bytes
+         * @param nEvents number of events in data
+         * @returns true if the frame was posted
+         */
+        bool streamData(char const* data, size_t const size, uint32_t const nEvents);
+
+        /**
+         * @brief Send the events of a frame from allocateEventFrame() to the consumer, using one credit
+         * The I2O header is filled in place and a duplicate of the reference is posted, the caller
+         * keeps ownership of frame and may hand it to the output writer as well. Dropped events are
+         * counted as for streamData(). Call only from the readout task
+         * @param frame frame from allocateEventFrame() holding the events at eventOffset()
+         * @param size size of the events in bytes
+         * @param nEvents number of events in the frame
+         * @returns true if the frame was posted
+         */
+        bool streamFrame(toolbox::mem::Reference* frame, size_t const size, uint32_t const nEvents);
+
+        /**
+         * @brief I2O_READOUT_CONFIRM handler, returns credits from the consumer
+         */
+        void onReadoutConfirm(toolbox::mem::Reference* ref)
+          throw (i2o::exception::Exception);
+
+        /**
+         * @brief Give credits back to the stream window, capped at the configured credits
+         */
+        void returnStreamCredits(int32_t const credits);
+
+        void streamDropped(std::string const& reason);
+
         // inspired by HCAL readout application
         /*
         virtual int readout(unsigned int expected, unsigned int* eventNumbers,
@@ -105,6 +267,42 @@ namespace gem {
           xdata::String outputType;
           xdata::String outputLocation;
           xdata::String setupLocation;
+
+          // adaptive poll policy
+          xdata::UnsignedInteger32 pollSpinCount;    ///< empty readout calls before starting to back off
+          xdata::UnsignedInteger32 pollMinSleepUsec; ///< first backoff interval, in microseconds
+          xdata::UnsignedInteger32 pollMaxSleepUsec; ///< cap on the backoff interval, in microseconds
+
+          // QueueDepth publication
+          xdata::UnsignedInteger32 queueDepthPollMsec;   ///< how often the queue depth counter is sampled
+          xdata::UnsignedInteger32 queueDepthUpdateMsec; ///< maximum interval between publications of a changed value
+          xdata::UnsignedInteger64 queueDepthThreshold;  ///< change in depth that is published immediately
+
+          // thread and buffer placement
+          xdata::String            readoutCPUs; ///< CPUs the readout task is pinned to, e.g., "2,3" or "4-7", empty for no pinning
+          xdata::Integer           numaNode;    ///< NUMA node for readout buffers, -1 for the node of the readout task
+          xdata::String            hugePages;   ///< "none", "transparent" or "explicit"
+          xdata::UnsignedInteger32 bufferSize;  ///< size in bytes of the readout output buffer, 0 for the default
+
+          // hardware FIFO drain batching
+          xdata::UnsignedInteger32 fifoDepth;       ///< capacity of the hardware FIFO in the unit of its occupancy, 0 for the default of the readout
+          xdata::Double            drainTargetFill; ///< fill fraction above which the FIFO is drained with the largest batch
+          xdata::UnsignedInteger32 drainMaxPackets; ///< maximum number of IPbus packets per drain transaction
+
+          // output compression
+          xdata::String            compression;          ///< "none", "zlib", "zstd" or "lz4"
+          xdata::Integer           compressionLevel;     ///< codec specific level, -1 for the codec default
+          xdata::UnsignedInteger32 compressionBlockSize; ///< uncompressed size in bytes of one output frame
+
+          // event frame memory pool
+          xdata::UnsignedInteger64 poolSize;          ///< bytes committed to the event frame pool
+          xdata::Double            poolHighWatermark; ///< pool fill fraction at which the readout stops taking events
+          xdata::Double            poolLowWatermark;  ///< pool fill fraction below which the readout resumes
+
+          // I2O event stream
+          xdata::String            streamClass;    ///< class of the consumer application, empty to disable streaming
+          xdata::UnsignedInteger32 streamInstance; ///< instance of the consumer application
+          xdata::UnsignedInteger32 streamCredits;  ///< frames that may be in flight to the consumer
         };
 
         xdata::Bag<GEMReadoutSettings> m_readoutSettings;
@@ -116,7 +314,53 @@ namespace gem {
 
         double m_usecUsed;
 
+        // time spent by the readout task in each of the PollStates, in microseconds
+        xdata::UnsignedInteger64 m_usecIdle;
+        xdata::UnsignedInteger64 m_usecBusy;
+        xdata::UnsignedInteger64 m_usecSpin;
+        xdata::UnsignedInteger64 m_usecBackoff;
+        xdata::UnsignedInteger32 m_pollState;
+        xdata::UnsignedInteger32 m_pollSleepUsec;
+
+        xdata::UnsignedInteger64 m_queueDepth;
+
+        GEMDrainController       m_drainController;
+        xdata::UnsignedInteger32 m_drainBatch;
+        xdata::Double            m_drainFillFraction;
+        xdata::Double            m_drainLatencyUsec;
+
+        xdata::UnsignedInteger64 m_poolExhausted;  ///< readout attempts refused because the frame pool was full
+        xdata::UnsignedInteger64 m_poolUsedBytes;
+
+        xdata::UnsignedInteger64 m_streamFrames;       ///< frames sent to the consumer
+        xdata::UnsignedInteger64 m_streamCreditStalls; ///< readout attempts refused for lack of credits
+        xdata::UnsignedInteger64 m_streamDropped;      ///< frames that could not be streamed in this run
+
       private:
+        // owned by the readout task
+        std::shared_ptr<GEMCompressedWriter> p_outWriter;
+
+        // written by the readout thread, published to m_queueDepth by the timer
+        std::atomic<uint64_t>  m_queueDepthCount;
+        toolbox::task::Timer*  p_queueDepthTimer;
+        std::string            m_queueDepthTimerName;
+        toolbox::TimeVal       m_queueDepthLastUpdate;
+
+        // written by the readout thread, published to m_poolExhausted by the timer
+        std::atomic<uint64_t>  m_poolExhaustedCount;
+        bool                   m_poolThrottled;
+
+        // stream state, credits are returned on the I2O thread
+        xdaq::ApplicationDescriptor* p_streamDestination;
+        std::atomic<int32_t>         m_streamCreditCount;
+        uint32_t                     m_streamSequence;
+        std::atomic<uint64_t>        m_streamFrameCount;
+        std::atomic<uint64_t>        m_streamStallCount;
+        std::atomic<uint64_t>        m_streamDropCount;
+
+        // used to interrupt the backoff sleep when a command arrives
+        std::mutex              m_cmdMutex;
+        std::condition_variable m_cmdCondition;
 
       };
 
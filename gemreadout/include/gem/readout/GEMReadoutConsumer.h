@@ -0,0 +1,86 @@
+/** @file GEMReadoutConsumer.h */
+
+#ifndef GEM_READOUT_GEMREADOUTCONSUMER_H
+#define GEM_READOUT_GEMREADOUTCONSUMER_H
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "i2o/i2o.h"
+#include "i2o/exception/Exception.h"
+#include "toolbox/mem/Pool.h"
+#include "toolbox/mem/Reference.h"
+
+#include "gem/base/GEMApplication.h"
+
+namespace gem {
+  namespace readout {
+
+    class GEMCompressedWriter;
+
+    /**
+     * @brief Receives the I2O event stream of one or more GEMReadoutApplications
+     * Events are optionally written to a file per run and producer, and the credits are
+     * returned once the data has been handed to the writer, so the producers can never
+     * run more than their credit window ahead of the disk.
+     * Producer and consumer can run in the same executive, in which case the frames are
+     * delivered without a network transport.
+     */
+    class GEMReadoutConsumer : public gem::base::GEMApplication
+      {
+      public:
+        XDAQ_INSTANTIATOR();
+
+        GEMReadoutConsumer(xdaq::ApplicationStub* s)
+          throw (xdaq::exception::Exception);
+
+        virtual ~GEMReadoutConsumer();
+
+        virtual void actionPerformed(xdata::Event& event);
+
+        /**
+         * @brief I2O_READOUT_NOTIFY handler
+         */
+        void onReadoutNotify(toolbox::mem::Reference* ref)
+          throw (i2o::exception::Exception);
+
+      protected:
+        /**
+         * @brief Return credits to a producer with an I2O_READOUT_CONFIRM frame
+         */
+        void sendCredits(I2O_TID const producer, uint32_t const credits, uint32_t const sequence);
+
+        /**
+         * @brief Writer for the data of a producer in the given run, NULL when writing is disabled
+         */
+        GEMCompressedWriter* getWriter(I2O_TID const producer, uint32_t const runNumber);
+
+        xdata::String            m_outputLocation;  ///< directory for the output files, empty to only count
+        xdata::String            m_compression;     ///< codec of the output files, see GEMCompressedWriter
+        xdata::UnsignedInteger32 m_creditBatch;     ///< frames consumed before credits are returned, at most the producer streamCredits
+
+        xdata::UnsignedInteger64 m_framesReceived;
+        xdata::UnsignedInteger64 m_eventsReceived;
+        xdata::UnsignedInteger64 m_bytesReceived;
+        xdata::UnsignedInteger64 m_sequenceErrors;
+
+      private:
+        struct ProducerState {
+          uint32_t runNumber;
+          uint32_t nextSequence;
+          uint32_t pendingCredits;
+          std::shared_ptr<GEMCompressedWriter> writer;
+
+          ProducerState() : runNumber(0), nextSequence(0), pendingCredits(0) {};
+        };
+
+        toolbox::mem::Pool* m_pool;  ///< for the confirm frames
+
+        std::map<I2O_TID, ProducerState> m_producers;
+      };
+
+  }  // namespace gem::readout
+}  // namespace gem
+
+#endif  // GEM_READOUT_GEMREADOUTCONSUMER_H
@@ -0,0 +1,39 @@
+/** @file GEMReadoutI2O.h */
+
+#ifndef GEM_READOUT_GEMREADOUTI2O_H
+#define GEM_READOUT_GEMREADOUTI2O_H
+
+#include <stdint.h>
+
+#include "i2o/i2o.h"
+
+/**
+ * Frame layouts of the readout stream between a GEMReadoutApplication and a GEMReadoutConsumer
+ *
+ * The producer sends I2O_READOUT_NOTIFY frames, each carrying one or more whole events, and may
+ * only have as many frames outstanding as it holds credits. The consumer returns credits with
+ * I2O_READOUT_CONFIRM frames once it has processed the data, so a slow consumer throttles the
+ * producer instead of being overrun.
+ */
+
+/**
+ * @brief I2O_READOUT_NOTIFY, producer to consumer, followed by dataSize bytes of event data
+ */
+typedef struct _I2O_GEM_READOUT_NOTIFY_MESSAGE_FRAME {
+  I2O_PRIVATE_MESSAGE_FRAME PvtMessageFrame;
+  uint32_t runNumber;
+  uint32_t sequence;  ///< frame counter of the producer, restarts at 0 on every start
+  uint32_t nEvents;   ///< number of events in the payload
+  uint32_t dataSize;  ///< payload size in bytes, the frame is padded to a multiple of 4 bytes
+} I2O_GEM_READOUT_NOTIFY_MESSAGE_FRAME, *PI2O_GEM_READOUT_NOTIFY_MESSAGE_FRAME;
+
+/**
+ * @brief I2O_READOUT_CONFIRM, consumer to producer
+ */
+typedef struct _I2O_GEM_READOUT_CONFIRM_MESSAGE_FRAME {
+  I2O_PRIVATE_MESSAGE_FRAME PvtMessageFrame;
+  uint32_t credits;   ///< number of frames returned to the producer
+  uint32_t sequence;  ///< sequence number of the last frame consumed
+} I2O_GEM_READOUT_CONFIRM_MESSAGE_FRAME, *PI2O_GEM_READOUT_CONFIRM_MESSAGE_FRAME;
+
+#endif  // GEM_READOUT_GEMREADOUTI2O_H
@@ -0,0 +1,108 @@
+/** @file GEMReadoutResources.h */
+
+#ifndef GEM_READOUT_GEMREADOUTRESOURCES_H
+#define GEM_READOUT_GEMREADOUTRESOURCES_H
+
+#include <string>
+#include <vector>
+
+#include "gem/utils/GEMLogging.h"
+
+namespace gem {
+  namespace readout {
+
+    /**
+     * @brief Helpers to place readout threads and their buffers on the host
+     * On multi-socket DAQ PCs the readout threads should run on fixed cores and use
+     * memory from their own NUMA node, optionally backed by huge pages
+     */
+    class GEMReadoutResources
+      {
+      public:
+        /**
+         * @brief Parse a list of CPUs in the format used by taskset/cpuset, e.g., "2,4-7"
+         * @param cpus the CPU list, an empty string returns an empty list
+         * @returns the list of CPU indices
+         */
+        static std::vector<int> parseCPUList(std::string const& cpus);
+
+        /**
+         * @brief Pin the calling thread to the given CPUs
+         * @param logger used to report failures, which are not fatal
+         * @param cpus list of CPU indices, an empty list leaves the affinity untouched
+         * @returns true if the affinity was applied
+         */
+        static bool pinCurrentThread(log4cplus::Logger& logger, std::vector<int> const& cpus);
+
+        /**
+         * @brief NUMA node of the CPU the calling thread is running on, -1 if it cannot be determined
+         */
+        static int currentNUMANode();
+
+        /**
+         * @brief highest NUMA node of the system, as numa_max_node(), -1 if it cannot be determined
+         */
+        static int maxNUMANode();
+      };
+
+    /**
+     * @brief Large page-aligned buffer for readout data
+     * The memory is bound to a NUMA node (or to the node of the allocating thread through
+     * first touch) and optionally backed by transparent or explicit huge pages.
+     * Allocate it from the readout thread after pinning so that first touch places it locally.
+     */
+    class GEMReadoutBuffer
+      {
+      public:
+        struct HugePages {
+          enum EHugePages {
+            NONE        = 0,  ///< regular pages
+            TRANSPARENT = 1,  ///< madvise(MADV_HUGEPAGE), kernel decides
+            EXPLICIT    = 2   ///< MAP_HUGETLB from the preallocated pool, falls back to TRANSPARENT
+          } HugePages;
+        };
+
+        /**
+         * @param logger used to report failures and fallbacks
+         * @param size requested size in bytes, rounded up to the page size in use
+         * @param numaNode node to bind the memory to, -1 to rely on first touch
+         * @param hugePages one of "none", "transparent" or "explicit"
+         * @throws gem::readout::exception::ConfigurationProblem if the settings fail checkSettings
+         */
+        GEMReadoutBuffer(log4cplus::Logger& logger, size_t const size,
+                         int const numaNode=-1, std::string const& hugePages="none");
+
+        ~GEMReadoutBuffer();
+
+        char*  data() const { return p_data; };
+        size_t size() const { return m_size; };
+
+        bool isHuge() const { return m_hugePages != HugePages::NONE; };
+
+        static int parseHugePages(std::string const& hugePages);
+
+        /**
+         * @brief Check the buffer settings without allocating, e.g., at configure
+         * @param numaNode node to bind the memory to, -1 to rely on first touch
+         * @param hugePages one of "none", "transparent" or "explicit"
+         * @throws gem::readout::exception::ConfigurationProblem if numaNode is not a node of the
+         *         system or hugePages is not one of the known values
+         */
+        static void checkSettings(int const numaNode, std::string const& hugePages);
+
+      private:
+        log4cplus::Logger m_gemLogger;
+
+        char*  p_data;
+        size_t m_size;
+        int    m_hugePages;
+
+        // Prevent copying
+        GEMReadoutBuffer(GEMReadoutBuffer const&);
+        GEMReadoutBuffer& operator=(GEMReadoutBuffer const&);
+      };
+
+  }  // namespace gem::readout
+}  // namespace gem
+
+#endif  // GEM_READOUT_GEMREADOUTRESOURCES_H
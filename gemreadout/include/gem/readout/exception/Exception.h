@@ -70,6 +70,7 @@ GEM_READOUT_DEFINE_EXCEPTION(ConfigurationValidationProblem)
 GEM_READOUT_DEFINE_EXCEPTION(InfoSpaceProblem)
 
 GEM_READOUT_DEFINE_EXCEPTION(HardwareProblem)
+GEM_READOUT_DEFINE_EXCEPTION(OutputProblem)
 
 GEM_READOUT_DEFINE_EXCEPTION(RCMSNotificationError)
 GEM_READOUT_DEFINE_EXCEPTION(SOAPCommandParameterProblem)
@@ -0,0 +1,398 @@
+/**
+ * class: GEMCompressedWriter
+ * description: Block framed, compressed output of readout data on a separate thread
+ */
+
+#include "gem/readout/GEMCompressedWriter.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+
+#ifdef GEM_READOUT_USE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef GEM_READOUT_USE_LZ4
+#include <lz4.h>
+#endif
+
+#include "toolbox/string.h"
+
+#include "gem/readout/exception/Exception.h"
+
+namespace bo = boost::iostreams;
+
+const uint32_t gem::readout::GEMCompressedWriter::FRAME_MAGIC;
+
+int gem::readout::GEMCompressedWriter::parseCodec(std::string const& codec)
+{
+  int res = Codecs::NONE;
+  if (codec == "zlib")
+    res = Codecs::ZLIB;
+  else if (codec == "zstd")
+    res = Codecs::ZSTD;
+  else if (codec == "lz4")
+    res = Codecs::LZ4;
+
+  if (!isAvailable(res))
+    res = Codecs::ZLIB;
+  return res;
+}
+
+bool gem::readout::GEMCompressedWriter::isAvailable(int const codec)
+{
+  switch (codec) {
+  case Codecs::NONE:
+  case Codecs::ZLIB:
+    return true;
+#ifdef GEM_READOUT_USE_ZSTD
+  case Codecs::ZSTD:
+    return true;
+#endif
+#ifdef GEM_READOUT_USE_LZ4
+  case Codecs::LZ4:
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+std::string gem::readout::GEMCompressedWriter::extension(int const codec)
+{
+  switch (codec) {
+  case Codecs::ZLIB:
+    return ".zz";
+  case Codecs::ZSTD:
+    return ".zst";
+  case Codecs::LZ4:
+    return ".lz4";
+  default:
+    return "";
+  }
+}
+
+gem::readout::GEMCompressedWriter::GEMCompressedWriter(log4cplus::Logger& logger, std::string const& codec,
+                                                       size_t const blockSize, int const level,
+                                                       size_t const maxQueued) :
+  m_gemLogger(logger),
+  m_codec(parseCodec(codec)),
+  m_level(level),
+  // the frame header stores sizes as 32-bit values
+  m_blockSize(std::max(size_t(4096), std::min(blockSize, size_t(1) << 30))),
+  m_maxQueued(std::max(size_t(1), maxQueued)),
+  m_closing(false),
+  m_bytesIn(0),
+  m_bytesOut(0)
+{
+  if (!codec.empty() && codec != "none" && m_codec == Codecs::ZLIB && codec != "zlib")
+    CMSGEMOS_WARN("GEMCompressedWriter codec " << codec << " is not available, using zlib");
+}
+
+gem::readout::GEMCompressedWriter::~GEMCompressedWriter()
+{
+  try {
+    close();
+  } catch (gem::readout::exception::Exception const& e) {
+    CMSGEMOS_ERROR("GEMCompressedWriter::~GEMCompressedWriter " << e.what());
+  }
+}
+
+void gem::readout::GEMCompressedWriter::open(std::string const& fileName)
+{
+  if (isOpen())
+    close();
+
+  m_fileName = fileName;
+  m_out.open(m_fileName.c_str(), std::ios_base::app | std::ios::binary);
+  if (!m_out.is_open()) {
+    std::string msg = "GEMCompressedWriter::open unable to open " + m_fileName;
+    CMSGEMOS_ERROR(msg);
+    XCEPT_RAISE(gem::readout::exception::OutputProblem, msg);
+  }
+
+  m_block.release();
+  m_closing = false;
+  m_error.clear();
+  m_bytesIn.store(0, std::memory_order_relaxed);
+  m_bytesOut.store(0, std::memory_order_relaxed);
+  m_thread = std::thread(&GEMCompressedWriter::writerThread, this);
+}
+
+void gem::readout::GEMCompressedWriter::Block::release()
+{
+  for (auto frame = frames.begin(); frame != frames.end(); ++frame)
+    (*frame)->release();
+  frames.clear();
+  framePieces.clear();
+  bytes.clear();
+  size = 0;
+}
+
+void gem::readout::GEMCompressedWriter::write(char const* data, size_t const size)
+{
+  // only close a block between two writes, so that blocks hold whole events
+  if (!m_block.frames.empty() || (!m_block.empty() && m_block.size + size > m_blockSize))
+    flushBlock();
+
+  if (m_block.bytes.capacity() < m_blockSize)
+    m_block.bytes.reserve(m_blockSize);
+  m_block.bytes.insert(m_block.bytes.end(), data, data+size);
+  m_block.size += size;
+  m_bytesIn.fetch_add(size, std::memory_order_relaxed);
+
+  if (m_block.size >= m_blockSize)
+    flushBlock();
+}
+
+void gem::readout::GEMCompressedWriter::write(toolbox::mem::Reference* frame)
+{
+  write(frame, 0, frame->getDataSize());
+}
+
+void gem::readout::GEMCompressedWriter::write(toolbox::mem::Reference* frame, size_t const offset, size_t const size)
+{
+  if (!m_block.bytes.empty() || (!m_block.empty() && m_block.size + size > m_blockSize))
+    flushBlock();
+
+  m_block.frames.push_back(frame->duplicate());
+  m_block.framePieces.push_back(std::make_pair(static_cast<char const*>(frame->getDataLocation()) + offset, size));
+  m_block.size += size;
+  m_bytesIn.fetch_add(size, std::memory_order_relaxed);
+
+  if (m_block.size >= m_blockSize)
+    flushBlock();
+}
+
+void gem::readout::GEMCompressedWriter::close()
+{
+  if (!isOpen())
+    return;
+
+  std::string error;
+  try {
+    flushBlock();
+  } catch (gem::readout::exception::OutputProblem const& e) {
+    error = e.what();
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(m_queueMutex);
+    m_closing = true;
+  }
+  m_queueCondition.notify_all();
+  m_thread.join();
+  m_out.close();
+
+  {
+    std::lock_guard<std::mutex> guard(m_queueMutex);
+    if (error.empty())
+      error = m_error;
+  }
+
+  uint64_t const in  = bytesIn();
+  uint64_t const out = bytesOut();
+  CMSGEMOS_INFO("GEMCompressedWriter::close " << m_fileName << " wrote " << out << " bytes for "
+                << in << " input bytes (ratio " << (out ? static_cast<double>(in)/out : 0.) << ")");
+
+  if (!error.empty())
+    XCEPT_RAISE(gem::readout::exception::OutputProblem, error);
+}
+
+void gem::readout::GEMCompressedWriter::flushBlock()
+{
+  if (m_block.empty())
+    return;
+
+  std::unique_lock<std::mutex> lock(m_queueMutex);
+  // throttle the producer when the disk cannot keep up
+  m_queueCondition.wait(lock, [this] { return m_queue.size() < m_maxQueued || !m_error.empty(); });
+  if (!m_error.empty()) {
+    std::string msg = m_error;
+    lock.unlock();
+    m_block.release();
+    XCEPT_RAISE(gem::readout::exception::OutputProblem, msg);
+  }
+  m_queue.push_back(std::move(m_block));
+  m_block = Block();
+  lock.unlock();
+  m_queueCondition.notify_all();
+}
+
+void gem::readout::GEMCompressedWriter::writerThread()
+{
+  Block block;
+  piece_list pieces;
+  std::vector<char> scratch, payload;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(m_queueMutex);
+      m_queueCondition.wait(lock, [this] { return !m_queue.empty() || m_closing; });
+      if (m_queue.empty())
+        break;
+      block = std::move(m_queue.front());
+      m_queue.pop_front();
+      // after a failure keep draining the queue so the producer never blocks forever
+      if (!m_error.empty()) {
+        lock.unlock();
+        block.release();
+        m_queueCondition.notify_all();
+        continue;
+      }
+    }
+    m_queueCondition.notify_all();
+
+    pieces.clear();
+    if (!block.bytes.empty())
+      pieces.push_back(std::make_pair(block.bytes.data(), block.bytes.size()));
+    pieces.insert(pieces.end(), block.framePieces.begin(), block.framePieces.end());
+
+    try {
+      if (m_codec == Codecs::NONE) {
+        for (auto piece = pieces.begin(); piece != pieces.end(); ++piece)
+          m_out.write(piece->first, piece->second);
+        m_bytesOut.fetch_add(block.size, std::memory_order_relaxed);
+      } else {
+        compress(m_codec, m_level, pieces, block.size, scratch, payload);
+        FrameHeader header;
+        header.magic          = FRAME_MAGIC;
+        header.codec          = m_codec;
+        header.reserved       = 0;
+        header.rawSize        = block.size;
+        header.compressedSize = payload.size();
+        m_out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        m_out.write(payload.data(), payload.size());
+        m_bytesOut.fetch_add(sizeof(header) + payload.size(), std::memory_order_relaxed);
+      }
+      if (!m_out.good())
+        throw std::runtime_error("write to " + m_fileName + " failed");
+    } catch (std::exception const& e) {
+      CMSGEMOS_ERROR("GEMCompressedWriter::writerThread " << e.what());
+      std::lock_guard<std::mutex> guard(m_queueMutex);
+      m_error = toolbox::toString("GEMCompressedWriter output failed: %s", e.what());
+    }
+    // frames go back to their pool as soon as they are on disk
+    block.release();
+    // wake a producer waiting on the error
+    m_queueCondition.notify_all();
+  }
+}
+
+void gem::readout::GEMCompressedWriter::compress(int const codec, int const level,
+                                                 piece_list const& raw, size_t const rawSize,
+                                                 std::vector<char>& scratch, std::vector<char>& out)
+{
+  out.clear();
+  if (codec == Codecs::ZLIB) {
+    // zlib streams the pieces, no need to make them contiguous
+    bo::filtering_ostream os;
+    os.push(bo::zlib_compressor(level < 0 ? bo::zlib::default_compression : level));
+    os.push(bo::back_inserter(out));
+    for (auto piece = raw.begin(); piece != raw.end(); ++piece)
+      os.write(piece->first, piece->second);
+    os.reset();
+    return;
+  }
+
+  // the block codecs need contiguous input
+  char const* src = NULL;
+  if (raw.size() == 1) {
+    src = raw.front().first;
+  } else {
+    scratch.resize(rawSize);
+    size_t pos = 0;
+    for (auto piece = raw.begin(); piece != raw.end(); ++piece) {
+      std::copy(piece->first, piece->first+piece->second, scratch.begin()+pos);
+      pos += piece->second;
+    }
+    src = scratch.data();
+  }
+
+  switch (codec) {
+#ifdef GEM_READOUT_USE_ZSTD
+  case Codecs::ZSTD: {
+    out.resize(ZSTD_compressBound(rawSize));
+    size_t res = ZSTD_compress(out.data(), out.size(), src, rawSize, level < 0 ? 3 : level);
+    if (ZSTD_isError(res))
+      throw std::runtime_error(std::string("zstd compression failed: ") + ZSTD_getErrorName(res));
+    out.resize(res);
+    break;
+  }
+#endif
+#ifdef GEM_READOUT_USE_LZ4
+  case Codecs::LZ4: {
+    out.resize(LZ4_compressBound(rawSize));
+    int res = LZ4_compress_default(src, out.data(), rawSize, out.size());
+    if (res <= 0)
+      throw std::runtime_error("lz4 compression failed");
+    out.resize(res);
+    break;
+  }
+#endif
+  default:
+    throw std::runtime_error(toolbox::toString("codec %d is not available", codec));
+  }
+}
+
+void gem::readout::GEMCompressedWriter::decompress(int const codec, std::vector<char> const& in,
+                                                   std::vector<char>& raw)
+{
+  switch (codec) {
+  case Codecs::ZLIB: {
+    bo::filtering_istream is;
+    is.push(bo::zlib_decompressor());
+    is.push(bo::array_source(in.data(), in.size()));
+    is.read(raw.data(), raw.size());
+    if (static_cast<size_t>(is.gcount()) != raw.size())
+      throw std::runtime_error("zlib frame is shorter than its header claims");
+    break;
+  }
+#ifdef GEM_READOUT_USE_ZSTD
+  case Codecs::ZSTD: {
+    size_t res = ZSTD_decompress(raw.data(), raw.size(), in.data(), in.size());
+    if (ZSTD_isError(res) || res != raw.size())
+      throw std::runtime_error("zstd decompression failed");
+    break;
+  }
+#endif
+#ifdef GEM_READOUT_USE_LZ4
+  case Codecs::LZ4: {
+    int res = LZ4_decompress_safe(in.data(), raw.data(), in.size(), raw.size());
+    if (res < 0 || static_cast<size_t>(res) != raw.size())
+      throw std::runtime_error("lz4 decompression failed");
+    break;
+  }
+#endif
+  default:
+    throw std::runtime_error(toolbox::toString("codec %d is not available", codec));
+  }
+}
+
+bool gem::readout::GEMCompressedWriter::readFrame(std::istream& in, std::vector<char>& raw)
+{
+  FrameHeader header;
+  in.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (in.gcount() == 0)
+    return false;
+  if (static_cast<size_t>(in.gcount()) != sizeof(header) || header.magic != FRAME_MAGIC)
+    XCEPT_RAISE(gem::readout::exception::OutputProblem, "GEMCompressedWriter::readFrame corrupt frame header");
+
+  std::vector<char> payload(header.compressedSize);
+  in.read(payload.data(), payload.size());
+  if (static_cast<size_t>(in.gcount()) != payload.size())
+    XCEPT_RAISE(gem::readout::exception::OutputProblem, "GEMCompressedWriter::readFrame truncated frame");
+
+  raw.resize(header.rawSize);
+  try {
+    decompress(header.codec, payload, raw);
+  } catch (std::exception const& e) {
+    XCEPT_RAISE(gem::readout::exception::OutputProblem,
+                std::string("GEMCompressedWriter::readFrame ") + e.what());
+  }
+  return true;
+}
@@ -0,0 +1,111 @@
+/**
+ * class: GEMDrainController
+ * description: Adaptive batch sizing for draining hardware FIFOs over IPbus
+ */
+
+#include "gem/readout/GEMDrainController.h"
+
+#include <algorithm>
+
+namespace {
+  // weight of a new measurement in the moving averages
+  double const EWMA_ALPHA = 0.2;
+
+  double ewma(double const avg, double const value)
+  {
+    return avg + EWMA_ALPHA*(value - avg);
+  }
+}
+
+const uint32_t gem::readout::GEMDrainController::IPBUS_MAX_PAYLOAD_WORDS;
+const uint32_t gem::readout::GEMDrainController::TRACKING_FIFO_WORDS;
+const uint32_t gem::readout::GEMDrainController::MAX_DEFERRALS;
+
+gem::readout::GEMDrainController::GEMDrainController(uint32_t const blockSize,
+                                                     uint32_t const fifoDepth,
+                                                     double   const targetFill,
+                                                     uint32_t const maxBatch) :
+  m_lastBatch(0),
+  m_fillFraction(0.),
+  m_latencyUsec(0.)
+{
+  configure(blockSize, fifoDepth, targetFill, maxBatch);
+}
+
+void gem::readout::GEMDrainController::configure(uint32_t const blockSize, uint32_t const fifoDepth,
+                                                 double const targetFill, uint32_t const maxBatch)
+{
+  m_blockSize  = std::max(1u, blockSize);
+  m_fifoDepth  = std::max(m_blockSize, fifoDepth);
+  m_targetFill = std::min(1., std::max(0., targetFill));
+  m_maxBatch   = std::max(m_blockSize, roundToBlocks(maxBatch));
+
+  m_arrivalRate   = 0.;
+  m_fixedUsec     = 0.;
+  m_perUnitUsec   = 0.;
+  m_lastOccupancy = 0;
+  m_deferred      = 0;
+  m_lastUpdate    = std::chrono::steady_clock::now();
+
+  m_lastBatch.store(0, std::memory_order_relaxed);
+  m_fillFraction.store(0., std::memory_order_relaxed);
+  m_latencyUsec.store(0., std::memory_order_relaxed);
+}
+
+uint32_t gem::readout::GEMDrainController::nextBatch(uint32_t const occupancy)
+{
+  double const fill = static_cast<double>(occupancy)/m_fifoDepth;
+  m_fillFraction.store(fill, std::memory_order_relaxed);
+
+  uint32_t const available = roundToBlocks(std::min(occupancy, m_maxBatch));
+  if (available == 0)
+    return 0;
+
+  // above target, or starved of reads for too long: take as much as possible
+  if (fill >= m_targetFill || m_deferred >= MAX_DEFERRALS) {
+    m_deferred = 0;
+    return available;
+  }
+
+  // only worth a read once it carries what arrives while it is in flight
+  double const minUnits = std::min(static_cast<double>(m_maxBatch),
+                                   m_arrivalRate*(m_fixedUsec + m_perUnitUsec*available));
+  uint32_t const minBatch = roundToBlocks(static_cast<uint32_t>(minUnits));
+  if (available < minBatch) {
+    ++m_deferred;
+    return 0;
+  }
+
+  m_deferred = 0;
+  return available;
+}
+
+void gem::readout::GEMDrainController::update(uint32_t const nRead, double const latencyUsec,
+                                              uint32_t const occupancy)
+{
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  double const elapsedUsec = std::chrono::duration<double, std::micro>(now - m_lastUpdate).count();
+  m_lastUpdate = now;
+
+  m_lastBatch.store(nRead, std::memory_order_relaxed);
+  if (nRead > 0)
+    m_latencyUsec.store(latencyUsec, std::memory_order_relaxed);
+  m_fillFraction.store(static_cast<double>(occupancy)/m_fifoDepth, std::memory_order_relaxed);
+
+  // split the latency into a fixed and a per-unit part, attributing the excess over
+  // the fixed cost to the payload
+  if (nRead > 0) {
+    if (m_fixedUsec == 0.)
+      m_fixedUsec = latencyUsec;
+    double const perUnit = std::max(0., latencyUsec - m_fixedUsec)/nRead;
+    m_perUnitUsec = ewma(m_perUnitUsec, perUnit);
+    m_fixedUsec   = ewma(m_fixedUsec, std::max(0., latencyUsec - m_perUnitUsec*nRead));
+  }
+
+  // units that entered the FIFO since the last measurement
+  if (elapsedUsec > 0.) {
+    double const arrived = static_cast<double>(occupancy) + nRead - m_lastOccupancy;
+    m_arrivalRate = ewma(m_arrivalRate, std::max(0., arrived)/elapsedUsec);
+  }
+  m_lastOccupancy = occupancy;
+}
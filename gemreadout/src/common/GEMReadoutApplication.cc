@@ -8,13 +8,27 @@
 
 #include "gem/readout/GEMReadoutApplication.h"
 
+#include <algorithm>
+#include <cstring>
 #include <iomanip>
+#include <chrono>
+#include <thread>
 
 #include "toolbox/mem/Pool.h"
 #include "toolbox/mem/MemoryPoolFactory.h"
 #include "toolbox/mem/CommittedHeapAllocator.h"
+#include "toolbox/mem/exception/Exception.h"
+#include "toolbox/net/URN.h"
+
+#include "i2o/Method.h"
+#include "i2o/utils/AddressMap.h"
+#include "interface/shared/i2oXFunctionCodes.h"
 
 #include "gem/readout/GEMReadoutWebApplication.h"
+#include "gem/readout/GEMReadoutResources.h"
+#include "gem/readout/GEMCompressedWriter.h"
+#include "gem/readout/GEMReadoutI2O.h"
+#include "gem/readout/exception/Exception.h"
 
 const int gem::readout::GEMReadoutApplication::I2O_READOUT_NOTIFY=0x84;
 const int gem::readout::GEMReadoutApplication::I2O_READOUT_CONFIRM=0x85;
@@ -42,6 +56,35 @@ gem::readout::GEMReadoutApplication::GEMReadoutSettings::GEMReadoutSettings() {
   outputType     = "Bin";
   outputLocation = "/tmp";
   setupLocation  = "";
+
+  pollSpinCount    = 100;
+  pollMinSleepUsec = 10;
+  pollMaxSleepUsec = 10000;
+
+  queueDepthPollMsec   = 100;
+  queueDepthUpdateMsec = 1000;
+  queueDepthThreshold  = 1024;
+
+  readoutCPUs = "";
+  numaNode    = -1;
+  hugePages   = "none";
+  bufferSize  = 0;
+
+  fifoDepth       = 0;
+  drainTargetFill = 0.5;
+  drainMaxPackets = 8;
+
+  compression          = "none";
+  compressionLevel     = -1;
+  compressionBlockSize = 4*1024*1024;
+
+  poolSize          = 64*1024*1024;
+  poolHighWatermark = 0.9;
+  poolLowWatermark  = 0.7;
+
+  streamClass    = "";
+  streamInstance = 0;
+  streamCredits  = 16;
 }
 
 void gem::readout::GEMReadoutApplication::GEMReadoutSettings::registerFields(xdata::Bag<gem::readout::GEMReadoutApplication::GEMReadoutSettings>* bag) {
@@ -51,6 +94,35 @@ void gem::readout::GEMReadoutApplication::GEMReadoutSettings::registerFields(xda
   bag->addField("outputType",     &outputType);
   bag->addField("outputLocation", &outputLocation);
   bag->addField("setupLocation",  &setupLocation);
+
+  bag->addField("pollSpinCount",    &pollSpinCount);
+  bag->addField("pollMinSleepUsec", &pollMinSleepUsec);
+  bag->addField("pollMaxSleepUsec", &pollMaxSleepUsec);
+
+  bag->addField("queueDepthPollMsec",   &queueDepthPollMsec);
+  bag->addField("queueDepthUpdateMsec", &queueDepthUpdateMsec);
+  bag->addField("queueDepthThreshold",  &queueDepthThreshold);
+
+  bag->addField("readoutCPUs", &readoutCPUs);
+  bag->addField("numaNode",    &numaNode);
+  bag->addField("hugePages",   &hugePages);
+  bag->addField("bufferSize",  &bufferSize);
+
+  bag->addField("fifoDepth",       &fifoDepth);
+  bag->addField("drainTargetFill", &drainTargetFill);
+  bag->addField("drainMaxPackets", &drainMaxPackets);
+
+  bag->addField("compression",          &compression);
+  bag->addField("compressionLevel",     &compressionLevel);
+  bag->addField("compressionBlockSize", &compressionBlockSize);
+
+  bag->addField("poolSize",          &poolSize);
+  bag->addField("poolHighWatermark", &poolHighWatermark);
+  bag->addField("poolLowWatermark",  &poolLowWatermark);
+
+  bag->addField("streamClass",    &streamClass);
+  bag->addField("streamInstance", &streamInstance);
+  bag->addField("streamCredits",  &streamCredits);
 }
 
 
@@ -58,20 +130,61 @@ gem::readout::GEMReadoutApplication::GEMReadoutApplication(xdaq::ApplicationStub
   throw (xdaq::exception::Exception) :
   gem::base::GEMFSMApplication(stub),
   m_outFileName(""),
+  m_pool(NULL),
   m_connectionFile("ConnectionFile"),
   m_deviceName("ReadoutDevice"),
   m_eventsReadout(0),
   m_usecPerEvent(0.0),
-  m_usecUsed(0.0)
+  m_usecUsed(0.0),
+  m_usecIdle(0),
+  m_usecBusy(0),
+  m_usecSpin(0),
+  m_usecBackoff(0),
+  m_pollState(PollStates::IDLE),
+  m_pollSleepUsec(0),
+  m_queueDepth(0),
+  m_drainBatch(0),
+  m_drainFillFraction(0.),
+  m_drainLatencyUsec(0.),
+  m_poolExhausted(0),
+  m_poolUsedBytes(0),
+  m_streamFrames(0),
+  m_streamCreditStalls(0),
+  m_streamDropped(0),
+  m_queueDepthCount(0),
+  p_queueDepthTimer(NULL),
+  m_poolExhaustedCount(0),
+  m_poolThrottled(false),
+  p_streamDestination(NULL),
+  m_streamCreditCount(0),
+  m_streamSequence(0),
+  m_streamFrameCount(0),
+  m_streamStallCount(0),
+  m_streamDropCount(0)
 {
   CMSGEMOS_DEBUG("GEMReadoutApplication ctor begin");
-  //i2o::bind(this,&ReadoutApplication::onReadoutNotify,I2O_READOUT_NOTIFY,XDAQ_ORGANIZATION_ID);
+  i2o::bind(this,&GEMReadoutApplication::onReadoutConfirm,I2O_READOUT_CONFIRM,XDAQ_ORGANIZATION_ID);
   //xoap::bind(this,&ReadoutApplication::getReadoutCredits,"GetReadoutCredits","urn:GEMReadoutApplication-soap:1");
   p_appInfoSpace->fireItemAvailable("ReadoutSettings",&m_readoutSettings);
   p_appInfoSpace->fireItemAvailable("DeviceName",     &m_deviceName);
   p_appInfoSpace->fireItemAvailable("ConnectionFile", &m_connectionFile);
   p_appInfoSpace->fireItemAvailable("EventsReadout",  &m_eventsReadout);
   p_appInfoSpace->fireItemAvailable("uSecPerEvent",   &m_usecPerEvent);
+  p_appInfoSpace->fireItemAvailable("uSecIdle",       &m_usecIdle);
+  p_appInfoSpace->fireItemAvailable("uSecBusy",       &m_usecBusy);
+  p_appInfoSpace->fireItemAvailable("uSecSpin",       &m_usecSpin);
+  p_appInfoSpace->fireItemAvailable("uSecBackoff",    &m_usecBackoff);
+  p_appInfoSpace->fireItemAvailable("PollState",      &m_pollState);
+  p_appInfoSpace->fireItemAvailable("PollSleepUsec",  &m_pollSleepUsec);
+  p_appInfoSpace->fireItemAvailable("QueueDepth",     &m_queueDepth);
+  p_appInfoSpace->fireItemAvailable("DrainBatch",        &m_drainBatch);
+  p_appInfoSpace->fireItemAvailable("DrainFillFraction", &m_drainFillFraction);
+  p_appInfoSpace->fireItemAvailable("DrainLatencyUsec",  &m_drainLatencyUsec);
+  p_appInfoSpace->fireItemAvailable("PoolExhausted",     &m_poolExhausted);
+  p_appInfoSpace->fireItemAvailable("PoolUsedBytes",     &m_poolUsedBytes);
+  p_appInfoSpace->fireItemAvailable("StreamFrames",       &m_streamFrames);
+  p_appInfoSpace->fireItemAvailable("StreamCreditStalls", &m_streamCreditStalls);
+  p_appInfoSpace->fireItemAvailable("StreamDropped",      &m_streamDropped);
 
   p_appInfoSpace->addItemRetrieveListener("ReadoutSettings", this);
   p_appInfoSpace->addItemRetrieveListener("DeviceName",      this);
@@ -87,6 +200,19 @@ gem::readout::GEMReadoutApplication::GEMReadoutApplication(xdaq::ApplicationStub
 
   p_gemWebInterface = new gem::readout::GEMReadoutWebApplication(this);
 
+  std::stringstream timerName;
+  timerName << m_urn << ":QueueDepthTimer";
+  m_queueDepthTimerName = timerName.str();
+  try {
+    if (toolbox::task::getTimerFactory()->hasTimer(m_queueDepthTimerName))
+      p_queueDepthTimer = toolbox::task::getTimerFactory()->getTimer(m_queueDepthTimerName);
+    else
+      p_queueDepthTimer = toolbox::task::getTimerFactory()->createTimer(m_queueDepthTimerName);
+    p_queueDepthTimer->stop();
+  } catch (toolbox::task::exception::Exception& te) {
+    XCEPT_RETHROW(xdaq::exception::Exception, "Unable to create the readout queue depth timer", te);
+  }
+
   ////set up the info hwCfgInfoSpace
   //init();
   CMSGEMOS_DEBUG("GEMReadoutApplication::GEMReadoutApplication() "      << std::endl
@@ -99,7 +225,13 @@ gem::readout::GEMReadoutApplication::GEMReadoutApplication(xdaq::ApplicationStub
 
 gem::readout::GEMReadoutApplication::~GEMReadoutApplication()
 {
-
+  if (p_queueDepthTimer) {
+    try {
+      p_queueDepthTimer->stop();
+    } catch (toolbox::task::exception::Exception const& ex) {
+      CMSGEMOS_WARN("GEMReadoutApplication::~GEMReadoutApplication could not stop queue depth timer " << ex.what());
+    }
+  }
 }
 
 void gem::readout::GEMReadoutApplication::actionPerformed(xdata::Event& event)
@@ -130,33 +262,68 @@ void gem::readout::GEMReadoutApplication::initializeAction()
     m_task = std::make_shared<gem::readout::GEMReadoutTask>(this);
     m_task->activate();
   } else {
-    m_cmdQueue.push(ReadoutCommands::CMD_STOP);
+    pushCommand(ReadoutCommands::CMD_STOP);
   }
 
-  /*
-  // create a pool
+  // create the event frame pool, its size is fixed for the lifetime of the application
   if (!m_pool) {
     char poolname[128];
     snprintf(poolname,128,"GEMReadoutPool-%s-%d",getApplicationDescriptor()->getClassName().c_str(),(int)getApplicationDescriptor()->getInstance());
     try {
-      // 4k events at the average size
-      toolbox::mem::CommittedHeapAllocator* alloc = new toolbox::mem::CommittedHeapAllocator(4096*4096);
+      size_t const poolSize = m_readoutSettings.bag.poolSize.value_;
+      double const high     = std::min(1., std::max(0., static_cast<double>(m_readoutSettings.bag.poolHighWatermark.value_)));
+      double const low      = std::min(high, std::max(0., static_cast<double>(m_readoutSettings.bag.poolLowWatermark.value_)));
+      toolbox::mem::CommittedHeapAllocator* alloc = new toolbox::mem::CommittedHeapAllocator(poolSize);
       toolbox::net::URN urn("toolbox-mem-pool",poolname);
       m_pool = toolbox::mem::getMemoryPoolFactory()->createPool(urn,alloc);
+      m_pool->setHighThreshold(static_cast<size_t>(high*poolSize));
+      m_pool->setLowThreshold(static_cast<size_t>(low*poolSize));
     } catch (xcept::Exception& e) {
       XCEPT_RETHROW(gem::base::exception::Exception,"Unable to create readout memory pool",e);
     }
   }
-  */
+  m_poolThrottled = false;
+  m_poolExhaustedCount.store(0, std::memory_order_relaxed);
+  m_poolExhausted = 0;
   m_eventsReadout.value_ = 0;
   m_usecPerEvent.value_  = 0;
   m_usecUsed = 0;
+
+  m_usecIdle.value_    = 0;
+  m_usecBusy.value_    = 0;
+  m_usecSpin.value_    = 0;
+  m_usecBackoff.value_ = 0;
+
+  startQueueDepthTimer();
+}
+
+void gem::readout::GEMReadoutApplication::startQueueDepthTimer()
+{
+  m_queueDepthCount.store(0, std::memory_order_relaxed);
+  m_queueDepth = 0;
+  m_queueDepthLastUpdate = toolbox::TimeVal::gettimeofday();
+  if (p_queueDepthTimer && !p_queueDepthTimer->isActive()) {
+    uint32_t pollMsec = std::max(1u, static_cast<uint32_t>(m_readoutSettings.bag.queueDepthPollMsec.value_));
+    p_queueDepthTimer->start();
+    p_queueDepthTimer->scheduleAtFixedRate(toolbox::TimeVal::gettimeofday(), this,
+                                           toolbox::TimeInterval(pollMsec/1000, 1000*(pollMsec%1000)),
+                                           0, "QueueDepth");
+  }
 }
 
 void gem::readout::GEMReadoutApplication::configureAction()
   /*throw (gem::readout::exception::Exception)*/
 {
   CMSGEMOS_DEBUG("gem::readout::GEMReadoutApplication::configureAction begin");
+  // the buffers are only allocated by the readout task, a bad setting must fail Configure instead
+  try {
+    GEMReadoutBuffer::checkSettings(m_readoutSettings.bag.numaNode.value_,
+                                    m_readoutSettings.bag.hugePages.toString());
+  } catch (gem::readout::exception::ConfigurationProblem const& e) {
+    CMSGEMOS_ERROR("GEMReadoutApplication::configureAction " << e.what());
+    throw;
+  }
+  configureStream();
 }
 
 void gem::readout::GEMReadoutApplication::startAction()
@@ -193,28 +360,34 @@ void gem::readout::GEMReadoutApplication::startAction()
 
   m_outFileName  = m_readoutSettings.bag.fileName.toString();
 
-  m_cmdQueue.push(ReadoutCommands::CMD_START);
+  // a new run starts with a full credit window, the consumer resets its sequence tracking on sequence 0
+  m_streamCreditCount.store(m_readoutSettings.bag.streamCredits.value_, std::memory_order_relaxed);
+  m_streamSequence = 0;
+  m_streamDropCount.store(0, std::memory_order_relaxed);
+  m_streamDropped = 0;
+
+  pushCommand(ReadoutCommands::CMD_START);
 }
 
 void gem::readout::GEMReadoutApplication::pauseAction()
   /*throw (gem::readout::exception::Exception)*/
 {
   CMSGEMOS_DEBUG("gem::readout::GEMReadoutApplication::pauseAction begin");
-  m_cmdQueue.push(ReadoutCommands::CMD_PAUSE);
+  pushCommand(ReadoutCommands::CMD_PAUSE);
 }
 
 void gem::readout::GEMReadoutApplication::resumeAction()
   /*throw (gem::readout::exception::Exception)*/
 {
   CMSGEMOS_DEBUG("gem::readout::GEMReadoutApplication::resumeAction begin");
-  m_cmdQueue.push(ReadoutCommands::CMD_RESUME);
+  pushCommand(ReadoutCommands::CMD_RESUME);
 }
 
 void gem::readout::GEMReadoutApplication::stopAction()
   /*throw (gem::readout::exception::Exception)*/
 {
   CMSGEMOS_DEBUG("gem::readout::GEMReadoutApplication::stopAction begin");
-  m_cmdQueue.push(ReadoutCommands::CMD_STOP);
+  pushCommand(ReadoutCommands::CMD_STOP);
 }
 
 void gem::readout::GEMReadoutApplication::haltAction()
@@ -222,7 +395,7 @@ void gem::readout::GEMReadoutApplication::haltAction()
 {
   CMSGEMOS_DEBUG("gem::readout::GEMReadoutApplication::haltAction begin");
   if (m_task)
-    m_cmdQueue.push(ReadoutCommands::CMD_STOP);
+    pushCommand(ReadoutCommands::CMD_STOP);
 }
 
 void gem::readout::GEMReadoutApplication::resetAction()
@@ -243,22 +416,306 @@ void gem::readout::GEMReadoutApplication::resetAction(toolbox::Event::Reference
   // close open file pointers
 }
 
+void gem::readout::GEMReadoutApplication::timeExpired(toolbox::task::TimerEvent& event)
+{
+  // drain statistics are cheap to copy, refresh them on every tick
+  m_drainBatch        = m_drainController.lastBatch();
+  m_drainFillFraction = m_drainController.fillFraction();
+  m_drainLatencyUsec  = m_drainController.latencyUsec();
+  m_poolExhausted      = m_poolExhaustedCount.load(std::memory_order_relaxed);
+  m_streamFrames       = m_streamFrameCount.load(std::memory_order_relaxed);
+  m_streamCreditStalls = m_streamStallCount.load(std::memory_order_relaxed);
+  m_streamDropped      = m_streamDropCount.load(std::memory_order_relaxed);
+  if (m_pool)
+    m_poolUsedBytes   = m_pool->getMemoryUsage().getUsed();
+
+  uint64_t const depth     = m_queueDepthCount.load(std::memory_order_relaxed);
+  uint64_t const published = m_queueDepth.value_;
+  if (depth == published)
+    return;
+
+  toolbox::TimeVal now = toolbox::TimeVal::gettimeofday();
+  uint64_t const delta = (depth > published) ? depth - published : published - depth;
+  double const sinceMsec = 1000.*static_cast<double>(now - m_queueDepthLastUpdate);
+  if (delta < m_readoutSettings.bag.queueDepthThreshold.value_ &&
+      sinceMsec < m_readoutSettings.bag.queueDepthUpdateMsec.value_)
+    return;
+
+  m_queueDepth = depth;
+  m_queueDepthLastUpdate = now;
+  p_appInfoSpace->fireItemValueChanged("QueueDepth");
+}
+
+std::shared_ptr<gem::readout::GEMReadoutBuffer> gem::readout::GEMReadoutApplication::allocateReadoutBuffer(size_t const defaultSize)
+{
+  size_t size = m_readoutSettings.bag.bufferSize.value_;
+  if (size == 0)
+    size = defaultSize;
+  return std::make_shared<GEMReadoutBuffer>(m_gemLogger, size,
+                                            m_readoutSettings.bag.numaNode.value_,
+                                            m_readoutSettings.bag.hugePages.toString());
+}
+
+void gem::readout::GEMReadoutApplication::configureDrainController(uint32_t const blockSize,
+                                                                   uint32_t const defaultDepth,
+                                                                   uint32_t const maxBatch)
+{
+  uint32_t const depth = m_readoutSettings.bag.fifoDepth.value_;
+  m_drainController.configure(blockSize,
+                              depth ? depth : defaultDepth,
+                              m_readoutSettings.bag.drainTargetFill.value_,
+                              maxBatch ? maxBatch :
+                              m_readoutSettings.bag.drainMaxPackets.value_*GEMDrainController::IPBUS_MAX_PAYLOAD_WORDS);
+}
+
+gem::readout::GEMCompressedWriter* gem::readout::GEMReadoutApplication::outputWriter(std::string const& fileName)
+{
+  int const codec = GEMCompressedWriter::parseCodec(m_readoutSettings.bag.compression.toString());
+  if (codec == GEMCompressedWriter::Codecs::NONE) {
+    closeOutputWriter();
+    return NULL;
+  }
+
+  std::string const outName = fileName + GEMCompressedWriter::extension(codec);
+  if (p_outWriter && p_outWriter->isOpen() && p_outWriter->codec() == codec && p_outWriter->fileName() == outName)
+    return p_outWriter.get();
+
+  closeOutputWriter();
+  p_outWriter = std::make_shared<GEMCompressedWriter>(m_gemLogger,
+                                                      m_readoutSettings.bag.compression.toString(),
+                                                      m_readoutSettings.bag.compressionBlockSize.value_,
+                                                      m_readoutSettings.bag.compressionLevel.value_);
+  p_outWriter->open(outName);
+  return p_outWriter.get();
+}
+
+void gem::readout::GEMReadoutApplication::closeOutputWriter()
+{
+  if (!p_outWriter)
+    return;
+  std::shared_ptr<GEMCompressedWriter> writer;
+  writer.swap(p_outWriter);
+  try {
+    writer->close();
+  } catch (gem::readout::exception::OutputProblem const& e) {
+    CMSGEMOS_ERROR("GEMReadoutApplication::closeOutputWriter " << e.what());
+  }
+}
+
+bool gem::readout::GEMReadoutApplication::poolThrottled()
+{
+  if (!m_pool)
+    return false;
+
+  // hysteresis between the two watermarks so the readout does not flap at the limit
+  if (m_poolThrottled && !m_pool->isLowThresholdExceeded()) {
+    CMSGEMOS_DEBUG("GEMReadoutApplication::poolThrottled frame pool below low watermark, resuming");
+    m_poolThrottled = false;
+  } else if (!m_poolThrottled && m_pool->isHighThresholdExceeded()) {
+    CMSGEMOS_DEBUG("GEMReadoutApplication::poolThrottled frame pool above high watermark, throttling");
+    m_poolThrottled = true;
+  }
+
+  if (m_poolThrottled)
+    m_poolExhaustedCount.fetch_add(1, std::memory_order_relaxed);
+  return m_poolThrottled;
+}
+
+toolbox::mem::Reference* gem::readout::GEMReadoutApplication::allocateFrame(size_t const size)
+{
+  if (!m_pool)
+    return NULL;
+
+  try {
+    toolbox::mem::Reference* frame = toolbox::mem::getMemoryPoolFactory()->getFrame(m_pool, size);
+    frame->setDataSize(size);
+    return frame;
+  } catch (toolbox::mem::exception::Exception const& e) {
+    CMSGEMOS_DEBUG("GEMReadoutApplication::allocateFrame unable to get a frame of " << size
+                   << " bytes: " << e.what());
+    m_poolExhaustedCount.fetch_add(1, std::memory_order_relaxed);
+    return NULL;
+  }
+}
+
+toolbox::mem::Reference* gem::readout::GEMReadoutApplication::allocateEventFrame(size_t const size)
+{
+  // rounded to the 32-bit words of the I2O message size
+  return allocateFrame((eventOffset() + size + 3) & ~size_t(3));
+}
+
+size_t gem::readout::GEMReadoutApplication::eventOffset()
+{
+  return sizeof(I2O_GEM_READOUT_NOTIFY_MESSAGE_FRAME);
+}
+
+void gem::readout::GEMReadoutApplication::configureStream()
+{
+  p_streamDestination = NULL;
+  std::string const streamClass = m_readoutSettings.bag.streamClass.toString();
+  if (streamClass.empty())
+    return;
+
+  uint32_t const instance = m_readoutSettings.bag.streamInstance.value_;
+  try {
+    p_streamDestination = getApplicationContext()->getDefaultZone()->getApplicationDescriptor(streamClass, instance);
+  } catch (xcept::Exception& e) {
+    std::string msg = toolbox::toString("Unable to find readout stream consumer %s:%d",
+                                        streamClass.c_str(), instance);
+    CMSGEMOS_ERROR(msg);
+    XCEPT_RETHROW(gem::readout::exception::ConfigurationProblem, msg, e);
+  }
+  CMSGEMOS_INFO("GEMReadoutApplication::configureStream streaming to " << streamClass << ":" << instance
+                << " with " << m_readoutSettings.bag.streamCredits.toString() << " credits");
+}
+
+bool gem::readout::GEMReadoutApplication::streamThrottled()
+{
+  if (!isStreaming() || m_streamCreditCount.load(std::memory_order_acquire) > 0)
+    return false;
+  m_streamStallCount.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool gem::readout::GEMReadoutApplication::streamData(char const* data, size_t const size, uint32_t const nEvents)
+{
+  if (!isStreaming())
+    return false;
+
+  toolbox::mem::Reference* ref = allocateEventFrame(size);
+  if (!ref) {
+    streamDropped("the frame pool is exhausted");
+    return false;
+  }
+  std::memcpy(static_cast<char*>(ref->getDataLocation()) + eventOffset(), data, size);
+  bool const posted = streamFrame(ref, size, nEvents);
+  ref->release();
+  return posted;
+}
+
+bool gem::readout::GEMReadoutApplication::streamFrame(toolbox::mem::Reference* ref, size_t const size,
+                                                      uint32_t const nEvents)
+{
+  if (!isStreaming())
+    return false;
+
+  // I2O message sizes are counted in 32-bit words, in a 16-bit field
+  size_t const frameSize = (eventOffset() + size + 3) & ~size_t(3);
+  if ((frameSize >> 2) > 0xffff) {
+    streamDropped(toolbox::toString("%lu bytes do not fit in one I2O frame", size));
+    return false;
+  }
+
+  // take the credit before posting, a confirm may arrive as soon as the frame is out
+  int32_t credits = m_streamCreditCount.load(std::memory_order_acquire);
+  do {
+    if (credits <= 0) {
+      streamDropped("no credits left");
+      return false;
+    }
+  } while (!m_streamCreditCount.compare_exchange_weak(credits, credits - 1, std::memory_order_acq_rel));
+
+  PI2O_GEM_READOUT_NOTIFY_MESSAGE_FRAME frame = (PI2O_GEM_READOUT_NOTIFY_MESSAGE_FRAME)ref->getDataLocation();
+  std::memset(frame, 0, sizeof(I2O_GEM_READOUT_NOTIFY_MESSAGE_FRAME));
+  frame->PvtMessageFrame.StdMessageFrame.MsgFlags         = 0;
+  frame->PvtMessageFrame.StdMessageFrame.VersionOffset    = 0;
+  frame->PvtMessageFrame.StdMessageFrame.TargetAddress    = i2o::utils::getAddressMap()->getTid(p_streamDestination);
+  frame->PvtMessageFrame.StdMessageFrame.InitiatorAddress = i2o::utils::getAddressMap()->getTid(getApplicationDescriptor());
+  frame->PvtMessageFrame.StdMessageFrame.MessageSize      = frameSize >> 2;
+  frame->PvtMessageFrame.StdMessageFrame.Function         = I2O_PRIVATE_MESSAGE;
+  frame->PvtMessageFrame.OrganizationID = XDAQ_ORGANIZATION_ID;
+  frame->PvtMessageFrame.XFunctionCode  = I2O_READOUT_NOTIFY;
+  frame->runNumber = m_runNumber.value_;
+  frame->sequence  = m_streamSequence;
+  frame->nEvents   = nEvents;
+  frame->dataSize  = size;
+
+  // the consumer releases its own reference, the events stay readable for the output writer
+  toolbox::mem::Reference* posted = ref->duplicate();
+  try {
+    getApplicationContext()->postFrame(posted, getApplicationDescriptor(), p_streamDestination);
+  } catch (xcept::Exception& e) {
+    // the frame was not handed over, it is still ours, and so is the credit
+    posted->release();
+    returnStreamCredits(1);
+    streamDropped(toolbox::toString("failed to post frame %u: %s", m_streamSequence, e.what()));
+    return false;
+  }
+
+  m_streamFrameCount.fetch_add(1, std::memory_order_relaxed);
+  ++m_streamSequence;
+  return true;
+}
+
+void gem::readout::GEMReadoutApplication::streamDropped(std::string const& reason)
+{
+  uint64_t const dropped = m_streamDropCount.fetch_add(1, std::memory_order_relaxed) + 1;
+  CMSGEMOS_ERROR("GEMReadoutApplication::streamData events not streamed, " << reason
+                 << ", " << dropped << " frames dropped in this run");
+}
+
+void gem::readout::GEMReadoutApplication::returnStreamCredits(int32_t const credits)
+{
+  // never grow the window beyond the configured credits, e.g., for confirms of a previous run
+  int32_t const maxCredits = m_readoutSettings.bag.streamCredits.value_;
+  int32_t current = m_streamCreditCount.load(std::memory_order_relaxed);
+  int32_t updated;
+  do {
+    updated = std::min(maxCredits, current + credits);
+  } while (!m_streamCreditCount.compare_exchange_weak(current, updated, std::memory_order_acq_rel));
+}
+
+void gem::readout::GEMReadoutApplication::onReadoutConfirm(toolbox::mem::Reference* ref)
+  throw (i2o::exception::Exception)
+{
+  PI2O_GEM_READOUT_CONFIRM_MESSAGE_FRAME frame = (PI2O_GEM_READOUT_CONFIRM_MESSAGE_FRAME)ref->getDataLocation();
+  int32_t const credits = frame->credits;
+  CMSGEMOS_TRACE("GEMReadoutApplication::onReadoutConfirm " << credits << " credits, consumer at sequence "
+                 << frame->sequence);
+  ref->release();
+
+  returnStreamCredits(credits);
+}
+
+void gem::readout::GEMReadoutApplication::pushCommand(int const cmd)
+{
+  m_cmdQueue.push(cmd);
+  // take the mutex so the notification cannot fall between the predicate check and the wait
+  std::lock_guard<std::mutex> guard(m_cmdMutex);
+  m_cmdCondition.notify_all();
+}
+
 int gem::readout::GEMReadoutApplication::readoutTask()
 {
+  typedef std::chrono::steady_clock clock;
+
   bool isRunning(false), isDone(false);
   int nevtsRead(0);
   // may at some point want to actually pass the memory
   std::vector<toolbox::mem::Reference* > data;
 
+  // pin before the readout allocates anything, so that buffers land on the local NUMA node
+  GEMReadoutResources::pinCurrentThread(m_gemLogger,
+                                        GEMReadoutResources::parseCPUList(m_readoutSettings.bag.readoutCPUs.toString()));
+
+  // adaptive poll policy: spin while data is flowing, back off exponentially when empty
+  uint32_t nEmpty(0);
+  uint32_t sleepUsec(0);
+
   while (!isDone) {
     if (!isRunning || m_cmdQueue.size() > 0) {
+      clock::time_point idleStart = clock::now();
+      m_pollState = PollStates::IDLE;
       int cmd = m_cmdQueue.pop();
+      if (!isRunning)
+        m_usecIdle.value_ += std::chrono::duration_cast<std::chrono::microseconds>(clock::now()-idleStart).count();
       switch(cmd) {
       case(ReadoutCommands::CMD_PAUSE) :
         isRunning = false;
         break;
       case(ReadoutCommands::CMD_STOP) :
         isRunning = false;
+        closeOutputWriter();
         break;
       case(ReadoutCommands::CMD_START) :
         isRunning = true;
@@ -269,14 +726,18 @@ int gem::readout::GEMReadoutApplication::readoutTask()
       case(ReadoutCommands::CMD_EXIT) :
         isDone    = true;
         isRunning = false;
+        closeOutputWriter();
         break;
       }
+      nEmpty    = 0;
+      sleepUsec = 0;
     }
 
     if (isRunning) {
       data.clear();
       struct timeval start,stop;
 
+      clock::time_point pollStart = clock::now();
       gettimeofday(&start,0);
       nevtsRead = 0;
       try {
@@ -303,20 +764,42 @@ int gem::readout::GEMReadoutApplication::readoutTask()
       }
 
       CMSGEMOS_DEBUG("GEMReadoutApplication::readoutTask read " << nevtsRead << " events");
-      /*
-      for (int i = 0; i < nevtsRead; i++) {
-        CMSGEMOS_DEBUG("GEMReadoutApplication::readoutTask releaseing data[" << i << "]");
-        data[i]->release();
-      }
-      */
+      // return the frames to the pool, consumers hold their own references
+      for (auto frame = data.begin(); frame != data.end(); ++frame)
+        (*frame)->release();
+      data.clear();
       if (nevtsRead > 0) {
         gettimeofday(&stop,0);
         m_eventsReadout.value_ = m_eventsReadout.value_ + nevtsRead;
         double deltaU=(stop.tv_sec-start.tv_sec)*1e6+(stop.tv_usec-start.tv_usec);
         m_usecUsed += deltaU;
         m_usecPerEvent.value_ = m_usecUsed/(m_eventsReadout.value_);
+
+        m_pollState = PollStates::BUSY;
+        m_usecBusy.value_ += std::chrono::duration_cast<std::chrono::microseconds>(clock::now()-pollStart).count();
+        nEmpty    = 0;
+        sleepUsec = 0;
+      } else if (nEmpty < m_readoutSettings.bag.pollSpinCount.value_) {
+        ++nEmpty;
+        m_pollState = PollStates::SPIN;
+        std::this_thread::yield();
+        m_usecSpin.value_ += std::chrono::duration_cast<std::chrono::microseconds>(clock::now()-pollStart).count();
+      } else {
+        // exponential backoff, capped, interrupted as soon as a command is queued
+        uint32_t const minSleep = std::max(1u, static_cast<uint32_t>(m_readoutSettings.bag.pollMinSleepUsec.value_));
+        uint32_t const maxSleep = std::max(minSleep, static_cast<uint32_t>(m_readoutSettings.bag.pollMaxSleepUsec.value_));
+        sleepUsec = (sleepUsec == 0) ? minSleep : std::min(2*sleepUsec, maxSleep);
+        m_pollState     = PollStates::BACKOFF;
+        m_pollSleepUsec = sleepUsec;
+        {
+          std::unique_lock<std::mutex> guard(m_cmdMutex);
+          m_cmdCondition.wait_for(guard, std::chrono::microseconds(sleepUsec),
+                                  [this]{ return m_cmdQueue.size() > 0; });
+        }
+        m_usecBackoff.value_ += std::chrono::duration_cast<std::chrono::microseconds>(clock::now()-pollStart).count();
       }
     }
   }
+  m_pollState = PollStates::IDLE;
   return 0;
 }
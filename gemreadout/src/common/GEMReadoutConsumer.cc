@@ -0,0 +1,178 @@
+/**
+ * class: GEMReadoutConsumer
+ * description: Receiver of the I2O event stream sent by the readout applications,
+ *              returning credits to throttle the producers
+ */
+
+#include "gem/readout/GEMReadoutConsumer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "toolbox/mem/MemoryPoolFactory.h"
+#include "toolbox/mem/CommittedHeapAllocator.h"
+#include "toolbox/net/URN.h"
+
+#include "i2o/Method.h"
+#include "i2o/utils/AddressMap.h"
+#include "interface/shared/i2oXFunctionCodes.h"
+
+#include "gem/base/GEMWebApplication.h"
+#include "gem/readout/GEMReadoutApplication.h"
+#include "gem/readout/GEMReadoutI2O.h"
+#include "gem/readout/GEMCompressedWriter.h"
+#include "gem/readout/exception/Exception.h"
+
+XDAQ_INSTANTIATOR_IMPL(gem::readout::GEMReadoutConsumer);
+
+gem::readout::GEMReadoutConsumer::GEMReadoutConsumer(xdaq::ApplicationStub* stub)
+  throw (xdaq::exception::Exception) :
+  gem::base::GEMApplication(stub),
+  m_outputLocation(""),
+  m_compression("none"),
+  m_creditBatch(4),
+  m_framesReceived(0),
+  m_eventsReceived(0),
+  m_bytesReceived(0),
+  m_sequenceErrors(0),
+  m_pool(NULL)
+{
+  CMSGEMOS_DEBUG("GEMReadoutConsumer ctor begin");
+  p_appInfoSpace->fireItemAvailable("OutputLocation", &m_outputLocation);
+  p_appInfoSpace->fireItemAvailable("Compression",    &m_compression);
+  p_appInfoSpace->fireItemAvailable("CreditBatch",    &m_creditBatch);
+  p_appInfoSpace->fireItemAvailable("FramesReceived", &m_framesReceived);
+  p_appInfoSpace->fireItemAvailable("EventsReceived", &m_eventsReceived);
+  p_appInfoSpace->fireItemAvailable("BytesReceived",  &m_bytesReceived);
+  p_appInfoSpace->fireItemAvailable("SequenceErrors", &m_sequenceErrors);
+
+  i2o::bind(this,&GEMReadoutConsumer::onReadoutNotify,GEMReadoutApplication::I2O_READOUT_NOTIFY,XDAQ_ORGANIZATION_ID);
+
+  char poolname[128];
+  snprintf(poolname,128,"GEMReadoutConsumerPool-%d",(int)getApplicationDescriptor()->getInstance());
+  try {
+    // only small confirm frames come from this pool
+    toolbox::mem::CommittedHeapAllocator* alloc = new toolbox::mem::CommittedHeapAllocator(1024*1024);
+    toolbox::net::URN urn("toolbox-mem-pool",poolname);
+    m_pool = toolbox::mem::getMemoryPoolFactory()->createPool(urn,alloc);
+  } catch (xcept::Exception& e) {
+    XCEPT_RETHROW(xdaq::exception::Exception,"Unable to create consumer memory pool",e);
+  }
+
+  p_gemWebInterface = new gem::base::GEMWebApplication(this);
+  CMSGEMOS_DEBUG("GEMReadoutConsumer ctor end");
+}
+
+gem::readout::GEMReadoutConsumer::~GEMReadoutConsumer()
+{
+  // writers flush and close on destruction
+  m_producers.clear();
+}
+
+void gem::readout::GEMReadoutConsumer::actionPerformed(xdata::Event& event)
+{
+  if (event.type() == "setDefaultValues" || event.type() == "urn:xdaq-event:setDefaultValues") {
+    CMSGEMOS_DEBUG("GEMReadoutConsumer::actionPerformed() setDefaultValues"
+                   << " OutputLocation:" << m_outputLocation.toString()
+                   << " Compression:"    << m_compression.toString()
+                   << " CreditBatch:"    << m_creditBatch.toString());
+  }
+  gem::base::GEMApplication::actionPerformed(event);
+}
+
+void gem::readout::GEMReadoutConsumer::onReadoutNotify(toolbox::mem::Reference* ref)
+  throw (i2o::exception::Exception)
+{
+  PI2O_GEM_READOUT_NOTIFY_MESSAGE_FRAME frame = (PI2O_GEM_READOUT_NOTIFY_MESSAGE_FRAME)ref->getDataLocation();
+  I2O_TID const producer = frame->PvtMessageFrame.StdMessageFrame.InitiatorAddress;
+  uint32_t const runNumber = frame->runNumber;
+  uint32_t const sequence  = frame->sequence;
+
+  ProducerState& state = m_producers[producer];
+  // a producer restarts its sequence at every start
+  if (sequence == 0) {
+    state.nextSequence   = 0;
+    state.pendingCredits = 0;
+  }
+  if (sequence != state.nextSequence) {
+    CMSGEMOS_WARN("GEMReadoutConsumer::onReadoutNotify producer " << producer << " sent sequence "
+                  << sequence << ", expected " << state.nextSequence);
+    m_sequenceErrors = m_sequenceErrors.value_ + 1;
+  }
+  state.nextSequence = sequence + 1;
+
+  m_framesReceived = m_framesReceived.value_ + 1;
+  m_eventsReceived = m_eventsReceived.value_ + frame->nEvents;
+  m_bytesReceived  = m_bytesReceived.value_  + frame->dataSize;
+
+  try {
+    GEMCompressedWriter* writer = getWriter(producer, runNumber);
+    if (writer)
+      writer->write(reinterpret_cast<char const*>(frame) + sizeof(I2O_GEM_READOUT_NOTIFY_MESSAGE_FRAME),
+                    frame->dataSize);
+  } catch (gem::readout::exception::Exception const& e) {
+    // keep returning credits, a stalled producer would hide the problem in the readout
+    CMSGEMOS_ERROR("GEMReadoutConsumer::onReadoutNotify unable to write data of producer "
+                   << producer << ": " << e.what());
+  }
+  ref->release();
+
+  // the credit goes back only now that the data has left the frame
+  if (++state.pendingCredits >= std::max(1u, static_cast<uint32_t>(m_creditBatch.value_))) {
+    sendCredits(producer, state.pendingCredits, sequence);
+    state.pendingCredits = 0;
+  }
+}
+
+void gem::readout::GEMReadoutConsumer::sendCredits(I2O_TID const producer, uint32_t const credits,
+                                                   uint32_t const sequence)
+{
+  toolbox::mem::Reference* ref = NULL;
+  try {
+    xdaq::ApplicationDescriptor* destination = i2o::utils::getAddressMap()->getApplicationDescriptor(producer);
+    ref = toolbox::mem::getMemoryPoolFactory()->getFrame(m_pool, sizeof(I2O_GEM_READOUT_CONFIRM_MESSAGE_FRAME));
+    ref->setDataSize(sizeof(I2O_GEM_READOUT_CONFIRM_MESSAGE_FRAME));
+
+    PI2O_GEM_READOUT_CONFIRM_MESSAGE_FRAME frame = (PI2O_GEM_READOUT_CONFIRM_MESSAGE_FRAME)ref->getDataLocation();
+    std::memset(frame, 0, sizeof(I2O_GEM_READOUT_CONFIRM_MESSAGE_FRAME));
+    frame->PvtMessageFrame.StdMessageFrame.MsgFlags         = 0;
+    frame->PvtMessageFrame.StdMessageFrame.VersionOffset    = 0;
+    frame->PvtMessageFrame.StdMessageFrame.TargetAddress    = producer;
+    frame->PvtMessageFrame.StdMessageFrame.InitiatorAddress = i2o::utils::getAddressMap()->getTid(getApplicationDescriptor());
+    frame->PvtMessageFrame.StdMessageFrame.MessageSize      = sizeof(I2O_GEM_READOUT_CONFIRM_MESSAGE_FRAME) >> 2;
+    frame->PvtMessageFrame.StdMessageFrame.Function         = I2O_PRIVATE_MESSAGE;
+    frame->PvtMessageFrame.OrganizationID = XDAQ_ORGANIZATION_ID;
+    frame->PvtMessageFrame.XFunctionCode  = GEMReadoutApplication::I2O_READOUT_CONFIRM;
+    frame->credits  = credits;
+    frame->sequence = sequence;
+
+    getApplicationContext()->postFrame(ref, getApplicationDescriptor(), destination);
+  } catch (xcept::Exception& e) {
+    if (ref)
+      ref->release();
+    CMSGEMOS_ERROR("GEMReadoutConsumer::sendCredits unable to return " << credits
+                   << " credits to producer " << producer << ": " << e.what());
+  }
+}
+
+gem::readout::GEMCompressedWriter* gem::readout::GEMReadoutConsumer::getWriter(I2O_TID const producer,
+                                                                               uint32_t const runNumber)
+{
+  if (m_outputLocation.toString().empty())
+    return NULL;
+
+  ProducerState& state = m_producers[producer];
+  if (state.writer && state.runNumber == runNumber)
+    return state.writer.get();
+
+  // "none" gives an unframed raw file, written on the writer thread all the same
+  state.writer.reset();
+  std::shared_ptr<GEMCompressedWriter> writer = std::make_shared<GEMCompressedWriter>(m_gemLogger,
+                                                                                      m_compression.toString());
+  std::string fileName = toolbox::toString("%s/run%06d_stream_tid%d.dat",
+                                           m_outputLocation.toString().c_str(), runNumber, producer);
+  writer->open(fileName + GEMCompressedWriter::extension(writer->codec()));
+  state.runNumber = runNumber;
+  state.writer    = writer;
+  return state.writer.get();
+}
@@ -0,0 +1,207 @@
+/**
+ * class: GEMReadoutResources
+ * description: CPU affinity and NUMA/huge page aware buffers for the readout threads
+ */
+
+#include "gem/readout/GEMReadoutResources.h"
+
+#include <algorithm>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <new>
+
+#include <climits>
+#include <fstream>
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "toolbox/string.h"
+
+#include "gem/readout/exception/Exception.h"
+
+namespace {
+  size_t const HUGE_PAGE_SIZE = 2*1024*1024;
+
+  size_t roundUp(size_t const size, size_t const page)
+  {
+    return ((size + page - 1)/page)*page;
+  }
+}
+
+std::vector<int> gem::readout::GEMReadoutResources::parseCPUList(std::string const& cpus)
+{
+  std::vector<int> cpuList;
+  std::stringstream ss(cpus);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty())
+      continue;
+    size_t dash = range.find('-');
+    try {
+      if (dash == std::string::npos) {
+        cpuList.push_back(std::stoi(range));
+      } else {
+        int first = std::stoi(range.substr(0, dash));
+        int last  = std::stoi(range.substr(dash+1));
+        for (int cpu = first; cpu <= last; ++cpu)
+          cpuList.push_back(cpu);
+      }
+    } catch (std::exception const&) {
+      // ignore malformed entries, the caller reports an empty result
+    }
+  }
+  return cpuList;
+}
+
+bool gem::readout::GEMReadoutResources::pinCurrentThread(log4cplus::Logger& logger, std::vector<int> const& cpus)
+{
+  if (cpus.empty())
+    return false;
+
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (auto cpu = cpus.begin(); cpu != cpus.end(); ++cpu)
+    if (*cpu >= 0 && *cpu < CPU_SETSIZE)
+      CPU_SET(*cpu, &cpuset);
+
+  int res = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+  if (res != 0) {
+    WARN_LOGGER(logger, "GEMReadoutResources::pinCurrentThread unable to set affinity: " << std::strerror(res));
+    return false;
+  }
+  INFO_LOGGER(logger, "GEMReadoutResources::pinCurrentThread pinned to " << cpus.size()
+              << " CPU(s), now on CPU " << sched_getcpu() << " NUMA node " << currentNUMANode());
+  return true;
+}
+
+int gem::readout::GEMReadoutResources::currentNUMANode()
+{
+  int cpu = sched_getcpu();
+  if (cpu < 0)
+    return -1;
+
+  std::string cpuDir = toolbox::toString("/sys/devices/system/cpu/cpu%d", cpu);
+  DIR* dir = opendir(cpuDir.c_str());
+  if (!dir)
+    return -1;
+
+  int node = -1;
+  while (struct dirent* entry = readdir(dir)) {
+    if (std::strncmp(entry->d_name, "node", 4) == 0) {
+      node = std::atoi(entry->d_name+4);
+      break;
+    }
+  }
+  closedir(dir);
+  return node;
+}
+
+int gem::readout::GEMReadoutResources::maxNUMANode()
+{
+  // same as numa_max_node(), e.g., "0-1" or "0"
+  std::ifstream possible("/sys/devices/system/node/possible");
+  std::string nodes;
+  if (!(possible >> nodes))
+    return -1;
+  std::vector<int> const nodeList = parseCPUList(nodes);
+  if (nodeList.empty())
+    return -1;
+  return *std::max_element(nodeList.begin(), nodeList.end());
+}
+
+int gem::readout::GEMReadoutBuffer::parseHugePages(std::string const& hugePages)
+{
+  if (hugePages == "transparent")
+    return HugePages::TRANSPARENT;
+  else if (hugePages == "explicit")
+    return HugePages::EXPLICIT;
+  return HugePages::NONE;
+}
+
+void gem::readout::GEMReadoutBuffer::checkSettings(int const numaNode, std::string const& hugePages)
+{
+  if (numaNode >= 0) {
+    int const maxNode = GEMReadoutResources::maxNUMANode();
+    if (numaNode >= static_cast<int>(sizeof(unsigned long)*CHAR_BIT) || (maxNode >= 0 && numaNode > maxNode)) {
+      std::string msg = toolbox::toString("GEMReadoutBuffer NUMA node %d out of range, the highest node is %d",
+                                          numaNode, maxNode);
+      XCEPT_RAISE(gem::readout::exception::ConfigurationProblem, msg);
+    }
+  }
+  if (hugePages != "none" && hugePages != "transparent" && hugePages != "explicit") {
+    std::string msg = toolbox::toString("GEMReadoutBuffer unknown hugePages '%s', expected none, transparent or explicit",
+                                        hugePages.c_str());
+    XCEPT_RAISE(gem::readout::exception::ConfigurationProblem, msg);
+  }
+}
+
+gem::readout::GEMReadoutBuffer::GEMReadoutBuffer(log4cplus::Logger& logger, size_t const size,
+                                                 int const numaNode, std::string const& hugePages) :
+  m_gemLogger(logger),
+  p_data(NULL),
+  m_size(0),
+  m_hugePages(parseHugePages(hugePages))
+{
+  try {
+    checkSettings(numaNode, hugePages);
+  } catch (gem::readout::exception::ConfigurationProblem const& e) {
+    CMSGEMOS_ERROR(e.what());
+    throw;
+  }
+
+  void* mem = MAP_FAILED;
+  if (m_hugePages == HugePages::EXPLICIT) {
+    m_size = roundUp(size, HUGE_PAGE_SIZE);
+    mem = mmap(NULL, m_size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+    if (mem == MAP_FAILED) {
+      CMSGEMOS_WARN("GEMReadoutBuffer unable to map " << m_size << " bytes of explicit huge pages ("
+                    << std::strerror(errno) << "), falling back to transparent huge pages");
+      m_hugePages = HugePages::TRANSPARENT;
+    }
+  }
+
+  if (mem == MAP_FAILED) {
+    size_t const page = (m_hugePages == HugePages::TRANSPARENT) ? HUGE_PAGE_SIZE : sysconf(_SC_PAGESIZE);
+    m_size = roundUp(size, page);
+    mem = mmap(NULL, m_size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+      std::string msg = toolbox::toString("GEMReadoutBuffer unable to map %lu bytes: %s",
+                                          m_size, std::strerror(errno));
+      CMSGEMOS_ERROR(msg);
+      throw std::bad_alloc();
+    }
+    if (m_hugePages == HugePages::TRANSPARENT && madvise(mem, m_size, MADV_HUGEPAGE) != 0)
+      CMSGEMOS_WARN("GEMReadoutBuffer madvise(MADV_HUGEPAGE) failed: " << std::strerror(errno));
+  }
+
+  if (numaNode >= 0) {
+    unsigned long nodemask = 1UL << numaNode;
+    if (syscall(SYS_mbind, mem, m_size, MPOL_BIND, &nodemask, sizeof(nodemask)*8, 0) != 0)
+      CMSGEMOS_WARN("GEMReadoutBuffer unable to bind buffer to NUMA node " << numaNode
+                    << ": " << std::strerror(errno));
+  }
+
+  // fault the pages in now, from the calling thread, so first touch places them and
+  // the readout does not take page faults later
+  std::memset(mem, 0, m_size);
+  p_data = static_cast<char*>(mem);
+
+  CMSGEMOS_INFO("GEMReadoutBuffer allocated " << m_size << " bytes"
+                << " hugePages " << m_hugePages
+                << " NUMA node " << (numaNode >= 0 ? numaNode : GEMReadoutResources::currentNUMANode()));
+}
+
+gem::readout::GEMReadoutBuffer::~GEMReadoutBuffer()
+{
+  if (p_data)
+    munmap(p_data, m_size);
+  p_data = NULL;
+}
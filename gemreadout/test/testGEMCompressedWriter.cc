@@ -0,0 +1,150 @@
+#include "gem/readout/GEMCompressedWriter.h"
+#include "gem/readout/exception/Exception.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE GEMCompressedWriter
+#include <boost/test/unit_test.hpp>
+
+/* Needed to make the linker happy. */
+#include <xdaq/version.h>
+config::PackageInfo xdaq::getPackageInfo()
+{
+  return config::PackageInfo("", "", "", "", "", "", "", "");
+}
+
+using gem::readout::GEMCompressedWriter;
+
+namespace {
+  size_t const BLOCK_SIZE = 4096;
+
+  /**
+   * events of varying sizes, compressible like the real data, spanning several blocks
+   */
+  std::vector<std::vector<char> > makeEvents()
+  {
+    std::vector<std::vector<char> > events;
+    for (unsigned evt = 0; evt < 50; ++evt) {
+      std::vector<char> event(8*(16 + (evt*37)%200));
+      for (size_t i = 0; i < event.size(); ++i)
+        event[i] = static_cast<char>((i%8 == 0) ? evt : (i*7)%13);
+      events.push_back(event);
+    }
+    return events;
+  }
+
+  std::string writeFile(std::string const& codec, std::vector<std::vector<char> > const& events)
+  {
+    log4cplus::Logger logger = log4cplus::Logger::getInstance("testGEMCompressedWriter");
+    int const codecID = GEMCompressedWriter::parseCodec(codec);
+    std::stringstream fileName;
+    fileName << "/tmp/testGEMCompressedWriter_" << getpid() << ".dat" << GEMCompressedWriter::extension(codecID);
+    // the writer appends to the file
+    std::remove(fileName.str().c_str());
+
+    GEMCompressedWriter writer(logger, codec, BLOCK_SIZE);
+    writer.open(fileName.str());
+    BOOST_CHECK(writer.isOpen());
+    BOOST_CHECK_EQUAL(writer.codec(), codecID);
+    for (auto event = events.begin(); event != events.end(); ++event)
+      writer.write(event->data(), event->size());
+    writer.close();
+    BOOST_CHECK(!writer.isOpen());
+    return fileName.str();
+  }
+
+  void checkRoundTrip(std::string const& codec)
+  {
+    std::vector<std::vector<char> > const events = makeEvents();
+    std::vector<char> expected;
+    for (auto event = events.begin(); event != events.end(); ++event)
+      expected.insert(expected.end(), event->begin(), event->end());
+
+    std::string const fileName = writeFile(codec, events);
+    std::ifstream in(fileName.c_str(), std::ios::binary);
+    BOOST_REQUIRE(in.good());
+
+    std::vector<char> data, raw;
+    unsigned nFrames = 0;
+    while (GEMCompressedWriter::readFrame(in, raw)) {
+      // blocks hold whole events and are closed once they reach the block size
+      BOOST_CHECK_LE(raw.size(), BLOCK_SIZE + events.back().size());
+      data.insert(data.end(), raw.begin(), raw.end());
+      ++nFrames;
+    }
+    in.close();
+    std::remove(fileName.c_str());
+
+    BOOST_CHECK_GT(nFrames, 1U);
+    BOOST_CHECK_EQUAL(data.size(), expected.size());
+    BOOST_CHECK(data == expected);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(CompressedWriter)
+
+BOOST_AUTO_TEST_CASE(ParseCodec)
+{
+  BOOST_CHECK_EQUAL(GEMCompressedWriter::parseCodec("none"), GEMCompressedWriter::Codecs::NONE);
+  BOOST_CHECK_EQUAL(GEMCompressedWriter::parseCodec("zlib"), GEMCompressedWriter::Codecs::ZLIB);
+  BOOST_CHECK_EQUAL(GEMCompressedWriter::parseCodec("bogus"), GEMCompressedWriter::Codecs::NONE);
+  BOOST_CHECK(GEMCompressedWriter::isAvailable(GEMCompressedWriter::Codecs::ZLIB));
+  BOOST_CHECK(GEMCompressedWriter::extension(GEMCompressedWriter::Codecs::NONE).empty());
+}
+
+BOOST_AUTO_TEST_CASE(Uncompressed)
+{
+  std::vector<std::vector<char> > const events = makeEvents();
+  std::string const fileName = writeFile("none", events);
+
+  // the file is the same as the data written directly
+  std::ifstream in(fileName.c_str(), std::ios::binary);
+  std::vector<char> const data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+  std::remove(fileName.c_str());
+
+  std::vector<char> expected;
+  for (auto event = events.begin(); event != events.end(); ++event)
+    expected.insert(expected.end(), event->begin(), event->end());
+  BOOST_CHECK(data == expected);
+}
+
+BOOST_AUTO_TEST_CASE(ZLIB)
+{
+  checkRoundTrip("zlib");
+}
+
+#ifdef GEM_READOUT_USE_ZSTD
+BOOST_AUTO_TEST_CASE(ZSTD)
+{
+  checkRoundTrip("zstd");
+}
+#endif
+
+#ifdef GEM_READOUT_USE_LZ4
+BOOST_AUTO_TEST_CASE(LZ4)
+{
+  checkRoundTrip("lz4");
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(CorruptFrame)
+{
+  std::istringstream in(std::string(sizeof(GEMCompressedWriter::FrameHeader), 'x'));
+  std::vector<char> raw;
+  BOOST_CHECK_THROW(GEMCompressedWriter::readFrame(in, raw), gem::readout::exception::OutputProblem);
+
+  // an empty stream is the end of the file
+  std::istringstream empty("");
+  BOOST_CHECK(!GEMCompressedWriter::readFrame(empty, raw));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,120 @@
+#include "gem/readout/GEMDrainController.h"
+
+#include <chrono>
+#include <limits>
+#include <thread>
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE GEMDrainController
+#include <boost/test/unit_test.hpp>
+
+/* Needed to make the linker happy. */
+#include <xdaq/version.h>
+config::PackageInfo xdaq::getPackageInfo()
+{
+  return config::PackageInfo("", "", "", "", "", "", "", "");
+}
+
+using gem::readout::GEMDrainController;
+
+namespace {
+  /**
+   * feed the controller a read long after the previous one with many words arrived meanwhile, so
+   * that it expects a lot of words during the next read
+   */
+  void busyFIFO(GEMDrainController& drain, uint32_t const occupancy)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    drain.update(7, 1000., occupancy);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(DrainController)
+
+BOOST_AUTO_TEST_CASE(Empty)
+{
+  GEMDrainController drain;
+  BOOST_CHECK_EQUAL(drain.nextBatch(0), 0U);
+  // less than one block is left for later
+  BOOST_CHECK_EQUAL(drain.nextBatch(6), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(WholeBlocks)
+{
+  GEMDrainController drain(7, 16384, 0.5, 1000);
+  BOOST_CHECK_EQUAL(drain.maxBatch(), 994U);
+  // nothing measured yet, any block is worth a read
+  BOOST_CHECK_EQUAL(drain.nextBatch(100), 98U);
+  BOOST_CHECK_EQUAL(drain.nextBatch(5000), 994U);
+}
+
+BOOST_AUTO_TEST_CASE(IPbusPackets)
+{
+  GEMDrainController drain;
+  BOOST_CHECK_EQUAL(drain.maxBatch(), (8*GEMDrainController::IPBUS_MAX_PAYLOAD_WORDS/7)*7);
+}
+
+BOOST_AUTO_TEST_CASE(Events)
+{
+  // the AMC13 monitor buffer, in events, read all at once
+  GEMDrainController drain(1, 512, 0.5, std::numeric_limits<uint32_t>::max());
+  BOOST_CHECK_EQUAL(drain.nextBatch(1), 1U);
+  BOOST_CHECK_EQUAL(drain.nextBatch(300), 300U);
+}
+
+BOOST_AUTO_TEST_CASE(Defer)
+{
+  GEMDrainController drain(7, 16384, 0.5, 1000);
+  busyFIFO(drain, 7000);
+  BOOST_CHECK_GT(drain.arrivalRate(), 0.);
+  // a few blocks are not worth a read while thousands of words arrive during one
+  BOOST_CHECK_EQUAL(drain.nextBatch(70), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(DeferLimit)
+{
+  GEMDrainController drain(7, 16384, 0.5, 1000);
+  busyFIFO(drain, 7000);
+  uint32_t nDeferred = 0;
+  while (drain.nextBatch(70) == 0 && nDeferred < 100)
+    ++nDeferred;
+  // the reads are deferred a limited number of times only
+  BOOST_CHECK_GT(nDeferred, 0U);
+  BOOST_CHECK_LT(nDeferred, 100U);
+}
+
+BOOST_AUTO_TEST_CASE(TargetFill)
+{
+  GEMDrainController drain(7, 1400, 0.5, 1000);
+  busyFIFO(drain, 7000);
+  // above the target fill the FIFO is drained whatever the trend
+  BOOST_CHECK_EQUAL(drain.nextBatch(700), 700U);
+  BOOST_CHECK_CLOSE(drain.fillFraction(), 0.5, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(Exported)
+{
+  GEMDrainController drain(7, 1000, 0.5, 1000);
+  drain.update(70, 250., 100);
+  BOOST_CHECK_EQUAL(drain.lastBatch(), 70U);
+  BOOST_CHECK_CLOSE(drain.latencyUsec(), 250., 1e-9);
+  BOOST_CHECK_CLOSE(drain.fillFraction(), 0.1, 1e-9);
+
+  // nothing read, the latency of the last read stays
+  drain.update(0, 0., 200);
+  BOOST_CHECK_EQUAL(drain.lastBatch(), 0U);
+  BOOST_CHECK_CLOSE(drain.latencyUsec(), 250., 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(Configure)
+{
+  GEMDrainController drain(7, 16384, 0.5, 1000);
+  busyFIFO(drain, 7000);
+  drain.configure(7, 16384, 0.5, 1000);
+  // the measured trends are forgotten
+  BOOST_CHECK_EQUAL(drain.arrivalRate(), 0.);
+  BOOST_CHECK_EQUAL(drain.lastBatch(), 0U);
+  BOOST_CHECK_EQUAL(drain.nextBatch(70), 70U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,50 @@
+#include "gem/readout/GEMReadoutResources.h"
+#include "gem/readout/exception/Exception.h"
+
+#include <vector>
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE GEMReadoutResources
+#include <boost/test/unit_test.hpp>
+
+/* Needed to make the linker happy. */
+#include <xdaq/version.h>
+config::PackageInfo xdaq::getPackageInfo()
+{
+  return config::PackageInfo("", "", "", "", "", "", "", "");
+}
+
+using gem::readout::GEMReadoutBuffer;
+using gem::readout::GEMReadoutResources;
+
+BOOST_AUTO_TEST_SUITE(ReadoutResources)
+
+BOOST_AUTO_TEST_CASE(CPUList)
+{
+  std::vector<int> const cpus = GEMReadoutResources::parseCPUList("2,4-7");
+  BOOST_CHECK_EQUAL(cpus.size(), 5U);
+  BOOST_CHECK_EQUAL(cpus.front(), 2);
+  BOOST_CHECK_EQUAL(cpus.back(), 7);
+  BOOST_CHECK(GEMReadoutResources::parseCPUList("").empty());
+}
+
+BOOST_AUTO_TEST_CASE(HugePages)
+{
+  BOOST_CHECK_EQUAL(GEMReadoutBuffer::parseHugePages("none"), GEMReadoutBuffer::HugePages::NONE);
+  BOOST_CHECK_EQUAL(GEMReadoutBuffer::parseHugePages("transparent"), GEMReadoutBuffer::HugePages::TRANSPARENT);
+  BOOST_CHECK_EQUAL(GEMReadoutBuffer::parseHugePages("explicit"), GEMReadoutBuffer::HugePages::EXPLICIT);
+}
+
+BOOST_AUTO_TEST_CASE(CheckSettings)
+{
+  BOOST_CHECK_NO_THROW(GEMReadoutBuffer::checkSettings(-1, "none"));
+  BOOST_CHECK_NO_THROW(GEMReadoutBuffer::checkSettings(-1, "transparent"));
+  BOOST_CHECK_NO_THROW(GEMReadoutBuffer::checkSettings(0, "explicit"));
+
+  // a typo or a node the host does not have fails before any buffer is allocated
+  BOOST_CHECK_THROW(GEMReadoutBuffer::checkSettings(-1, "huge"), gem::readout::exception::ConfigurationProblem);
+  BOOST_CHECK_THROW(GEMReadoutBuffer::checkSettings(-1, ""), gem::readout::exception::ConfigurationProblem);
+  BOOST_CHECK_THROW(GEMReadoutBuffer::checkSettings(1024, "none"), gem::readout::exception::ConfigurationProblem);
+}
+
+BOOST_AUTO_TEST_SUITE_END()